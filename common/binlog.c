@@ -0,0 +1,284 @@
+#include "plugin_common.h"
+#include "binlog.h"
+#include <Common.h>
+#include <orbis/libkernel.h>
+
+// Records are spread over a few rings by calling thread so game threads rarely share a
+// ring; each ring is a bounded MPSC queue drained by one low priority thread.
+
+#define BINLOG_RINGS       8 // must be power of two
+#define BINLOG_RING_SIZE   128 // must be power of two
+#define BINLOG_SITES       512 // must be power of two
+#define BINLOG_FILE_BUFFER (16 * 1024)
+#define BINLOG_SEMA_MAX    0x7fffffff
+
+typedef struct {
+    u64 head __attribute__((aligned(64)));
+    u64 tail __attribute__((aligned(64)));
+    binlog_record record[BINLOG_RING_SIZE] __attribute__((aligned(64)));
+} binlog_ring;
+
+typedef struct {
+    const binlog_site *site;
+    u32 id;
+} binlog_site_entry;
+
+u32 g_BinlogLevel = BINLOG_INFO;
+
+static binlog_ring g_BinlogRings[BINLOG_RINGS];
+static u32 g_BinlogRunning = 0;
+static u32 g_BinlogDropped = 0;
+static u32 g_BinlogSinks = 0;
+static OrbisPthread g_BinlogThread;
+// The drainer sleeps on the sema. A commit only signals it when it finds g_BinlogWake
+// clear, the drainer clears it before each pass, so an idle drainer costs nothing and
+// busy rings cost one signal per pass. g_BinlogSignalers lets binlog_shutdown wait for
+// commits about to signal before it deletes the sema.
+static OrbisKernelSema g_BinlogSema;
+static u32 g_BinlogWake = 0;
+static u32 g_BinlogSignalers = 0;
+
+// Only touched by the drainer thread.
+static s32 g_BinlogFd = -1;
+static u8 g_BinlogBuffer[BINLOG_FILE_BUFFER];
+static u32 g_BinlogBufferUsed = 0;
+static binlog_site_entry g_BinlogSites[BINLOG_SITES];
+static u32 g_BinlogSiteCount = 0;
+
+static void binlog_flush(void)
+{
+    if (g_BinlogFd >= 0 && g_BinlogBufferUsed) {
+        sceKernelWrite(g_BinlogFd, g_BinlogBuffer, g_BinlogBufferUsed);
+    }
+    g_BinlogBufferUsed = 0;
+}
+
+static void binlog_write(const void *data, u32 size)
+{
+    if (g_BinlogBufferUsed + size > sizeof(g_BinlogBuffer)) {
+        binlog_flush();
+    }
+    memcpy(g_BinlogBuffer + g_BinlogBufferUsed, data, size);
+    g_BinlogBufferUsed += size;
+}
+
+// Returns the file id of a call site, writing its definition the first time it is seen.
+static u32 binlog_site_id(const binlog_site *site)
+{
+    u32 slot = (u32)(((uintptr_t)site >> 4) * 0x9e3779b1u) & (BINLOG_SITES - 1);
+    while (g_BinlogSites[slot].site) {
+        if (g_BinlogSites[slot].site == site) {
+            return g_BinlogSites[slot].id;
+        }
+        slot = (slot + 1) & (BINLOG_SITES - 1);
+    }
+
+    const u32 id = g_BinlogSiteCount++;
+    if (g_BinlogSiteCount < BINLOG_SITES / 2) {
+        g_BinlogSites[slot].site = site;
+        g_BinlogSites[slot].id = id;
+    }
+
+    const u8 kind = BINLOG_ENTRY_SITE;
+    const u8 level = (u8)site->level;
+    const u16 fmt_len = (u16)strnlen(site->fmt, 0xffff);
+    const u16 file_len = (u16)strnlen(site->file, 0xffff);
+    binlog_write(&kind, sizeof(kind));
+    binlog_write(&id, sizeof(id));
+    binlog_write(&site->line, sizeof(site->line));
+    binlog_write(&level, sizeof(level));
+    binlog_write(&fmt_len, sizeof(fmt_len));
+    binlog_write(&file_len, sizeof(file_len));
+    binlog_write(site->fmt, fmt_len);
+    binlog_write(site->file, file_len);
+    return id;
+}
+
+static void binlog_emit(const binlog_record *r)
+{
+    if (g_BinlogSinks & BINLOG_SINK_KLOG) {
+        char text[512];
+        binlog_format(r->site->fmt, r->payload, r->size, text, sizeof(text));
+        klog("(%s:%u) %s%s", r->site->file, r->site->line, r->truncated ? "[truncated] " : "", text);
+    }
+    if (g_BinlogFd >= 0) {
+        const u32 id = binlog_site_id(r->site);
+        const u8 kind = BINLOG_ENTRY_RECORD;
+        binlog_write(&kind, sizeof(kind));
+        binlog_write(&id, sizeof(id));
+        binlog_write(&r->time, sizeof(r->time));
+        binlog_write(&r->thread, sizeof(r->thread));
+        binlog_write(&r->size, sizeof(r->size));
+        binlog_write(r->payload, r->size);
+    }
+}
+
+static void binlog_drain(void)
+{
+    for (u32 i = 0; i < BINLOG_RINGS; i++) {
+        binlog_ring *ring = &g_BinlogRings[i];
+        for (;;) {
+            binlog_record *r = &ring->record[ring->tail & (BINLOG_RING_SIZE - 1)];
+            if (__atomic_load_n(&r->sequence, __ATOMIC_ACQUIRE) != ring->tail + 1) {
+                break;
+            }
+            binlog_emit(r);
+            __atomic_store_n(&r->sequence, ring->tail + BINLOG_RING_SIZE, __ATOMIC_RELEASE);
+            ring->tail++;
+        }
+    }
+    const u32 dropped = __atomic_exchange_n(&g_BinlogDropped, 0, __ATOMIC_RELAXED);
+    if (dropped) {
+        final_printf("binlog: ring full, dropped %u record(s)\n", dropped);
+    }
+    binlog_flush();
+}
+
+static void *binlog_thread(void *args)
+{
+    scePthreadSetprio(scePthreadSelf(), ORBIS_KERNEL_PRIO_FIFO_LOWEST);
+    while (__atomic_load_n(&g_BinlogRunning, __ATOMIC_ACQUIRE)) {
+        sceKernelWaitSema(g_BinlogSema, 1, NULL);
+        // pairs with the exchange in binlog_commit, records committed before it are seen
+        __atomic_exchange_n(&g_BinlogWake, 0, __ATOMIC_ACQ_REL);
+        binlog_drain();
+    }
+    binlog_drain();
+    scePthreadExit(NULL);
+    return NULL;
+}
+
+int32_t binlog_init(const char *file, uint32_t level, uint32_t sinks)
+{
+    if (__atomic_load_n(&g_BinlogRunning, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    for (u32 i = 0; i < BINLOG_RINGS; i++) {
+        g_BinlogRings[i].head = 0;
+        g_BinlogRings[i].tail = 0;
+        for (u32 j = 0; j < BINLOG_RING_SIZE; j++) {
+            g_BinlogRings[i].record[j].sequence = j;
+        }
+    }
+    memset(g_BinlogSites, 0, sizeof(g_BinlogSites));
+    g_BinlogSiteCount = 0;
+    g_BinlogSinks = sinks;
+    g_BinlogLevel = level;
+
+    if ((sinks & BINLOG_SINK_FILE) && file) {
+        g_BinlogFd = sceKernelOpen(file, 0x200 | 0x400 | 0x001, 0777);
+        if (g_BinlogFd < 0) {
+            final_printf("binlog: failed to open %s (0x%08x)\n", file, g_BinlogFd);
+        } else {
+            binlog_file_header header;
+            header.magic = BINLOG_MAGIC;
+            header.version = BINLOG_VERSION;
+            header.frequency = sceKernelGetProcessTimeCounterFrequency();
+            binlog_write(&header, sizeof(header));
+        }
+    }
+
+    g_BinlogWake = 0;
+    s32 ret = sceKernelCreateSema(&g_BinlogSema, "binlog_sema", 1, 0, BINLOG_SEMA_MAX, NULL);
+    if (ret != 0) {
+        final_printf("binlog: sceKernelCreateSema: 0x%08x, logging synchronously\n", ret);
+    } else {
+        __atomic_store_n(&g_BinlogRunning, 1, __ATOMIC_RELEASE);
+        ret = scePthreadCreate(&g_BinlogThread, NULL, binlog_thread, NULL, "binlog_thread");
+        if (ret != 0) {
+            final_printf("binlog: scePthreadCreate: 0x%08x, logging synchronously\n", ret);
+            __atomic_store_n(&g_BinlogRunning, 0, __ATOMIC_SEQ_CST);
+            while (__atomic_load_n(&g_BinlogSignalers, __ATOMIC_SEQ_CST)) {
+                scePthreadYield();
+            }
+            sceKernelDeleteSema(g_BinlogSema);
+        }
+    }
+    if (ret != 0) {
+        binlog_flush();
+        if (g_BinlogFd >= 0) {
+            sceKernelClose(g_BinlogFd);
+            g_BinlogFd = -1;
+        }
+        return ret;
+    }
+    return 0;
+}
+
+void binlog_shutdown(void)
+{
+    u32 running = 1;
+    if (__atomic_compare_exchange_n(&g_BinlogRunning, &running, 0, false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+        sceKernelSignalSema(g_BinlogSema, 1);
+        scePthreadJoin(g_BinlogThread, NULL);
+        while (__atomic_load_n(&g_BinlogSignalers, __ATOMIC_SEQ_CST)) {
+            scePthreadYield();
+        }
+        sceKernelDeleteSema(g_BinlogSema);
+        if (g_BinlogFd >= 0) {
+            sceKernelClose(g_BinlogFd);
+            g_BinlogFd = -1;
+        }
+    }
+}
+
+void binlog_set_level(uint32_t level)
+{
+    __atomic_store_n(&g_BinlogLevel, level, __ATOMIC_RELAXED);
+}
+
+binlog_record *binlog_begin(const binlog_site *site, binlog_record *local)
+{
+    binlog_record *r = local;
+    u64 pos = BINLOG_LOCAL;
+    const u64 thread = (u64)(uintptr_t)scePthreadSelf();
+
+    if (__atomic_load_n(&g_BinlogRunning, __ATOMIC_ACQUIRE)) {
+        binlog_ring *ring = &g_BinlogRings[((thread >> 6) * 0x9e3779b1u >> 16) & (BINLOG_RINGS - 1)];
+        pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        for (;;) {
+            r = &ring->record[pos & (BINLOG_RING_SIZE - 1)];
+            const s64 diff = (s64)__atomic_load_n(&r->sequence, __ATOMIC_ACQUIRE) - (s64)pos;
+            if (diff == 0) {
+                if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true,
+                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                __atomic_fetch_add(&g_BinlogDropped, 1, __ATOMIC_RELAXED);
+                return NULL;
+            } else {
+                pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    if (r == local) {
+        r->sequence = BINLOG_LOCAL;
+    }
+    r->site = site;
+    r->time = sceKernelGetProcessTimeCounter();
+    r->thread = thread;
+    r->size = 0;
+    r->truncated = 0;
+    return r;
+}
+
+void binlog_commit(binlog_record *r)
+{
+    if (r->sequence == BINLOG_LOCAL) {
+        char text[512];
+        binlog_format(r->site->fmt, r->payload, r->size, text, sizeof(text));
+        klog("(%s:%u) %s", r->site->file, r->site->line, text);
+        return;
+    }
+    __atomic_store_n(&r->sequence, r->sequence + 1, __ATOMIC_RELEASE);
+    if (!__atomic_exchange_n(&g_BinlogWake, 1, __ATOMIC_ACQ_REL)) {
+        __atomic_add_fetch(&g_BinlogSignalers, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&g_BinlogRunning, __ATOMIC_SEQ_CST)) {
+            sceKernelSignalSema(g_BinlogSema, 1);
+        }
+        __atomic_sub_fetch(&g_BinlogSignalers, 1, __ATOMIC_RELEASE);
+    }
+}
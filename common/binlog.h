@@ -0,0 +1,237 @@
+#pragma once
+
+// Binary ring logger for hot paths.
+// A log call copies the call site pointer, a timestamp and the raw arguments into a
+// lock-free ring; a background thread formats them into klog and/or writes them to a
+// binary file that `tools/binlog_decode` turns back into text.
+//
+// Usage:
+//     binlog_init(GOLDHEN_PATH "/afr.binlog", BINLOG_INFO, BINLOG_SINK_KLOG | BINLOG_SINK_FILE);
+//     binlog_info("new fd: 0x%08x path: %s\n", fd, path);
+//     binlog_shutdown();
+//
+// Arguments are captured by type: integers (32 or 64 bit, the width is kept in the tag),
+// floating point, `char*` (copied, truncated to fit the record) and `void*`. Other pointer
+// types must be cast to `void*`.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+enum binlog_level {
+    BINLOG_ERROR = 0,
+    BINLOG_WARN,
+    BINLOG_INFO,
+    BINLOG_DEBUG,
+    BINLOG_TRACE,
+};
+
+enum binlog_sink {
+    BINLOG_SINK_KLOG = 1 << 0,
+    BINLOG_SINK_FILE = 1 << 1,
+};
+
+enum binlog_arg_type {
+    BINLOG_ARG_INT = 1,
+    BINLOG_ARG_DOUBLE,
+    BINLOG_ARG_STR,
+    BINLOG_ARG_PTR,
+    BINLOG_ARG_INT32,
+};
+
+// Calls above this level compile to nothing.
+#ifndef BINLOG_LEVEL_MAX
+#if (__FINAL__) == 1
+#define BINLOG_LEVEL_MAX BINLOG_INFO
+#else
+#define BINLOG_LEVEL_MAX BINLOG_TRACE
+#endif
+#endif
+
+#define BINLOG_PAYLOAD_SIZE 94
+#define BINLOG_LOCAL        (~0ull)
+
+// File format, all fields little endian:
+//     binlog_file_header
+//     { u8 BINLOG_ENTRY_SITE, u32 id, u32 line, u8 level, u16 fmt_len, u16 file_len, fmt, file }
+//     { u8 BINLOG_ENTRY_RECORD, u32 id, u64 time, u64 thread, u8 size, payload[size] }
+#define BINLOG_MAGIC        0x4c424847 // "GHBL"
+#define BINLOG_VERSION      2 // 2 added BINLOG_ARG_INT32
+#define BINLOG_ENTRY_SITE   1
+#define BINLOG_ENTRY_RECORD 2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t frequency;
+} binlog_file_header;
+
+typedef struct {
+    const char *fmt;
+    const char *file;
+    uint32_t line;
+    uint32_t level;
+} binlog_site;
+
+typedef struct {
+    uint64_t sequence;
+    const binlog_site *site;
+    uint64_t time;
+    uint64_t thread;
+    uint8_t size;
+    uint8_t truncated;
+    uint8_t payload[BINLOG_PAYLOAD_SIZE];
+} binlog_record;
+
+extern uint32_t g_BinlogLevel;
+
+/**
+ * @brief Starts the drainer thread.
+ *
+ * @param file Binary log path, used when `sinks` has `BINLOG_SINK_FILE`.
+ * @param level Runtime level, records above it are discarded at the call site.
+ * @param sinks Bitmask of `binlog_sink`.
+ * @return 0 on success.
+ */
+int32_t binlog_init(const char *file, uint32_t level, uint32_t sinks);
+/** @brief Drains pending records, stops the drainer and closes the file. */
+void binlog_shutdown(void);
+/** @brief Changes the runtime level. */
+void binlog_set_level(uint32_t level);
+
+/**
+ * @brief Reserves a record for a call site.
+ *
+ * @param site Call site descriptor.
+ * @param local Record used when the drainer is not running, it is formatted synchronously.
+ * @return Record to fill, or NULL if the ring is full and the record was dropped.
+ */
+binlog_record *binlog_begin(const binlog_site *site, binlog_record *local);
+/** @brief Publishes a record returned by `binlog_begin`. */
+void binlog_commit(binlog_record *record);
+
+/**
+ * @brief Formats a record payload with its call site format string.
+ *
+ * Shared with the host decoder, so it does not depend on any Orbis API.
+ *
+ * @return Number of characters written, excluding the terminator.
+ */
+uint32_t binlog_format(const char *fmt, const uint8_t *payload, uint32_t size, char *out, uint32_t out_size);
+
+static inline uint8_t *binlog_reserve(binlog_record *r, uint32_t size)
+{
+    if (r->size + size > BINLOG_PAYLOAD_SIZE) {
+        r->truncated = 1;
+        return NULL;
+    }
+    uint8_t *p = r->payload + r->size;
+    r->size += size;
+    return p;
+}
+
+static inline void binlog_put_int(binlog_record *r, int64_t v)
+{
+    uint8_t *p = binlog_reserve(r, 1 + sizeof(v));
+    if (p) {
+        p[0] = BINLOG_ARG_INT;
+        memcpy(p + 1, &v, sizeof(v));
+    }
+}
+
+static inline void binlog_put_int32(binlog_record *r, int32_t v)
+{
+    uint8_t *p = binlog_reserve(r, 1 + sizeof(v));
+    if (p) {
+        p[0] = BINLOG_ARG_INT32;
+        memcpy(p + 1, &v, sizeof(v));
+    }
+}
+
+static inline void binlog_put_double(binlog_record *r, double v)
+{
+    uint8_t *p = binlog_reserve(r, 1 + sizeof(v));
+    if (p) {
+        p[0] = BINLOG_ARG_DOUBLE;
+        memcpy(p + 1, &v, sizeof(v));
+    }
+}
+
+static inline void binlog_put_ptr(binlog_record *r, const void *v)
+{
+    const uint64_t u = (uint64_t)(uintptr_t)v;
+    uint8_t *p = binlog_reserve(r, 1 + sizeof(u));
+    if (p) {
+        p[0] = BINLOG_ARG_PTR;
+        memcpy(p + 1, &u, sizeof(u));
+    }
+}
+
+static inline void binlog_put_str(binlog_record *r, const char *s)
+{
+    // Keep the tail of long strings, paths differ at the end.
+    const uint32_t avail = BINLOG_PAYLOAD_SIZE - r->size;
+    if (avail < 2) {
+        r->truncated = 1;
+        return;
+    }
+    if (!s) {
+        s = "(null)";
+    }
+    uint32_t len = (uint32_t)strlen(s);
+    if (len > avail - 2) {
+        s += len - (avail - 2);
+        len = avail - 2;
+        r->truncated = 1;
+    }
+    uint8_t *p = binlog_reserve(r, 2 + len);
+    p[0] = BINLOG_ARG_STR;
+    p[1] = (uint8_t)len;
+    memcpy(p + 2, s, len);
+}
+
+#define BINLOG_PUT(r, x) _Generic((x),                  \
+    char *: binlog_put_str,                             \
+    const char *: binlog_put_str,                       \
+    float: binlog_put_double,                           \
+    double: binlog_put_double,                          \
+    void *: binlog_put_ptr,                             \
+    const void *: binlog_put_ptr,                       \
+    char: binlog_put_int32,                             \
+    signed char: binlog_put_int32,                      \
+    unsigned char: binlog_put_int32,                    \
+    short: binlog_put_int32,                            \
+    unsigned short: binlog_put_int32,                   \
+    int: binlog_put_int32,                              \
+    unsigned int: binlog_put_int32,                     \
+    default: binlog_put_int)(r, x)
+
+#define BINLOG_PUT_0(r)
+#define BINLOG_PUT_1(r, a)                BINLOG_PUT(r, a)
+#define BINLOG_PUT_2(r, a, b)             BINLOG_PUT(r, a); BINLOG_PUT_1(r, b)
+#define BINLOG_PUT_3(r, a, b, c)          BINLOG_PUT(r, a); BINLOG_PUT_2(r, b, c)
+#define BINLOG_PUT_4(r, a, b, c, d)       BINLOG_PUT(r, a); BINLOG_PUT_3(r, b, c, d)
+#define BINLOG_PUT_5(r, a, b, c, d, e)    BINLOG_PUT(r, a); BINLOG_PUT_4(r, b, c, d, e)
+#define BINLOG_PUT_6(r, a, b, c, d, e, f) BINLOG_PUT(r, a); BINLOG_PUT_5(r, b, c, d, e, f)
+#define BINLOG_PUT_N(_0, _1, _2, _3, _4, _5, _6, name, ...) name
+#define BINLOG_PUT_ALL(r, ...)                                                            \
+    BINLOG_PUT_N(_0, ##__VA_ARGS__, BINLOG_PUT_6, BINLOG_PUT_5, BINLOG_PUT_4, BINLOG_PUT_3, \
+                 BINLOG_PUT_2, BINLOG_PUT_1, BINLOG_PUT_0)(r, ##__VA_ARGS__)
+
+#define binlog(lvl, fmt_, args...) do {                                             \
+    if ((lvl) <= BINLOG_LEVEL_MAX && (uint32_t)(lvl) <= g_BinlogLevel) {            \
+        static const binlog_site _binlog_site = { fmt_, __FILE__, __LINE__, lvl };  \
+        binlog_record _binlog_local;                                                \
+        binlog_record *_binlog_r = binlog_begin(&_binlog_site, &_binlog_local);     \
+        if (_binlog_r) {                                                            \
+            BINLOG_PUT_ALL(_binlog_r, ##args);                                      \
+            binlog_commit(_binlog_r);                                               \
+        }                                                                           \
+    }                                                                               \
+} while (0)
+
+#define binlog_error(fmt_, args...) binlog(BINLOG_ERROR, fmt_, ##args)
+#define binlog_warn(fmt_, args...)  binlog(BINLOG_WARN, fmt_, ##args)
+#define binlog_info(fmt_, args...)  binlog(BINLOG_INFO, fmt_, ##args)
+#define binlog_debug(fmt_, args...) binlog(BINLOG_DEBUG, fmt_, ##args)
+#define binlog_trace(fmt_, args...) binlog(BINLOG_TRACE, fmt_, ##args)
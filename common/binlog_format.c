@@ -0,0 +1,166 @@
+#include "binlog.h"
+#include <stdio.h>
+
+// Reads the next argument, returns false if it does not match the expected type.
+// 32 bit integers are sign extended to 64 bit.
+static bool binlog_next_arg(const uint8_t *payload, uint32_t size, uint32_t *pos, uint8_t type,
+                            uint64_t *value, const char **str, uint32_t *str_len)
+{
+    if (*pos >= size) {
+        return false;
+    }
+    const uint8_t actual = payload[*pos];
+    if (actual == BINLOG_ARG_STR) {
+        if (*pos + 2 > size) {
+            return false;
+        }
+        *str_len = payload[*pos + 1];
+        *str = (const char *)payload + *pos + 2;
+        *pos += 2 + *str_len;
+    } else if (actual == BINLOG_ARG_INT32) {
+        int32_t v;
+        if (*pos + 1 + sizeof(v) > size) {
+            return false;
+        }
+        memcpy(&v, payload + *pos + 1, sizeof(v));
+        *value = (uint64_t)(int64_t)v;
+        *pos += 1 + sizeof(v);
+    } else {
+        if (*pos + 1 + sizeof(*value) > size) {
+            return false;
+        }
+        memcpy(value, payload + *pos + 1, sizeof(*value));
+        *pos += 1 + sizeof(*value);
+    }
+    // Pointers and integers of either width are interchangeable.
+    const bool actual_int = actual == BINLOG_ARG_INT || actual == BINLOG_ARG_INT32 || actual == BINLOG_ARG_PTR;
+    const bool type_int = type == BINLOG_ARG_INT || type == BINLOG_ARG_PTR;
+    return actual == type || (actual_int && type_int);
+}
+
+uint32_t binlog_format(const char *fmt, const uint8_t *payload, uint32_t size, char *out, uint32_t out_size)
+{
+    uint32_t len = 0;
+    uint32_t pos = 0;
+    char spec[32];
+
+    if (!out_size) {
+        return 0;
+    }
+#define BINLOG_APPEND(...) do {                                          \
+        if (len < out_size) {                                            \
+            const int n = snprintf(out + len, out_size - len, __VA_ARGS__); \
+            if (n > 0) {                                                 \
+                len += (uint32_t)n < out_size - len ? (uint32_t)n : out_size - len - 1; \
+            }                                                            \
+        }                                                                \
+    } while (0)
+
+    for (const char *p = fmt; *p && len + 1 < out_size; p++) {
+        if (*p != '%') {
+            out[len++] = *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[len++] = '%';
+            p++;
+            continue;
+        }
+
+        // Copy flags, width and precision. Length modifiers are dropped, the value is printed
+        // as 64 bit after it was cut to the width they ask for, like printf would.
+        uint32_t spec_len = 0;
+        uint32_t bits = 32;
+        spec[spec_len++] = '%';
+        p++;
+        while (*p && strchr("-+ #0123456789.", *p) && spec_len < sizeof(spec) - 4) {
+            spec[spec_len++] = *p++;
+        }
+        while (*p && strchr("hljztL", *p)) {
+            if (*p == 'h') {
+                bits = bits == 32 ? 16 : 8;
+            } else if (*p != 'L') {
+                bits = 64;
+            }
+            p++;
+        }
+        if (!*p) {
+            break;
+        }
+
+        const char conv = *p;
+        uint64_t value = 0;
+        const char *str = NULL;
+        uint32_t str_len = 0;
+        bool ok = false;
+        switch (conv) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            ok = binlog_next_arg(payload, size, &pos, BINLOG_ARG_INT, &value, &str, &str_len);
+            spec[spec_len++] = 'l';
+            spec[spec_len++] = 'l';
+            spec[spec_len++] = conv;
+            spec[spec_len] = 0;
+            if (ok) {
+                if (bits < 64) {
+                    const uint32_t shift = 64 - bits;
+                    value = conv == 'd' || conv == 'i' ? (uint64_t)((int64_t)(value << shift) >> shift)
+                                                       : value << shift >> shift;
+                }
+                if (conv == 'd' || conv == 'i') {
+                    BINLOG_APPEND(spec, (long long)value);
+                } else {
+                    BINLOG_APPEND(spec, (unsigned long long)value);
+                }
+            }
+            break;
+        case 'c':
+            ok = binlog_next_arg(payload, size, &pos, BINLOG_ARG_INT, &value, &str, &str_len);
+            if (ok) {
+                BINLOG_APPEND("%c", (int)value);
+            }
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            ok = binlog_next_arg(payload, size, &pos, BINLOG_ARG_DOUBLE, &value, &str, &str_len);
+            spec[spec_len++] = conv;
+            spec[spec_len] = 0;
+            if (ok) {
+                double d;
+                memcpy(&d, &value, sizeof(d));
+                BINLOG_APPEND(spec, d);
+            }
+            break;
+        case 's':
+            ok = binlog_next_arg(payload, size, &pos, BINLOG_ARG_STR, &value, &str, &str_len);
+            if (ok) {
+                BINLOG_APPEND("%.*s", (int)str_len, str);
+            }
+            break;
+        case 'p':
+            ok = binlog_next_arg(payload, size, &pos, BINLOG_ARG_PTR, &value, &str, &str_len);
+            if (ok) {
+                BINLOG_APPEND("0x%llx", (unsigned long long)value);
+            }
+            break;
+        default:
+            break;
+        }
+        if (!ok) {
+            BINLOG_APPEND("<?>");
+        }
+    }
+#undef BINLOG_APPEND
+    out[len < out_size ? len : out_size - 1] = 0;
+    return len;
+}
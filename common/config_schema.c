@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "plugin_common.h"
+#include "config_schema.h"
+
+// Seeds tried before falling back to a linear search.
+#define CONFIG_MAX_SEEDS 4096
+#define CONFIG_NO_SEED 0xffffffff
+
+static inline uint32_t fnv1a(uint32_t seed, const char *str, bool fold_case) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (; *str; str++) {
+        uint8_t c = (uint8_t)*str;
+        if (fold_case && c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Finds a seed for which every name lands in its own slot.
+static uint32_t build_perfect_hash(const char *(*get_name)(const void *, uint32_t), const void *table, uint32_t size,
+                                   uint8_t *slot, uint32_t slot_count, bool fold_case) {
+    if (size >= slot_count) {
+        return CONFIG_NO_SEED;
+    }
+    for (uint32_t seed = 0; seed < CONFIG_MAX_SEEDS; seed++) {
+        memset(slot, 0, slot_count);
+        uint32_t i = 0;
+        for (; i < size; i++) {
+            uint32_t index = fnv1a(seed, get_name(table, i), fold_case) & (slot_count - 1);
+            if (slot[index]) {
+                break;
+            }
+            slot[index] = (uint8_t)(i + 1);
+        }
+        if (i == size) {
+            return seed;
+        }
+    }
+    return CONFIG_NO_SEED;
+}
+
+static const char *field_name(const void *table, uint32_t i) {
+    return ((const config_field *)table)[i].key;
+}
+
+static const char *enum_name(const void *table, uint32_t i) {
+    return ((const config_enum_value *)table)[i].name;
+}
+
+static void schema_prepare(config_schema *schema) {
+    if (schema->ready) {
+        return;
+    }
+    schema->seed = build_perfect_hash(field_name, schema->field, schema->size, schema->slot, CONFIG_SCHEMA_SLOTS, false);
+    if (schema->seed == CONFIG_NO_SEED) {
+        final_printf("%s: no perfect hash for %u keys, using linear lookups\n", schema->name, schema->size);
+    }
+    schema->ready = true;
+}
+
+static const config_field *schema_find(const config_schema *schema, const char *key) {
+    if (schema->seed != CONFIG_NO_SEED) {
+        uint8_t index = schema->slot[fnv1a(schema->seed, key, false) & (CONFIG_SCHEMA_SLOTS - 1)];
+        if (index && strcmp(schema->field[index - 1].key, key) == 0) {
+            return &schema->field[index - 1];
+        }
+        return NULL;
+    }
+    for (uint32_t i = 0; i < schema->size; i++) {
+        if (strcmp(schema->field[i].key, key) == 0) {
+            return &schema->field[i];
+        }
+    }
+    return NULL;
+}
+
+bool config_enum_find(config_enum *enums, const char *name, uint32_t *value) {
+    if (!enums->ready) {
+        enums->seed = build_perfect_hash(enum_name, enums->value, enums->size, enums->slot, CONFIG_ENUM_SLOTS, true);
+        enums->ready = true;
+    }
+    if (enums->seed != CONFIG_NO_SEED) {
+        uint8_t index = enums->slot[fnv1a(enums->seed, name, true) & (CONFIG_ENUM_SLOTS - 1)];
+        if (index && strcasecmp(enums->value[index - 1].name, name) == 0) {
+            *value = enums->value[index - 1].value;
+            return true;
+        }
+        return false;
+    }
+    for (uint32_t i = 0; i < enums->size; i++) {
+        if (strcasecmp(enums->value[i].name, name) == 0) {
+            *value = enums->value[i].value;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t config_schema_bind(config_schema *schema, const config_view *view, void *out) {
+    if (view == NULL || out == NULL) {
+        return 0;
+    }
+    schema_prepare(schema);
+    uint32_t bound = 0;
+    for (uint32_t i = 0; i < view->size; i++) {
+        const config_pair *pair = &view->pair[i];
+        const config_field *field = schema_find(schema, pair->key);
+        if (field == NULL) {
+            debug_printf("%s: unknown key %s\n", schema->name, pair->key);
+            continue;
+        }
+        void *dest = (uint8_t *)out + field->offset;
+        switch (field->type) {
+            case CONFIG_TYPE_BOOL:
+                *(bool *)dest = strcasecmp(pair->value, "on") == 0 || strcasecmp(pair->value, "true") == 0 ||
+                                strcasecmp(pair->value, "1") == 0;
+                break;
+            case CONFIG_TYPE_INT: {
+                int32_t value = atoi(pair->value);
+                if (value < field->min || value > field->max) {
+                    final_printf("%s: %s=%i out of range [%i, %i], keeping default\n", schema->name, pair->key, value,
+                                 field->min, field->max);
+                    continue;
+                }
+                *(int32_t *)dest = value;
+                break;
+            }
+            case CONFIG_TYPE_ENUM:
+                if (!config_enum_find(field->enums, pair->value, (uint32_t *)dest)) {
+                    final_printf("%s: %s=%s is not a valid option, keeping default\n", schema->name, pair->key,
+                                 pair->value);
+                    continue;
+                }
+                break;
+        }
+        bound++;
+    }
+    return bound;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+/*
+ * Typed config structs bound from a config_view in a single pass.
+ *
+ * A schema is an X-macro listing every key once:
+ *
+ * #define MY_CONFIG(X, S) \
+ *     X(S, BOOL, enableThing, true, 0, 1, NULL) \
+ *     X(S, INT, threshold, 13, 0, 128, NULL) \
+ *     X(S, ENUM, mode, MODE_A, 0, 0, &g_modeEnum)
+ *
+ * CONFIG_DECLARE_STRUCT(my_config, MY_CONFIG) generates the struct,
+ * CONFIG_DEFAULTS(my_config, MY_CONFIG) its default initializer and
+ * CONFIG_DEFINE_SCHEMA(my_config, MY_CONFIG) the field table used by
+ * config_schema_bind().
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config_service.h"
+
+#define CONFIG_SCHEMA_SLOTS 128
+#define CONFIG_ENUM_SLOTS 64
+
+typedef enum config_field_type {
+    CONFIG_TYPE_BOOL,
+    CONFIG_TYPE_INT,
+    CONFIG_TYPE_ENUM,
+} config_field_type;
+
+typedef struct config_enum_value {
+    const char *name;
+    uint32_t value;
+} config_enum_value;
+
+// Names are matched case insensitive.
+typedef struct config_enum {
+    const config_enum_value *value;
+    uint32_t size;
+    // Perfect hash, built on first use.
+    bool ready;
+    uint32_t seed;
+    uint8_t slot[CONFIG_ENUM_SLOTS];
+} config_enum;
+
+typedef struct config_field {
+    const char *key;
+    config_field_type type;
+    uint32_t offset;
+    int32_t min;
+    int32_t max;
+    config_enum *enums;
+} config_field;
+
+typedef struct config_schema {
+    const char *name;
+    const config_field *field;
+    uint32_t size;
+    // Perfect hash, built on first use.
+    bool ready;
+    uint32_t seed;
+    uint8_t slot[CONFIG_SCHEMA_SLOTS];
+} config_schema;
+
+#define CONFIG_CTYPE_BOOL bool
+#define CONFIG_CTYPE_INT int32_t
+#define CONFIG_CTYPE_ENUM uint32_t
+
+#define CONFIG_STRUCT_MEMBER(S, type, name, def, min, max, enums) CONFIG_CTYPE_##type name;
+#define CONFIG_STRUCT_DEFAULT(S, type, name, def, min, max, enums) .name = def,
+#define CONFIG_SCHEMA_FIELD(S, type, name, def, min, max, enums) \
+    { #name, CONFIG_TYPE_##type, (uint32_t)offsetof(S, name), min, max, enums },
+
+#define CONFIG_DECLARE_STRUCT(S, SCHEMA) \
+    typedef struct S { SCHEMA(CONFIG_STRUCT_MEMBER, S) } S
+
+#define CONFIG_DEFAULTS(S, SCHEMA) \
+    { SCHEMA(CONFIG_STRUCT_DEFAULT, S) }
+
+#define CONFIG_DEFINE_SCHEMA(S, SCHEMA) \
+    static const config_field S##_fields[] = { SCHEMA(CONFIG_SCHEMA_FIELD, S) }; \
+    config_schema S##_schema = { #S, S##_fields, sizeof(S##_fields) / sizeof(S##_fields[0]), false, 0, {0} }
+
+#define CONFIG_ENUM_INIT(values) \
+    { values, sizeof(values) / sizeof(values[0]), false, 0, {0} }
+
+/**
+ * @brief Fills `out' from `view' in one walk of its pairs. Keys are matched
+ *        through a perfect hash of the schema, values outside min/max or not
+ *        found in the enum table are logged and leave the field unchanged.
+ * @param schema
+ * @param view
+ * @param [out]out Struct declared with CONFIG_DECLARE_STRUCT, holding defaults.
+ * @return uint32_t Number of fields set.
+ */
+uint32_t config_schema_bind(config_schema *schema, const config_view *view, void *out);
+
+/**
+ * @brief Looks up `name' in `enums'. Returns false if it does not exist.
+ * @param enums
+ * @param name
+ * @param [out]value
+ * @return bool
+ */
+bool config_enum_find(config_enum *enums, const char *name, uint32_t *value);
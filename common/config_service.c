@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "plugin_common.h"
+#include "config_service.h"
+
+static config_get_view_t g_ConfigGetView = NULL;
+static bool g_ConfigServiceResolved = false;
+
+static void resolve_config_service(void) {
+    OrbisKernelModule handles[256] = {0};
+    size_t numModules = 0;
+    g_ConfigServiceResolved = true;
+    if (sceKernelGetModuleList(handles, sizeof(handles), &numModules)) {
+        return;
+    }
+    for (size_t i = 0; i < numModules; ++i) {
+        OrbisKernelModuleInfo moduleInfo = {0};
+        moduleInfo.size = sizeof(moduleInfo);
+        if (sceKernelGetModuleInfo(handles[i], &moduleInfo)) {
+            continue;
+        }
+        if (strstr(moduleInfo.name, CONFIG_SERVICE_MODULE)) {
+            sceKernelDlsym(handles[i], CONFIG_SERVICE_GET_VIEW, (void **)&g_ConfigGetView);
+            debug_printf("%s @ 0x%p\n", CONFIG_SERVICE_GET_VIEW, g_ConfigGetView);
+            return;
+        }
+    }
+}
+
+const config_view *config_service_get_view(const char *file) {
+    if (!g_ConfigServiceResolved) {
+        resolve_config_service();
+    }
+    if (g_ConfigGetView == NULL) {
+        return NULL;
+    }
+    return g_ConfigGetView(file);
+}
+
+static uint32_t merge_entries(config_pair *pair, uint32_t size, const config_entry *entry, int count) {
+    for (int i = 0; i < count; i++) {
+        if (entry[i].key[0] == '\0' || entry[i].key[0] == ';') {
+            continue;
+        }
+        uint32_t j = 0;
+        for (; j < size; j++) {
+            if (strcmp(pair[j].key, entry[i].key) == 0) {
+                break;
+            }
+        }
+        if (j == size) {
+            pair[size++].key = entry[i].key;
+        }
+        pair[j].value = entry[i].value;
+    }
+    return size;
+}
+
+uint32_t config_view_merge(config_pair *pair, const config_entry *default_entry, int default_size,
+                           const config_entry *title_entry, int title_size) {
+    const uint32_t size = merge_entries(pair, 0, default_entry, default_size);
+    return merge_entries(pair, size, title_entry, title_size);
+}
+
+const char *config_view_get(const config_view *view, const char *key) {
+    if (view == NULL) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < view->size; i++) {
+        if (strcmp(view->pair[i].key, key) == 0) {
+            return view->pair[i].value;
+        }
+    }
+    return NULL;
+}
+
+bool config_view_get_int(const config_view *view, const char *key, int *value) {
+    const char *val = config_view_get(view, key);
+    if (val == NULL) {
+        return false;
+    }
+    *value = atoi(val);
+    return true;
+}
+
+bool config_view_get_bool(const config_view *view, const char *key, bool *value) {
+    const char *val = config_view_get(view, key);
+    if (val == NULL) {
+        return false;
+    }
+    *value = strcasecmp(val, "on") == 0 || strcasecmp(val, "true") == 0 || strcasecmp(val, "1") == 0;
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+// Read-only INI views parsed once by plugin_loader and shared with every plugin.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CONFIG_SERVICE_MODULE "plugin_loader"
+#define CONFIG_SERVICE_GET_VIEW "plugin_config_get_view"
+#define CONFIG_DEFAULT_SECTION "default"
+
+// INI entry as both INI parsers store their sections.
+typedef struct config_entry {
+    char *key;
+    char *value;
+} config_entry;
+
+typedef struct config_pair {
+    const char *key;
+    const char *value;
+} config_pair;
+
+// `default' section merged with the current title ID section,
+// keys from the title ID section override default ones.
+typedef struct config_view {
+    const char *file;
+    const config_pair *pair;
+    uint32_t size;
+} config_view;
+
+typedef const config_view *(*config_get_view_t)(const char *file);
+
+/**
+ * @brief Returns the merged view of `file' from plugin_loader.
+ *        Returns NULL if plugin_loader is not loaded or the file can not be read,
+ *        callers should then parse the file themselves.
+ * @param file
+ * @return const config_view*
+ */
+const config_view *config_service_get_view(const char *file);
+
+/**
+ * @brief Merges the `default' section with a title ID section into `pair', keys of the
+ *        title ID section override default ones. Empty and comment keys are skipped.
+ *        The pairs point at the entries, `pair' needs room for both sections.
+ * @param [out]pair
+ * @param default_entry entries of the `default' section, NULL if there is none
+ * @param default_size
+ * @param title_entry entries of the title ID section, NULL if there is none
+ * @param title_size
+ * @return uint32_t number of merged pairs
+ */
+uint32_t config_view_merge(config_pair *pair, const config_entry *default_entry, int default_size,
+                           const config_entry *title_entry, int title_size);
+
+/**
+ * @brief Retrieves the value of `key' in `view'. Returns NULL if it does not exist.
+ * @param view
+ * @param key
+ * @return const char*
+ */
+const char *config_view_get(const config_view *view, const char *key);
+
+/**
+ * @brief Retrieves the value of `key' in `view' converted to int. Returns false on failure.
+ * @param view
+ * @param key
+ * @param [out]value
+ * @return bool
+ */
+bool config_view_get_int(const config_view *view, const char *key, int *value);
+
+/**
+ * @brief Retrieves the value of `key' in `view' converted to bool. Returns false on failure.
+ * @param view
+ * @param key
+ * @param [out]value
+ * @return bool
+ */
+bool config_view_get_bool(const config_view *view, const char *key, bool *value);
@@ -0,0 +1,4 @@
+#define GIT_COMMIT "4df3a9eaf5889647ed90b1de42b6c5dc18c6ac3c"
+#define GIT_VER "master"
+#define GIT_NUM 32
+#define BUILD_DATE "Oct 19 2026 @ 12:42:53"
@@ -0,0 +1,200 @@
+#include "hook_stats.h"
+
+#if defined(HOOK_STATS) && (HOOK_STATS) == 1
+
+#include "plugin_common.h"
+#include <Common.h>
+#include <stdbool.h>
+#include <orbis/libkernel.h>
+
+#define HOOK_STATS_DIR     GOLDHEN_PATH "/hook_stats"
+#define HOOK_STATS_MAX     32
+
+typedef struct {
+    hook_stat *stat;
+    u64 calls;
+    u64 ticks;
+    u32 bucket[HOOK_STATS_BUCKETS];
+} hook_stats_snapshot;
+
+static hook_stat *g_HookStatsList = NULL;
+static u32 g_HookStatsRunning = 0;
+static OrbisPthread g_HookStatsThread;
+static u32 g_HookStatsInterval = 0;
+static char g_HookStatsPath[MAX_PATH_];
+
+// Only touched by the exporter thread.
+static hook_stats_snapshot g_HookStatsPrev[HOOK_STATS_MAX];
+static u64 g_HookStatsLastExport = 0;
+
+static inline u32 hook_stats_bucket(u64 ticks)
+{
+    if (ticks < (1u << HOOK_STATS_SUB_BITS)) {
+        return (u32)ticks;
+    }
+    const u32 msb = 63 - __builtin_clzll(ticks);
+    const u32 sub = (u32)(ticks >> (msb - HOOK_STATS_SUB_BITS)) & ((1u << HOOK_STATS_SUB_BITS) - 1);
+    const u32 bucket = ((msb - HOOK_STATS_SUB_BITS + 1) << HOOK_STATS_SUB_BITS) | sub;
+    return bucket < HOOK_STATS_BUCKETS ? bucket : HOOK_STATS_BUCKETS - 1;
+}
+
+// Midpoint of a bucket in ticks.
+static u64 hook_stats_bucket_value(u32 bucket)
+{
+    if (bucket < (1u << HOOK_STATS_SUB_BITS)) {
+        return bucket;
+    }
+    const u32 msb = (bucket >> HOOK_STATS_SUB_BITS) + HOOK_STATS_SUB_BITS - 1;
+    const u64 sub = bucket & ((1u << HOOK_STATS_SUB_BITS) - 1);
+    const u64 width = 1ull << (msb - HOOK_STATS_SUB_BITS);
+    return (1ull << msb) + sub * width + width / 2;
+}
+
+hook_stats_scope hook_stats_begin(hook_stat *stat)
+{
+    hook_stats_scope scope;
+    if (!__atomic_load_n(&stat->registered, __ATOMIC_ACQUIRE)) {
+        u32 expected = 0;
+        if (__atomic_compare_exchange_n(&stat->registered, &expected, 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            hook_stat *head = __atomic_load_n(&g_HookStatsList, __ATOMIC_ACQUIRE);
+            do {
+                stat->next = head;
+            } while (!__atomic_compare_exchange_n(&g_HookStatsList, &head, stat, true,
+                                                  __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+        }
+    }
+    scope.stat = stat;
+    scope.start = sceKernelGetProcessTimeCounter();
+    return scope;
+}
+
+void hook_stats_end(hook_stats_scope *scope)
+{
+    const u64 ticks = sceKernelGetProcessTimeCounter() - scope->start;
+    const u64 thread = (u64)(uintptr_t)scePthreadSelf();
+    hook_stats_shard *shard = &scope->stat->shard[((thread >> 6) * 0x9e3779b1u >> 16) & (HOOK_STATS_SHARDS - 1)];
+    __atomic_fetch_add(&shard->calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&shard->ticks, ticks, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&shard->bucket[hook_stats_bucket(ticks)], 1, __ATOMIC_RELAXED);
+}
+
+static u64 hook_stats_percentile(const u32 *bucket, u64 total, u32 percent)
+{
+    const u64 target = (total * percent + 99) / 100;
+    u64 seen = 0;
+    for (u32 i = 0; i < HOOK_STATS_BUCKETS; i++) {
+        seen += bucket[i];
+        if (seen >= target && seen) {
+            return hook_stats_bucket_value(i);
+        }
+    }
+    return 0;
+}
+
+static void hook_stats_export(void)
+{
+    const u64 now = sceKernelGetProcessTimeCounter();
+    const u64 freq = sceKernelGetProcessTimeCounterFrequency();
+    const double elapsed = (double)(now - g_HookStatsLastExport) / freq;
+    const double us_per_tick = 1000000.0 / freq;
+    g_HookStatsLastExport = now;
+
+    s32 fd = sceKernelOpen(g_HookStatsPath, 0x0001 | 0x0008, 0777); // O_WRONLY | O_APPEND
+    if (fd < 0) {
+        return;
+    }
+    u32 index = 0;
+    for (hook_stat *stat = __atomic_load_n(&g_HookStatsList, __ATOMIC_ACQUIRE);
+         stat && index < HOOK_STATS_MAX; stat = stat->next, index++) {
+        hook_stats_snapshot cur;
+        hook_stats_snapshot *prev = &g_HookStatsPrev[index];
+        if (prev->stat != stat) {
+            memset(prev, 0, sizeof(*prev));
+            prev->stat = stat;
+        }
+        memset(&cur, 0, sizeof(cur));
+        for (u32 s = 0; s < HOOK_STATS_SHARDS; s++) {
+            const hook_stats_shard *shard = &stat->shard[s];
+            cur.calls += __atomic_load_n(&shard->calls, __ATOMIC_RELAXED);
+            cur.ticks += __atomic_load_n(&shard->ticks, __ATOMIC_RELAXED);
+            for (u32 b = 0; b < HOOK_STATS_BUCKETS; b++) {
+                cur.bucket[b] += __atomic_load_n(&shard->bucket[b], __ATOMIC_RELAXED);
+            }
+        }
+
+        u32 delta_bucket[HOOK_STATS_BUCKETS];
+        for (u32 b = 0; b < HOOK_STATS_BUCKETS; b++) {
+            delta_bucket[b] = cur.bucket[b] - prev->bucket[b];
+        }
+        const u64 calls = cur.calls - prev->calls;
+        const u64 ticks = cur.ticks - prev->ticks;
+        char line[256];
+        s32 len = snprintf(line, sizeof(line), "%.3f,%s,%lu,%lu,%.1f,%.3f,%.3f,%.3f\n",
+                           (double)now / freq, stat->name, cur.calls, calls,
+                           elapsed > 0 ? calls / elapsed : 0.0,
+                           calls ? ticks * us_per_tick / calls : 0.0,
+                           hook_stats_percentile(delta_bucket, calls, 50) * us_per_tick,
+                           hook_stats_percentile(delta_bucket, calls, 99) * us_per_tick);
+        sceKernelWrite(fd, line, len);
+        cur.stat = stat;
+        memcpy(prev, &cur, sizeof(cur));
+    }
+    sceKernelClose(fd);
+}
+
+static void *hook_stats_thread(void *args)
+{
+    scePthreadSetprio(scePthreadSelf(), ORBIS_KERNEL_PRIO_FIFO_LOWEST);
+    u64 waited_ms = 0;
+    while (__atomic_load_n(&g_HookStatsRunning, __ATOMIC_ACQUIRE)) {
+        sceKernelUsleep(100 * 1000);
+        waited_ms += 100;
+        if (waited_ms >= g_HookStatsInterval) {
+            hook_stats_export();
+            waited_ms = 0;
+        }
+    }
+    hook_stats_export();
+    scePthreadExit(NULL);
+    return NULL;
+}
+
+void hook_stats_start(const char *plugin, uint32_t interval_ms)
+{
+    if (__atomic_load_n(&g_HookStatsRunning, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    sceKernelMkdir(HOOK_STATS_DIR, 0777);
+    snprintf(g_HookStatsPath, sizeof(g_HookStatsPath), HOOK_STATS_DIR "/%s.csv", plugin);
+    s32 fd = sceKernelOpen(g_HookStatsPath, 0x0001 | 0x0200 | 0x0400, 0777);
+    if (fd < 0) {
+        final_printf("hook_stats: failed to open %s (0x%08x)\n", g_HookStatsPath, fd);
+        return;
+    }
+    static const char header[] = "time_s,hook,total_calls,calls,calls_per_s,avg_us,p50_us,p99_us\n";
+    sceKernelWrite(fd, header, sizeof(header) - 1);
+    sceKernelClose(fd);
+
+    g_HookStatsInterval = interval_ms ? interval_ms : 5000;
+    g_HookStatsLastExport = sceKernelGetProcessTimeCounter();
+    __atomic_store_n(&g_HookStatsRunning, 1, __ATOMIC_RELEASE);
+    s32 ret = scePthreadCreate(&g_HookStatsThread, NULL, hook_stats_thread, NULL, "hook_stats_thread");
+    if (ret != 0) {
+        final_printf("hook_stats: scePthreadCreate: 0x%08x\n", ret);
+        __atomic_store_n(&g_HookStatsRunning, 0, __ATOMIC_RELEASE);
+        return;
+    }
+    final_printf("hook_stats: exporting to %s every %u ms\n", g_HookStatsPath, g_HookStatsInterval);
+}
+
+void hook_stats_stop(void)
+{
+    u32 running = 1;
+    if (__atomic_compare_exchange_n(&g_HookStatsRunning, &running, 0, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        scePthreadJoin(g_HookStatsThread, NULL);
+    }
+}
+
+#endif
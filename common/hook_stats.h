@@ -0,0 +1,76 @@
+#pragma once
+
+// Opt-in call count and latency counters for hook bodies.
+// Build a plugin with `HOOK_STATS=1` to enable, otherwise every macro compiles to nothing.
+//
+// Usage:
+//     HOOK_INIT(sceKernelOpen);
+//     HOOK_STATS_INIT(sceKernelOpen);
+//
+//     s32 sceKernelOpen_hook(...)
+//     {
+//         HOOK_STATS_SCOPE(sceKernelOpen);
+//         ...
+//     }
+//
+//     hook_stats_start(g_pluginName, 5000); // in plugin_load
+//     hook_stats_stop();                    // in plugin_unload
+//
+// The measured time covers the whole hook body, including the original function.
+// Every export interval one CSV row per hook is appended to
+// /data/GoldHEN/hook_stats/<plugin>.csv with the call rate and p50/p99 latency.
+
+#include <stdint.h>
+
+#if defined(HOOK_STATS) && (HOOK_STATS) == 1
+
+#define HOOK_STATS_SHARDS  8 // must be power of two
+// Latency histogram: 4 sub buckets per power of two of process time counter ticks.
+#define HOOK_STATS_SUB_BITS 2
+#define HOOK_STATS_BUCKETS  (40 << HOOK_STATS_SUB_BITS)
+
+typedef struct {
+    uint64_t calls;
+    uint64_t ticks;
+    uint32_t bucket[HOOK_STATS_BUCKETS];
+} __attribute__((aligned(64))) hook_stats_shard;
+
+typedef struct hook_stat {
+    const char *name;
+    struct hook_stat *next;
+    uint32_t registered;
+    hook_stats_shard shard[HOOK_STATS_SHARDS];
+} hook_stat;
+
+typedef struct {
+    hook_stat *stat;
+    uint64_t start;
+} hook_stats_scope;
+
+/** @brief Registers the hook on first use and samples the start time. */
+hook_stats_scope hook_stats_begin(hook_stat *stat);
+/** @brief Scope cleanup, adds the elapsed time to the calling thread's shard. */
+void hook_stats_end(hook_stats_scope *scope);
+
+/**
+ * @brief Starts the exporter thread.
+ *
+ * @param plugin Plugin name, used for the CSV file name.
+ * @param interval_ms Export interval.
+ */
+void hook_stats_start(const char *plugin, uint32_t interval_ms);
+/** @brief Writes a final row per hook and stops the exporter thread. */
+void hook_stats_stop(void);
+
+#define HOOK_STATS_INIT(func) static hook_stat func##_stats = { #func, 0, 0, {{0}} }
+#define HOOK_STATS_SCOPE(func) \
+    hook_stats_scope _hook_stats_scope __attribute__((cleanup(hook_stats_end))) = hook_stats_begin(&func##_stats)
+
+#else
+
+#define HOOK_STATS_INIT(func)
+#define HOOK_STATS_SCOPE(func)
+static inline void hook_stats_start(const char *plugin, uint32_t interval_ms) { (void)plugin; (void)interval_ms; }
+static inline void hook_stats_stop(void) {}
+
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+
+// Host shim of the GoldHEN SDK Common.h, see common/host/host.h.
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <orbis/libkernel.h>
+
+#include "Detour.h"
+#include "GoldHEN.h"
+
+#define STRINGIFY(x) #x
+
+#define HOOK_INIT(function) Detour function##Detour
+
+#define HOOK32(function)                                                                                         \
+    Detour_Construct(&function##Detour, DetourMode_x32);                                                         \
+    Detour_DetourNamed(&function##Detour, #function, (uint64_t)function, (void *)function##_hook)
+
+#define HOOK(function)                                                                                           \
+    Detour_Construct(&function##Detour, DetourMode_x64);                                                         \
+    Detour_DetourNamed(&function##Detour, #function, (uint64_t)function, (void *)function##_hook)
+
+#define UNHOOK(function) Detour_Destroy(&function##Detour)
+
+#define HOOK_CONTINUE(function, type, ...) ((type)function##Detour.StubPtr)(__VA_ARGS__)
@@ -0,0 +1,35 @@
+#pragma once
+
+// Host shim of the GoldHEN SDK detours, see common/host/host.h.
+// Nothing is patched, detours are entries of a table the host harness calls through
+// with host_hook_target(). Hooks of the same function chain like they do on console.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum DetourMode {
+    DetourMode_x64,
+    DetourMode_x32,
+} DetourMode;
+
+typedef struct Detour {
+    DetourMode Mode;
+    const char *Name;
+    uint64_t Address;
+    void *HookPtr;
+    void *StubPtr;
+    struct Detour *Next;
+} Detour;
+
+void Detour_Construct(Detour *This, DetourMode Mode);
+void Detour_Destroy(Detour *This);
+void *Detour_DetourFunction(Detour *This, uint64_t FunctionPtr, void *HookPtr);
+// Same as Detour_DetourFunction with the hooked function name kept for the table.
+void *Detour_DetourNamed(Detour *This, const char *Name, uint64_t FunctionPtr, void *HookPtr);
+
+#ifdef __cplusplus
+}
+#endif
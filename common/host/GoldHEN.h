@@ -0,0 +1,44 @@
+#pragma once
+
+// Host shim of the GoldHEN SDK syscalls, see common/host/host.h.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GOLDHEN_SDK_VERSION 0x00000100
+
+struct proc_info {
+    int pid;
+    char name[32];
+    char path[64];
+    char titleid[16];
+    char contentid[64];
+    char version[8];
+    uint64_t base_address;
+};
+
+struct proc_rw {
+    uint64_t address;
+    void *data;
+    uint64_t length;
+    uint64_t write_flags;
+};
+
+// Process info of the emulated title, set by GOLDHEN_HOST_TITLEID or host_proc_image().
+int32_t sys_sdk_proc_info(struct proc_info *info);
+// Reads or writes the buffer registered with host_proc_image(), other addresses fail.
+int32_t sys_sdk_proc_rw(struct proc_rw *data);
+uint32_t sys_sdk_version(void);
+
+int32_t sys_dynlib_load_prx(const char *path, int32_t *handle);
+int32_t sys_dynlib_unload_prx(int32_t handle);
+int32_t sys_dynlib_dlsym(int32_t handle, const char *symbol, void *addr);
+
+void klog(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#ifdef __cplusplus
+}
+#endif
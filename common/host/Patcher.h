@@ -0,0 +1,29 @@
+#pragma once
+
+// Host shim of the GoldHEN SDK patcher, see common/host/host.h.
+// Patches are applied only inside the buffer registered with host_proc_image(),
+// other addresses are logged and skipped.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PATCHER_MAX_SIZE 64
+
+typedef struct Patcher {
+    uint64_t Address;
+    size_t Size;
+    uint8_t Original[PATCHER_MAX_SIZE];
+    int Applied;
+} Patcher;
+
+void Patcher_Construct(Patcher *This);
+void Patcher_Destroy(Patcher *This);
+void Patcher_Install_Patch(Patcher *This, uint64_t Address, const void *Patch, size_t Size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,361 @@
+// bench: Runs the plugin hot path workloads on the host build, see bench.h.
+// Usage: bench [--baseline baseline.csv] [--out results.csv] [--update] [--tolerance pct]
+//              [--repeat n] [--filter substring]
+// Results: one CSV row per workload with the fastest and the median ns per operation.
+// The fastest run is compared to the baseline, a workload still slower than the baseline
+// by more than `tolerance' percent (default 25) after two more tries is reported and the
+// exit code is 1.
+// --update rewrites the baseline from this run instead.
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "host.h"
+
+#define BENCH_TITLEID "CUSA99999"
+#define BENCH_MAX_WORKLOADS 64
+#define BENCH_MAX_REPEAT 64
+#define BENCH_RETRIES 2
+
+typedef struct bench_result {
+    const char *name;
+    uint32_t ops;
+    uint32_t repeat;
+    double best;
+    double median;
+    uint64_t checksum;
+} bench_result;
+
+typedef struct bench_baseline {
+    char name[64];
+    double ns_per_op;
+} bench_baseline;
+
+static char g_BinDir[PATH_MAX];
+static FILE *g_Console;
+
+void bench_fill(bench_rng *rng, void *out, size_t size)
+{
+    uint8_t *bytes = (uint8_t *)out;
+    for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+        const uint64_t value = bench_rng_next(rng);
+        memcpy(bytes + i, &value, size - i < sizeof(value) ? size - i : sizeof(value));
+    }
+}
+
+void *bench_plugin_open(const char *plugin, int load)
+{
+    char path[PATH_MAX + 64];
+    snprintf(path, sizeof(path), "%s/../%s.so", g_BinDir, plugin);
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+        fprintf(g_Console, "[bench] %s\n", dlerror());
+        return NULL;
+    }
+    if (load) {
+        int32_t (*plugin_load)(int32_t, const char **) = (int32_t (*)(int32_t, const char **))bench_symbol(handle, "plugin_load");
+        if (plugin_load == NULL || plugin_load(0, NULL) != 0) {
+            fprintf(g_Console, "[bench] plugin_load of %s failed\n", plugin);
+            dlclose(handle);
+            return NULL;
+        }
+    }
+    return handle;
+}
+
+void bench_plugin_unload(void *handle)
+{
+    int32_t (*plugin_unload)(int32_t, const char **) = (int32_t (*)(int32_t, const char **))bench_symbol(handle, "plugin_unload");
+    if (plugin_unload) {
+        plugin_unload(0, NULL);
+    }
+}
+
+void *bench_symbol(void *handle, const char *symbol)
+{
+    void *address = dlsym(handle, symbol);
+    if (address == NULL) {
+        fprintf(g_Console, "[bench] missing symbol %s\n", symbol);
+    }
+    return address;
+}
+
+int bench_write_file(const char *path, const void *data, size_t size)
+{
+    char resolved[PATH_MAX];
+    host_path(path, resolved, sizeof(resolved));
+    for (char *p = strchr(resolved + 1, '/'); p; p = strchr(p + 1, '/')) {
+        *p = '\0';
+        mkdir(resolved, 0777);
+        *p = '/';
+    }
+    FILE *f = fopen(resolved, "wb");
+    if (f == NULL) {
+        fprintf(g_Console, "[bench] can't write %s: %s\n", resolved, strerror(errno));
+        return -1;
+    }
+    const int ok = fwrite(data, 1, size, f) == size;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int run_workload(const bench_workload *w, uint32_t repeat, bench_result *out)
+{
+    if (w->setup && w->setup() != 0) {
+        return -1;
+    }
+    double sample[BENCH_MAX_REPEAT];
+    uint64_t checksum = 0;
+    // The first run warms caches and is not counted.
+    for (uint32_t i = 0; i <= repeat; i++) {
+        if (w->prepare) {
+            w->prepare();
+        }
+        const double start = now_ns();
+        const uint64_t sum = w->run(w->ops);
+        const double elapsed = now_ns() - start;
+        if (i == 0) {
+            checksum = sum;
+            continue;
+        }
+        sample[i - 1] = elapsed / w->ops;
+    }
+    if (w->teardown) {
+        w->teardown();
+    }
+    qsort(sample, repeat, sizeof(sample[0]), compare_double);
+    out->name = w->name;
+    out->ops = w->ops;
+    out->repeat = repeat;
+    out->best = sample[0];
+    out->median = sample[repeat / 2];
+    out->checksum = checksum;
+    return 0;
+}
+
+static uint32_t read_baseline(const char *path, bench_baseline *baseline, uint32_t max)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return 0;
+    }
+    char line[256];
+    uint32_t count = 0;
+    while (count < max && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || strncmp(line, "workload,", 9) == 0) {
+            continue;
+        }
+        char *comma = strchr(line, ',');
+        if (comma == NULL || (size_t)(comma - line) >= sizeof(baseline[count].name)) {
+            continue;
+        }
+        *comma = '\0';
+        snprintf(baseline[count].name, sizeof(baseline[count].name), "%.63s", line);
+        baseline[count].ns_per_op = strtod(comma + 1, NULL);
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+static int write_baseline(const char *path, const bench_result *result, uint32_t count)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(g_Console, "[bench] can't write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(f, "# Fastest ns per operation of each workload, written by `make bench-baseline'.\n");
+    fprintf(f, "# Only comparable on the machine that wrote it, regenerate it there after intended changes.\n");
+    fprintf(f, "workload,ns_per_op\n");
+    for (uint32_t i = 0; i < count; i++) {
+        fprintf(f, "%s,%.2f\n", result[i].name, result[i].best);
+    }
+    fclose(f);
+    return 0;
+}
+
+static int write_results(const char *path, const bench_result *result, uint32_t count)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(g_Console, "[bench] can't write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(f, "workload,ops,repeat,ns_per_op_min,ns_per_op_median,checksum\n");
+    for (uint32_t i = 0; i < count; i++) {
+        fprintf(f, "%s,%u,%u,%.2f,%.2f,%016lx\n", result[i].name, result[i].ops, result[i].repeat, result[i].best,
+                result[i].median, (unsigned long)result[i].checksum);
+    }
+    fclose(f);
+    return 0;
+}
+
+static const bench_baseline *find_baseline(const bench_baseline *baseline, uint32_t count, const char *name)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(baseline[i].name, name) == 0 && baseline[i].ns_per_op > 0) {
+            return &baseline[i];
+        }
+    }
+    return NULL;
+}
+
+static double change_percent(const bench_result *result, const bench_baseline *base)
+{
+    return (result->best / base->ns_per_op - 1.0) * 100.0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *baseline_path = NULL;
+    const char *out_path = NULL;
+    const char *filter = NULL;
+    double tolerance = 25.0;
+    uint32_t repeat = 7;
+    int update = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--update") == 0) {
+            update = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [--baseline baseline.csv] [--out results.csv] [--update] [--tolerance pct]"
+                            " [--repeat n] [--filter substring]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (repeat == 0 || repeat > BENCH_MAX_REPEAT) {
+        repeat = 7;
+    }
+
+    char exe[PATH_MAX] = {0};
+    if (readlink("/proc/self/exe", exe, sizeof(exe) - 1) < 0) {
+        perror("readlink");
+        return 2;
+    }
+    snprintf(g_BinDir, sizeof(g_BinDir), "%s", dirname(exe));
+
+    // Plugin logs go to bench.log, the console keeps the runner's output.
+    g_Console = fdopen(dup(STDERR_FILENO), "w");
+    setvbuf(g_Console, NULL, _IONBF, 0);
+    char path[PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s/bench.log", g_BinDir);
+    const int log = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log >= 0) {
+        dup2(log, STDERR_FILENO);
+        dup2(log, STDOUT_FILENO);
+        close(log);
+    }
+    snprintf(path, sizeof(path), "%s/root", g_BinDir);
+    setenv(HOST_ROOT_ENV, path, 1);
+    setenv(HOST_TITLEID_ENV, BENCH_TITLEID, 1);
+
+    const bench_workload *all[BENCH_MAX_WORKLOADS];
+    uint32_t total = 0;
+    const bench_workload *groups[] = { g_GamePatchWorkloads, g_PluginWorkloads };
+    for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++) {
+        for (const bench_workload *w = groups[g]; w->name && total < BENCH_MAX_WORKLOADS; w++) {
+            if (filter == NULL || strstr(w->name, filter)) {
+                all[total++] = w;
+            }
+        }
+    }
+
+    static bench_baseline baseline[BENCH_MAX_WORKLOADS];
+    uint32_t baseline_count = 0;
+    if (baseline_path && !update) {
+        baseline_count = read_baseline(baseline_path, baseline, BENCH_MAX_WORKLOADS);
+        if (baseline_count == 0) {
+            fprintf(g_Console, "[bench] no baseline in %s, run `make bench-baseline'\n", baseline_path);
+            return 1;
+        }
+    }
+
+    static bench_result result[BENCH_MAX_WORKLOADS];
+    uint32_t count = 0;
+    uint32_t failed = 0;
+    uint32_t regressions = 0;
+    fprintf(g_Console, "%-40s %8s %14s %14s\n", "workload", "ops", "min ns/op", "median ns/op");
+    for (uint32_t i = 0; i < total; i++) {
+        bench_result *r = &result[count];
+        if (run_workload(all[i], repeat, r) != 0) {
+            fprintf(g_Console, "[bench] %s: setup failed\n", all[i]->name);
+            failed++;
+            continue;
+        }
+        count++;
+        const bench_baseline *base = find_baseline(baseline, baseline_count, r->name);
+        // A slow run is measured again before it counts, one busy moment of the host is not a regression.
+        for (uint32_t retry = 0; base && retry < BENCH_RETRIES && change_percent(r, base) > tolerance; retry++) {
+            bench_result again;
+            if (run_workload(all[i], repeat, &again) == 0 && again.best < r->best) {
+                *r = again;
+            }
+        }
+        fprintf(g_Console, "%-40s %8u %14.2f %14.2f\n", r->name, r->ops, r->best, r->median);
+        if (baseline_path == NULL || update) {
+            continue;
+        }
+        if (base == NULL) {
+            fprintf(g_Console, "[bench] %s has no baseline\n", r->name);
+        } else if (change_percent(r, base) > tolerance) {
+            fprintf(g_Console, "[bench] REGRESSION %s: %.2f ns/op, baseline %.2f ns/op (%+.1f%%, limit %+.1f%%)\n",
+                    r->name, r->best, base->ns_per_op, change_percent(r, base), tolerance);
+            regressions++;
+        }
+    }
+
+    if (out_path && write_results(out_path, result, count) != 0) {
+        return 2;
+    }
+    if (baseline_path == NULL) {
+        return failed ? 1 : 0;
+    }
+    if (update) {
+        if (failed) {
+            fprintf(g_Console, "[bench] %u workload(s) failed, baseline not written\n", failed);
+            return 1;
+        }
+        return write_baseline(baseline_path, result, count) ? 2 : 0;
+    }
+    if (regressions || failed) {
+        fprintf(g_Console, "[bench] FAILED: %u regression(s), %u failed workload(s)\n", regressions, failed);
+        return 1;
+    }
+    fprintf(g_Console, "[bench] %u workload(s) within %.0f%% of %s\n", count, tolerance, baseline_path);
+    return 0;
+}
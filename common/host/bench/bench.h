@@ -0,0 +1,90 @@
+#pragma once
+
+// Benchmarks of the plugin hot paths on the host build, run by `make bench'.
+// Every workload draws its input from a fixed seed so runs are comparable. The
+// runner times `repeat' runs of `ops' operations, writes one CSV row per workload
+// and fails when a workload is slower than its row in baseline.csv allows.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct bench_workload {
+    const char *name;
+    uint32_t ops;
+    // Returns 0 when the workload can run, logs why not otherwise.
+    int (*setup)(void);
+    // Restores the input consumed by `run', not timed. May be NULL.
+    void (*prepare)(void);
+    // Runs `ops' operations and returns a checksum of their results.
+    uint64_t (*run)(uint32_t ops);
+    void (*teardown)(void);
+} bench_workload;
+
+typedef struct bench_rng {
+    uint64_t state;
+} bench_rng;
+
+// xorshift64*, the same seed gives the same stream on every host.
+static inline void bench_rng_seed(bench_rng *rng, uint64_t seed)
+{
+    rng->state = seed ? seed : 0x9E3779B97F4A7C15ull;
+}
+
+static inline uint64_t bench_rng_next(bench_rng *rng)
+{
+    uint64_t x = rng->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+static inline uint32_t bench_rng_range(bench_rng *rng, uint32_t bound)
+{
+    return (uint32_t)(bench_rng_next(rng) % bound);
+}
+
+void bench_fill(bench_rng *rng, void *out, size_t size);
+
+/**
+ * @brief dlopens bin/host/<plugin>.so, optionally running its plugin_load.
+ * @param plugin
+ * @param load
+ * @return void* dlopen handle, NULL on failure
+ */
+void *bench_plugin_open(const char *plugin, int load);
+
+/**
+ * @brief Runs plugin_unload of `handle'. The plugin stays mapped, its detours point into it.
+ * @param handle
+ */
+void bench_plugin_unload(void *handle);
+
+/**
+ * @brief Looks up `symbol' in `handle', logs when it is missing.
+ * @param handle
+ * @param symbol
+ * @return void*
+ */
+void *bench_symbol(void *handle, const char *symbol);
+
+/**
+ * @brief Writes `size' bytes to `path' below the host root, creating its directories.
+ * @param path
+ * @param data
+ * @param size
+ * @return int 0 on success
+ */
+int bench_write_file(const char *path, const void *data, size_t size);
+
+extern const bench_workload g_GamePatchWorkloads[];
+extern const bench_workload g_PluginWorkloads[];
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,166 @@
+// game_patch workloads. patch.cpp and utils.cpp are built into the runner, game_patch
+// itself needs libmxml which the host build may skip.
+
+#include "bench.h"
+#include "host.h"
+#include "patch.h"
+#include "utils.h"
+
+#define SCAN_IMAGE_SIZE (4u << 20)
+#define PATCH_IMAGE_SIZE (1u << 20)
+#define HEX_STRINGS 1024
+#define PATCH_LINES 1024
+
+static u8 *g_ScanImage;
+static char g_Signature[128];
+
+static char *g_HexString[HEX_STRINGS];
+
+typedef struct patch_line {
+    const char *type;
+    u64 offset;
+    char value[160];
+} patch_line;
+
+static u8 *g_PatchImage;
+static patch_line *g_PatchLine;
+
+static int pattern_scan_setup(void)
+{
+    bench_rng rng;
+    bench_rng_seed(&rng, 0x5CA11);
+    g_ScanImage = (u8 *)malloc(SCAN_IMAGE_SIZE);
+    if (g_ScanImage == nullptr) {
+        return -1;
+    }
+    bench_fill(&rng, g_ScanImage, SCAN_IMAGE_SIZE);
+    // IDA style signature of 24 bytes near the end of the image, two of them wildcards.
+    const u8 *target = g_ScanImage + SCAN_IMAGE_SIZE - (SCAN_IMAGE_SIZE / 8) + bench_rng_range(&rng, 4096);
+    char *out = g_Signature;
+    for (u32 i = 0; i < 24; i++) {
+        if (i == 5 || i == 17) {
+            out += sprintf(out, i ? " ??" : "??");
+        } else {
+            out += sprintf(out, i ? " %02X" : "%02X", target[i]);
+        }
+    }
+    return 0;
+}
+
+static uint64_t pattern_scan_run(uint32_t ops)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < ops; i++) {
+        sum += (uint64_t)(PatternScan((uint64_t)g_ScanImage, SCAN_IMAGE_SIZE, g_Signature) - g_ScanImage);
+    }
+    return sum;
+}
+
+static void pattern_scan_teardown(void)
+{
+    free(g_ScanImage);
+}
+
+static int hexstrtochar2_setup(void)
+{
+    static const char digits[] = "0123456789ABCDEFabcdef";
+    bench_rng rng;
+    bench_rng_seed(&rng, 0x4E58);
+    for (u32 i = 0; i < HEX_STRINGS; i++) {
+        const u32 length = 8 + bench_rng_range(&rng, 249);
+        g_HexString[i] = (char *)malloc(length + 1);
+        if (g_HexString[i] == nullptr) {
+            return -1;
+        }
+        for (u32 j = 0; j < length; j++) {
+            g_HexString[i][j] = digits[bench_rng_range(&rng, sizeof(digits) - 1)];
+        }
+        g_HexString[i][length] = '\0';
+    }
+    return 0;
+}
+
+static uint64_t hexstrtochar2_run(uint32_t ops)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < ops; i++) {
+        s64 size = 0;
+        u8 *data = hexstrtochar2(g_HexString[i % HEX_STRINGS], &size);
+        if (data) {
+            sum += (uint64_t)size + data[0];
+            plugin_heap_free(data);
+        }
+    }
+    return sum;
+}
+
+static void hexstrtochar2_teardown(void)
+{
+    for (u32 i = 0; i < HEX_STRINGS; i++) {
+        free(g_HexString[i]);
+        g_HexString[i] = nullptr;
+    }
+}
+
+// Types and value formats game patches use, weighted like the patch database.
+static int patch_data1_setup(void)
+{
+    static const char *types[] = { "byte", "bytes16", "bytes32", "bytes64", "bytes", "bytes", "bytes", "bytes",
+                                   "float32", "float64", "utf8", "utf16" };
+    bench_rng rng;
+    bench_rng_seed(&rng, 0xDA7A1);
+    g_PatchImage = (u8 *)calloc(1, PATCH_IMAGE_SIZE);
+    g_PatchLine = (patch_line *)calloc(PATCH_LINES, sizeof(patch_line));
+    if (g_PatchImage == nullptr || g_PatchLine == nullptr) {
+        return -1;
+    }
+    host_proc_image(g_PatchImage, PATCH_IMAGE_SIZE);
+    for (u32 i = 0; i < PATCH_LINES; i++) {
+        patch_line *line = &g_PatchLine[i];
+        line->type = types[bench_rng_range(&rng, sizeof(types) / sizeof(types[0]))];
+        line->offset = bench_rng_range(&rng, PATCH_IMAGE_SIZE - 256);
+        if (strcmp(line->type, "bytes") == 0) {
+            const u32 length = 2 * (1 + bench_rng_range(&rng, 64));
+            for (u32 j = 0; j < length; j++) {
+                line->value[j] = "0123456789abcdef"[bench_rng_range(&rng, 16)];
+            }
+        } else if (strncmp(line->type, "float", 5) == 0) {
+            snprintf(line->value, sizeof(line->value), "%.4f", (double)bench_rng_range(&rng, 1000000) / 100.0);
+        } else if (strncmp(line->type, "utf", 3) == 0) {
+            snprintf(line->value, sizeof(line->value), "Patched\\x20string\\n%u", bench_rng_range(&rng, 100000));
+        } else if (bench_rng_range(&rng, 2)) {
+            snprintf(line->value, sizeof(line->value), "0x%lx", (unsigned long)(bench_rng_next(&rng) & 0x7fffffff));
+        } else {
+            snprintf(line->value, sizeof(line->value), "%u", bench_rng_range(&rng, 0x7fffffff));
+        }
+    }
+    return 0;
+}
+
+static uint64_t patch_data1_run(uint32_t ops)
+{
+    const u64 base = (u64)g_PatchImage;
+    for (uint32_t i = 0; i < ops; i++) {
+        const patch_line *line = &g_PatchLine[i % PATCH_LINES];
+        patch_data1(line->type, base + line->offset, line->value, 0, 0);
+    }
+    uint64_t sum = 0;
+    for (u32 i = 0; i < PATCH_IMAGE_SIZE; i += 64) {
+        sum += g_PatchImage[i];
+    }
+    return sum;
+}
+
+static void patch_data1_teardown(void)
+{
+    host_proc_image(nullptr, 0);
+    free(g_PatchLine);
+    free(g_PatchImage);
+}
+
+extern "C" const bench_workload g_GamePatchWorkloads[] = {
+    { "game_patch.PatternScan", 2, pattern_scan_setup, nullptr, pattern_scan_run, pattern_scan_teardown },
+    { "game_patch.hexstrtochar2", 16384, hexstrtochar2_setup, nullptr, hexstrtochar2_run, hexstrtochar2_teardown },
+    { "game_patch.patch_data1", 16384, patch_data1_setup, nullptr, patch_data1_run, patch_data1_teardown },
+    { nullptr, 0, nullptr, nullptr, nullptr, nullptr },
+};
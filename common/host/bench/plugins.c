@@ -0,0 +1,479 @@
+// Workloads of the plugins built by `make host': gamepad_helper, psc-bridge, plugin_loader,
+// afr and aio_fix_505. Plugin functions are reached through dlsym, hooks through
+// host_hook_target() like a game call would reach them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Common.h"
+#include "bench.h"
+#include "host.h"
+#include "plugin_common.h"
+#include <orbis/Pad.h>
+#include <orbis/UserService.h>
+
+#define PAD_FRAMES 4096
+#define USB_REPORT_SIZE 64
+#define INI_SECTIONS 96
+#define AFR_FILES 256
+#define AIO_FILE_SIZE (4u << 20)
+#define AIO_BLOCK 16384
+#define AIO_BATCH 4
+
+#define BENCH_DATA GOLDHEN_PATH "/bench"
+
+typedef int (*pad_filter_t)(OrbisPadData *);
+typedef int (*pad_handle_filter_t)(int32_t, OrbisPadData *);
+typedef int32_t (*pad_read_t)(int32_t, OrbisPadData *, int32_t);
+typedef void (*translate_t)(const uint8_t *, OrbisPadData *);
+typedef void *(*ini_create_t)(void);
+typedef bool (*ini_read_t)(void *, const char *);
+typedef void (*ini_destroy_t)(void *);
+typedef int32_t (*open_t)(const char *, int32_t, OrbisKernelMode);
+typedef FILE *(*fopen_t)(const char *, const char *);
+
+// Same layout as aio_fix_505 and the shim.
+typedef struct bench_aio_result {
+    int64_t returnValue;
+    uint32_t state;
+} bench_aio_result;
+
+typedef struct bench_aio_request {
+    off_t offset;
+    int64_t nbyte;
+    void *buf;
+    bench_aio_result *result;
+    int32_t fd;
+} bench_aio_request;
+
+typedef int32_t (*aio_submit_t)(bench_aio_request *, int32_t, int32_t, int32_t *);
+typedef int32_t (*aio_wait_t)(int32_t, int32_t *, uint32_t *);
+
+//
+// gamepad_helper
+//
+
+static const char g_GamepadIni[] =
+    "[default]\n"
+    "enableDeadZone=true\n"
+    "DeadZoneLeft=20\n"
+    "DeadZoneRight=16\n"
+    "enableCustomTouchPad=true\n"
+    "TOUCH_L1=BUTTON_L1\n"
+    "TOUCH_R1=BUTTON_R1\n"
+    "TOUCH_L2=BUTTON_L2\n"
+    "TOUCH_R2=BUTTON_R2\n"
+    "enableCustomButton=true\n"
+    "BUTTON_CROSS=BUTTON_CIRCLE\n"
+    "BUTTON_CIRCLE=BUTTON_CROSS\n"
+    "BUTTON_SQUARE=BUTTON_TRIANGLE\n"
+    "BUTTON_TRIANGLE=BUTTON_SQUARE\n"
+    "BUTTON_L1=BUTTON_L2\n"
+    "BUTTON_L2=BUTTON_L1\n";
+
+static void *g_Gamepad;
+static pad_filter_t g_DeadzoneApply;
+static pad_handle_filter_t g_CustomButton;
+static pad_handle_filter_t g_CustomTouchpad;
+static pad_read_t g_PadReadHook;
+static int32_t g_PadHandle;
+static OrbisPadData g_PadStream[PAD_FRAMES];
+static OrbisPadData g_PadWork[PAD_FRAMES];
+
+// Recorded-like input: sticks around the center, a few buttons held, touches all over the pad.
+static void pad_stream_generate(void)
+{
+    static const uint32_t buttons[] = { ORBIS_PAD_BUTTON_L3, ORBIS_PAD_BUTTON_R3, ORBIS_PAD_BUTTON_OPTIONS,
+                                        ORBIS_PAD_BUTTON_UP, ORBIS_PAD_BUTTON_RIGHT, ORBIS_PAD_BUTTON_DOWN,
+                                        ORBIS_PAD_BUTTON_LEFT, ORBIS_PAD_BUTTON_L2, ORBIS_PAD_BUTTON_R2,
+                                        ORBIS_PAD_BUTTON_L1, ORBIS_PAD_BUTTON_R1, ORBIS_PAD_BUTTON_TRIANGLE,
+                                        ORBIS_PAD_BUTTON_CIRCLE, ORBIS_PAD_BUTTON_CROSS, ORBIS_PAD_BUTTON_SQUARE };
+    bench_rng rng;
+    bench_rng_seed(&rng, 0x9AD);
+    memset(g_PadStream, 0, sizeof(g_PadStream));
+    for (uint32_t i = 0; i < PAD_FRAMES; i++) {
+        OrbisPadData *pad = &g_PadStream[i];
+        for (size_t b = 0; b < sizeof(buttons) / sizeof(buttons[0]); b++) {
+            if (bench_rng_range(&rng, 4) == 0) {
+                pad->buttons |= buttons[b];
+            }
+        }
+        if (bench_rng_range(&rng, 5) == 0) {
+            pad->buttons |= ORBIS_PAD_BUTTON_TOUCH_PAD;
+            pad->touch.fingers = 1;
+            pad->touch.touch[0].x = (uint16_t)bench_rng_range(&rng, 1920);
+            pad->touch.touch[0].y = (uint16_t)bench_rng_range(&rng, 942);
+        }
+        pad->leftStick.x = (uint8_t)(0x80 - 40 + bench_rng_range(&rng, 81));
+        pad->leftStick.y = (uint8_t)(0x80 - 40 + bench_rng_range(&rng, 81));
+        pad->rightStick.x = (uint8_t)(0x80 - 40 + bench_rng_range(&rng, 81));
+        pad->rightStick.y = (uint8_t)(0x80 - 40 + bench_rng_range(&rng, 81));
+        pad->connected = 1;
+        pad->timestamp = i * 16666ull;
+    }
+}
+
+static uint64_t pad_checksum(const OrbisPadData *pad, uint32_t count)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum = sum * 31 + pad[i].buttons + pad[i].leftStick.x + pad[i].rightStick.y;
+    }
+    return sum;
+}
+
+static int gamepad_setup(void)
+{
+    if (g_Gamepad) {
+        return 0;
+    }
+    if (bench_write_file(GOLDHEN_PATH "/gamepad.ini", g_GamepadIni, sizeof(g_GamepadIni) - 1)) {
+        return -1;
+    }
+    g_Gamepad = bench_plugin_open("gamepad_helper", 1);
+    if (g_Gamepad == NULL) {
+        return -1;
+    }
+    g_DeadzoneApply = (pad_filter_t)bench_symbol(g_Gamepad, "deadzone_apply");
+    g_CustomButton = (pad_handle_filter_t)bench_symbol(g_Gamepad, "custom_button");
+    g_CustomTouchpad = (pad_handle_filter_t)bench_symbol(g_Gamepad, "custom_touchpad");
+    g_PadReadHook = (pad_read_t)host_hook_target("scePadRead");
+    if (!g_DeadzoneApply || !g_CustomButton || !g_CustomTouchpad || !g_PadReadHook) {
+        return -1;
+    }
+    pad_stream_generate();
+    return 0;
+}
+
+static void gamepad_prepare(void)
+{
+    memcpy(g_PadWork, g_PadStream, sizeof(g_PadWork));
+}
+
+static uint64_t deadzone_apply_run(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        g_DeadzoneApply(&g_PadWork[i % PAD_FRAMES]);
+    }
+    return pad_checksum(g_PadWork, PAD_FRAMES);
+}
+
+static uint64_t custom_button_run(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        g_CustomButton(0, &g_PadWork[i % PAD_FRAMES]);
+    }
+    return pad_checksum(g_PadWork, PAD_FRAMES);
+}
+
+static uint64_t custom_touchpad_run(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        g_CustomTouchpad(0, &g_PadWork[i % PAD_FRAMES]);
+    }
+    return pad_checksum(g_PadWork, PAD_FRAMES);
+}
+
+static int pad_read_setup(void)
+{
+    if (gamepad_setup()) {
+        return -1;
+    }
+    int32_t user = 0;
+    sceUserServiceGetInitialUser(&user);
+    g_PadHandle = scePadOpen(user, 0, 0, NULL);
+    if (g_PadHandle < 0) {
+        return -1;
+    }
+    host_pad_frames(g_PadStream, PAD_FRAMES);
+    return 0;
+}
+
+// A full game read: the hook reads the replay and filters the frame.
+static uint64_t pad_read_run(uint32_t ops)
+{
+    uint64_t sum = 0;
+    OrbisPadData pad;
+    for (uint32_t i = 0; i < ops; i++) {
+        if (g_PadReadHook(g_PadHandle, &pad, 1) == 1) {
+            sum += pad.buttons;
+        }
+    }
+    return sum;
+}
+
+static void pad_read_teardown(void)
+{
+    host_pad_frames(NULL, 0);
+    scePadClose(g_PadHandle);
+    bench_plugin_unload(g_Gamepad);
+    g_Gamepad = NULL;
+}
+
+//
+// psc-bridge
+//
+
+static translate_t g_Translate;
+static uint8_t g_UsbReports[PAD_FRAMES][USB_REPORT_SIZE];
+
+static int translate_setup(void)
+{
+    void *bridge = bench_plugin_open("psc-bridge", 0);
+    if (bridge == NULL || (g_Translate = (translate_t)bench_symbol(bridge, "translate_ps5_to_ps4")) == NULL) {
+        return -1;
+    }
+    bench_rng rng;
+    bench_rng_seed(&rng, 0xD5);
+    bench_fill(&rng, g_UsbReports, sizeof(g_UsbReports));
+    for (uint32_t i = 0; i < PAD_FRAMES; i++) {
+        g_UsbReports[i][0] = 0x01;
+        // D-pad values above 8 are invalid, keep the released state in the mix.
+        g_UsbReports[i][8] = (uint8_t)((g_UsbReports[i][8] & 0xF0) | bench_rng_range(&rng, 9));
+    }
+    return 0;
+}
+
+static uint64_t translate_run(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        g_Translate(g_UsbReports[i % PAD_FRAMES], &g_PadWork[i % PAD_FRAMES]);
+    }
+    return pad_checksum(g_PadWork, PAD_FRAMES);
+}
+
+//
+// plugin_loader
+//
+
+static ini_create_t g_IniCreate;
+static ini_read_t g_IniRead;
+static ini_destroy_t g_IniDestroy;
+
+// plugins.ini of a user with many per-title sections.
+static int ini_read_setup(void)
+{
+    void *loader = bench_plugin_open("plugin_loader", 0);
+    if (loader == NULL) {
+        return -1;
+    }
+    g_IniCreate = (ini_create_t)bench_symbol(loader, "ini_table_create");
+    g_IniRead = (ini_read_t)bench_symbol(loader, "ini_table_read_from_file");
+    g_IniDestroy = (ini_destroy_t)bench_symbol(loader, "ini_table_destroy");
+    if (!g_IniCreate || !g_IniRead || !g_IniDestroy) {
+        return -1;
+    }
+    static const char *plugins[] = { "afr", "aio_fix_505", "button_swap", "fliprate_remover", "force_1080p_display",
+                                     "force_30_fps", "frame_logger", "game_patch", "gamepad_helper",
+                                     "no_share_watermark", "psc-bridge" };
+    bench_rng rng;
+    bench_rng_seed(&rng, 0x1A1);
+    size_t capacity = 1 << 20;
+    size_t size = 0;
+    char *ini = (char *)malloc(capacity);
+    if (ini == NULL) {
+        return -1;
+    }
+    size += snprintf(ini + size, capacity - size, "; plugins.ini\n[default]\n");
+    for (uint32_t s = 0; s < INI_SECTIONS && size < capacity - 4096; s++) {
+        if (s) {
+            size += snprintf(ini + size, capacity - size, "\n[CUSA%05u]\n", 10000 + bench_rng_range(&rng, 90000));
+        }
+        const uint32_t lines = 4 + bench_rng_range(&rng, 28);
+        for (uint32_t l = 0; l < lines; l++) {
+            const char *plugin = plugins[bench_rng_range(&rng, sizeof(plugins) / sizeof(plugins[0]))];
+            switch (bench_rng_range(&rng, 8)) {
+            case 0:
+                size += snprintf(ini + size, capacity - size, "; %s disabled\n", plugin);
+                break;
+            case 1:
+                size += snprintf(ini + size, capacity - size, "%s_option=%u\n", plugin, bench_rng_range(&rng, 1000));
+                break;
+            default:
+                size += snprintf(ini + size, capacity - size, "/data/GoldHEN/plugins/%s.prx\n", plugin);
+                break;
+            }
+        }
+    }
+    const int ret = bench_write_file(BENCH_DATA "/plugins.ini", ini, size);
+    free(ini);
+    return ret;
+}
+
+static uint64_t ini_read_run(uint32_t ops)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < ops; i++) {
+        void *table = g_IniCreate();
+        sum += g_IniRead(table, BENCH_DATA "/plugins.ini");
+        g_IniDestroy(table);
+    }
+    return sum;
+}
+
+//
+// afr
+//
+
+static void *g_Afr;
+static open_t g_OpenHook;
+static fopen_t g_FopenHook;
+static char g_AfrPath[AFR_FILES][64];
+
+// Every file exists in /app0, even ones also have an override in the AFR folder.
+static int afr_setup(void)
+{
+    if (g_Afr) {
+        return 0;
+    }
+    char path[128];
+    for (uint32_t i = 0; i < AFR_FILES; i++) {
+        snprintf(g_AfrPath[i], sizeof(g_AfrPath[i]), "/app0/data/level%02u/asset_%03u.bin", i % 16, i);
+        if (bench_write_file(g_AfrPath[i], g_AfrPath[i], strlen(g_AfrPath[i]))) {
+            return -1;
+        }
+        if ((i & 1) == 0) {
+            snprintf(path, sizeof(path), GOLDHEN_PATH "/AFR/%s/%s", getenv(HOST_TITLEID_ENV), g_AfrPath[i] + 6);
+            if (bench_write_file(path, path, strlen(path))) {
+                return -1;
+            }
+        }
+    }
+    g_Afr = bench_plugin_open("afr", 1);
+    if (g_Afr == NULL) {
+        return -1;
+    }
+    g_OpenHook = (open_t)host_hook_target("sceKernelOpen");
+    g_FopenHook = (fopen_t)host_hook_target("fopen");
+    return g_OpenHook && g_FopenHook ? 0 : -1;
+}
+
+static uint64_t afr_open(uint32_t ops, uint32_t first)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < ops; i++) {
+        const int32_t fd = g_OpenHook(g_AfrPath[(first + 2 * i) % AFR_FILES], 0, 0);
+        if (fd >= 0) {
+            sum++;
+            sceKernelClose(fd);
+        }
+    }
+    return sum;
+}
+
+static uint64_t afr_open_redirected_run(uint32_t ops)
+{
+    return afr_open(ops, 0);
+}
+
+static uint64_t afr_open_passthrough_run(uint32_t ops)
+{
+    return afr_open(ops, 1);
+}
+
+static uint64_t afr_fopen_run(uint32_t ops)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < ops; i++) {
+        FILE *f = g_FopenHook(g_AfrPath[i % AFR_FILES], "rb");
+        if (f) {
+            sum++;
+            fclose(f);
+        }
+    }
+    return sum;
+}
+
+static void afr_teardown(void)
+{
+    bench_plugin_unload(g_Afr);
+    g_Afr = NULL;
+}
+
+//
+// aio_fix_505
+//
+
+static void *g_Aio;
+static aio_submit_t g_AioSubmit;
+static aio_wait_t g_AioWait;
+static int32_t g_AioFd = -1;
+static uint8_t *g_AioBuffer;
+static off_t g_AioOffset[256];
+
+static int aio_setup(void)
+{
+    bench_rng rng;
+    bench_rng_seed(&rng, 0xA10);
+    uint8_t *data = (uint8_t *)malloc(AIO_FILE_SIZE);
+    g_AioBuffer = (uint8_t *)malloc(AIO_BLOCK * AIO_BATCH);
+    if (data == NULL || g_AioBuffer == NULL) {
+        free(data);
+        return -1;
+    }
+    bench_fill(&rng, data, AIO_FILE_SIZE);
+    const int ret = bench_write_file(BENCH_DATA "/aio.bin", data, AIO_FILE_SIZE);
+    free(data);
+    if (ret) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < sizeof(g_AioOffset) / sizeof(g_AioOffset[0]); i++) {
+        g_AioOffset[i] = (off_t)bench_rng_range(&rng, AIO_FILE_SIZE / AIO_BLOCK) * AIO_BLOCK;
+    }
+    g_Aio = bench_plugin_open("aio_fix_505", 1);
+    if (g_Aio == NULL) {
+        return -1;
+    }
+    g_AioSubmit = (aio_submit_t)host_hook_target("sceKernelAioSubmitReadCommands");
+    g_AioWait = (aio_wait_t)host_hook_target("sceKernelAioWaitRequest");
+    g_AioFd = sceKernelOpen(BENCH_DATA "/aio.bin", 0, 0);
+    return g_AioSubmit && g_AioWait && g_AioFd >= 0 ? 0 : -1;
+}
+
+// One operation: a batch of reads submitted and waited for, like a streaming game.
+static uint64_t aio_run(uint32_t ops)
+{
+    uint64_t sum = 0;
+    bench_aio_result result[AIO_BATCH];
+    bench_aio_request req[AIO_BATCH];
+    for (uint32_t i = 0; i < ops; i++) {
+        for (uint32_t r = 0; r < AIO_BATCH; r++) {
+            req[r].offset = g_AioOffset[(i * AIO_BATCH + r) % 256];
+            req[r].nbyte = AIO_BLOCK;
+            req[r].buf = g_AioBuffer + r * AIO_BLOCK;
+            req[r].result = &result[r];
+            req[r].fd = g_AioFd;
+        }
+        int32_t id = 0;
+        int32_t state = 0;
+        uint32_t usec = 0;
+        if (g_AioSubmit(req, AIO_BATCH, 0, &id) == 0 && g_AioWait(id, &state, &usec) == 0) {
+            sum += (uint64_t)state + (uint64_t)result[AIO_BATCH - 1].returnValue;
+        }
+    }
+    return sum;
+}
+
+static void aio_teardown(void)
+{
+    sceKernelClose(g_AioFd);
+    free(g_AioBuffer);
+    bench_plugin_unload(g_Aio);
+    g_Aio = NULL;
+}
+
+// gamepad_helper runs before plugin_loader is mapped, its config then comes from gamepad.ini.
+const bench_workload g_PluginWorkloads[] = {
+    { "gamepad_helper.deadzone_apply", 65536, gamepad_setup, gamepad_prepare, deadzone_apply_run, NULL },
+    { "gamepad_helper.custom_button", 65536, gamepad_setup, gamepad_prepare, custom_button_run, NULL },
+    { "gamepad_helper.custom_touchpad", 65536, gamepad_setup, gamepad_prepare, custom_touchpad_run, NULL },
+    { "gamepad_helper.scePadRead", 65536, pad_read_setup, NULL, pad_read_run, pad_read_teardown },
+    { "psc-bridge.translate_ps5_to_ps4", 65536, translate_setup, NULL, translate_run, NULL },
+    { "plugin_loader.ini_table_read_from_file", 32, ini_read_setup, NULL, ini_read_run, NULL },
+    { "afr.sceKernelOpen_redirected", 4096, afr_setup, NULL, afr_open_redirected_run, NULL },
+    { "afr.sceKernelOpen_passthrough", 4096, afr_setup, NULL, afr_open_passthrough_run, NULL },
+    { "afr.fopen", 4096, afr_setup, NULL, afr_fopen_run, afr_teardown },
+    { "aio_fix_505.submit_wait", 4096, aio_setup, NULL, aio_run, aio_teardown },
+    { NULL, 0, NULL, NULL, NULL, NULL },
+};
@@ -0,0 +1,567 @@
+// Pad and USB replay, video out and the system services the plugins touch.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Common.h"
+#include "host.h"
+#include "shim.h"
+
+#include <orbis/Pad.h>
+#include <orbis/Remoteplay.h>
+#include <orbis/ScreenShot.h>
+#include <orbis/Sysmodule.h>
+#include <orbis/SystemService.h>
+#include <orbis/Usbd.h>
+#include <orbis/UserService.h>
+#include <orbis/VideoOut.h>
+#include <orbis/VideoRecording.h>
+
+_Static_assert(sizeof(OrbisPadData) == HOST_PAD_RECORD_SIZE, "OrbisPadData layout");
+
+#define HOST_PAD_HANDLE 1
+#define HOST_USER_ID    0x10000000
+
+static void *host_read_file(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        klog("host: can not open %s\n", path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    const long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    void *data = len > 0 ? malloc((size_t)len) : NULL;
+    if (data == NULL || fread(data, 1, (size_t)len, f) != (size_t)len) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = (size_t)len;
+    return data;
+}
+
+//
+// Pad
+//
+
+static const OrbisPadData *g_PadFrames = NULL;
+static size_t g_PadFrameCount = 0;
+static uint64_t g_PadCursor = 0;
+static void *g_PadFile = NULL;
+static bool g_PadOpened = false;
+static bool g_PadEnvChecked = false;
+
+void host_pad_frames(const void *records, size_t count)
+{
+    g_PadFrames = (const OrbisPadData *)records;
+    g_PadFrameCount = records ? count : 0;
+    g_PadCursor = 0;
+}
+
+int host_pad_replay(const char *path)
+{
+    free(g_PadFile);
+    g_PadFile = NULL;
+    host_pad_frames(NULL, 0);
+    if (path == NULL) {
+        return 0;
+    }
+    size_t size = 0;
+    void *data = host_read_file(path, &size);
+    if (data == NULL || size < sizeof(OrbisPadData)) {
+        free(data);
+        return -1;
+    }
+    g_PadFile = data;
+    host_pad_frames(data, size / sizeof(OrbisPadData));
+    return 0;
+}
+
+static void host_pad_next(OrbisPadData *data)
+{
+    if (!g_PadEnvChecked) {
+        const char *path = getenv(HOST_PAD_ENV);
+        g_PadEnvChecked = true;
+        if (path && path[0] && g_PadFrames == NULL) {
+            host_pad_replay(path);
+        }
+    }
+    if (g_PadFrameCount == 0) {
+        memset(data, 0, sizeof(*data));
+        data->timestamp = sceKernelGetProcessTimeCounter();
+        return;
+    }
+    const uint64_t index = __atomic_fetch_add(&g_PadCursor, 1, __ATOMIC_RELAXED) % g_PadFrameCount;
+    memcpy(data, &g_PadFrames[index], sizeof(*data));
+}
+
+int32_t scePadInit(void)
+{
+    return 0;
+}
+
+int32_t scePadOpen(int32_t userId, int32_t type, int32_t index, void *param)
+{
+    (void)userId;
+    (void)type;
+    (void)index;
+    (void)param;
+    if (g_PadOpened) {
+        return ORBIS_PAD_ERROR_ALREADY_OPENED;
+    }
+    g_PadOpened = true;
+    return HOST_PAD_HANDLE;
+}
+
+int32_t scePadClose(int32_t handle)
+{
+    if (handle != HOST_PAD_HANDLE || !g_PadOpened) {
+        return ORBIS_PAD_ERROR_INVALID_HANDLE;
+    }
+    g_PadOpened = false;
+    return 0;
+}
+
+int32_t scePadGetHandle(int32_t userId, int32_t type, int32_t index)
+{
+    (void)userId;
+    (void)type;
+    (void)index;
+    return g_PadOpened ? HOST_PAD_HANDLE : ORBIS_PAD_ERROR_NOT_INITIALIZED;
+}
+
+// Returns `count' consecutive replay frames, or one disconnected frame without a replay.
+int32_t scePadRead(int32_t handle, OrbisPadData *data, int32_t count)
+{
+    if (handle != HOST_PAD_HANDLE) {
+        return ORBIS_PAD_ERROR_INVALID_HANDLE;
+    }
+    if (data == NULL || count <= 0) {
+        return ORBIS_PAD_ERROR_INVALID_ARG;
+    }
+    host_pad_next(&data[0]);
+    if (g_PadFrameCount == 0) {
+        return 1;
+    }
+    for (int32_t i = 1; i < count; i++) {
+        host_pad_next(&data[i]);
+    }
+    return count;
+}
+
+int32_t scePadReadState(int32_t handle, OrbisPadData *data)
+{
+    if (handle != HOST_PAD_HANDLE) {
+        return ORBIS_PAD_ERROR_INVALID_HANDLE;
+    }
+    if (data == NULL) {
+        return ORBIS_PAD_ERROR_INVALID_ARG;
+    }
+    host_pad_next(data);
+    return 0;
+}
+
+int32_t scePadReadExt(int32_t handle, OrbisPadData *data, int32_t count)
+{
+    return scePadRead(handle, data, count);
+}
+
+int32_t scePadReadStateExt(int32_t handle, OrbisPadData *data)
+{
+    return scePadReadState(handle, data);
+}
+
+int32_t scePadSetVibration(int32_t handle, const OrbisPadVibeParam *param)
+{
+    (void)param;
+    return handle == HOST_PAD_HANDLE ? 0 : ORBIS_PAD_ERROR_INVALID_HANDLE;
+}
+
+int32_t scePadSetLightBar(int32_t handle, const void *param)
+{
+    (void)param;
+    return handle == HOST_PAD_HANDLE ? 0 : ORBIS_PAD_ERROR_INVALID_HANDLE;
+}
+
+//
+// Usbd
+//
+
+struct libusb_context {
+    int unused;
+};
+
+struct libusb_device {
+    int unused;
+};
+
+struct libusb_device_handle {
+    int unused;
+};
+
+static struct libusb_context g_UsbdContext;
+static struct libusb_device g_UsbdDevice;
+static struct libusb_device_handle g_UsbdHandle;
+
+static uint8_t *g_UsbdFile = NULL;
+static host_usbd_header g_UsbdHeader;
+static uint32_t *g_UsbdReports = NULL; // offsets of the { u16 length, data } records
+static size_t g_UsbdReportCount = 0;
+static uint64_t g_UsbdCursor = 0;
+static bool g_UsbdEnvChecked = false;
+
+int host_usbd_replay(const char *path)
+{
+    free(g_UsbdFile);
+    free(g_UsbdReports);
+    g_UsbdFile = NULL;
+    g_UsbdReports = NULL;
+    g_UsbdReportCount = 0;
+    g_UsbdCursor = 0;
+    if (path == NULL) {
+        return 0;
+    }
+    size_t size = 0;
+    uint8_t *data = (uint8_t *)host_read_file(path, &size);
+    if (data == NULL || size < sizeof(host_usbd_header) || ((host_usbd_header *)data)->magic != HOST_USBD_MAGIC) {
+        klog("host: %s is not a USB replay\n", path);
+        free(data);
+        return -1;
+    }
+    size_t count = 0;
+    for (size_t off = sizeof(host_usbd_header); off + 2 <= size; count++) {
+        uint16_t len;
+        memcpy(&len, data + off, sizeof(len));
+        off += 2 + len;
+    }
+    uint32_t *reports = (uint32_t *)calloc(count ? count : 1, sizeof(*reports));
+    if (reports == NULL) {
+        free(data);
+        return -1;
+    }
+    size_t n = 0;
+    for (size_t off = sizeof(host_usbd_header); off + 2 <= size && n < count; n++) {
+        uint16_t len;
+        memcpy(&len, data + off, sizeof(len));
+        if (off + 2 + len > size) {
+            break;
+        }
+        reports[n] = (uint32_t)off;
+        off += 2 + len;
+    }
+    memcpy(&g_UsbdHeader, data, sizeof(g_UsbdHeader));
+    g_UsbdFile = data;
+    g_UsbdReports = reports;
+    g_UsbdReportCount = n;
+    return 0;
+}
+
+static bool host_usbd_attached(void)
+{
+    if (!g_UsbdEnvChecked) {
+        const char *path = getenv(HOST_USBD_ENV);
+        g_UsbdEnvChecked = true;
+        if (path && path[0] && g_UsbdFile == NULL) {
+            host_usbd_replay(path);
+        }
+    }
+    return g_UsbdFile != NULL;
+}
+
+int32_t sceUsbdInit(struct libusb_context **ctx)
+{
+    if (ctx) {
+        *ctx = &g_UsbdContext;
+    }
+    return 0;
+}
+
+void sceUsbdExit(struct libusb_context *ctx)
+{
+    (void)ctx;
+}
+
+ssize_t sceUsbdGetDeviceList(struct libusb_device ***list)
+{
+    struct libusb_device **devs = (struct libusb_device **)calloc(2, sizeof(*devs));
+    if (devs == NULL) {
+        return LIBUSB_ERROR_IO;
+    }
+    const bool attached = host_usbd_attached();
+    devs[0] = attached ? &g_UsbdDevice : NULL;
+    *list = devs;
+    return attached ? 1 : 0;
+}
+
+void sceUsbdFreeDeviceList(struct libusb_device **list)
+{
+    free(list);
+}
+
+int32_t sceUsbdGetDeviceDescriptor(struct libusb_device *dev, struct libusb_device_descriptor *desc)
+{
+    if (dev != &g_UsbdDevice || !host_usbd_attached()) {
+        return LIBUSB_ERROR_NO_DEVICE;
+    }
+    memset(desc, 0, sizeof(*desc));
+    desc->bLength = sizeof(*desc);
+    desc->bDescriptorType = 1;
+    desc->idVendor = g_UsbdHeader.vendor;
+    desc->idProduct = g_UsbdHeader.product;
+    desc->bNumConfigurations = 1;
+    return 0;
+}
+
+int32_t sceUsbdOpen(struct libusb_device *dev, struct libusb_device_handle **handle)
+{
+    if (dev != &g_UsbdDevice || !host_usbd_attached()) {
+        return LIBUSB_ERROR_NO_DEVICE;
+    }
+    *handle = &g_UsbdHandle;
+    return 0;
+}
+
+void sceUsbdClose(struct libusb_device_handle *handle)
+{
+    (void)handle;
+}
+
+int32_t sceUsbdClaimInterface(struct libusb_device_handle *handle, int32_t iface)
+{
+    (void)iface;
+    return handle == &g_UsbdHandle ? 0 : LIBUSB_ERROR_NO_DEVICE;
+}
+
+int32_t sceUsbdReleaseInterface(struct libusb_device_handle *handle, int32_t iface)
+{
+    (void)iface;
+    return handle == &g_UsbdHandle ? 0 : LIBUSB_ERROR_NO_DEVICE;
+}
+
+int32_t sceUsbdInterruptTransfer(struct libusb_device_handle *handle, uint8_t endpoint, uint8_t *data, int32_t length,
+                                 int32_t *transferred, uint32_t timeout)
+{
+    (void)timeout;
+    if (handle != &g_UsbdHandle || !host_usbd_attached()) {
+        return LIBUSB_ERROR_NO_DEVICE;
+    }
+    if (!(endpoint & 0x80)) {
+        *transferred = length;
+        return 0;
+    }
+    if (g_UsbdReportCount == 0) {
+        *transferred = 0;
+        return LIBUSB_ERROR_TIMEOUT;
+    }
+    const uint64_t index = __atomic_fetch_add(&g_UsbdCursor, 1, __ATOMIC_RELAXED) % g_UsbdReportCount;
+    const uint8_t *record = g_UsbdFile + g_UsbdReports[index];
+    uint16_t len;
+    memcpy(&len, record, sizeof(len));
+    const int32_t copy = len < length ? len : length;
+    memcpy(data, record + 2, (size_t)copy);
+    *transferred = copy;
+    return 0;
+}
+
+//
+// Video out and Gnm
+//
+
+int32_t sceVideoOutOpen(int32_t userId, int32_t type, int32_t index, const void *param)
+{
+    (void)userId;
+    (void)type;
+    (void)index;
+    (void)param;
+    return 1;
+}
+
+int32_t sceVideoOutClose(int32_t handle)
+{
+    (void)handle;
+    return 0;
+}
+
+int32_t sceVideoOutSetFlipRate(int32_t handle, int32_t rate)
+{
+    (void)handle;
+    (void)rate;
+    return 0;
+}
+
+// Flips are shown as soon as they are submitted, the flip event carries the flip argument.
+#define HOST_EVFILT_VIDEO_OUT (-13)
+
+static uint64_t g_FlipCount = 0;
+static uint64_t g_FlipProcessTime = 0;
+static int64_t g_FlipArg = 0;
+static int32_t g_FlipBuffer = -1;
+static pthread_mutex_t g_FlipLock = PTHREAD_MUTEX_INITIALIZER;
+
+int32_t sceVideoOutSubmitFlip(int32_t handle, int32_t indexBuffer, int32_t flipMode, int64_t flipArg)
+{
+    (void)handle;
+    (void)flipMode;
+    const uint64_t now = sceKernelGetProcessTimeCounter();
+    pthread_mutex_lock(&g_FlipLock);
+    g_FlipCount++;
+    g_FlipProcessTime = now * 1000000 / sceKernelGetProcessTimeCounterFrequency();
+    g_FlipArg = flipArg;
+    g_FlipBuffer = indexBuffer;
+    pthread_mutex_unlock(&g_FlipLock);
+    host_equeue_trigger(ORBIS_VIDEO_OUT_EVENT_FLIP, HOST_EVFILT_VIDEO_OUT, flipArg);
+    return 0;
+}
+
+int32_t sceVideoOutAddFlipEvent(OrbisKernelEqueue eq, int32_t handle, void *udata)
+{
+    (void)handle;
+    return host_equeue_add(eq, ORBIS_VIDEO_OUT_EVENT_FLIP, HOST_EVFILT_VIDEO_OUT, udata);
+}
+
+int32_t sceVideoOutGetFlipStatus(int32_t handle, OrbisVideoOutFlipStatus *status)
+{
+    (void)handle;
+    memset(status, 0, sizeof(*status));
+    pthread_mutex_lock(&g_FlipLock);
+    status->count = g_FlipCount;
+    status->processTime = g_FlipProcessTime;
+    status->flipArg = g_FlipArg;
+    status->currentBuffer = g_FlipBuffer;
+    pthread_mutex_unlock(&g_FlipLock);
+    return 0;
+}
+
+int32_t sceVideoOutGetResolutionStatus(int32_t handle, OrbisVideoOutResolutionStatus *status)
+{
+    (void)handle;
+    memset(status, 0, sizeof(*status));
+    status->width = 3840;
+    status->height = 2160;
+    status->paneWidth = 3840;
+    status->paneHeight = 2160;
+    return 0;
+}
+
+int32_t sceGnmSubmitAndFlipCommandBuffers(uint32_t count, void *dcbGpuAddrs[], uint32_t *dcbSizesInBytes,
+                                          void *ccbGpuAddrs[], uint32_t *ccbSizesInBytes, uint32_t videoOutHandle,
+                                          uint32_t displayBufferIndex, uint32_t flipMode, int64_t flipArg)
+{
+    (void)count;
+    (void)dcbGpuAddrs;
+    (void)dcbSizesInBytes;
+    (void)ccbGpuAddrs;
+    (void)ccbSizesInBytes;
+    return sceVideoOutSubmitFlip((int32_t)videoOutHandle, (int32_t)displayBufferIndex, (int32_t)flipMode, flipArg);
+}
+
+int32_t sceGnmSubmitAndFlipCommandBuffersForWorkload(uint64_t workload, uint32_t count, void *dcbGpuAddrs[],
+                                                     uint32_t *dcbSizesInBytes, void *ccbGpuAddrs[],
+                                                     uint32_t *ccbSizesInBytes, uint32_t videoOutHandle,
+                                                     uint32_t displayBufferIndex, uint32_t flipMode, int64_t flipArg)
+{
+    (void)workload;
+    return sceGnmSubmitAndFlipCommandBuffers(count, dcbGpuAddrs, dcbSizesInBytes, ccbGpuAddrs, ccbSizesInBytes,
+                                             videoOutHandle, displayBufferIndex, flipMode, flipArg);
+}
+
+//
+// System services
+//
+
+int32_t sceSysmoduleLoadModule(uint16_t id)
+{
+    (void)id;
+    return 0;
+}
+
+int32_t sceSysmoduleUnloadModule(uint16_t id)
+{
+    (void)id;
+    return 0;
+}
+
+int32_t sceUserServiceInitialize(OrbisUserServiceInitializeParams *params)
+{
+    (void)params;
+    return 0;
+}
+
+int32_t sceUserServiceGetInitialUser(int32_t *userId)
+{
+    *userId = HOST_USER_ID;
+    return 0;
+}
+
+int32_t sceSystemServiceParamGetInt(int32_t paramId, int32_t *value)
+{
+    switch (paramId) {
+    case ORBIS_SYSTEM_SERVICE_PARAM_ID_LANG:
+        *value = 1; // English (United States)
+        break;
+    case ORBIS_SYSTEM_SERVICE_PARAM_ID_ENTER_BUTTON_ASSIGN:
+        *value = 1; // cross
+        break;
+    default:
+        *value = 0;
+        break;
+    }
+    return 0;
+}
+
+int32_t sceScreenShotDisable(void)
+{
+    return 0;
+}
+
+int32_t sceScreenShotEnable(void)
+{
+    return 0;
+}
+
+int32_t sceScreenShotSetOverlayImage(const char *path, int32_t offsetX, int32_t offsetY)
+{
+    (void)path;
+    (void)offsetX;
+    (void)offsetY;
+    return 0;
+}
+
+int32_t sceScreenShotSetOverlayImageWithOrigin(const char *path, int32_t marginX, int32_t marginY, int32_t origin)
+{
+    (void)path;
+    (void)marginX;
+    (void)marginY;
+    (void)origin;
+    return 0;
+}
+
+int32_t sceRemoteplayProhibit(void)
+{
+    return 0;
+}
+
+int32_t sceRemoteplayProhibitStreaming(int32_t mode)
+{
+    (void)mode;
+    return 0;
+}
+
+int32_t sceRemoteplayApprove(void)
+{
+    return 0;
+}
+
+int32_t sceVideoRecordingSetInfo(int32_t infoType, const void *info, int64_t size)
+{
+    (void)infoType;
+    (void)info;
+    (void)size;
+    return 0;
+}
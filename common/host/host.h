@@ -0,0 +1,109 @@
+#pragma once
+
+// Host build of the plugins.
+// `make host' compiles every plugin as bin/host/<plugin>.so against the headers in this
+// directory and links it to bin/host/libgoldhen_host.so, which implements them on Linux:
+//     - sceKernel file calls on POSIX files, absolute paths are resolved below
+//       GOLDHEN_HOST_ROOT (default `./host_root'), also for libc calls of plugin code,
+//       `.prx' modules load the matching `.so', module_start runs on load
+//     - threads, mutexes, time and memory on pthreads, clock_gettime and mmap
+//     - HOOK/HOOK32/UNHOOK record detours in a table instead of patching code,
+//       host_hook_target() returns what a game call would reach
+//     - scePad and sceUsbd serve recorded input, see the replay formats below
+//     - sys_sdk_proc_rw and the patcher write into a buffer set with host_proc_image()
+//     - klog goes to stderr, notifications to stdout
+// Extra flags: DEBUG=1, HOOK_STATS=1, TRACE=1, SANITIZE=address,undefined.
+//
+// Harnesses dlopen the plugin, call plugin_load and drive it through this API,
+// `make bench' runs the ones in bench/, see bench/bench.h.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOST_ROOT_ENV     "GOLDHEN_HOST_ROOT"
+#define HOST_TITLEID_ENV  "GOLDHEN_HOST_TITLEID"
+#define HOST_PAD_ENV      "GOLDHEN_HOST_PAD"
+#define HOST_USBD_ENV     "GOLDHEN_HOST_USBD"
+#define HOST_ROOT_DEFAULT "host_root"
+
+// Pad replay: a sequence of 120 byte OrbisPadData records, one per read, looped.
+#define HOST_PAD_RECORD_SIZE 120
+
+// USB replay: host_usbd_header then { u16 length, u8 data[length] } per interrupt IN
+// transfer, looped. Transfers to OUT endpoints are accepted and dropped.
+#define HOST_USBD_MAGIC 0x44425355 // "USBD"
+
+typedef struct host_usbd_header {
+    uint32_t magic;
+    uint16_t vendor;
+    uint16_t product;
+} host_usbd_header;
+
+/**
+ * @brief Resolves `path' below the host root into `out'.
+ * @param path
+ * @param [out]out
+ * @param size
+ * @return const char* `out'
+ */
+const char *host_path(const char *path, char *out, size_t size);
+
+/**
+ * @brief Returns the function a game call to `name' reaches: the newest active hook,
+ *        or the shim implementation when nothing hooks it. Returns NULL if unknown.
+ * @param name
+ * @return void*
+ */
+void *host_hook_target(const char *name);
+
+/**
+ * @brief Logs the active detours to stderr.
+ */
+void host_hook_dump(void);
+
+/**
+ * @brief Registers `image' as the emulated title, its address becomes `base_address'.
+ *        sys_sdk_proc_rw and patches write into it.
+ * @param image
+ * @param size
+ */
+void host_proc_image(void *image, size_t size);
+
+/**
+ * @brief Runs what the libc startup of the title would, after plugin_loader's
+ *        module_start redirected `_init_env' of `libc.prx'.
+ * @param argc
+ * @param argv
+ * @return int -1 if nothing redirected it
+ */
+int host_start_title(int argc, char **argv);
+
+/**
+ * @brief Loads the pad replay `path', or stops replaying when NULL.
+ *        Without a replay reads return disconnected pads.
+ * @param path
+ * @return int 0 on success
+ */
+int host_pad_replay(const char *path);
+
+/**
+ * @brief Serves pad reads from `count' records in memory, not copied. NULL stops replaying.
+ * @param records
+ * @param count
+ */
+void host_pad_frames(const void *records, size_t count);
+
+/**
+ * @brief Loads the USB replay `path', or detaches the device when NULL.
+ * @param path
+ * @return int 0 on success
+ */
+int host_usbd_replay(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
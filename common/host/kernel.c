@@ -0,0 +1,978 @@
+// libkernel on Linux: files, memory, time, threads, AIO, klog and notifications.
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Common.h"
+#include "host.h"
+#include "shim.h"
+
+// FreeBSD open(2) flags used by the console.
+#define ORBIS_O_ACCMODE   0x0003
+#define ORBIS_O_NONBLOCK  0x0004
+#define ORBIS_O_APPEND    0x0008
+#define ORBIS_O_FSYNC     0x0080
+#define ORBIS_O_CREAT     0x0200
+#define ORBIS_O_TRUNC     0x0400
+#define ORBIS_O_EXCL      0x0800
+#define ORBIS_O_DIRECTORY 0x20000
+
+// FreeBSD mmap(2) flags.
+#define ORBIS_MAP_SHARED  0x0001
+#define ORBIS_MAP_PRIVATE 0x0002
+#define ORBIS_MAP_FIXED   0x0010
+#define ORBIS_MAP_ANON    0x1000
+
+int32_t host_error(int err)
+{
+    // Linux and FreeBSD agree below EAGAIN/EDEADLK.
+    switch (err) {
+    case EAGAIN:
+        err = 35;
+        break;
+    case EDEADLK:
+        err = 11;
+        break;
+    case ENAMETOOLONG:
+        err = 63;
+        break;
+    case ENOTEMPTY:
+        err = 66;
+        break;
+    case ENOSYS:
+        err = 78;
+        break;
+    case ELOOP:
+        err = 62;
+        break;
+    case ETIMEDOUT:
+        err = 60;
+        break;
+    default:
+        if (err <= 0 || err > 34) {
+            err = 5; // EIO
+        }
+        break;
+    }
+    return (int32_t)(ORBIS_KERNEL_ERROR_UNKNOWN | (uint32_t)err);
+}
+
+const char *host_path(const char *path, char *out, size_t size)
+{
+    const char *root = getenv(HOST_ROOT_ENV);
+    if (root == NULL || root[0] == '\0') {
+        root = HOST_ROOT_DEFAULT;
+    }
+    if (path[0] == '/') {
+        snprintf(out, size, "%s%s", root, path);
+    } else {
+        snprintf(out, size, "%s", path);
+    }
+    return out;
+}
+
+// libc calls of plugin code taking paths are linked to these with --wrap, see plugin.mk.
+
+FILE *__wrap_fopen(const char *path, const char *mode)
+{
+    char resolved[PATH_MAX];
+    return fopen(host_path(path, resolved, sizeof(resolved)), mode);
+}
+
+int __wrap_stat(const char *path, struct stat *sb)
+{
+    char resolved[PATH_MAX];
+    return stat(host_path(path, resolved, sizeof(resolved)), sb);
+}
+
+int __wrap_access(const char *path, int mode)
+{
+    char resolved[PATH_MAX];
+    return access(host_path(path, resolved, sizeof(resolved)), mode);
+}
+
+int __wrap_chmod(const char *path, mode_t mode)
+{
+    char resolved[PATH_MAX];
+    return chmod(host_path(path, resolved, sizeof(resolved)), mode);
+}
+
+int __wrap_mkdir(const char *path, mode_t mode)
+{
+    char resolved[PATH_MAX];
+    return mkdir(host_path(path, resolved, sizeof(resolved)), mode);
+}
+
+DIR *__wrap_opendir(const char *path)
+{
+    char resolved[PATH_MAX];
+    return opendir(host_path(path, resolved, sizeof(resolved)));
+}
+
+int __wrap_unlink(const char *path)
+{
+    char resolved[PATH_MAX];
+    return unlink(host_path(path, resolved, sizeof(resolved)));
+}
+
+int __wrap_remove(const char *path)
+{
+    char resolved[PATH_MAX];
+    return remove(host_path(path, resolved, sizeof(resolved)));
+}
+
+int __wrap_rename(const char *from, const char *to)
+{
+    char resolved_from[PATH_MAX];
+    char resolved_to[PATH_MAX];
+    host_path(from, resolved_from, sizeof(resolved_from));
+    host_path(to, resolved_to, sizeof(resolved_to));
+    return rename(resolved_from, resolved_to);
+}
+
+void klog(const char *fmt, ...)
+{
+    char line[1024];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    fprintf(stderr, "[klog] %s", line);
+}
+
+int32_t sceKernelSendNotificationRequest(int32_t device, OrbisNotificationRequest *req, size_t size, int32_t blocking)
+{
+    (void)device;
+    (void)size;
+    (void)blocking;
+    printf("[notify] %s\n", req->message);
+    fflush(stdout);
+    return 0;
+}
+
+const char *sceKernelGetFsSandboxRandomWord(void)
+{
+    return "hostsandbx";
+}
+
+//
+// Time
+//
+
+uint64_t sceKernelGetProcessTimeCounter(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t sceKernelGetProcessTimeCounterFrequency(void)
+{
+    return 1000000000ull;
+}
+
+int32_t sceKernelUsleep(uint32_t usec)
+{
+    return usleep(usec) ? host_error(errno) : 0;
+}
+
+//
+// Threads
+//
+
+typedef struct host_thread_start {
+    void *(*entry)(void *);
+    void *arg;
+    char name[16];
+} host_thread_start;
+
+static void *host_thread_entry(void *args)
+{
+    host_thread_start start = *(host_thread_start *)args;
+    free(args);
+    pthread_setname_np(pthread_self(), start.name);
+    return start.entry(start.arg);
+}
+
+int32_t scePthreadCreate(OrbisPthread *thread, const OrbisPthreadAttr *attr, void *(*entry)(void *), void *arg,
+                         const char *name)
+{
+    (void)attr;
+    host_thread_start *start = (host_thread_start *)malloc(sizeof(*start));
+    if (start == NULL) {
+        return ORBIS_KERNEL_ERROR_ENOMEM;
+    }
+    start->entry = entry;
+    start->arg = arg;
+    snprintf(start->name, sizeof(start->name), "%s", name ? name : "");
+    pthread_t tid;
+    int ret = pthread_create(&tid, NULL, host_thread_entry, start);
+    if (ret != 0) {
+        free(start);
+        return host_error(ret);
+    }
+    *thread = (OrbisPthread)(uintptr_t)tid;
+    return 0;
+}
+
+void scePthreadExit(void *value)
+{
+    pthread_exit(value);
+}
+
+int32_t scePthreadJoin(OrbisPthread thread, void **value)
+{
+    int ret = pthread_join((pthread_t)(uintptr_t)thread, value);
+    return ret ? host_error(ret) : 0;
+}
+
+int32_t scePthreadDetach(OrbisPthread thread)
+{
+    int ret = pthread_detach((pthread_t)(uintptr_t)thread);
+    return ret ? host_error(ret) : 0;
+}
+
+OrbisPthread scePthreadSelf(void)
+{
+    return (OrbisPthread)(uintptr_t)pthread_self();
+}
+
+// FIFO priorities need privileges on Linux, threads keep the default policy.
+int32_t scePthreadSetprio(OrbisPthread thread, int32_t prio)
+{
+    (void)thread;
+    (void)prio;
+    return 0;
+}
+
+int32_t scePthreadYield(void)
+{
+    sched_yield();
+    return 0;
+}
+
+int32_t scePthreadMutexInit(OrbisPthreadMutex *mutex, const OrbisPthreadMutexattr *attr, const char *name)
+{
+    (void)attr;
+    (void)name;
+    pthread_mutex_t *m = (pthread_mutex_t *)malloc(sizeof(*m));
+    if (m == NULL) {
+        return ORBIS_KERNEL_ERROR_ENOMEM;
+    }
+    pthread_mutex_init(m, NULL);
+    *mutex = m;
+    return 0;
+}
+
+int32_t scePthreadMutexDestroy(OrbisPthreadMutex *mutex)
+{
+    if (mutex == NULL || *mutex == NULL) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    pthread_mutex_destroy((pthread_mutex_t *)*mutex);
+    free(*mutex);
+    *mutex = NULL;
+    return 0;
+}
+
+int32_t scePthreadMutexLock(OrbisPthreadMutex *mutex)
+{
+    if (mutex == NULL || *mutex == NULL) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    int ret = pthread_mutex_lock((pthread_mutex_t *)*mutex);
+    return ret ? host_error(ret) : 0;
+}
+
+int32_t scePthreadMutexTrylock(OrbisPthreadMutex *mutex)
+{
+    if (mutex == NULL || *mutex == NULL) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    int ret = pthread_mutex_trylock((pthread_mutex_t *)*mutex);
+    return ret ? host_error(ret) : 0;
+}
+
+int32_t scePthreadMutexUnlock(OrbisPthreadMutex *mutex)
+{
+    if (mutex == NULL || *mutex == NULL) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    int ret = pthread_mutex_unlock((pthread_mutex_t *)*mutex);
+    return ret ? host_error(ret) : 0;
+}
+
+int32_t scePthreadKeyCreate(OrbisPthreadKey *key, void (*destructor)(void *))
+{
+    pthread_key_t k;
+    int ret = pthread_key_create(&k, destructor);
+    if (ret != 0) {
+        return host_error(ret);
+    }
+    *key = (OrbisPthreadKey)k;
+    return 0;
+}
+
+int32_t scePthreadKeyDelete(OrbisPthreadKey key)
+{
+    int ret = pthread_key_delete((pthread_key_t)key);
+    return ret ? host_error(ret) : 0;
+}
+
+int32_t scePthreadSetspecific(OrbisPthreadKey key, const void *value)
+{
+    int ret = pthread_setspecific((pthread_key_t)key, value);
+    return ret ? host_error(ret) : 0;
+}
+
+void *scePthreadGetspecific(OrbisPthreadKey key)
+{
+    return pthread_getspecific((pthread_key_t)key);
+}
+
+typedef struct host_sema {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int32_t count;
+    int32_t max;
+} host_sema;
+
+int32_t sceKernelCreateSema(OrbisKernelSema *sem, const char *name, uint32_t attr, int32_t init, int32_t max,
+                            const void *opt)
+{
+    (void)name;
+    (void)attr;
+    (void)opt;
+    if (sem == NULL || init < 0 || max <= 0 || init > max) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    host_sema *s = (host_sema *)malloc(sizeof(*s));
+    if (s == NULL) {
+        return ORBIS_KERNEL_ERROR_ENOMEM;
+    }
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->count = init;
+    s->max = max;
+    *sem = s;
+    return 0;
+}
+
+int32_t sceKernelDeleteSema(OrbisKernelSema sem)
+{
+    host_sema *s = (host_sema *)sem;
+    if (s == NULL) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->lock);
+    free(s);
+    return 0;
+}
+
+// `timeout' is relative in microseconds, NULL waits forever.
+int32_t sceKernelWaitSema(OrbisKernelSema sem, int32_t need, OrbisKernelUseconds *timeout)
+{
+    host_sema *s = (host_sema *)sem;
+    if (s == NULL || need <= 0 || need > s->max) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    struct timespec deadline;
+    if (timeout) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += *timeout / 1000000;
+        deadline.tv_nsec += (long)(*timeout % 1000000) * 1000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+    int32_t ret = 0;
+    pthread_mutex_lock(&s->lock);
+    while (s->count < need) {
+        if (timeout == NULL) {
+            pthread_cond_wait(&s->cond, &s->lock);
+        } else if (pthread_cond_timedwait(&s->cond, &s->lock, &deadline) != 0) {
+            ret = ORBIS_KERNEL_ERROR_ETIMEDOUT;
+            break;
+        }
+    }
+    if (ret == 0) {
+        s->count -= need;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return ret;
+}
+
+int32_t sceKernelSignalSema(OrbisKernelSema sem, int32_t count)
+{
+    host_sema *s = (host_sema *)sem;
+    if (s == NULL || count <= 0) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    int32_t ret = 0;
+    pthread_mutex_lock(&s->lock);
+    if (count > s->max - s->count) {
+        ret = ORBIS_KERNEL_ERROR_EINVAL;
+    } else {
+        s->count += count;
+        pthread_cond_broadcast(&s->cond);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return ret;
+}
+
+// Events are cleared once reported, a trigger of a pending event only updates its data.
+#define HOST_EQUEUE_EVENTS 8
+
+typedef struct host_equeue {
+    struct host_equeue *next;
+    pthread_cond_t cond;
+    int32_t count;
+    OrbisKernelEvent event[HOST_EQUEUE_EVENTS];
+    bool pending[HOST_EQUEUE_EVENTS];
+} host_equeue;
+
+static host_equeue *g_Equeues = NULL;
+static pthread_mutex_t g_EqueueLock = PTHREAD_MUTEX_INITIALIZER;
+
+int32_t sceKernelCreateEqueue(OrbisKernelEqueue *eq, const char *name)
+{
+    (void)name;
+    if (eq == NULL) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    host_equeue *q = (host_equeue *)calloc(1, sizeof(*q));
+    if (q == NULL) {
+        return ORBIS_KERNEL_ERROR_ENOMEM;
+    }
+    pthread_cond_init(&q->cond, NULL);
+    pthread_mutex_lock(&g_EqueueLock);
+    q->next = g_Equeues;
+    g_Equeues = q;
+    pthread_mutex_unlock(&g_EqueueLock);
+    *eq = q;
+    return 0;
+}
+
+int32_t sceKernelDeleteEqueue(OrbisKernelEqueue eq)
+{
+    host_equeue *q = (host_equeue *)eq;
+    if (q == NULL) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    pthread_mutex_lock(&g_EqueueLock);
+    host_equeue **link = &g_Equeues;
+    while (*link && *link != q) {
+        link = &(*link)->next;
+    }
+    if (*link == NULL) {
+        pthread_mutex_unlock(&g_EqueueLock);
+        return ORBIS_KERNEL_ERROR_EBADF;
+    }
+    *link = q->next;
+    pthread_mutex_unlock(&g_EqueueLock);
+    pthread_cond_destroy(&q->cond);
+    free(q);
+    return 0;
+}
+
+// `timeout' is relative in microseconds, NULL waits forever.
+int32_t sceKernelWaitEqueue(OrbisKernelEqueue eq, OrbisKernelEvent *ev, int32_t num, int32_t *out,
+                            OrbisKernelUseconds *timeout)
+{
+    host_equeue *q = (host_equeue *)eq;
+    if (q == NULL || ev == NULL || num <= 0 || out == NULL) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    struct timespec deadline;
+    if (timeout) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += *timeout / 1000000;
+        deadline.tv_nsec += (long)(*timeout % 1000000) * 1000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+    int32_t ret = 0;
+    *out = 0;
+    pthread_mutex_lock(&g_EqueueLock);
+    for (;;) {
+        for (int32_t i = 0; i < q->count && *out < num; i++) {
+            if (q->pending[i]) {
+                q->pending[i] = false;
+                ev[(*out)++] = q->event[i];
+            }
+        }
+        if (*out) {
+            break;
+        }
+        if (timeout == NULL) {
+            pthread_cond_wait(&q->cond, &g_EqueueLock);
+        } else if (pthread_cond_timedwait(&q->cond, &g_EqueueLock, &deadline) != 0) {
+            ret = ORBIS_KERNEL_ERROR_ETIMEDOUT;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_EqueueLock);
+    return ret;
+}
+
+int32_t host_equeue_add(OrbisKernelEqueue eq, uint64_t ident, int16_t filter, void *udata)
+{
+    host_equeue *q = (host_equeue *)eq;
+    if (q == NULL) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    int32_t ret = 0;
+    pthread_mutex_lock(&g_EqueueLock);
+    int32_t i = 0;
+    while (i < q->count && (q->event[i].ident != ident || q->event[i].filter != filter)) {
+        i++;
+    }
+    if (i == HOST_EQUEUE_EVENTS) {
+        ret = ORBIS_KERNEL_ERROR_ENOMEM;
+    } else {
+        if (i == q->count) {
+            q->count++;
+        }
+        memset(&q->event[i], 0, sizeof(q->event[i]));
+        q->event[i].ident = ident;
+        q->event[i].filter = filter;
+        q->event[i].udata = udata;
+        q->pending[i] = false;
+    }
+    pthread_mutex_unlock(&g_EqueueLock);
+    return ret;
+}
+
+void host_equeue_trigger(uint64_t ident, int16_t filter, int64_t data)
+{
+    pthread_mutex_lock(&g_EqueueLock);
+    for (host_equeue *q = g_Equeues; q; q = q->next) {
+        for (int32_t i = 0; i < q->count; i++) {
+            if (q->event[i].ident == ident && q->event[i].filter == filter) {
+                q->event[i].data = data;
+                q->pending[i] = true;
+                pthread_cond_broadcast(&q->cond);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_EqueueLock);
+}
+
+//
+// Files
+//
+
+static int host_open_flags(int32_t flags)
+{
+    int out = 0;
+    switch (flags & ORBIS_O_ACCMODE) {
+    case 1:
+        out = O_WRONLY;
+        break;
+    case 2:
+        out = O_RDWR;
+        break;
+    default:
+        out = O_RDONLY;
+        break;
+    }
+    if (flags & ORBIS_O_NONBLOCK) {
+        out |= O_NONBLOCK;
+    }
+    if (flags & ORBIS_O_APPEND) {
+        out |= O_APPEND;
+    }
+    if (flags & ORBIS_O_FSYNC) {
+        out |= O_SYNC;
+    }
+    if (flags & ORBIS_O_CREAT) {
+        out |= O_CREAT;
+    }
+    if (flags & ORBIS_O_TRUNC) {
+        out |= O_TRUNC;
+    }
+    if (flags & ORBIS_O_EXCL) {
+        out |= O_EXCL;
+    }
+    if (flags & ORBIS_O_DIRECTORY) {
+        out |= O_DIRECTORY;
+    }
+    return out | O_CLOEXEC;
+}
+
+int32_t sceKernelOpen(const char *path, int32_t flags, OrbisKernelMode mode)
+{
+    char resolved[PATH_MAX];
+    int fd = open(host_path(path, resolved, sizeof(resolved)), host_open_flags(flags), mode);
+    return fd < 0 ? host_error(errno) : fd;
+}
+
+int32_t sceKernelClose(int32_t fd)
+{
+    return close(fd) ? host_error(errno) : 0;
+}
+
+ssize_t sceKernelRead(int32_t fd, void *buf, size_t nbytes)
+{
+    ssize_t ret = read(fd, buf, nbytes);
+    return ret < 0 ? host_error(errno) : ret;
+}
+
+ssize_t sceKernelWrite(int32_t fd, const void *buf, size_t nbytes)
+{
+    ssize_t ret = write(fd, buf, nbytes);
+    return ret < 0 ? host_error(errno) : ret;
+}
+
+ssize_t sceKernelPread(int32_t fd, void *buf, size_t nbytes, off_t offset)
+{
+    ssize_t ret = pread(fd, buf, nbytes, offset);
+    return ret < 0 ? host_error(errno) : ret;
+}
+
+ssize_t sceKernelPwrite(int32_t fd, const void *buf, size_t nbytes, off_t offset)
+{
+    ssize_t ret = pwrite(fd, buf, nbytes, offset);
+    return ret < 0 ? host_error(errno) : ret;
+}
+
+off_t sceKernelLseek(int32_t fd, off_t offset, int32_t whence)
+{
+    off_t ret = lseek(fd, offset, whence);
+    return ret < 0 ? host_error(errno) : ret;
+}
+
+int32_t sceKernelStat(const char *path, struct stat *sb)
+{
+    char resolved[PATH_MAX];
+    return stat(host_path(path, resolved, sizeof(resolved)), sb) ? host_error(errno) : 0;
+}
+
+int32_t sceKernelCheckReachability(const char *path)
+{
+    struct stat sb;
+    return sceKernelStat(path, &sb);
+}
+
+int32_t sceKernelFstat(int32_t fd, struct stat *sb)
+{
+    return fstat(fd, sb) ? host_error(errno) : 0;
+}
+
+int32_t sceKernelFsync(int32_t fd)
+{
+    return fsync(fd) ? host_error(errno) : 0;
+}
+
+int32_t sceKernelFtruncate(int32_t fd, off_t length)
+{
+    return ftruncate(fd, length) ? host_error(errno) : 0;
+}
+
+int32_t sceKernelMkdir(const char *path, OrbisKernelMode mode)
+{
+    char resolved[PATH_MAX];
+    return mkdir(host_path(path, resolved, sizeof(resolved)), mode) ? host_error(errno) : 0;
+}
+
+int32_t sceKernelRmdir(const char *path)
+{
+    char resolved[PATH_MAX];
+    return rmdir(host_path(path, resolved, sizeof(resolved))) ? host_error(errno) : 0;
+}
+
+int32_t sceKernelUnlink(const char *path)
+{
+    char resolved[PATH_MAX];
+    return unlink(host_path(path, resolved, sizeof(resolved))) ? host_error(errno) : 0;
+}
+
+int32_t sceKernelRename(const char *from, const char *to)
+{
+    char resolved_from[PATH_MAX];
+    char resolved_to[PATH_MAX];
+    host_path(from, resolved_from, sizeof(resolved_from));
+    host_path(to, resolved_to, sizeof(resolved_to));
+    return rename(resolved_from, resolved_to) ? host_error(errno) : 0;
+}
+
+int32_t sceKernelChmod(const char *path, OrbisKernelMode mode)
+{
+    char resolved[PATH_MAX];
+    return chmod(host_path(path, resolved, sizeof(resolved)), mode) ? host_error(errno) : 0;
+}
+
+// Linux `struct linux_dirent64' records are converted in place to the FreeBSD
+// layout, which is never larger.
+int32_t sceKernelGetdents(int32_t fd, char *buf, int32_t nbytes)
+{
+    long ret = syscall(SYS_getdents64, fd, buf, (size_t)nbytes);
+    if (ret < 0) {
+        return host_error(errno);
+    }
+    long in = 0;
+    int32_t out = 0;
+    while (in < ret) {
+        const struct dirent64 *src = (const struct dirent64 *)(buf + in);
+        const uint16_t src_reclen = src->d_reclen;
+        const uint64_t ino = src->d_ino;
+        const uint8_t type = src->d_type;
+        const size_t namlen = strnlen(src->d_name, 255);
+        char name[256];
+        memcpy(name, src->d_name, namlen);
+        name[namlen] = '\0';
+
+        OrbisKernelDirent *dst = (OrbisKernelDirent *)(buf + out);
+        const uint16_t reclen = (uint16_t)((offsetof(OrbisKernelDirent, d_name) + namlen + 1 + 3) & ~3u);
+        dst->d_fileno = (uint32_t)ino;
+        dst->d_reclen = reclen;
+        dst->d_type = type;
+        dst->d_namlen = (uint8_t)namlen;
+        memcpy(dst->d_name, name, namlen + 1);
+        in += src_reclen;
+        out += reclen;
+    }
+    return out;
+}
+
+//
+// Memory
+//
+
+static int host_map_flags(int32_t flags)
+{
+    int out = (flags & ORBIS_MAP_SHARED) ? MAP_SHARED : MAP_PRIVATE;
+    if (flags & ORBIS_MAP_FIXED) {
+        out |= MAP_FIXED;
+    }
+    if (flags & ORBIS_MAP_ANON) {
+        out |= MAP_ANONYMOUS;
+    }
+    return out;
+}
+
+int32_t sceKernelMmap(void *addr, size_t len, int32_t prot, int32_t flags, int32_t fd, off_t offset, void **res)
+{
+    void *ret = mmap(addr, len, prot & 0x7, host_map_flags(flags), fd, offset);
+    if (ret == MAP_FAILED) {
+        return host_error(errno);
+    }
+    *res = ret;
+    return 0;
+}
+
+int32_t sceKernelMunmap(void *addr, size_t len)
+{
+    return munmap(addr, len) ? host_error(errno) : 0;
+}
+
+int32_t sceKernelMprotect(const void *addr, size_t len, int32_t prot)
+{
+    return mprotect((void *)addr, len, prot & 0x7) ? host_error(errno) : 0;
+}
+
+int32_t sceKernelMapNamedFlexibleMemory(void **addr, size_t len, int32_t prot, int32_t flags, const char *name)
+{
+    (void)flags;
+    (void)name;
+    void *ret = mmap(*addr, len, prot & 0x7, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ret == MAP_FAILED) {
+        return host_error(errno);
+    }
+    *addr = ret;
+    return 0;
+}
+
+int32_t sceKernelAvailableFlexibleMemorySize(size_t *size)
+{
+    *size = (size_t)sysconf(_SC_AVPHYS_PAGES) * (size_t)sysconf(_SC_PAGESIZE);
+    return 0;
+}
+
+// libc heap statistics, see plugin_loader/source/profile.c.
+typedef struct SceLibcMallocManagedSize {
+    uint16_t size;
+    uint16_t version;
+    uint32_t reserved1;
+    size_t maxSystemSize;
+    size_t currentSystemSize;
+    size_t maxInuseSize;
+    size_t currentInuseSize;
+} SceLibcMallocManagedSize;
+
+int malloc_stats_fast(SceLibcMallocManagedSize *ManagedSize)
+{
+    static size_t max_system = 0;
+    static size_t max_inuse = 0;
+    struct mallinfo2 info = mallinfo2();
+    const size_t system = info.arena + info.hblkhd;
+    const size_t inuse = info.uordblks + info.hblkhd;
+    max_system = system > max_system ? system : max_system;
+    max_inuse = inuse > max_inuse ? inuse : max_inuse;
+    ManagedSize->maxSystemSize = max_system;
+    ManagedSize->currentSystemSize = system;
+    ManagedSize->maxInuseSize = max_inuse;
+    ManagedSize->currentInuseSize = inuse;
+    return 0;
+}
+
+//
+// AIO, requests complete synchronously on submit
+//
+
+#define HOST_AIO_STATE_COMPLETED 3
+#define HOST_AIO_STATE_ABORTED   4
+
+typedef struct SceKernelAioResult {
+    int64_t returnValue;
+    uint32_t state;
+} SceKernelAioResult;
+
+typedef int32_t SceKernelAioSubmitId;
+
+typedef struct SceKernelAioRWRequest {
+    off_t offset;
+    int64_t nbyte;
+    void *buf;
+    SceKernelAioResult *result;
+    int32_t fd;
+} SceKernelAioRWRequest;
+
+static SceKernelAioSubmitId g_AioNextId = 1;
+
+static SceKernelAioSubmitId host_aio_id(void)
+{
+    return __atomic_fetch_add(&g_AioNextId, 1, __ATOMIC_RELAXED);
+}
+
+static void host_aio_run(SceKernelAioRWRequest *req, bool write)
+{
+    const ssize_t ret = write ? sceKernelPwrite(req->fd, req->buf, (size_t)req->nbyte, req->offset)
+                              : sceKernelPread(req->fd, req->buf, (size_t)req->nbyte, req->offset);
+    req->result->returnValue = ret;
+    req->result->state = ret < 0 ? HOST_AIO_STATE_ABORTED : HOST_AIO_STATE_COMPLETED;
+}
+
+int32_t sceKernelAioInitializeImpl(void *p, int32_t size)
+{
+    (void)p;
+    (void)size;
+    return 0;
+}
+
+int32_t sceKernelAioSubmitReadCommands(SceKernelAioRWRequest req[], int32_t size, int32_t prio,
+                                       SceKernelAioSubmitId *id)
+{
+    (void)prio;
+    for (int32_t i = 0; i < size; i++) {
+        host_aio_run(&req[i], false);
+    }
+    *id = host_aio_id();
+    return 0;
+}
+
+int32_t sceKernelAioSubmitReadCommandsMultiple(SceKernelAioRWRequest req[], int32_t size, int32_t prio,
+                                               SceKernelAioSubmitId id[])
+{
+    (void)prio;
+    for (int32_t i = 0; i < size; i++) {
+        host_aio_run(&req[i], false);
+        id[i] = host_aio_id();
+    }
+    return 0;
+}
+
+int32_t sceKernelAioSubmitWriteCommands(SceKernelAioRWRequest req[], int32_t size, int32_t prio,
+                                        SceKernelAioSubmitId *id)
+{
+    (void)prio;
+    for (int32_t i = 0; i < size; i++) {
+        host_aio_run(&req[i], true);
+    }
+    *id = host_aio_id();
+    return 0;
+}
+
+int32_t sceKernelAioSubmitWriteCommandsMultiple(SceKernelAioRWRequest req[], int32_t size, int32_t prio,
+                                                SceKernelAioSubmitId id[])
+{
+    (void)prio;
+    for (int32_t i = 0; i < size; i++) {
+        host_aio_run(&req[i], true);
+        id[i] = host_aio_id();
+    }
+    return 0;
+}
+
+int32_t sceKernelAioDeleteRequest(SceKernelAioSubmitId id, int32_t *ret)
+{
+    (void)id;
+    *ret = 0;
+    return 0;
+}
+
+int32_t sceKernelAioDeleteRequests(SceKernelAioSubmitId id[], int32_t num, int32_t ret[])
+{
+    (void)id;
+    for (int32_t i = 0; i < num; i++) {
+        ret[i] = 0;
+    }
+    return 0;
+}
+
+int32_t sceKernelAioPollRequest(SceKernelAioSubmitId id, int32_t *state)
+{
+    (void)id;
+    *state = HOST_AIO_STATE_COMPLETED;
+    return 0;
+}
+
+int32_t sceKernelAioPollRequests(SceKernelAioSubmitId id[], int32_t num, int32_t state[])
+{
+    (void)id;
+    for (int32_t i = 0; i < num; i++) {
+        state[i] = HOST_AIO_STATE_COMPLETED;
+    }
+    return 0;
+}
+
+int32_t sceKernelAioCancelRequest(SceKernelAioSubmitId id, int32_t *state)
+{
+    return sceKernelAioPollRequest(id, state);
+}
+
+int32_t sceKernelAioCancelRequests(SceKernelAioSubmitId id[], int32_t num, int32_t state[])
+{
+    return sceKernelAioPollRequests(id, num, state);
+}
+
+int32_t sceKernelAioWaitRequest(SceKernelAioSubmitId id, int32_t *state, uint32_t *usec)
+{
+    (void)usec;
+    return sceKernelAioPollRequest(id, state);
+}
+
+int32_t sceKernelAioWaitRequests(SceKernelAioSubmitId id[], int32_t num, int32_t state[], uint32_t mode,
+                                 uint32_t *usec)
+{
+    (void)mode;
+    (void)usec;
+    return sceKernelAioPollRequests(id, num, state);
+}
@@ -0,0 +1,495 @@
+// Modules, dynlib, GoldHEN SDK syscalls, detours and the patcher on Linux.
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <limits.h>
+#include <link.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Common.h"
+#include "Patcher.h"
+#include "host.h"
+#include "shim.h"
+
+#define HOST_MODULES_MAX 128
+
+typedef struct host_module {
+    char name[256];
+    char path[PATH_MAX];
+    void *dl;
+    uint64_t base;
+    uint32_t size;
+} host_module;
+
+// Handles are indices + 1, entries are never removed so handles stay valid.
+static host_module g_Modules[HOST_MODULES_MAX];
+static int32_t g_ModuleCount = 0;
+static pthread_mutex_t g_ModuleLock = PTHREAD_MUTEX_INITIALIZER;
+
+static Detour *g_Detours = NULL; // newest first
+static pthread_mutex_t g_DetourLock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint8_t *g_Image = NULL;
+static size_t g_ImageSize = 0;
+
+// plugin_loader starts by redirecting libc's `_init_env' with a jump written through
+// sys_sdk_proc_rw. The shim reports a `libc.prx' module whose `_init_env' is this slot,
+// host_start_title() follows the jump like the libc startup would.
+#define HOST_LIBC_NAME "libc.prx"
+static uint8_t g_InitEnv[16];
+static bool g_InitEnvListed = false;
+
+//
+// Modules
+//
+
+static int host_module_visit(struct dl_phdr_info *info, size_t size, void *data)
+{
+    (void)size;
+    (void)data;
+    const char *path = info->dlpi_name;
+    const bool main_program = path == NULL || path[0] == '\0';
+    char self[PATH_MAX] = {0};
+    if (main_program) {
+        const ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+        if (len <= 0) {
+            return 0;
+        }
+        path = self;
+    }
+    for (int32_t i = 0; i < g_ModuleCount; i++) {
+        if (strcmp(g_Modules[i].path, path) == 0) {
+            return 0;
+        }
+    }
+    if (g_ModuleCount >= HOST_MODULES_MAX) {
+        return 1;
+    }
+
+    uint64_t start = UINT64_MAX;
+    uint64_t end = 0;
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+        if (phdr->p_type != PT_LOAD) {
+            continue;
+        }
+        const uint64_t seg_start = info->dlpi_addr + phdr->p_vaddr;
+        const uint64_t seg_end = seg_start + phdr->p_memsz;
+        start = seg_start < start ? seg_start : start;
+        end = seg_end > end ? seg_end : end;
+    }
+    void *dl = main_program ? dlopen(NULL, RTLD_LAZY) : dlopen(path, RTLD_LAZY | RTLD_NOLOAD);
+    if (dl == NULL || start == UINT64_MAX) {
+        return 0;
+    }
+
+    host_module *module = &g_Modules[g_ModuleCount++];
+    const char *slash = strrchr(path, '/');
+    snprintf(module->path, sizeof(module->path), "%s", path);
+    snprintf(module->name, sizeof(module->name), "%s", main_program ? "eboot.bin" : slash ? slash + 1 : path);
+    module->dl = dl;
+    module->base = start;
+    module->size = (uint32_t)(end - start);
+    return 0;
+}
+
+static void host_module_refresh(void)
+{
+    dl_iterate_phdr(host_module_visit, NULL);
+    if (!g_InitEnvListed && g_ModuleCount < HOST_MODULES_MAX) {
+        host_module *module = &g_Modules[g_ModuleCount++];
+        snprintf(module->path, sizeof(module->path), "<%s>", HOST_LIBC_NAME);
+        snprintf(module->name, sizeof(module->name), "%s", HOST_LIBC_NAME);
+        module->base = (uint64_t)(uintptr_t)g_InitEnv;
+        module->size = sizeof(g_InitEnv);
+        g_InitEnvListed = true;
+    }
+}
+
+static host_module *host_module_get(int32_t handle)
+{
+    pthread_mutex_lock(&g_ModuleLock);
+    host_module *module = handle > 0 && handle <= g_ModuleCount ? &g_Modules[handle - 1] : NULL;
+    pthread_mutex_unlock(&g_ModuleLock);
+    return module;
+}
+
+static void host_module_scan(void)
+{
+    pthread_mutex_lock(&g_ModuleLock);
+    host_module_refresh();
+    pthread_mutex_unlock(&g_ModuleLock);
+}
+
+static int32_t host_module_find(const char *path)
+{
+    int32_t handle = 0;
+    pthread_mutex_lock(&g_ModuleLock);
+    host_module_refresh();
+    for (int32_t i = 0; i < g_ModuleCount; i++) {
+        if (strcmp(g_Modules[i].path, path) == 0) {
+            handle = i + 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_ModuleLock);
+    return handle;
+}
+
+int32_t host_shim_module(void)
+{
+    static int32_t handle = 0;
+    if (handle == 0) {
+        Dl_info info;
+        if (dladdr((void *)host_shim_module, &info) && info.dli_fname) {
+            handle = host_module_find(info.dli_fname);
+        }
+    }
+    return handle;
+}
+
+void *host_shim_symbol(const char *symbol)
+{
+    host_module *module = host_module_get(host_shim_module());
+    void *addr = module ? dlsym(module->dl, symbol) : NULL;
+    return addr ? addr : dlsym(RTLD_DEFAULT, symbol);
+}
+
+// `/data/GoldHEN/plugins/x.prx' loads `<root>/data/GoldHEN/plugins/x.so'.
+// Plugins are linked with module_start/module_stop as DT_INIT/DT_FINI, dlopen runs them.
+static int32_t host_module_load(const char *path, int32_t *res)
+{
+    char resolved[PATH_MAX];
+    host_path(path, resolved, sizeof(resolved));
+    char *ext = strrchr(resolved, '.');
+    if (ext && (strcmp(ext, ".prx") == 0 || strcmp(ext, ".sprx") == 0) && (size_t)(ext - resolved) + 4 < sizeof(resolved)) {
+        strcpy(ext, ".so");
+    }
+    void *dl = dlopen(resolved, RTLD_NOW | RTLD_LOCAL);
+    if (dl == NULL) {
+        klog("host: dlopen %s: %s\n", resolved, dlerror());
+        return ORBIS_KERNEL_ERROR_ENOENT;
+    }
+    struct link_map *map = NULL;
+    dlinfo(dl, RTLD_DI_LINKMAP, &map);
+    const int32_t handle = host_module_find(map && map->l_name ? map->l_name : resolved);
+    if (handle == 0) {
+        return ORBIS_KERNEL_ERROR_EMFILE;
+    }
+    if (res) {
+        *res = 0;
+    }
+    return handle;
+}
+
+int32_t sceKernelLoadStartModule(const char *path, size_t argc, const void *argv, uint32_t flags, void *opt,
+                                 int32_t *res)
+{
+    (void)argc;
+    (void)argv;
+    (void)flags;
+    (void)opt;
+    return host_module_load(path, res);
+}
+
+int32_t sceKernelStopUnloadModule(int32_t handle, size_t argc, const void *argv, uint32_t flags, void *opt,
+                                  int32_t *res)
+{
+    (void)argc;
+    (void)argv;
+    (void)flags;
+    (void)opt;
+    if (host_module_get(handle) == NULL) {
+        return ORBIS_KERNEL_ERROR_ESRCH;
+    }
+    if (res) {
+        *res = 0;
+    }
+    // Kept mapped, detours and threads of the module may still point into it.
+    // module_stop runs at exit.
+    return 0;
+}
+
+int32_t sceKernelDlsym(int32_t handle, const char *symbol, void **addr)
+{
+    host_module *module = host_module_get(handle);
+    if (module == NULL) {
+        return ORBIS_KERNEL_ERROR_ESRCH;
+    }
+    if (module->dl == NULL) {
+        *addr = strcmp(symbol, "_init_env") == 0 ? (void *)g_InitEnv : NULL;
+    } else {
+        *addr = dlsym(module->dl, symbol);
+    }
+    return *addr ? 0 : ORBIS_KERNEL_ERROR_EFAULT;
+}
+
+int32_t sceKernelGetModuleList(OrbisKernelModule *handles, size_t size, size_t *count)
+{
+    const size_t capacity = size / sizeof(*handles);
+    pthread_mutex_lock(&g_ModuleLock);
+    host_module_refresh();
+    size_t n = 0;
+    for (int32_t i = 0; i < g_ModuleCount && n < capacity; i++) {
+        handles[n++] = i + 1;
+    }
+    pthread_mutex_unlock(&g_ModuleLock);
+    *count = n;
+    return 0;
+}
+
+int32_t sceKernelGetModuleInfo(OrbisKernelModule handle, OrbisKernelModuleInfo *info)
+{
+    host_module *module = host_module_get(handle);
+    if (module == NULL) {
+        return ORBIS_KERNEL_ERROR_ESRCH;
+    }
+    const size_t size = info->size;
+    memset(info, 0, sizeof(*info));
+    info->size = size;
+    snprintf(info->name, sizeof(info->name), "%s", module->name);
+    info->segmentInfo[0].address = (void *)(uintptr_t)module->base;
+    info->segmentInfo[0].size = module->size;
+    info->segmentInfo[0].prot = 0x5; // r-x
+    info->segmentCount = 1;
+    return 0;
+}
+
+// System libraries (`libScePad.sprx') are all served by the shim.
+int32_t sys_dynlib_load_prx(const char *path, int32_t *handle)
+{
+    const char *ext = strrchr(path, '.');
+    const bool system = !strchr(path, '/') || (ext && strcmp(ext, ".sprx") == 0);
+    const int32_t ret = system ? host_shim_module() : host_module_load(path, NULL);
+    if (ret <= 0) {
+        return ret ? ret : ORBIS_KERNEL_ERROR_ENOENT;
+    }
+    *handle = ret;
+    return 0;
+}
+
+int32_t sys_dynlib_unload_prx(int32_t handle)
+{
+    return host_module_get(handle) ? 0 : ORBIS_KERNEL_ERROR_ESRCH;
+}
+
+int32_t sys_dynlib_dlsym(int32_t handle, const char *symbol, void *addr)
+{
+    host_module *module = host_module_get(handle);
+    if (module == NULL) {
+        return ORBIS_KERNEL_ERROR_ESRCH;
+    }
+    if (handle != host_shim_module()) {
+        return sceKernelDlsym(handle, symbol, (void **)addr);
+    }
+    void *sym = host_shim_symbol(symbol);
+    *(void **)addr = sym;
+    return sym ? 0 : ORBIS_KERNEL_ERROR_EFAULT;
+}
+
+//
+// GoldHEN SDK
+//
+
+void host_proc_image(void *image, size_t size)
+{
+    g_Image = (uint8_t *)image;
+    g_ImageSize = image ? size : 0;
+}
+
+static bool host_range_contains(const void *buffer, size_t size, uint64_t address, uint64_t length)
+{
+    const uint64_t base = (uint64_t)(uintptr_t)buffer;
+    return buffer && address >= base && length <= size && address - base <= size - length;
+}
+
+bool host_image_contains(uint64_t address, uint64_t length)
+{
+    return host_range_contains(g_Image, g_ImageSize, address, length) ||
+           host_range_contains(g_InitEnv, sizeof(g_InitEnv), address, length);
+}
+
+uint64_t host_image_base(void)
+{
+    if (g_Image) {
+        return (uint64_t)(uintptr_t)g_Image;
+    }
+    host_module *module = host_module_get(1); // main program is reported first
+    return module ? module->base : 0;
+}
+
+int host_start_title(int argc, char **argv)
+{
+    static const uint8_t jmp[] = {0xFF, 0x25, 0x00, 0x00, 0x00, 0x00};
+    if (memcmp(g_InitEnv, jmp, sizeof(jmp)) != 0) {
+        klog("host: %s _init_env is not redirected\n", HOST_LIBC_NAME);
+        return -1;
+    }
+    uint64_t target = 0;
+    memcpy(&target, g_InitEnv + sizeof(jmp), sizeof(target));
+    int (*init_env)(int *, char **) = (int (*)(int *, char **))(uintptr_t)target;
+    return init_env(&argc, argv);
+}
+
+int32_t sys_sdk_proc_info(struct proc_info *info)
+{
+    const char *titleid = getenv(HOST_TITLEID_ENV);
+    memset(info, 0, sizeof(*info));
+    host_module_scan();
+    info->pid = getpid();
+    snprintf(info->name, sizeof(info->name), "eboot.bin");
+    snprintf(info->path, sizeof(info->path), "/app0/eboot.bin");
+    snprintf(info->titleid, sizeof(info->titleid), "%s", titleid && titleid[0] ? titleid : "CUSA00000");
+    snprintf(info->contentid, sizeof(info->contentid), "HOST00-%s_00-0000000000000000", info->titleid);
+    snprintf(info->version, sizeof(info->version), "01.00");
+    info->base_address = host_image_base();
+    return 0;
+}
+
+int32_t sys_sdk_proc_rw(struct proc_rw *data)
+{
+    if (!host_image_contains(data->address, data->length)) {
+        klog("host: proc_rw 0x%lx (%lu bytes) outside of the process image\n", (unsigned long)data->address,
+             (unsigned long)data->length);
+        return ORBIS_KERNEL_ERROR_EFAULT;
+    }
+    void *target = (void *)(uintptr_t)data->address;
+    if (data->write_flags) {
+        memcpy(target, data->data, data->length);
+    } else {
+        memcpy(data->data, target, data->length);
+    }
+    return 0;
+}
+
+uint32_t sys_sdk_version(void)
+{
+    return GOLDHEN_SDK_VERSION;
+}
+
+//
+// Detours
+//
+
+// Caller holds g_DetourLock.
+static void host_detour_unlink(Detour *This)
+{
+    for (Detour **it = &g_Detours; *it; it = &(*it)->Next) {
+        if (*it != This) {
+            continue;
+        }
+        *it = This->Next;
+        // The next newer hook of the same function continues into our original.
+        for (Detour *d = g_Detours; d; d = d->Next) {
+            if (d->Address == This->Address && d->StubPtr == This->HookPtr) {
+                d->StubPtr = This->StubPtr;
+            }
+        }
+        break;
+    }
+    This->Next = NULL;
+}
+
+void Detour_Construct(Detour *This, DetourMode Mode)
+{
+    pthread_mutex_lock(&g_DetourLock);
+    host_detour_unlink(This);
+    pthread_mutex_unlock(&g_DetourLock);
+    memset(This, 0, sizeof(*This));
+    This->Mode = Mode;
+}
+
+void Detour_Destroy(Detour *This)
+{
+    pthread_mutex_lock(&g_DetourLock);
+    host_detour_unlink(This);
+    pthread_mutex_unlock(&g_DetourLock);
+    This->HookPtr = NULL;
+}
+
+void *Detour_DetourNamed(Detour *This, const char *Name, uint64_t FunctionPtr, void *HookPtr)
+{
+    Dl_info info;
+    if (Name == NULL && dladdr((void *)(uintptr_t)FunctionPtr, &info) && info.dli_sname) {
+        Name = info.dli_sname;
+    }
+    pthread_mutex_lock(&g_DetourLock);
+    host_detour_unlink(This);
+    This->Name = Name ? Name : "?";
+    This->Address = FunctionPtr;
+    This->HookPtr = HookPtr;
+    This->StubPtr = (void *)(uintptr_t)FunctionPtr;
+    for (Detour *d = g_Detours; d; d = d->Next) {
+        if (d->Address == FunctionPtr) {
+            This->StubPtr = d->HookPtr;
+            break;
+        }
+    }
+    This->Next = g_Detours;
+    g_Detours = This;
+    pthread_mutex_unlock(&g_DetourLock);
+    return This->StubPtr;
+}
+
+void *Detour_DetourFunction(Detour *This, uint64_t FunctionPtr, void *HookPtr)
+{
+    return Detour_DetourNamed(This, NULL, FunctionPtr, HookPtr);
+}
+
+void *host_hook_target(const char *name)
+{
+    void *target = NULL;
+    pthread_mutex_lock(&g_DetourLock);
+    for (Detour *d = g_Detours; d; d = d->Next) {
+        if (strcmp(d->Name, name) == 0) {
+            target = d->HookPtr;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_DetourLock);
+    return target ? target : host_shim_symbol(name);
+}
+
+void host_hook_dump(void)
+{
+    pthread_mutex_lock(&g_DetourLock);
+    for (Detour *d = g_Detours; d; d = d->Next) {
+        fprintf(stderr, "[hook] %s @ 0x%lx -> %p (continues to %p)\n", d->Name, (unsigned long)d->Address, d->HookPtr,
+                d->StubPtr);
+    }
+    pthread_mutex_unlock(&g_DetourLock);
+}
+
+//
+// Patcher
+//
+
+void Patcher_Construct(Patcher *This)
+{
+    memset(This, 0, sizeof(*This));
+}
+
+void Patcher_Install_Patch(Patcher *This, uint64_t Address, const void *Patch, size_t Size)
+{
+    if (Size > sizeof(This->Original) || !host_image_contains(Address, Size)) {
+        klog("host: patch at 0x%lx (%zu bytes) outside of the process image, skipped\n", (unsigned long)Address, Size);
+        return;
+    }
+    This->Address = Address;
+    This->Size = Size;
+    memcpy(This->Original, (const void *)(uintptr_t)Address, Size);
+    memcpy((void *)(uintptr_t)Address, Patch, Size);
+    This->Applied = 1;
+}
+
+void Patcher_Destroy(Patcher *This)
+{
+    if (This->Applied) {
+        memcpy((void *)(uintptr_t)This->Address, This->Original, This->Size);
+        This->Applied = 0;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+// Host shim of the OpenOrbis Pad header, see common/host/host.h.
+// Reads are served from the pad replay set by GOLDHEN_HOST_PAD or host_pad_replay().
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORBIS_PAD_BUTTON_L3          0x00000002
+#define ORBIS_PAD_BUTTON_R3          0x00000004
+#define ORBIS_PAD_BUTTON_OPTIONS     0x00000008
+#define ORBIS_PAD_BUTTON_UP          0x00000010
+#define ORBIS_PAD_BUTTON_RIGHT       0x00000020
+#define ORBIS_PAD_BUTTON_DOWN        0x00000040
+#define ORBIS_PAD_BUTTON_LEFT        0x00000080
+#define ORBIS_PAD_BUTTON_L2          0x00000100
+#define ORBIS_PAD_BUTTON_R2          0x00000200
+#define ORBIS_PAD_BUTTON_L1          0x00000400
+#define ORBIS_PAD_BUTTON_R1          0x00000800
+#define ORBIS_PAD_BUTTON_TRIANGLE    0x00001000
+#define ORBIS_PAD_BUTTON_CIRCLE      0x00002000
+#define ORBIS_PAD_BUTTON_CROSS       0x00004000
+#define ORBIS_PAD_BUTTON_SQUARE      0x00008000
+#define ORBIS_PAD_BUTTON_TOUCH_PAD   0x00100000
+#define ORBIS_PAD_BUTTON_INTERCEPTED 0x80000000
+
+#define ORBIS_PAD_ERROR_INVALID_ARG     (int32_t)0x80920001
+#define ORBIS_PAD_ERROR_INVALID_PORT    (int32_t)0x80920002
+#define ORBIS_PAD_ERROR_INVALID_HANDLE  (int32_t)0x80920003
+#define ORBIS_PAD_ERROR_ALREADY_OPENED  (int32_t)0x80920004
+#define ORBIS_PAD_ERROR_NOT_INITIALIZED (int32_t)0x80920005
+
+typedef struct OrbisPadVec2 {
+    uint8_t x;
+    uint8_t y;
+} OrbisPadVec2;
+
+typedef struct OrbisPadAnalog {
+    uint8_t l2;
+    uint8_t r2;
+} OrbisPadAnalog;
+
+typedef struct OrbisPadTouch {
+    uint16_t x;
+    uint16_t y;
+    uint8_t finger;
+    uint8_t pad[3];
+} OrbisPadTouch;
+
+typedef struct OrbisPadTouchData {
+    uint8_t fingers;
+    uint8_t padding1[3];
+    uint32_t padding2;
+    OrbisPadTouch touch[2];
+} OrbisPadTouchData;
+
+typedef struct OrbisPadExtensionUnitData {
+    uint32_t extensionUnitId;
+    uint8_t reserve[1];
+    uint8_t dataLength;
+    uint8_t data[10];
+} OrbisPadExtensionUnitData;
+
+// 120 bytes, same layout as ScePadData.
+typedef struct OrbisPadData {
+    uint32_t buttons;
+    OrbisPadVec2 leftStick;
+    OrbisPadVec2 rightStick;
+    OrbisPadAnalog analogButtons;
+    uint16_t padding;
+    float quat[4];
+    float vel[3];
+    float acell[3];
+    OrbisPadTouchData touch;
+    uint8_t connected;
+    uint64_t timestamp;
+    OrbisPadExtensionUnitData extensionUnitData;
+    uint8_t count;
+    uint8_t unknown[15];
+} OrbisPadData;
+
+typedef struct OrbisPadVibeParam {
+    uint8_t lgMotor;
+    uint8_t smMotor;
+} OrbisPadVibeParam;
+
+int32_t scePadInit(void);
+int32_t scePadOpen(int32_t userId, int32_t type, int32_t index, void *param);
+int32_t scePadClose(int32_t handle);
+int32_t scePadGetHandle(int32_t userId, int32_t type, int32_t index);
+int32_t scePadRead(int32_t handle, OrbisPadData *data, int32_t count);
+int32_t scePadReadState(int32_t handle, OrbisPadData *data);
+int32_t scePadReadExt(int32_t handle, OrbisPadData *data, int32_t count);
+int32_t scePadReadStateExt(int32_t handle, OrbisPadData *data);
+int32_t scePadSetVibration(int32_t handle, const OrbisPadVibeParam *param);
+int32_t scePadSetLightBar(int32_t handle, const void *param);
+
+#ifdef __cplusplus
+}
+#endif
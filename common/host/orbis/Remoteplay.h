@@ -0,0 +1,17 @@
+#pragma once
+
+// Host shim of the OpenOrbis Remoteplay header, see common/host/host.h.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int32_t sceRemoteplayProhibit(void);
+int32_t sceRemoteplayProhibitStreaming(int32_t mode);
+int32_t sceRemoteplayApprove(void);
+
+#ifdef __cplusplus
+}
+#endif
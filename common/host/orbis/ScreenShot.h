@@ -0,0 +1,18 @@
+#pragma once
+
+// Host shim of the OpenOrbis ScreenShot header, see common/host/host.h.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int32_t sceScreenShotDisable(void);
+int32_t sceScreenShotEnable(void);
+int32_t sceScreenShotSetOverlayImage(const char *path, int32_t offsetX, int32_t offsetY);
+int32_t sceScreenShotSetOverlayImageWithOrigin(const char *path, int32_t marginX, int32_t marginY, int32_t origin);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+
+// Host shim of the OpenOrbis Sysmodule header, see common/host/host.h.
+// The shim accepts every module id, these are only kept for source compatibility.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORBIS_SYSMODULE_VIDEO_RECORDING 0x0085
+#define ORBIS_SYSMODULE_SCREEN_SHOT     0x009a
+#define ORBIS_SYSMODULE_REMOTE_PLAY     0x00b9
+
+int32_t sceSysmoduleLoadModule(uint16_t id);
+int32_t sceSysmoduleUnloadModule(uint16_t id);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+// Host shim of the OpenOrbis SystemService header, see common/host/host.h.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORBIS_SYSTEM_SERVICE_PARAM_ID_LANG            1
+#define ORBIS_SYSTEM_SERVICE_PARAM_ID_DATE_FORMAT     2
+#define ORBIS_SYSTEM_SERVICE_PARAM_ID_TIME_FORMAT     3
+#define ORBIS_SYSTEM_SERVICE_PARAM_ID_TIME_ZONE       4
+#define ORBIS_SYSTEM_SERVICE_PARAM_ID_SUMMERTIME      5
+#define ORBIS_SYSTEM_SERVICE_PARAM_ID_SYSTEM_NAME     6
+#define ORBIS_SYSTEM_SERVICE_PARAM_ID_GAME_PARENTAL_LEVEL 7
+#define ORBIS_SYSTEM_SERVICE_PARAM_ID_ENTER_BUTTON_ASSIGN 1000
+
+int32_t sceSystemServiceParamGetInt(int32_t paramId, int32_t *value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+// Host shim of the Usbd header, see common/host/host.h.
+// A single device is attached while a USB replay is set by GOLDHEN_HOST_USBD or
+// host_usbd_replay(), interrupt IN transfers return its reports in order.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIBUSB_ERROR_IO        -1
+#define LIBUSB_ERROR_NO_DEVICE -4
+#define LIBUSB_ERROR_NOT_FOUND -5
+#define LIBUSB_ERROR_TIMEOUT   -7
+
+typedef struct libusb_context libusb_context;
+typedef struct libusb_device libusb_device;
+typedef struct libusb_device_handle libusb_device_handle;
+
+struct libusb_device_descriptor {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t bcdUSB;
+    uint8_t bDeviceClass;
+    uint8_t bDeviceSubClass;
+    uint8_t bDeviceProtocol;
+    uint8_t bMaxPacketSize0;
+    uint16_t idVendor;
+    uint16_t idProduct;
+    uint16_t bcdDevice;
+    uint8_t iManufacturer;
+    uint8_t iProduct;
+    uint8_t iSerialNumber;
+    uint8_t bNumConfigurations;
+};
+
+int32_t sceUsbdInit(struct libusb_context **ctx);
+void sceUsbdExit(struct libusb_context *ctx);
+ssize_t sceUsbdGetDeviceList(struct libusb_device ***list);
+void sceUsbdFreeDeviceList(struct libusb_device **list);
+int32_t sceUsbdGetDeviceDescriptor(struct libusb_device *dev, struct libusb_device_descriptor *desc);
+int32_t sceUsbdOpen(struct libusb_device *dev, struct libusb_device_handle **handle);
+void sceUsbdClose(struct libusb_device_handle *handle);
+int32_t sceUsbdClaimInterface(struct libusb_device_handle *handle, int32_t iface);
+int32_t sceUsbdReleaseInterface(struct libusb_device_handle *handle, int32_t iface);
+int32_t sceUsbdInterruptTransfer(struct libusb_device_handle *handle, uint8_t endpoint, uint8_t *data, int32_t length,
+                                 int32_t *transferred, uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+// Host shim of the OpenOrbis UserService header, see common/host/host.h.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OrbisUserServiceInitializeParams {
+    int32_t priority;
+} OrbisUserServiceInitializeParams;
+
+int32_t sceUserServiceInitialize(OrbisUserServiceInitializeParams *params);
+int32_t sceUserServiceGetInitialUser(int32_t *userId);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+
+// Host shim of the OpenOrbis VideoOut header, see common/host/host.h.
+
+#include <stdint.h>
+
+#include <orbis/libkernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORBIS_VIDEO_OUT_EVENT_FLIP 0
+
+typedef struct OrbisVideoOutResolutionStatus {
+    uint32_t width;
+    uint32_t height;
+    uint32_t paneWidth;
+    uint32_t paneHeight;
+    uint64_t refreshRate;
+    float screenSize;
+    uint16_t flags;
+    uint16_t reserved0;
+    uint32_t reserved1[3];
+} OrbisVideoOutResolutionStatus;
+
+typedef struct OrbisVideoOutFlipStatus {
+    uint64_t count;
+    uint64_t processTime;
+    uint64_t tsc;
+    int64_t flipArg;
+    uint64_t submitTsc;
+    uint64_t reserved0;
+    int32_t gcQueueNum;
+    int32_t flipPendingNum;
+    int32_t currentBuffer;
+    uint32_t reserved1;
+} OrbisVideoOutFlipStatus;
+
+int32_t sceVideoOutOpen(int32_t userId, int32_t type, int32_t index, const void *param);
+int32_t sceVideoOutClose(int32_t handle);
+int32_t sceVideoOutSetFlipRate(int32_t handle, int32_t rate);
+int32_t sceVideoOutSubmitFlip(int32_t handle, int32_t indexBuffer, int32_t flipMode, int64_t flipArg);
+int32_t sceVideoOutGetResolutionStatus(int32_t handle, OrbisVideoOutResolutionStatus *status);
+int32_t sceVideoOutGetFlipStatus(int32_t handle, OrbisVideoOutFlipStatus *status);
+int32_t sceVideoOutAddFlipEvent(OrbisKernelEqueue eq, int32_t handle, void *udata);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+// Host shim of the OpenOrbis VideoRecording header, see common/host/host.h.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int32_t sceVideoRecordingSetInfo(int32_t infoType, const void *info, int64_t size);
+
+#ifdef __cplusplus
+}
+#endif
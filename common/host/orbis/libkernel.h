@@ -0,0 +1,211 @@
+#pragma once
+
+// Host shim of the OpenOrbis libkernel header, see common/host/host.h.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *OrbisPthread;
+typedef void *OrbisPthreadAttr;
+typedef void *OrbisPthreadMutex;
+typedef void *OrbisPthreadMutexattr;
+typedef int OrbisPthreadKey;
+typedef void *OrbisKernelSema;
+typedef void *OrbisKernelEqueue;
+typedef uint32_t OrbisKernelUseconds;
+typedef int32_t OrbisKernelModule;
+typedef mode_t OrbisKernelMode;
+
+typedef struct OrbisKernelSchedParam {
+    int sched_priority;
+} OrbisKernelSchedParam;
+
+typedef struct OrbisKernelEvent {
+    uint64_t ident;
+    int16_t filter;
+    uint16_t flags;
+    uint32_t fflags;
+    int64_t data;
+    void *udata;
+} OrbisKernelEvent;
+
+#define ORBIS_KERNEL_PRIO_FIFO_DEFAULT 700
+#define ORBIS_KERNEL_PRIO_FIFO_HIGHEST 256
+#define ORBIS_KERNEL_PRIO_FIFO_LOWEST  767
+
+// libkernel errors are 0x80020000 | errno, errno values follow FreeBSD.
+#define ORBIS_KERNEL_ERROR_UNKNOWN 0x80020000
+#define ORBIS_KERNEL_ERROR_EPERM   0x80020001
+#define ORBIS_KERNEL_ERROR_ENOENT  0x80020002
+#define ORBIS_KERNEL_ERROR_EIO     0x80020005
+#define ORBIS_KERNEL_ERROR_EBADF   0x80020009
+#define ORBIS_KERNEL_ERROR_ENOMEM  0x8002000c
+#define ORBIS_KERNEL_ERROR_EACCES  0x8002000d
+#define ORBIS_KERNEL_ERROR_EFAULT  0x8002000e
+#define ORBIS_KERNEL_ERROR_EEXIST  0x80020011
+#define ORBIS_KERNEL_ERROR_ENOTDIR 0x80020014
+#define ORBIS_KERNEL_ERROR_EISDIR  0x80020015
+#define ORBIS_KERNEL_ERROR_EINVAL  0x80020016
+#define ORBIS_KERNEL_ERROR_EMFILE  0x80020018
+#define ORBIS_KERNEL_ERROR_ENOSPC  0x8002001c
+#define ORBIS_KERNEL_ERROR_ESRCH   0x80020003
+#define ORBIS_KERNEL_ERROR_ENOSYS  0x8002004e
+#define ORBIS_KERNEL_ERROR_ETIMEDOUT 0x8002003c
+
+typedef struct OrbisKernelModuleSegmentInfo {
+    void *address;
+    uint32_t size;
+    int32_t prot;
+} OrbisKernelModuleSegmentInfo;
+
+typedef struct OrbisKernelModuleInfo {
+    size_t size;
+    char name[256];
+    OrbisKernelModuleSegmentInfo segmentInfo[4];
+    uint32_t segmentCount;
+    uint8_t fingerprint[20];
+} OrbisKernelModuleInfo;
+
+// FreeBSD `struct dirent' as returned by sceKernelGetdents.
+typedef struct OrbisKernelDirent {
+    uint32_t d_fileno;
+    uint16_t d_reclen;
+    uint8_t d_type;
+    uint8_t d_namlen;
+    char d_name[256];
+} OrbisKernelDirent;
+
+typedef struct OrbisNotificationRequest {
+    int32_t type;
+    int32_t reqId;
+    int32_t priority;
+    int32_t msgId;
+    int32_t targetId;
+    int32_t userId;
+    int32_t unk1;
+    int32_t unk2;
+    int32_t appId;
+    int32_t errorNum;
+    int32_t unk3;
+    uint8_t useIconImageUri;
+    char message[1024];
+    char iconUri[1024];
+    char unk[1024];
+} OrbisNotificationRequest;
+
+typedef enum OrbisNotificationRequestType {
+    NotificationRequest = 0,
+    SystemNotification = 1,
+    SystemNotificationWithUserId = 2,
+    SystemNotificationWithDeviceId = 3,
+    SystemNotificationWithDeviceIdRelatedToUser = 4,
+    SystemNotificationWithText = 5,
+    SystemNotificationWithTextRelatedToUser = 6,
+    SystemNotificationWithErrorCode = 7,
+    SystemNotificationWithAppId = 8,
+    SystemNotificationWithAppName = 9,
+    SystemNotificationWithAppInfo = 10,
+    SystemNotificationWithAppNameRelatedToUser = 11,
+    SystemNotificationWithParams = 12,
+    SendSystemNotificationWithUserName = 13,
+    SystemNotificationWithUserNameInfo = 14,
+    SendAddressingSystemNotification = 15,
+    AddressingSystemNotificationWithDeviceId = 16,
+    AddressingSystemNotificationWithUserName = 17,
+    AddressingSystemNotificationWithUserId = 18,
+    UNK_1 = 19,
+    UNK_2 = 20,
+    UNK_3 = 21,
+    UNK_4 = 22,
+    UNK_5 = 23,
+    UNK_6 = 24,
+    UNK_7 = 25,
+    UNK_8 = 26,
+    UNK_9 = 27,
+    UNK_10 = 28,
+    UNK_11 = 29,
+    UNK_12 = 30,
+} OrbisNotificationRequestType;
+
+// Time
+uint64_t sceKernelGetProcessTimeCounter(void);
+uint64_t sceKernelGetProcessTimeCounterFrequency(void);
+int32_t sceKernelUsleep(uint32_t usec);
+
+// Threads
+int32_t scePthreadCreate(OrbisPthread *thread, const OrbisPthreadAttr *attr, void *(*entry)(void *), void *arg,
+                         const char *name);
+void scePthreadExit(void *value);
+int32_t scePthreadJoin(OrbisPthread thread, void **value);
+int32_t scePthreadDetach(OrbisPthread thread);
+OrbisPthread scePthreadSelf(void);
+int32_t scePthreadSetprio(OrbisPthread thread, int32_t prio);
+int32_t scePthreadYield(void);
+int32_t scePthreadMutexInit(OrbisPthreadMutex *mutex, const OrbisPthreadMutexattr *attr, const char *name);
+int32_t scePthreadMutexDestroy(OrbisPthreadMutex *mutex);
+int32_t scePthreadMutexLock(OrbisPthreadMutex *mutex);
+int32_t scePthreadMutexTrylock(OrbisPthreadMutex *mutex);
+int32_t scePthreadMutexUnlock(OrbisPthreadMutex *mutex);
+int32_t scePthreadKeyCreate(OrbisPthreadKey *key, void (*destructor)(void *));
+int32_t scePthreadKeyDelete(OrbisPthreadKey key);
+int32_t scePthreadSetspecific(OrbisPthreadKey key, const void *value);
+void *scePthreadGetspecific(OrbisPthreadKey key);
+int32_t sceKernelCreateSema(OrbisKernelSema *sem, const char *name, uint32_t attr, int32_t init, int32_t max,
+                            const void *opt);
+int32_t sceKernelDeleteSema(OrbisKernelSema sem);
+int32_t sceKernelWaitSema(OrbisKernelSema sem, int32_t need, OrbisKernelUseconds *timeout);
+int32_t sceKernelSignalSema(OrbisKernelSema sem, int32_t count);
+int32_t sceKernelCreateEqueue(OrbisKernelEqueue *eq, const char *name);
+int32_t sceKernelDeleteEqueue(OrbisKernelEqueue eq);
+int32_t sceKernelWaitEqueue(OrbisKernelEqueue eq, OrbisKernelEvent *ev, int32_t num, int32_t *out,
+                            OrbisKernelUseconds *timeout);
+
+// Files, paths are resolved below GOLDHEN_HOST_ROOT
+int32_t sceKernelOpen(const char *path, int32_t flags, OrbisKernelMode mode);
+int32_t sceKernelClose(int32_t fd);
+ssize_t sceKernelRead(int32_t fd, void *buf, size_t nbytes);
+ssize_t sceKernelWrite(int32_t fd, const void *buf, size_t nbytes);
+ssize_t sceKernelPread(int32_t fd, void *buf, size_t nbytes, off_t offset);
+ssize_t sceKernelPwrite(int32_t fd, const void *buf, size_t nbytes, off_t offset);
+off_t sceKernelLseek(int32_t fd, off_t offset, int32_t whence);
+int32_t sceKernelStat(const char *path, struct stat *sb);
+int32_t sceKernelFstat(int32_t fd, struct stat *sb);
+int32_t sceKernelCheckReachability(const char *path);
+int32_t sceKernelFsync(int32_t fd);
+int32_t sceKernelFtruncate(int32_t fd, off_t length);
+int32_t sceKernelMkdir(const char *path, OrbisKernelMode mode);
+int32_t sceKernelRmdir(const char *path);
+int32_t sceKernelUnlink(const char *path);
+int32_t sceKernelRename(const char *from, const char *to);
+int32_t sceKernelChmod(const char *path, OrbisKernelMode mode);
+int32_t sceKernelGetdents(int32_t fd, char *buf, int32_t nbytes);
+
+// Memory
+int32_t sceKernelMmap(void *addr, size_t len, int32_t prot, int32_t flags, int32_t fd, off_t offset, void **res);
+int32_t sceKernelMunmap(void *addr, size_t len);
+int32_t sceKernelMprotect(const void *addr, size_t len, int32_t prot);
+int32_t sceKernelMapNamedFlexibleMemory(void **addr, size_t len, int32_t prot, int32_t flags, const char *name);
+int32_t sceKernelAvailableFlexibleMemorySize(size_t *size);
+
+// Modules
+int32_t sceKernelLoadStartModule(const char *path, size_t argc, const void *argv, uint32_t flags, void *opt,
+                                 int32_t *res);
+int32_t sceKernelStopUnloadModule(int32_t handle, size_t argc, const void *argv, uint32_t flags, void *opt,
+                                  int32_t *res);
+int32_t sceKernelDlsym(int32_t handle, const char *symbol, void **addr);
+int32_t sceKernelGetModuleList(OrbisKernelModule *handles, size_t size, size_t *count);
+int32_t sceKernelGetModuleInfo(OrbisKernelModule handle, OrbisKernelModuleInfo *info);
+
+// System
+const char *sceKernelGetFsSandboxRandomWord(void);
+int32_t sceKernelSendNotificationRequest(int32_t device, OrbisNotificationRequest *req, size_t size, int32_t blocking);
+
+#ifdef __cplusplus
+}
+#endif
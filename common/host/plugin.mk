@@ -0,0 +1,116 @@
+# Host build of one plugin, see host.h.
+# Run from the plugin directory: make -f ../../common/host/plugin.mk
+
+DEBUG_FLAGS := -D__FINAL__=1
+ifeq ($(DEBUG),1)
+    DEBUG_FLAGS := -D__FINAL__=0
+endif
+
+EXTRAFLAGS := $(DEBUG_FLAGS) -D__USE_PRINTF__ -Wall
+ifeq ($(HOOK_STATS),1)
+    EXTRAFLAGS += -DHOOK_STATS=1
+endif
+ifeq ($(TRACE),1)
+    EXTRAFLAGS += -DTRACE=1
+endif
+ifneq ($(SANITIZE),)
+    EXTRAFLAGS += -fsanitize=$(SANITIZE) -fno-omit-frame-pointer
+endif
+
+CC         ?= cc
+CXX        ?= c++
+O_FLAG     ?= -O2 -g
+PLUGIN     := $(shell basename $(CURDIR))
+COMMON_DIR := ../../common
+HOST_DIR   := $(COMMON_DIR)/host
+BUILD_DIR  := ../../bin/host
+PROJDIR    := source
+INCLUDEDIR := include
+INTDIR     := $(BUILD_DIR)/obj/$(PLUGIN)
+TARGET     := $(BUILD_DIR)/$(PLUGIN).so
+SHIM       := $(BUILD_DIR)/libgoldhen_host.so
+
+CFILES      := $(wildcard $(PROJDIR)/*.c)
+CPPFILES    := $(wildcard $(PROJDIR)/*.cpp)
+COMMONFILES := $(wildcard $(COMMON_DIR)/*.c)
+OBJS        := $(patsubst $(PROJDIR)/%.c, $(INTDIR)/%.o, $(CFILES)) $(patsubst $(PROJDIR)/%.cpp, $(INTDIR)/%.o, $(CPPFILES))
+COMMONOBJS  := $(patsubst $(COMMON_DIR)/%.c, $(INTDIR)/common/%.o, $(COMMONFILES))
+
+# module_start/module_stop are hidden, they run as DT_INIT/DT_FINI like the PRX loader
+# runs them on console.
+# Common sources go through an archive so only what the plugin uses is linked, like
+# the explicit rules of the console Makefiles. C++ plugins get plugin_common built as
+# C++ the same way game_patch/Makefile does.
+# libc calls taking paths are rerooted below GOLDHEN_HOST_ROOT like the sceKernel ones.
+HOST_WRAP := fopen stat access chmod mkdir opendir unlink remove rename
+
+CFLAGS   := $(EXTRAFLAGS) $(O_FLAG) -fPIC -I$(HOST_DIR) -I$(INCLUDEDIR) -I$(COMMON_DIR)
+CXXFLAGS := $(CFLAGS)
+LINK     := $(CC)
+LIBS     :=
+ifneq ($(CPPFILES),)
+    LINK := $(CXX)
+    OBJS += $(INTDIR)/plugin_common_cpp.o
+endif
+
+# game_patch needs libmxml, skipped when it is not installed.
+ifneq ($(shell grep -l "<mxml.h>" $(CFILES) $(CPPFILES) 2>/dev/null),)
+    MXML_CFLAGS := $(shell pkg-config --cflags mxml 2>/dev/null)
+    MXML_LIBS   := $(shell pkg-config --libs mxml 2>/dev/null)
+    ifeq ($(MXML_LIBS),)
+        SKIP := libmxml not found
+    endif
+    CXXFLAGS += $(MXML_CFLAGS)
+    LIBS += $(MXML_LIBS)
+endif
+
+.PHONY: all clean build-info
+.DEFAULT_GOAL := all
+
+ifneq ($(SKIP),)
+all:
+	@echo "[!] Skipping $(PLUGIN): $(SKIP)"
+else
+all: build-info $(TARGET)
+endif
+
+# Only generated if missing, the console build rewrites it on every run.
+# Source trees without git (or a detached HEAD) still get a header that compiles.
+build-info:
+	@if [ ! -f $(COMMON_DIR)/git_ver.h ]; then \
+		echo "#define GIT_COMMIT \"$$(git rev-parse HEAD 2>/dev/null || echo unknown)\"" > $(COMMON_DIR)/git_ver.h; \
+		echo "#define GIT_VER \"$$(git branch --show-current 2>/dev/null | grep . || echo unknown)\"" >> $(COMMON_DIR)/git_ver.h; \
+		echo "#define GIT_NUM $$(git rev-list HEAD --count 2>/dev/null || echo 0)" >> $(COMMON_DIR)/git_ver.h; \
+		echo "#define BUILD_DATE \"$$(date '+%b %d %Y @ %T')\"" >> $(COMMON_DIR)/git_ver.h; \
+	fi
+
+$(TARGET): $(OBJS) $(INTDIR)/libcommon.a $(SHIM)
+	$(LINK) $(EXTRAFLAGS) -shared -o $@ $(OBJS) $(INTDIR)/libcommon.a -L$(BUILD_DIR) -lgoldhen_host $(LIBS) \
+		-Wl,-rpath,'$$ORIGIN' -Wl,-Bsymbolic -Wl,--no-undefined -Wl,-init,module_start -Wl,-fini,module_stop \
+		$(foreach f,$(HOST_WRAP),-Wl,--wrap=$(f)) \
+		-ldl -lpthread
+
+$(SHIM):
+	$(MAKE) -C $(HOST_DIR)
+
+$(INTDIR)/libcommon.a: $(COMMONOBJS)
+	@rm -f $@
+	ar rcs $@ $^
+
+$(INTDIR)/%.o: $(PROJDIR)/%.c | $(INTDIR)
+	$(CC) $(CFLAGS) -c -o $@ $<
+
+$(INTDIR)/%.o: $(PROJDIR)/%.cpp | $(INTDIR)
+	$(CXX) $(CXXFLAGS) -c -o $@ $<
+
+$(INTDIR)/common/%.o: $(COMMON_DIR)/%.c | $(INTDIR)
+	$(CC) $(CFLAGS) -c -o $@ $<
+
+$(INTDIR)/plugin_common_cpp.o: $(COMMON_DIR)/plugin_common.c | $(INTDIR)
+	$(CXX) $(CXXFLAGS) -x c++ -c -o $@ $<
+
+$(INTDIR):
+	@mkdir -p $@ $@/common
+
+clean:
+	rm -rf $(TARGET) $(INTDIR)
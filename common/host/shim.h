@@ -0,0 +1,24 @@
+#pragma once
+
+// Internals shared by the host shim sources.
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <orbis/libkernel.h>
+
+// libkernel error code of the current errno.
+int32_t host_error(int err);
+
+// Module handle of libgoldhen_host.so, system libraries resolve to it.
+int32_t host_shim_module(void);
+void *host_shim_symbol(const char *symbol);
+
+bool host_image_contains(uint64_t address, uint64_t length);
+uint64_t host_image_base(void);
+
+// Event queues: `host_equeue_add' makes `eq' report event `ident' of `filter', each
+// `host_equeue_trigger' of it wakes every queue it was added to.
+int32_t host_equeue_add(OrbisKernelEqueue eq, uint64_t ident, int16_t filter, void *udata);
+void host_equeue_trigger(uint64_t ident, int16_t filter, int64_t data);
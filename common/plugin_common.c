@@ -1,34 +1,284 @@
 #include "plugin_common.h"
 #include <Common.h>
+#include <stdbool.h>
+#include <orbis/libkernel.h>
+
+// Notifications are queued and sent from one low priority thread per plugin so callers
+// on game threads never block on `sceKernelSendNotificationRequest`.
+// The queue is a bounded MPSC ring (Vyukov style sequence per slot), the drainer
+// collapses repeated messages and rate limits the plugin as a whole. It sleeps on a
+// semaphore each published message signals.
+
+#define NOTIFY_QUEUE_SIZE       16 // must be power of two
+#define NOTIFY_ICON_MAX         128
+#define NOTIFY_HISTORY          4
+#define NOTIFY_COALESCE_MS      3000
+#define NOTIFY_RATE_WINDOW_MS   10000
+#define NOTIFY_RATE_BURST       4
+#define NOTIFY_SEMA_MAX         0x7fffffff
+
+enum notify_state {
+    NOTIFY_STOPPED = 0,
+    NOTIFY_STARTING,
+    NOTIFY_RUNNING,
+    NOTIFY_SYNC,
+};
+
+typedef struct {
+    u64 sequence;
+    char icon[NOTIFY_ICON_MAX];
+    char message[sizeof(((OrbisNotificationRequest*)0)->message)];
+} notify_slot;
+
+typedef struct {
+    u64 hash;
+    u64 last_sent;
+    u32 suppressed;
+} notify_history;
+
+static notify_slot g_NotifyQueue[NOTIFY_QUEUE_SIZE];
+static u64 g_NotifyHead = 0;
+static u64 g_NotifyTail = 0;
+static u32 g_NotifyState = NOTIFY_STOPPED;
+static u32 g_NotifyDropped = 0;
+static u32 g_NotifyPublishers = 0; // queued calls in flight, NotifyShutdown waits for them
+static OrbisPthread g_NotifyThread;
+static OrbisKernelSema g_NotifySema;
+
+// Only touched by the drainer thread.
+static notify_history g_NotifyHistory[NOTIFY_HISTORY];
+static u64 g_NotifyTokens = NOTIFY_RATE_BURST;
+static u64 g_NotifyRefill = 0;
+static u64 g_NotifyTicksPerMs = 0;
 
 // Thanks to OSM
 // https://github.com/OSM-Made/PS4-Notify/blob/c6d259bc5bd4aa519f5b0ce4f5e27ef7cb01ffdd/Notify.cpp
-
-// For pre formatted strings
-void NotifyStatic(const char* IconUri, const char* text) {
+static void notify_send(const char* IconUri, const char* text) {
     OrbisNotificationRequest Buffer;
-    final_printf("Notify text:\n%s\n", text);
+    memset(&Buffer, 0, sizeof(Buffer));
     Buffer.type = NotificationRequest;
     Buffer.unk3 = 0;
     Buffer.useIconImageUri = 1;
     Buffer.targetId = -1;
-    strcpy(Buffer.message, text);
-    strcpy(Buffer.iconUri, IconUri);
+    snprintf(Buffer.message, sizeof(Buffer.message), "%s", text);
+    snprintf(Buffer.iconUri, sizeof(Buffer.iconUri), "%s", IconUri);
     sceKernelSendNotificationRequest(0, &Buffer, sizeof(Buffer), 0);
 }
 
+static u64 notify_hash(const char* icon, const char* text) {
+    u64 hash = 0xcbf29ce484222325ull;
+    for (const char* p = icon; *p; p++) {
+        hash = (hash ^ (u8)*p) * 0x100000001b3ull;
+    }
+    for (const char* p = text; *p; p++) {
+        hash = (hash ^ (u8)*p) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Returns true if the message should be shown.
+static bool notify_admit(const char* icon, const char* text) {
+    const u64 now = sceKernelGetProcessTimeCounter();
+    const u64 coalesce = NOTIFY_COALESCE_MS * g_NotifyTicksPerMs;
+    const u64 hash = notify_hash(icon, text);
+    notify_history* oldest = &g_NotifyHistory[0];
+    notify_history* entry = NULL;
+
+    for (u32 i = 0; i < NOTIFY_HISTORY; i++) {
+        if (g_NotifyHistory[i].hash == hash && g_NotifyHistory[i].last_sent) {
+            entry = &g_NotifyHistory[i];
+            break;
+        }
+        if (g_NotifyHistory[i].last_sent < oldest->last_sent) {
+            oldest = &g_NotifyHistory[i];
+        }
+    }
+
+    if (entry && now - entry->last_sent < coalesce) {
+        entry->suppressed++;
+        return false;
+    }
+
+    const u64 window = NOTIFY_RATE_WINDOW_MS * g_NotifyTicksPerMs;
+    if (now - g_NotifyRefill >= window) {
+        g_NotifyTokens = NOTIFY_RATE_BURST;
+        g_NotifyRefill = now;
+    }
+    if (g_NotifyTokens == 0) {
+        final_printf("Notify rate limited, dropped:\n%s\n", text);
+        return false;
+    }
+    g_NotifyTokens--;
+
+    if (!entry) {
+        entry = oldest;
+        entry->hash = hash;
+        entry->suppressed = 0;
+    }
+    if (entry->suppressed) {
+        final_printf("Notify coalesced %u duplicate(s)\n", entry->suppressed);
+        entry->suppressed = 0;
+    }
+    entry->last_sent = now;
+    return true;
+}
+
+static void notify_drain(void) {
+    for (;;) {
+        notify_slot* slot = &g_NotifyQueue[g_NotifyTail & (NOTIFY_QUEUE_SIZE - 1)];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != g_NotifyTail + 1) {
+            break;
+        }
+        final_printf("Notify text:\n%s\n", slot->message);
+        if (notify_admit(slot->icon, slot->message)) {
+            notify_send(slot->icon, slot->message);
+        }
+        __atomic_store_n(&slot->sequence, g_NotifyTail + NOTIFY_QUEUE_SIZE, __ATOMIC_RELEASE);
+        g_NotifyTail++;
+    }
+    const u32 dropped = __atomic_exchange_n(&g_NotifyDropped, 0, __ATOMIC_RELAXED);
+    if (dropped) {
+        final_printf("Notify queue full, dropped %u message(s)\n", dropped);
+    }
+}
+
+static void* notify_thread(void* args) {
+    scePthreadSetprio(scePthreadSelf(), ORBIS_KERNEL_PRIO_FIFO_LOWEST);
+    while (__atomic_load_n(&g_NotifyState, __ATOMIC_ACQUIRE) != NOTIFY_SYNC) {
+        // a wakeup may find its message already drained by an earlier one
+        sceKernelWaitSema(g_NotifySema, 1, NULL);
+        notify_drain();
+    }
+    notify_drain();
+    scePthreadExit(NULL);
+    return NULL;
+}
+
+// Returns the state to use for this call, starting the drainer on first use.
+static u32 notify_service(void) {
+    u32 state = __atomic_load_n(&g_NotifyState, __ATOMIC_ACQUIRE);
+    if (state != NOTIFY_STOPPED) {
+        return state;
+    }
+    if (!__atomic_compare_exchange_n(&g_NotifyState, &state, (u32)NOTIFY_STARTING, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return state;
+    }
+    for (u32 i = 0; i < NOTIFY_QUEUE_SIZE; i++) {
+        g_NotifyQueue[i].sequence = i;
+    }
+    g_NotifyTicksPerMs = sceKernelGetProcessTimeCounterFrequency() / 1000;
+    g_NotifyRefill = sceKernelGetProcessTimeCounter();
+    s32 ret = sceKernelCreateSema(&g_NotifySema, "notify_sema", 1, 0, NOTIFY_SEMA_MAX, NULL);
+    if (ret != 0) {
+        final_printf("sceKernelCreateSema: 0x%08x, sending notifications inline\n", ret);
+        state = NOTIFY_SYNC;
+    } else if ((ret = scePthreadCreate(&g_NotifyThread, NULL, notify_thread, NULL, "notify_thread")) != 0) {
+        final_printf("scePthreadCreate: 0x%08x, sending notifications inline\n", ret);
+        sceKernelDeleteSema(g_NotifySema);
+        state = NOTIFY_SYNC;
+    } else {
+        state = NOTIFY_RUNNING;
+    }
+    __atomic_store_n(&g_NotifyState, state, __ATOMIC_RELEASE);
+    return state;
+}
+
+// Returns true when the message goes through the queue, the caller then publishes it and
+// calls notify_leave. Paired with NotifyShutdown, which moves the state before it waits for
+// the publishers: either it sees this one, or this one sees NOTIFY_SYNC and sends inline.
+static bool notify_enter(void) {
+    if (notify_service() != NOTIFY_RUNNING) {
+        return false;
+    }
+    __atomic_add_fetch(&g_NotifyPublishers, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_NotifyState, __ATOMIC_SEQ_CST) == NOTIFY_RUNNING) {
+        return true;
+    }
+    __atomic_sub_fetch(&g_NotifyPublishers, 1, __ATOMIC_RELEASE);
+    return false;
+}
+
+static void notify_leave(void) {
+    __atomic_sub_fetch(&g_NotifyPublishers, 1, __ATOMIC_RELEASE);
+}
+
+// Claims a queue slot, the caller fills `message` and publishes it.
+static notify_slot* notify_claim(u64* pos_out) {
+    u64 pos = __atomic_load_n(&g_NotifyHead, __ATOMIC_RELAXED);
+    for (;;) {
+        notify_slot* slot = &g_NotifyQueue[pos & (NOTIFY_QUEUE_SIZE - 1)];
+        const s64 diff = (s64)__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (s64)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&g_NotifyHead, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos_out = pos;
+                return slot;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&g_NotifyDropped, 1, __ATOMIC_RELAXED);
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&g_NotifyHead, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void notify_publish(notify_slot* slot, u64 pos, const char* IconUri) {
+    snprintf(slot->icon, sizeof(slot->icon), "%s", IconUri);
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+    sceKernelSignalSema(g_NotifySema, 1);
+}
+
+// For pre formatted strings
+void NotifyStatic(const char* IconUri, const char* text) {
+    if (notify_enter()) {
+        u64 pos = 0;
+        notify_slot* slot = notify_claim(&pos);
+        if (slot) {
+            snprintf(slot->message, sizeof(slot->message), "%s", text);
+            notify_publish(slot, pos, IconUri);
+        }
+        notify_leave();
+        return;
+    }
+    final_printf("Notify text:\n%s\n", text);
+    notify_send(IconUri, text);
+}
+
 // For formatted strings
 void Notify(const char* IconUri, const char *FMT, ...) {
-    OrbisNotificationRequest Buffer;
     va_list args;
+    if (notify_enter()) {
+        u64 pos = 0;
+        notify_slot* slot = notify_claim(&pos);
+        if (slot) {
+            va_start(args, FMT);
+            vsnprintf(slot->message, sizeof(slot->message), FMT, args);
+            va_end(args);
+            notify_publish(slot, pos, IconUri);
+        }
+        notify_leave();
+        return;
+    }
+    char message[sizeof(((OrbisNotificationRequest*)0)->message)];
     va_start(args, FMT);
-    vsprintf(Buffer.message, FMT, args);
+    vsnprintf(message, sizeof(message), FMT, args);
     va_end(args);
-    final_printf("Notify message:\n%s\n", Buffer.message);
-    Buffer.type = NotificationRequest;
-    Buffer.unk3 = 0;
-    Buffer.useIconImageUri = 1;
-    Buffer.targetId = -1;
-    strcpy(Buffer.iconUri, IconUri);
-    sceKernelSendNotificationRequest(0, &Buffer, sizeof(Buffer), 0);
+    final_printf("Notify message:\n%s\n", message);
+    notify_send(IconUri, message);
+}
+
+void NotifyShutdown(void) {
+    u32 state = NOTIFY_RUNNING;
+    if (__atomic_compare_exchange_n(&g_NotifyState, &state, (u32)NOTIFY_SYNC, false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+        // the drainer's last pass must see what they publish, and their signals the sema
+        while (__atomic_load_n(&g_NotifyPublishers, __ATOMIC_SEQ_CST)) {
+            scePthreadYield();
+        }
+        sceKernelSignalSema(g_NotifySema, 1);
+        scePthreadJoin(g_NotifyThread, NULL);
+        sceKernelDeleteSema(g_NotifySema);
+    }
 }
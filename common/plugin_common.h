@@ -48,6 +48,9 @@
 
 void NotifyStatic(const char* IconUri, const char *text);
 void Notify(const char* IconUri, const char *FMT, ...);
+// Notifications are queued and shown from a background thread, repeats are coalesced.
+// Call from `plugin_unload` to flush pending notifications and stop the thread.
+void NotifyShutdown(void);
 // Takes hardcoded input string 2 to strlen against during compile time.
 // startsWith(input_1, "input 2");
 #define startsWith(str1, str2) (strncmp(str1, str2, __builtin_strlen(str2)) == 0)
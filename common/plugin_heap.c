@@ -0,0 +1,361 @@
+#include "plugin_heap.h"
+#include "plugin_common.h"
+#include "telemetry.h"
+#include <stdbool.h>
+#include <orbis/libkernel.h>
+
+#define PLUGIN_HEAP_PAGE    (16 * 1024)
+#define PLUGIN_HEAP_MAGIC   0x50484748 // "GHHP"
+#define PLUGIN_HEAP_FREED   0x46524545 // "FREE"
+#define PLUGIN_HEAP_LARGE   0xff
+#define PLUGIN_HEAP_PROT_RW (0x01 | 0x02)
+
+// Precedes every block, keeps the payload 16 byte aligned.
+typedef struct heap_header {
+    u32 magic;
+    u32 size_class;
+    u64 size; // requested bytes
+} heap_header;
+
+// Large blocks are listed so shutdown can unmap them.
+typedef struct heap_large {
+    struct heap_large *next;
+    struct heap_large *prev;
+    u64 length; // mapping length
+    u64 reserved;
+    heap_header header;
+} heap_large;
+
+// Free blocks keep their header, the link lives in the payload.
+typedef struct heap_free {
+    heap_header header;
+    struct heap_free *next;
+} heap_free;
+
+// Starts every arena mapping. More are mapped when the current one is used up.
+typedef struct heap_chunk {
+    struct heap_chunk *next;
+    u64 length;
+} heap_chunk;
+
+static u32 g_HeapLock = 0;
+static bool g_HeapReady = false;
+static u64 g_HeapArenaSize = 0;
+static u64 g_HeapArenaUsed = 0; // of g_HeapChunks, the current arena
+static heap_free *g_HeapFree[PLUGIN_HEAP_CLASSES];
+static heap_large *g_HeapLarge = NULL;
+static heap_chunk *g_HeapChunks = NULL;
+static plugin_heap_stats g_HeapStats;
+static telemetry_slot *g_HeapLiveSlot = NULL;
+static telemetry_slot *g_HeapPeakSlot = NULL;
+static telemetry_slot *g_HeapMappedSlot = NULL;
+static bool g_HeapFailureLogged = false;
+
+// Allocations are short, a spin lock keeps game threads off kernel mutexes.
+static void heap_lock(void) {
+    while (__atomic_test_and_set(&g_HeapLock, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&g_HeapLock, __ATOMIC_RELAXED)) {
+            scePthreadYield();
+        }
+    }
+}
+
+static void heap_unlock(void) {
+    __atomic_clear(&g_HeapLock, __ATOMIC_RELEASE);
+}
+
+static inline u64 heap_round(u64 size, u64 align) {
+    return (size + align - 1) & ~(align - 1);
+}
+
+static inline u32 heap_class(size_t size) {
+    const size_t block = size + sizeof(heap_header);
+    if (block <= PLUGIN_HEAP_MIN_CLASS) {
+        return 0;
+    }
+    return (u32)(64 - __builtin_clzll(block - 1)) - __builtin_ctz(PLUGIN_HEAP_MIN_CLASS);
+}
+
+static inline u64 heap_class_size(u32 size_class) {
+    return (u64)PLUGIN_HEAP_MIN_CLASS << size_class;
+}
+
+static void heap_publish(void) {
+    telemetry_set(g_HeapLiveSlot, (s64)g_HeapStats.live);
+    telemetry_set(g_HeapPeakSlot, (s64)g_HeapStats.peak);
+    telemetry_set(g_HeapMappedSlot, (s64)g_HeapStats.mapped);
+}
+
+static void heap_account(s64 live, s64 mapped) {
+    g_HeapStats.live += live;
+    g_HeapStats.mapped += mapped;
+    if (g_HeapStats.live > g_HeapStats.peak) {
+        g_HeapStats.peak = g_HeapStats.live;
+    }
+    heap_publish();
+}
+
+static bool heap_within_budget(u64 length) {
+    return !g_HeapStats.budget || g_HeapStats.mapped + length <= g_HeapStats.budget;
+}
+
+static void heap_fail(size_t size) {
+    g_HeapStats.failures++;
+    if (!g_HeapFailureLogged) {
+        g_HeapFailureLogged = true;
+        final_printf("plugin_heap: %lu byte(s) over budget (%lu of %lu mapped)\n", (unsigned long)size,
+                     (unsigned long)g_HeapStats.mapped, (unsigned long)g_HeapStats.budget);
+    }
+}
+
+static int32_t heap_map_chunk(void) {
+    void *addr = NULL;
+    const int32_t ret =
+        sceKernelMapNamedFlexibleMemory(&addr, g_HeapArenaSize, PLUGIN_HEAP_PROT_RW, 0, "GoldHEN plugin heap");
+    if (ret != 0) {
+        final_printf("plugin_heap: sceKernelMapNamedFlexibleMemory(%lu): 0x%08x\n", (unsigned long)g_HeapArenaSize,
+                     ret);
+        return ret;
+    }
+    heap_chunk *chunk = (heap_chunk *)addr;
+    chunk->next = g_HeapChunks;
+    chunk->length = g_HeapArenaSize;
+    g_HeapChunks = chunk;
+    g_HeapArenaUsed = sizeof(heap_chunk);
+    g_HeapStats.arena_used += sizeof(heap_chunk);
+    heap_account(0, (s64)g_HeapArenaSize);
+    return 0;
+}
+
+// Called with the lock held.
+static int32_t heap_init_locked(const char *owner, size_t arena_size, size_t budget) {
+    if (g_HeapReady) {
+        return 0;
+    }
+    const u64 size = heap_round(arena_size ? arena_size : PLUGIN_HEAP_DEFAULT_ARENA, PLUGIN_HEAP_PAGE);
+    if (budget && budget < size) {
+        budget = size;
+    }
+    memset(g_HeapFree, 0, sizeof(g_HeapFree));
+    memset(&g_HeapStats, 0, sizeof(g_HeapStats));
+    g_HeapStats.budget = budget;
+    g_HeapFailureLogged = false;
+    g_HeapArenaSize = size;
+    const int32_t ret = heap_map_chunk();
+    if (ret != 0) {
+        return ret;
+    }
+    if (owner) {
+        g_HeapLiveSlot = telemetry_register(TELEMETRY_GAUGE, owner, "heap_live_bytes");
+        g_HeapPeakSlot = telemetry_register(TELEMETRY_GAUGE, owner, "heap_peak_bytes");
+        g_HeapMappedSlot = telemetry_register(TELEMETRY_GAUGE, owner, "heap_mapped_bytes");
+    }
+    heap_publish();
+    g_HeapReady = true;
+    return 0;
+}
+
+int32_t plugin_heap_init(const char *owner, size_t arena_size, size_t budget) {
+    heap_lock();
+    const int32_t ret = heap_init_locked(owner, arena_size, budget);
+    heap_unlock();
+    return ret;
+}
+
+void plugin_heap_shutdown(void) {
+    heap_lock();
+    if (!g_HeapReady) {
+        heap_unlock();
+        return;
+    }
+    u32 leaked = g_HeapStats.large_live;
+    for (u32 i = 0; i < PLUGIN_HEAP_CLASSES; i++) {
+        leaked += g_HeapStats.class_live[i];
+    }
+    if (leaked) {
+        final_printf("plugin_heap: %u block(s), %lu byte(s) still in use at shutdown\n", leaked,
+                     (unsigned long)g_HeapStats.live);
+    }
+    for (heap_large *large = g_HeapLarge; large;) {
+        heap_large *next = large->next;
+        sceKernelMunmap(large, large->length);
+        large = next;
+    }
+    g_HeapLarge = NULL;
+    for (heap_chunk *chunk = g_HeapChunks; chunk;) {
+        heap_chunk *next = chunk->next;
+        sceKernelMunmap(chunk, chunk->length);
+        chunk = next;
+    }
+    g_HeapChunks = NULL;
+    g_HeapArenaSize = 0;
+    g_HeapArenaUsed = 0;
+    memset(g_HeapFree, 0, sizeof(g_HeapFree));
+    g_HeapStats.live = 0;
+    g_HeapStats.mapped = 0;
+    heap_publish();
+    g_HeapLiveSlot = g_HeapPeakSlot = g_HeapMappedSlot = NULL;
+    g_HeapReady = false;
+    heap_unlock();
+}
+
+static void *heap_alloc_large(size_t size) {
+    const u64 length = heap_round(size + sizeof(heap_large), PLUGIN_HEAP_PAGE);
+    if (!heap_within_budget(length)) {
+        heap_fail(size);
+        return NULL;
+    }
+    void *addr = NULL;
+    const int32_t ret = sceKernelMapNamedFlexibleMemory(&addr, length, PLUGIN_HEAP_PROT_RW, 0, "GoldHEN plugin heap");
+    if (ret != 0) {
+        final_printf("plugin_heap: sceKernelMapNamedFlexibleMemory(%lu): 0x%08x\n", (unsigned long)length, ret);
+        g_HeapStats.failures++;
+        return NULL;
+    }
+    heap_large *large = (heap_large *)addr;
+    large->prev = NULL;
+    large->next = g_HeapLarge;
+    if (g_HeapLarge) {
+        g_HeapLarge->prev = large;
+    }
+    g_HeapLarge = large;
+    large->length = length;
+    large->header.magic = PLUGIN_HEAP_MAGIC;
+    large->header.size_class = PLUGIN_HEAP_LARGE;
+    large->header.size = size;
+    g_HeapStats.large_live++;
+    heap_account((s64)length, (s64)length);
+    return &large->header + 1;
+}
+
+void *plugin_heap_alloc(size_t size) {
+    heap_lock();
+    if (!g_HeapReady && heap_init_locked(NULL, 0, 0) != 0) {
+        heap_unlock();
+        return NULL;
+    }
+    void *ptr = NULL;
+    if (size > PLUGIN_HEAP_MAX_CLASS - sizeof(heap_header)) {
+        ptr = heap_alloc_large(size);
+    } else {
+        const u32 size_class = heap_class(size);
+        const u64 block = heap_class_size(size_class);
+        heap_header *header = (heap_header *)g_HeapFree[size_class];
+        if (header) {
+            g_HeapFree[size_class] = g_HeapFree[size_class]->next;
+        } else {
+            // The tail of a used up arena is left unused.
+            if (g_HeapArenaUsed + block > g_HeapArenaSize) {
+                if (!heap_within_budget(g_HeapArenaSize)) {
+                    heap_fail(size);
+                } else if (heap_map_chunk() != 0) {
+                    g_HeapStats.failures++;
+                }
+            }
+            if (g_HeapArenaUsed + block <= g_HeapArenaSize) {
+                header = (heap_header *)((u8 *)g_HeapChunks + g_HeapArenaUsed);
+                g_HeapArenaUsed += block;
+                g_HeapStats.arena_used += block;
+            }
+        }
+        if (header) {
+            header->magic = PLUGIN_HEAP_MAGIC;
+            header->size_class = size_class;
+            header->size = size;
+            g_HeapStats.class_live[size_class]++;
+            heap_account((s64)block, 0);
+            ptr = header + 1;
+        }
+    }
+    if (ptr) {
+        g_HeapStats.allocs++;
+    }
+    heap_unlock();
+    return ptr;
+}
+
+void *plugin_heap_calloc(size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *ptr = plugin_heap_alloc(count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+static heap_header *heap_header_of(void *ptr) {
+    heap_header *header = (heap_header *)ptr - 1;
+    if (header->magic == PLUGIN_HEAP_FREED) {
+        final_printf("plugin_heap: %p freed twice\n", ptr);
+        return NULL;
+    }
+    if (header->magic != PLUGIN_HEAP_MAGIC) {
+        final_printf("plugin_heap: %p was not allocated by plugin_heap_alloc\n", ptr);
+        return NULL;
+    }
+    return header;
+}
+
+void *plugin_heap_realloc(void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return plugin_heap_alloc(size);
+    }
+    heap_header *header = heap_header_of(ptr);
+    if (header == NULL) {
+        return NULL;
+    }
+    if (header->size_class != PLUGIN_HEAP_LARGE && size <= PLUGIN_HEAP_MAX_CLASS - sizeof(heap_header) &&
+        heap_class(size) == header->size_class) {
+        header->size = size;
+        return ptr;
+    }
+    void *resized = plugin_heap_alloc(size);
+    if (resized) {
+        memcpy(resized, ptr, header->size < size ? header->size : size);
+        plugin_heap_free(ptr);
+    }
+    return resized;
+}
+
+void plugin_heap_free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    heap_header *header = heap_header_of(ptr);
+    if (header == NULL) {
+        return;
+    }
+    heap_lock();
+    header->magic = PLUGIN_HEAP_FREED;
+    if (header->size_class == PLUGIN_HEAP_LARGE) {
+        heap_large *large = (heap_large *)((u8 *)header - offsetof(heap_large, header));
+        if (large->prev) {
+            large->prev->next = large->next;
+        } else {
+            g_HeapLarge = large->next;
+        }
+        if (large->next) {
+            large->next->prev = large->prev;
+        }
+        const u64 length = large->length;
+        sceKernelMunmap(large, length);
+        g_HeapStats.large_live--;
+        heap_account(-(s64)length, -(s64)length);
+    } else {
+        heap_free *node = (heap_free *)header;
+        node->next = g_HeapFree[header->size_class];
+        g_HeapFree[header->size_class] = node;
+        g_HeapStats.class_live[header->size_class]--;
+        heap_account(-(s64)heap_class_size(header->size_class), 0);
+    }
+    g_HeapStats.frees++;
+    heap_unlock();
+}
+
+void plugin_heap_get_stats(plugin_heap_stats *stats) {
+    heap_lock();
+    *stats = g_HeapStats;
+    heap_unlock();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// Allocator for memory a plugin owns, kept out of the game's heap.
+// Blocks up to PLUGIN_HEAP_MAX_CLASS bytes come from power of two size classes whose free
+// lists are refilled from a bump arena in a flexible memory mapping owned by the plugin,
+// another arena of the same size is mapped when it is used up. Larger blocks get a mapping
+// of their own. Live, peak and mapped bytes are published as
+// telemetry gauges of the plugin (see telemetry.h) and returned by plugin_heap_get_stats().
+//
+// Usage:
+//     plugin_heap_init(g_pluginName, 64 * 1024, 512 * 1024); // in plugin_load
+//     Detour *d = (Detour *)plugin_heap_alloc(sizeof(Detour));
+//     plugin_heap_free(d);
+//     plugin_heap_shutdown();                                 // in plugin_unload, after UNHOOK
+//
+// Allocating before plugin_heap_init() initializes the heap with the default sizes.
+// Memory from plugin_heap_alloc() must go back to plugin_heap_free(), never to free().
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PLUGIN_HEAP_MIN_CLASS 32
+#define PLUGIN_HEAP_MAX_CLASS 2048
+#define PLUGIN_HEAP_CLASSES 7 // 32, 64, ... 2048, 16 bytes of each are the header
+#define PLUGIN_HEAP_DEFAULT_ARENA (64 * 1024)
+
+typedef struct plugin_heap_stats {
+    uint64_t live;    // bytes of blocks in use, headers and class rounding included
+    uint64_t peak;    // highest `live' since init
+    uint64_t mapped;  // arena plus large block mappings
+    uint64_t arena_used;
+    uint64_t budget;  // 0 when unlimited
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t failures;
+    uint32_t class_live[PLUGIN_HEAP_CLASSES];
+    uint32_t large_live;
+} plugin_heap_stats;
+
+/**
+ * @brief Maps the arena of the plugin. Does nothing if the heap is already initialized.
+ * @param owner plugin name of the telemetry gauges
+ * @param arena_size bytes of each bump arena, rounded up to 16 KiB
+ * @param budget limit of `mapped' bytes, allocations past it fail. 0 for no limit.
+ * @return int32_t 0 on success
+ */
+int32_t plugin_heap_init(const char *owner, size_t arena_size, size_t budget);
+
+/**
+ * @brief Unmaps the arena and every large block. Blocks still in use are reported and lost.
+ */
+void plugin_heap_shutdown(void);
+
+/**
+ * @brief Returns a block of at least `size' bytes aligned to 16, NULL when out of budget.
+ * @param size
+ * @return void*
+ */
+void *plugin_heap_alloc(size_t size);
+
+void *plugin_heap_calloc(size_t count, size_t size);
+
+/**
+ * @brief Resizes `ptr' like realloc(), in place when the size class does not change.
+ * @param ptr
+ * @param size
+ * @return void*
+ */
+void *plugin_heap_realloc(void *ptr, size_t size);
+
+/**
+ * @brief Frees a block of plugin_heap_alloc(). NULL is ignored.
+ * @param ptr
+ */
+void plugin_heap_free(void *ptr);
+
+void plugin_heap_get_stats(plugin_heap_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
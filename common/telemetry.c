@@ -0,0 +1,69 @@
+#include <string.h>
+
+#include "plugin_common.h"
+#include "telemetry.h"
+
+static telemetry_get_bus_t g_TelemetryGetBus = NULL;
+static bool g_TelemetryResolved = false;
+
+static void resolve_telemetry(void) {
+    OrbisKernelModule handles[256] = {0};
+    size_t numModules = 0;
+    g_TelemetryResolved = true;
+    if (sceKernelGetModuleList(handles, sizeof(handles), &numModules)) {
+        return;
+    }
+    for (size_t i = 0; i < numModules; ++i) {
+        OrbisKernelModuleInfo moduleInfo = {0};
+        moduleInfo.size = sizeof(moduleInfo);
+        if (sceKernelGetModuleInfo(handles[i], &moduleInfo)) {
+            continue;
+        }
+        if (strstr(moduleInfo.name, TELEMETRY_MODULE)) {
+            sceKernelDlsym(handles[i], TELEMETRY_GET_BUS, (void **)&g_TelemetryGetBus);
+            debug_printf("%s @ 0x%p\n", TELEMETRY_GET_BUS, g_TelemetryGetBus);
+            return;
+        }
+    }
+}
+
+telemetry_bus *telemetry_get_bus(void) {
+    if (!g_TelemetryResolved) {
+        resolve_telemetry();
+    }
+    if (g_TelemetryGetBus == NULL) {
+        return NULL;
+    }
+    return g_TelemetryGetBus();
+}
+
+telemetry_slot *telemetry_register(telemetry_type type, const char *owner, const char *name) {
+    telemetry_bus *bus = telemetry_get_bus();
+    if (bus == NULL) {
+        return NULL;
+    }
+
+    // Reuse the slot of a previous load of the same plugin.
+    const uint32_t used = __atomic_load_n(&bus->used, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < used && i < bus->slot_count; i++) {
+        telemetry_slot *slot = &bus->slot[i];
+        if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) == TELEMETRY_SLOT_READY &&
+            slot->type == (uint32_t)type && strncmp(slot->owner, owner, sizeof(slot->owner)) == 0 &&
+            strncmp(slot->name, name, sizeof(slot->name)) == 0) {
+            return slot;
+        }
+    }
+
+    const uint32_t index = __atomic_fetch_add(&bus->used, 1, __ATOMIC_ACQ_REL);
+    if (index >= bus->slot_count) {
+        final_printf("telemetry: bus full, %s/%s not registered\n", owner, name);
+        return NULL;
+    }
+    telemetry_slot *slot = &bus->slot[index];
+    __atomic_store_n(&slot->state, TELEMETRY_SLOT_CLAIMED, __ATOMIC_RELAXED);
+    slot->type = type;
+    snprintf(slot->owner, sizeof(slot->owner), "%s", owner);
+    snprintf(slot->name, sizeof(slot->name), "%s", name);
+    __atomic_store_n(&slot->state, TELEMETRY_SLOT_READY, __ATOMIC_RELEASE);
+    return slot;
+}
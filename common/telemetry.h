@@ -0,0 +1,114 @@
+#pragma once
+
+// Process wide telemetry bus shared by every plugin.
+// plugin_loader owns a named mapping of fixed slots (counters, gauges and histograms);
+// plugins register slots into it without locks and update them with relaxed atomics.
+// When `telemetry_interval_ms' is set in plugins.ini, plugin_loader snapshots the bus
+// to /data/GoldHEN/telemetry/<titleid>_<time>.bin, `tools/telemetry_csv' converts it.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TELEMETRY_MODULE "plugin_loader"
+#define TELEMETRY_GET_BUS "plugin_telemetry_get_bus"
+
+#define TELEMETRY_MAGIC 0x42544847 // "GHTB"
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_SLOTS 256
+#define TELEMETRY_BUCKETS 32
+#define TELEMETRY_NAME_MAX 32
+
+typedef enum telemetry_type {
+    TELEMETRY_COUNTER = 1,
+    TELEMETRY_GAUGE,
+    TELEMETRY_HISTOGRAM,
+} telemetry_type;
+
+typedef enum telemetry_slot_state {
+    TELEMETRY_SLOT_FREE = 0,
+    TELEMETRY_SLOT_CLAIMED,
+    TELEMETRY_SLOT_READY,
+} telemetry_slot_state;
+
+// Histograms bucket values by power of two, bucket `i' holds values in [2^(i-1), 2^i).
+typedef struct telemetry_slot {
+    uint32_t state;
+    uint32_t type;
+    char owner[TELEMETRY_NAME_MAX];
+    char name[TELEMETRY_NAME_MAX];
+    uint64_t value;
+    uint64_t count;
+    uint64_t bucket[TELEMETRY_BUCKETS];
+} __attribute__((aligned(64))) telemetry_slot;
+
+typedef struct telemetry_bus {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t used;
+    telemetry_slot slot[TELEMETRY_SLOTS];
+} telemetry_bus;
+
+typedef telemetry_bus *(*telemetry_get_bus_t)(void);
+
+/**
+ * @brief Returns the bus from plugin_loader.
+ *        Returns NULL if plugin_loader is not loaded or telemetry is disabled.
+ * @return telemetry_bus*
+ */
+telemetry_bus *telemetry_get_bus(void);
+
+/**
+ * @brief Finds or registers the slot `owner'/`name' of `type'.
+ *        Returns NULL if the bus is unavailable or full, the update functions accept NULL.
+ * @param type
+ * @param owner
+ * @param name
+ * @return telemetry_slot*
+ */
+telemetry_slot *telemetry_register(telemetry_type type, const char *owner, const char *name);
+
+static inline uint32_t telemetry_bucket(uint64_t value)
+{
+    const uint32_t bucket = value ? 64 - __builtin_clzll(value) : 0;
+    return bucket < TELEMETRY_BUCKETS ? bucket : TELEMETRY_BUCKETS - 1;
+}
+
+static inline void telemetry_add(telemetry_slot *slot, uint64_t value)
+{
+    if (slot) {
+        __atomic_fetch_add(&slot->value, value, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void telemetry_set(telemetry_slot *slot, int64_t value)
+{
+    if (slot) {
+        __atomic_store_n(&slot->value, (uint64_t)value, __ATOMIC_RELAXED);
+    }
+}
+
+// `value' holds the sum of observed values.
+static inline void telemetry_observe(telemetry_slot *slot, uint64_t value)
+{
+    if (slot) {
+        __atomic_fetch_add(&slot->value, value, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&slot->count, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&slot->bucket[telemetry_bucket(value)], 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Snapshot file format, all fields little endian:
+//     telemetry_file_header
+//     { u8 TELEMETRY_ENTRY_SLOT, u16 index, u8 type, char owner[32], char name[32] }
+//     { u8 TELEMETRY_ENTRY_SNAPSHOT, u64 time, u16 count, count * { u16 index, u64 value, u64 count,
+//       u64 bucket[32] (histograms only) } }
+#define TELEMETRY_FILE_MAGIC 0x53544847 // "GHTS"
+#define TELEMETRY_ENTRY_SLOT 1
+#define TELEMETRY_ENTRY_SNAPSHOT 2
+
+typedef struct telemetry_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t frequency;
+} telemetry_file_header;
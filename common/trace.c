@@ -0,0 +1,194 @@
+#include "trace.h"
+
+#if defined(TRACE) && (TRACE) == 1
+
+#include "plugin_common.h"
+#include <Common.h>
+#include <stdbool.h>
+#include <orbis/libkernel.h>
+
+#define TRACE_DIR       GOLDHEN_PATH "/trace"
+#define TRACE_MAP_ALIGN (16 * 1024)
+#define TRACE_NO_NAME   0xffff
+
+// Rings are found through this table, it stays valid while the file is unmapped.
+typedef struct {
+    u64 thread;
+    u32 busy; // set while the owner writes to its ring
+} __attribute__((aligned(64))) trace_thread;
+
+static trace_file_header *g_TraceHeader = NULL;
+static trace_ring *g_TraceRings = NULL;
+static u64 g_TraceSize = 0;
+static u32 g_TraceLock = 0;
+static u32 g_TraceDropped = 0;
+static u32 g_TraceGeneration = 0; // 1 to 0xffff, bumped by trace_start to invalidate call site caches
+static trace_thread g_TraceThreads[TRACE_THREADS];
+
+static void trace_lock(void)
+{
+    while (__atomic_test_and_set(&g_TraceLock, __ATOMIC_ACQUIRE)) {
+        scePthreadYield();
+    }
+}
+
+static void trace_unlock(void)
+{
+    __atomic_clear(&g_TraceLock, __ATOMIC_RELEASE);
+}
+
+int32_t trace_start(const char *plugin)
+{
+    char path[MAX_PATH_];
+    trace_lock();
+    if (g_TraceHeader) {
+        trace_unlock();
+        return 0;
+    }
+    sceKernelMkdir(TRACE_DIR, 0777);
+    snprintf(path, sizeof(path), TRACE_DIR "/%s.trace", plugin);
+    const u64 size = (sizeof(trace_file_header) + sizeof(trace_ring) * TRACE_THREADS + TRACE_MAP_ALIGN - 1) &
+                     ~(u64)(TRACE_MAP_ALIGN - 1);
+    s32 fd = sceKernelOpen(path, 0x0002 | 0x0200 | 0x0400, 0777); // O_RDWR | O_CREAT | O_TRUNC
+    if (fd < 0) {
+        final_printf("trace: failed to open %s (0x%08x)\n", path, fd);
+        trace_unlock();
+        return fd;
+    }
+    void *addr = NULL;
+    s32 ret = sceKernelFtruncate(fd, size);
+    if (ret == 0) {
+        ret = sceKernelMmap(NULL, size, 0x01 | 0x02, 0x0001, fd, 0, &addr); // MAP_SHARED
+    }
+    sceKernelClose(fd);
+    if (ret != 0) {
+        final_printf("trace: failed to map %s (0x%08x)\n", path, ret);
+        trace_unlock();
+        return ret;
+    }
+
+    trace_file_header *header = (trace_file_header *)addr;
+    header->version = TRACE_VERSION;
+    header->frequency = sceKernelGetProcessTimeCounterFrequency();
+    header->start_time = sceKernelGetProcessTimeCounter();
+    header->threads = TRACE_THREADS;
+    header->ring_events = TRACE_RING_EVENTS;
+    strncpy(header->plugin, plugin, sizeof(header->plugin) - 1);
+    header->magic = TRACE_MAGIC;
+
+    memset(g_TraceThreads, 0, sizeof(g_TraceThreads));
+    g_TraceDropped = 0;
+    g_TraceGeneration = g_TraceGeneration % 0xffff + 1;
+    g_TraceSize = size;
+    g_TraceRings = (trace_ring *)(header + 1);
+    __atomic_store_n(&g_TraceHeader, header, __ATOMIC_SEQ_CST);
+    trace_unlock();
+    final_printf("trace: recording to %s\n", path);
+    return 0;
+}
+
+void trace_stop(void)
+{
+    trace_lock();
+    trace_file_header *header = g_TraceHeader;
+    if (!header) {
+        trace_unlock();
+        return;
+    }
+    // Writers check the header after marking themselves busy, wait for the ones in flight.
+    __atomic_store_n(&g_TraceHeader, NULL, __ATOMIC_SEQ_CST);
+    for (u32 i = 0; i < TRACE_THREADS; i++) {
+        while (__atomic_load_n(&g_TraceThreads[i].busy, __ATOMIC_SEQ_CST)) {
+            scePthreadYield();
+        }
+    }
+    header->dropped = __atomic_load_n(&g_TraceDropped, __ATOMIC_RELAXED);
+    sceKernelMunmap(header, g_TraceSize);
+    g_TraceRings = NULL;
+    g_TraceSize = 0;
+    trace_unlock();
+}
+
+uint16_t trace_name(uint32_t *id, const char *name)
+{
+    const u32 cached = __atomic_load_n(id, __ATOMIC_ACQUIRE);
+    if (cached && (cached >> 16) == __atomic_load_n(&g_TraceGeneration, __ATOMIC_RELAXED)) {
+        return (u16)cached;
+    }
+    trace_lock();
+    trace_file_header *header = g_TraceHeader;
+    u16 index = TRACE_NO_NAME;
+    if (header) {
+        for (u32 i = 0; i < header->names; i++) {
+            if (strncmp(header->name[i], name, TRACE_NAME_MAX - 1) == 0) {
+                index = (u16)i;
+                break;
+            }
+        }
+        if (index == TRACE_NO_NAME && header->names < TRACE_NAMES) {
+            index = (u16)header->names;
+            strncpy(header->name[index], name, TRACE_NAME_MAX - 1);
+            __atomic_store_n(&header->names, index + 1, __ATOMIC_RELEASE);
+        }
+        if (index != TRACE_NO_NAME) {
+            __atomic_store_n(id, (g_TraceGeneration << 16) | index, __ATOMIC_RELEASE);
+        }
+    }
+    trace_unlock();
+    return index;
+}
+
+// Returns the calling thread's slot, claiming a free one on its first event.
+static s32 trace_thread_slot(u64 thread)
+{
+    const u32 start = (u32)((thread >> 6) * 0x9e3779b1u >> 16);
+    for (u32 i = 0; i < TRACE_THREADS; i++) {
+        const u32 index = (start + i) & (TRACE_THREADS - 1);
+        trace_thread *slot = &g_TraceThreads[index];
+        u64 owner = __atomic_load_n(&slot->thread, __ATOMIC_ACQUIRE);
+        if (owner == thread) {
+            return (s32)index;
+        }
+        if (owner == 0 && __atomic_compare_exchange_n(&slot->thread, &owner, thread, false,
+                                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return (s32)index;
+        }
+    }
+    return -1;
+}
+
+void trace_emit(uint16_t name, uint8_t phase, uint32_t arg)
+{
+    const u64 time = sceKernelGetProcessTimeCounter();
+    const u64 thread = (u64)(uintptr_t)scePthreadSelf();
+    const s32 index = trace_thread_slot(thread);
+    if (index < 0) {
+        __atomic_fetch_add(&g_TraceDropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    trace_thread *slot = &g_TraceThreads[index];
+    __atomic_store_n(&slot->busy, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_TraceHeader, __ATOMIC_SEQ_CST)) {
+        trace_ring *ring = &g_TraceRings[index];
+        const u64 head = ring->head;
+        if (!ring->thread) {
+            ring->thread = thread;
+        }
+        trace_event *event = &ring->event[head & (TRACE_RING_EVENTS - 1)];
+        event->time = time;
+        event->name = name;
+        event->phase = phase;
+        event->arg = arg;
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&slot->busy, 0, __ATOMIC_RELEASE);
+}
+
+void trace_scope_end(trace_scope *scope)
+{
+    if (scope->active) {
+        trace_emit(scope->name, TRACE_PHASE_END, 0);
+    }
+}
+
+#endif
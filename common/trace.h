@@ -0,0 +1,135 @@
+#pragma once
+
+// Flight recorder of hook timelines.
+// Build a plugin with `TRACE=1` to enable, otherwise every macro compiles to nothing.
+// Begin/end and instant events are stamped with the process time counter and written to
+// per-thread rings inside /data/GoldHEN/trace/<plugin>.trace. The file is mapped shared,
+// so the last TRACE_RING_EVENTS events of every thread survive a crash of the game.
+// `tools/trace_json` converts one or more trace files to Chrome trace JSON for
+// chrome://tracing or ui.perfetto.dev.
+//
+// Usage:
+//     trace_start(g_pluginName);      // in plugin_load
+//
+//     s32 sceKernelOpen_hook(...)
+//     {
+//         TRACE_SCOPE("sceKernelOpen"); // begin now, end when the scope exits
+//         ...
+//         TRACE_INSTANT("redirect", fd);
+//     }
+//
+//     trace_stop();                   // in plugin_unload, after UNHOOK
+//
+// Event names must be string literals, each call site registers its name once.
+
+#include <stdint.h>
+
+// File format, all fields little endian:
+//     trace_file_header
+//     trace_ring[TRACE_THREADS]
+// A ring is owned by the first thread that traced into it. `head' counts every event
+// the thread wrote, the ring holds the last min(head, TRACE_RING_EVENTS) of them.
+#define TRACE_MAGIC       0x52544847 // "GHTR"
+#define TRACE_VERSION     1
+#define TRACE_THREADS     16
+#define TRACE_RING_EVENTS 2048 // must be power of two
+#define TRACE_NAMES       128
+#define TRACE_NAME_MAX    32
+
+enum trace_phase {
+    TRACE_PHASE_BEGIN = 'B',
+    TRACE_PHASE_END = 'E',
+    TRACE_PHASE_INSTANT = 'i',
+};
+
+typedef struct {
+    uint64_t time;
+    uint16_t name; // index in trace_file_header.name
+    uint8_t phase;
+    uint8_t reserved;
+    uint32_t arg;
+} trace_event;
+
+typedef struct {
+    uint64_t thread; // 0 while unowned
+    uint64_t head;
+    uint64_t reserved[6];
+    trace_event event[TRACE_RING_EVENTS];
+} trace_ring;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t frequency;
+    uint64_t start_time;
+    uint32_t threads;
+    uint32_t ring_events;
+    uint32_t names;   // registered entries of `name'
+    uint32_t dropped; // events of threads that found no free ring
+    char plugin[TRACE_NAME_MAX];
+    char name[TRACE_NAMES][TRACE_NAME_MAX];
+} __attribute__((aligned(64))) trace_file_header;
+
+#if defined(TRACE) && (TRACE) == 1
+
+typedef struct {
+    uint16_t name;
+    uint16_t active;
+} trace_scope;
+
+/**
+ * @brief Creates and maps the trace file of the plugin.
+ *
+ * @param plugin Plugin name, used for the file name.
+ * @return 0 on success.
+ */
+int32_t trace_start(const char *plugin);
+/** @brief Unmaps the trace file. Events traced later are discarded. */
+void trace_stop(void);
+
+/**
+ * @brief Returns the index of an event name, registering it on first use.
+ *
+ * @param id Call site cache, holds the index and the trace_start() it was registered in.
+ * @param name
+ * @return Name index, or 0xffff when tracing is stopped or the name table is full.
+ */
+uint16_t trace_name(uint32_t *id, const char *name);
+/** @brief Appends an event to the calling thread's ring. */
+void trace_emit(uint16_t name, uint8_t phase, uint32_t arg);
+
+/** @brief Scope cleanup, emits the end event of `trace_scope_begin'. */
+void trace_scope_end(trace_scope *scope);
+
+static inline trace_scope trace_scope_begin(uint32_t *id, const char *name)
+{
+    trace_scope scope = { trace_name(id, name), 0 };
+    if (scope.name != 0xffff) {
+        scope.active = 1;
+        trace_emit(scope.name, TRACE_PHASE_BEGIN, 0);
+    }
+    return scope;
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name_)                                                                   \
+    static uint32_t TRACE_CONCAT(_trace_id_, __LINE__);                                      \
+    trace_scope TRACE_CONCAT(_trace_scope_, __LINE__) __attribute__((cleanup(trace_scope_end))) = \
+        trace_scope_begin(&TRACE_CONCAT(_trace_id_, __LINE__), name_)
+#define TRACE_INSTANT(name_, arg) do {                                                       \
+    static uint32_t _trace_id;                                                               \
+    const uint16_t _trace_name = trace_name(&_trace_id, name_);                              \
+    if (_trace_name != 0xffff) {                                                             \
+        trace_emit(_trace_name, TRACE_PHASE_INSTANT, (uint32_t)(arg));                       \
+    }                                                                                        \
+} while (0)
+
+#else
+
+#define TRACE_SCOPE(name_)
+#define TRACE_INSTANT(name_, arg) do { (void)(arg); } while (0)
+static inline int32_t trace_start(const char *plugin) { (void)plugin; return 0; }
+static inline void trace_stop(void) {}
+
+#endif
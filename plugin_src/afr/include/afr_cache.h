@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+// RAM cache of small overrides, least recently used entries are evicted first.
+// Keyed by the override path (`<layer>/<path>'), filled when a file is opened the
+// first time and read through virtual descriptors afterwards. Entries stay alive
+// while a descriptor references them, the budget counts entries being read and cached.
+// Overrides changed on storage are dropped by afr_cache_drop_stale from the rescans.
+typedef enum {
+    AFR_CACHE_RESERVED, // being read, counted in the budget
+    AFR_CACHE_CACHED,   // in the buckets and LRU list, counted in the budget
+    AFR_CACHE_DROPPED,  // evicted, freed with its last reference
+} afr_cache_state;
+
+typedef struct afr_cache_entry {
+    struct afr_cache_entry *next;  // bucket chain
+    struct afr_cache_entry *older; // LRU list
+    struct afr_cache_entry *newer;
+    uint32_t hash;
+    uint32_t refs;
+    afr_cache_state state;
+    struct stat st;
+    uint64_t size;
+    const char *key;
+    uint8_t *data;
+} afr_cache_entry;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;  // reserves, small files read from storage
+    uint64_t evictions;
+    uint64_t invalidations; // dropped by afr_cache_drop_stale
+    uint64_t bytes;   // data held by cached entries
+    uint32_t entries;
+} afr_cache_stats;
+
+/**
+ * @brief Enables the cache.
+ * @param owner plugin name, owner of the telemetry counters
+ * @param budget bytes of file data the cache may hold
+ * @param max_file largest file size cached
+ * @return bool false when `budget' or `max_file' is 0
+ */
+bool afr_cache_init(const char *owner, uint64_t budget, uint64_t max_file);
+
+/** @brief Frees every entry no descriptor references, later releases free the rest. */
+void afr_cache_shutdown(void);
+
+/** @brief Largest file size cached, 0 while the cache is disabled. */
+uint64_t afr_cache_max_file(void);
+
+/**
+ * @brief Looks up `key' and references the entry on a hit, misses are counted by
+ *        afr_cache_reserve so files too large for the cache are not.
+ * @param key
+ * @return afr_cache_entry* NULL on a miss
+ */
+afr_cache_entry *afr_cache_get(const char *key);
+
+/**
+ * @brief Allocates a referenced entry of `size' bytes to read a file into, evicting
+ *        unreferenced entries to stay in the budget. Publish or release it after the read.
+ * @param key
+ * @param st stat of the file
+ * @param size
+ * @return afr_cache_entry* NULL when the entry does not fit the budget
+ */
+afr_cache_entry *afr_cache_reserve(const char *key, const struct stat *st, uint64_t size);
+
+/**
+ * @brief Adds a reserved entry to the cache. When another thread cached `key' first,
+ *        `entry' is released and the cached one returned.
+ * @param entry
+ * @return afr_cache_entry* referenced entry holding the file
+ */
+afr_cache_entry *afr_cache_publish(afr_cache_entry *entry);
+
+/** @brief Drops a reference from afr_cache_get, afr_cache_reserve or afr_cache_publish. */
+void afr_cache_release(afr_cache_entry *entry);
+
+/**
+ * @brief Drops the cached entries `stale' returns true for, descriptors still reading
+ *        one keep it until they close. `stale' is called without the lock held.
+ * @param stale gets the key and the stat the entry was cached with
+ */
+void afr_cache_drop_stale(bool (*stale)(const char *key, const struct stat *st));
+
+void afr_cache_get_stats(afr_cache_stats *stats);
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// Chunk-compressed overrides, built by `tools/afr_compress'. `<path>.afrz' in a layer
+// overrides `<path>' and is handed to the game as a virtual descriptor (see afr_file.h)
+// of the decompressed file. The file is cut into AFR_CHUNK_BLOCK_SIZE blocks compressed
+// one by one, so a read only loads and decodes the blocks it touches. Decoded blocks are
+// kept in a small cache shared by every open chunked file.
+//
+// File format, all fields little endian:
+//     afr_chunk_header
+//     uint64_t offset[blocks + 1]   block i is stored from offset[i] to offset[i + 1]
+//     stored blocks
+// Offsets are relative to the start of the file. A block stored with its decoded size
+// is kept raw, any smaller one is an LZ4 block (see afr_lz4.h) that decodes in place
+// from the end of an AFR_CHUNK_BUFFER_SIZE buffer, afr_compress checks this for every
+// block it writes.
+#define AFR_CHUNK_MAGIC       0x5a414847 // "GHAZ"
+#define AFR_CHUNK_VERSION     1
+#define AFR_CHUNK_SUFFIX      ".afrz"
+#define AFR_CHUNK_BLOCK_SIZE  0x10000
+#define AFR_CHUNK_BUFFER_SIZE (AFR_CHUNK_BLOCK_SIZE + AFR_CHUNK_BLOCK_SIZE / 256 + 32)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_size; // AFR_CHUNK_BLOCK_SIZE
+    uint32_t blocks;
+    uint64_t size;       // of the decompressed file
+    uint64_t reserved;
+} afr_chunk_header;
+
+typedef struct afr_chunk_file {
+    int32_t fd;
+    bool own_fd;         // closed with the file
+    uint32_t blocks;
+    uint64_t size;       // decompressed
+    uint64_t base;       // of the chunked file in `fd'
+    struct stat st;      // of `fd', identifies its blocks in the cache
+    uint64_t offset[];   // blocks + 1, relative to `base'
+} afr_chunk_file;
+
+typedef struct afr_chunk_stats {
+    uint64_t hits;       // blocks found decoded
+    uint64_t misses;     // blocks loaded and decoded
+    uint64_t stored;     // bytes loaded from storage for them
+    uint64_t decoded;    // bytes they decoded to
+} afr_chunk_stats;
+
+/**
+ * @brief Registers the telemetry of the block cache, its buffers are mapped at first use.
+ * @param owner plugin name of the telemetry counters
+ */
+void afr_chunk_init(const char *owner);
+
+/**
+ * @brief Frees the block cache. Every chunked file has to be closed.
+ */
+void afr_chunk_shutdown(void);
+
+/**
+ * @brief Reads the header of a chunked file.
+ * @param fd
+ * @param base offset of the chunked file in `fd'
+ * @param stored_size bytes of the chunked file
+ * @param [out]header
+ * @return int32_t 0 on success, ORBIS_KERNEL_ERROR_EINVAL for a damaged file, the failing sceKernel error otherwise
+ */
+int32_t afr_chunk_read_header(int32_t fd, uint64_t base, uint64_t stored_size, afr_chunk_header *header);
+
+/**
+ * @brief Reads the header and block table of a chunked file.
+ * @param [out]file
+ * @param fd
+ * @param own_fd close `fd' in afr_chunk_close, also when this fails
+ * @param st stat of `fd'
+ * @param base offset of the chunked file in `fd'
+ * @param stored_size bytes of the chunked file
+ * @return int32_t 0 on success, like afr_chunk_read_header or ORBIS_KERNEL_ERROR_ENOMEM otherwise
+ */
+int32_t afr_chunk_open(afr_chunk_file **file, int32_t fd, bool own_fd, const struct stat *st, uint64_t base,
+                       uint64_t stored_size);
+
+void afr_chunk_close(afr_chunk_file *file);
+
+/**
+ * @brief Reads decompressed bytes, past the end of the file nothing is read.
+ * @param file
+ * @param buf
+ * @param nbytes
+ * @param offset
+ * @return ssize_t bytes read, ORBIS_KERNEL_ERROR_EIO when a block is damaged, the failing sceKernel error otherwise
+ */
+ssize_t afr_chunk_read(afr_chunk_file *file, void *buf, size_t nbytes, uint64_t offset);
+
+void afr_chunk_get_stats(afr_chunk_stats *stats);
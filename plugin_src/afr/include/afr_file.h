@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "afr_cache.h"
+#include "afr_chunk.h"
+
+// Virtual descriptors handed to the game for overrides afr reads itself: a window of
+// a pack file, a file held by the RAM cache or a chunk-compressed file. They are AFR_FILE_FD_BASE + slot, far
+// above the ones the kernel hands out, and behave like read-only files.
+#define AFR_FILE_FD_BASE 0x40000000
+#define AFR_FILE_FDS     256
+
+static inline bool afr_file_owns_fd(int32_t fd)
+{
+    return fd >= AFR_FILE_FD_BASE && fd < AFR_FILE_FD_BASE + AFR_FILE_FDS;
+}
+
+/**
+ * @brief Fills `st' for a read-only file of `size' bytes.
+ * @param source stat of the file holding the data
+ * @param size
+ * @param [out]st
+ */
+void afr_file_stat(const struct stat *source, uint64_t size, struct stat *st);
+
+/**
+ * @brief Opens `size' bytes at `offset' of the descriptor `fd', which must outlive it.
+ * @param fd
+ * @param st stat of `fd', must outlive the descriptor
+ * @param offset
+ * @param size
+ * @return int32_t virtual descriptor, ORBIS_KERNEL_ERROR_EMFILE when all are in use
+ */
+int32_t afr_file_open_window(int32_t fd, const struct stat *st, uint64_t offset, uint64_t size);
+
+/**
+ * @brief Opens a cache entry, the descriptor takes over the reference.
+ * @param entry
+ * @return int32_t virtual descriptor, ORBIS_KERNEL_ERROR_EMFILE when all are in use
+ */
+int32_t afr_file_open_cached(afr_cache_entry *entry);
+
+/**
+ * @brief Opens a chunked file, the descriptor takes it over and closes it with itself.
+ * @param chunk
+ * @return int32_t virtual descriptor, ORBIS_KERNEL_ERROR_EMFILE when all are in use
+ */
+int32_t afr_file_open_chunked(afr_chunk_file *chunk);
+
+/**
+ * @brief Tells where a window descriptor reads from, for requests handed to the kernel.
+ * @param fd
+ * @param [out]source descriptor the window reads
+ * @param [out]offset of the window in `source'
+ * @param [out]size of the window
+ * @return bool false for cached and chunked files and descriptors that are not virtual
+ */
+bool afr_file_window(int32_t fd, int32_t *source, uint64_t *offset, uint64_t *size);
+
+// Descriptor calls on virtual descriptors, same results as their sceKernel counterparts.
+ssize_t afr_file_read(int32_t fd, void *buf, size_t nbytes);
+ssize_t afr_file_pread(int32_t fd, void *buf, size_t nbytes, off_t offset);
+off_t afr_file_lseek(int32_t fd, off_t offset, int32_t whence);
+int32_t afr_file_fstat(int32_t fd, struct stat *st);
+int32_t afr_file_close(int32_t fd);
+
+// Windows starting on a page of their source are mapped from it, everything else is read
+// into anonymous memory. Mappings are private either way, shared writable ones fail.
+int32_t afr_file_mmap(void *addr, size_t len, int32_t prot, int32_t flags, int32_t fd, off_t offset, void **res);
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hash set of the files and directories below an override folder, relative to it
+// (`data/level0/asset.bin'). Built once at load so the hooks only touch the file
+// system for paths that are actually redirected.
+//
+// The listing of every directory is kept in a cache file together with the
+// directory's mtime. On the next load only directories whose mtime changed are
+// listed again, the rest of the set comes from the cache without a syscall.
+//
+// Indexes of several override folders merge into one, each path then carries the
+// layer that provides it. Paths also keep whether they are a file or a directory, as
+// the listing's d_type said.
+typedef struct afr_index {
+    uint32_t count;     // paths in the set
+    uint32_t dirs;      // directories in the set, the folder itself included, summed by merges
+    uint32_t listed;    // directories listed by this build, the rest came from the cache
+    uint32_t mask;      // slot count - 1
+    uint64_t *slot;     // hash << 32 | pool offset + 1, 0 when empty
+    char *pool;         // layer byte followed by the NUL terminated path, at pool offset
+    uint32_t pool_size;
+    uint32_t pool_used;
+} afr_index;
+
+// Cache file format, all fields little endian:
+//     afr_index_file_header
+//     { afr_index_dir, path[path_len], { u8 type, u8 name_len, name[name_len] }[children] }[dirs]
+// `path' is relative to the folder, empty for the folder itself.
+#define AFR_INDEX_MAGIC   0x49414847 // "GHAI"
+#define AFR_INDEX_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dirs;
+    uint32_t reserved;
+    uint64_t size; // bytes of directory records after the header
+} afr_index_file_header;
+
+typedef struct {
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint32_t children;
+    uint16_t path_len;
+    uint16_t reserved;
+} afr_index_dir;
+
+/**
+ * @brief Fills the index with every file and directory below `root'.
+ *        A missing `root' leaves the index empty.
+ * @param index
+ * @param root
+ * @param cache cache file revalidated and rewritten when something changed, NULL for none
+ * @return int32_t 0 on success, the failing sceKernel error otherwise
+ */
+int32_t afr_index_build(afr_index *index, const char *root, const char *cache);
+
+/**
+ * @brief Adds a file found without listing, e.g. a file of a pack.
+ * @param index zeroed or filled by earlier calls
+ * @param path relative, without leading, trailing or repeated slashes
+ * @return bool false when out of memory
+ */
+bool afr_index_insert(afr_index *index, const char *path);
+
+/**
+ * @brief Looks up a path relative to the override folder, repeated and trailing
+ *        slashes are ignored.
+ * @param index
+ * @param path
+ * @return bool
+ */
+bool afr_index_contains(const afr_index *index, const char *path);
+
+/**
+ * @brief Looks up a path like afr_index_contains.
+ * @param index
+ * @param path
+ * @return int32_t layer providing the path, 0 outside of merges, -1 when not in the index
+ */
+int32_t afr_index_find(const afr_index *index, const char *path);
+
+/**
+ * @brief Adds every path of `layer' to `merged' as provided by layer `id'. Paths already
+ *        in `merged' move to `id', so merging layers in order lets later ones win.
+ * @param merged zeroed or filled by earlier merges
+ * @param layer
+ * @param id below 128
+ * @return bool false when out of memory
+ */
+bool afr_index_merge(afr_index *merged, const afr_index *layer, uint8_t id);
+
+/**
+ * @brief Counts the paths ending in `suffix'.
+ * @param index
+ * @param suffix
+ * @return uint32_t
+ */
+uint32_t afr_index_count_suffix(const afr_index *index, const char *suffix);
+
+/**
+ * @brief Iterates over the paths of the index in no particular order.
+ * @param index
+ * @param [in,out]cursor 0 to start
+ * @param [out]layer layer providing the path, 0 outside of merges
+ * @param [out]dir true for a directory
+ * @return const char* next path, NULL after the last one
+ */
+const char *afr_index_next(const afr_index *index, uint32_t *cursor, int32_t *layer, bool *dir);
+
+void afr_index_free(afr_index *index);
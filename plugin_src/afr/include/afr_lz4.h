@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Decoder of the LZ4 block format (no frame header, no checksums), shared with
+// tools/afr_compress which holds the encoder.
+
+/**
+ * @brief Decodes the LZ4 block `src' into `dst'. `src' may be the end of `dst' itself,
+ *        decoding in place then fails instead of overwriting input it has not read yet.
+ * @param src
+ * @param src_size
+ * @param dst
+ * @param dst_size bytes the block decodes to at most
+ * @return int64_t decoded bytes, -1 for a damaged block or one decoding past `dst_size'
+ */
+int64_t afr_lz4_decode(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
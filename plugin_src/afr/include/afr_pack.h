@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "afr_index.h"
+
+// One file holding every override of a layer, built by `tools/afr_pack'. Redirected
+// opens of packed paths return virtual descriptors reading a window of the pack (see
+// afr_file.h), so thousands of small files cost one open of the pack and its table
+// read at load.
+//
+// File format, all fields little endian:
+//     afr_pack_header
+//     afr_pack_entry[entries]   sorted by hash, then path
+//     names[names_size]         NUL terminated paths relative to the layer
+//     file data from data_offset, every file starting on an `align' boundary
+// Paths are stored without leading, trailing or repeated slashes.
+#define AFR_PACK_MAGIC   0x50414847 // "GHAP"
+#define AFR_PACK_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entries;
+    uint32_t align;
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint64_t data_offset;
+    uint64_t reserved;
+} afr_pack_header;
+
+typedef struct {
+    uint32_t hash; // afr_pack_hash of the path
+    uint32_t name; // offset of the path in names
+    uint64_t offset;
+    uint64_t size;
+} afr_pack_entry;
+
+// FNV-1a of a path without leading, trailing or repeated slashes.
+static inline uint32_t afr_pack_hash(const char *path)
+{
+    uint32_t hash = 0x811c9dc5u;
+    for (const char *p = path; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 0x01000193u;
+    }
+    return hash;
+}
+
+typedef struct afr_pack {
+    int32_t fd;                  // kept open while the plugin is loaded
+    void *table;                 // header, entries and names, mapped
+    uint64_t table_size;
+    const afr_pack_header *header;
+    const afr_pack_entry *entry;
+    const char *names;
+    struct stat st;              // of the pack, template of the packed files
+} afr_pack;
+
+/**
+ * @brief Opens `path' and maps its table after checking every entry lies inside the file.
+ * @param pack
+ * @param path
+ * @return int32_t 0 on success, the failing sceKernel error otherwise
+ */
+int32_t afr_pack_open(afr_pack *pack, const char *path);
+
+void afr_pack_close(afr_pack *pack);
+
+/**
+ * @brief Adds every packed path to `index', which must be zeroed.
+ * @param pack
+ * @param index
+ * @return bool false when out of memory
+ */
+bool afr_pack_index(const afr_pack *pack, afr_index *index);
+
+/**
+ * @brief Looks up a path relative to the layer, repeated and trailing slashes are ignored.
+ * @param pack
+ * @param path
+ * @return int32_t entry, -1 when the path is not packed
+ */
+int32_t afr_pack_find(const afr_pack *pack, const char *path);
+
+/**
+ * @brief Fills `st' for a packed path as if it was a read-only file.
+ * @param pack
+ * @param path
+ * @param [out]st
+ * @return int32_t 0 on success, ORBIS_KERNEL_ERROR_ENOENT when the path is not packed
+ */
+int32_t afr_pack_stat(const afr_pack *pack, const char *path, struct stat *st);
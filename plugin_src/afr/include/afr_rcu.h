@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+// Read side of pointers published to the hooks, e.g. the merged index. Readers take
+// no lock and do no atomic read-modify-write: each thread owns a slot whose sequence
+// it bumps to odd on entry and to even on exit, both plain stores. A writer swaps the
+// pointer, then afr_rcu_synchronize waits for every slot that was odd to move on,
+// after which nobody can still hold the old pointer and it can be freed.
+//
+// A thread claims its slot at its first read and gives it back when it exits. With every
+// slot taken afr_rcu_read_begin returns -1 and the caller has to do without the published
+// pointer, afr_rcu_shutdown reports how often that happened.
+#define AFR_RCU_THREADS 256
+
+/** @brief Creates the thread key that releases the slots of exiting threads. */
+void afr_rcu_init(void);
+
+/** @brief Deletes the thread key and reports the sections that found no free slot. */
+void afr_rcu_shutdown(void);
+
+/**
+ * @brief Enters a read side section, published pointers loaded until afr_rcu_read_end
+ *        stay valid. Sections do not nest.
+ * @return int32_t slot to pass to afr_rcu_read_end, -1 when no slot is free
+ */
+int32_t afr_rcu_read_begin(void);
+
+void afr_rcu_read_end(int32_t slot);
+
+/**
+ * @brief Waits until every read side section entered before the call has ended.
+ *        Called after swapping a pointer, before freeing the old one.
+ */
+void afr_rcu_synchronize(void);
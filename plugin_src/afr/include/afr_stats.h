@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "afr_index.h"
+
+// Per-path access statistics of /app0 opens and stats: how often a path was served
+// from an override (hit) or left to /app0 (miss), and a latency histogram of each call.
+// Every thread records into a fixed-size table of its own, claimed at its first call, so
+// recording takes no lock and no atomic read-modify-write. Paths that do not fit their
+// thread's table, and calls of threads without a table, are only counted as dropped.
+//
+// afr_stats_write merges the tables into a CSV:
+//     path,layer,hits,misses,opens,open_p50_us,open_p99_us,stats,stat_p50_us,stat_p99_us,open_us,stat_us
+// `layer' is the overlay that served the last hit, -1 when it never hit. Overrides of the
+// index that were never touched follow with zero counts and the overlay providing them,
+// so unused ones can be pruned.
+// `open_us' and `stat_us' list the histogram buckets separated by spaces, bucket 0 counts
+// calls under 2 us and bucket i calls from 2^i us to 2^(i+1) us, the last one everything above.
+// Percentiles are the upper end of the bucket they fall in.
+#define AFR_STATS_THREADS  32
+#define AFR_STATS_PATHS    256 // per thread, a power of two
+#define AFR_STATS_PATH_MAX 96  // longer paths are kept cut short
+#define AFR_STATS_BUCKETS  16
+
+typedef enum {
+    AFR_STATS_OPEN,
+    AFR_STATS_STAT,
+    AFR_STATS_KINDS,
+} afr_stats_kind;
+
+/**
+ * @brief Enables recording. Tables are mapped by the threads as they record.
+ */
+void afr_stats_start(void);
+
+/**
+ * @brief Disables recording and frees the tables. Called after unhooking.
+ */
+void afr_stats_stop(void);
+
+bool afr_stats_enabled(void);
+
+/**
+ * @brief Counts one call of the calling thread.
+ * @param path relative to /app0
+ * @param kind
+ * @param layer overlay serving the call, -1 when it went to /app0
+ * @param ticks process time counter ticks the call took
+ */
+void afr_stats_record(const char *path, afr_stats_kind kind, int32_t layer, uint64_t ticks);
+
+/** @brief Calls not recorded because a table was full or missing. */
+uint64_t afr_stats_dropped(void);
+
+/**
+ * @brief Writes the statistics recorded so far to `file', replacing it.
+ * @param file
+ * @param index files listed with zero counts when never touched, NULL for none
+ * @return int32_t 0 on success, the failing sceKernel error otherwise
+ */
+int32_t afr_stats_write(const char *file, const afr_index *index);
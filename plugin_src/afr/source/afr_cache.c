@@ -0,0 +1,296 @@
+#include "afr_cache.h"
+#include "plugin_common.h"
+#include "plugin_heap.h"
+#include "telemetry.h"
+#include <orbis/libkernel.h>
+
+#define AFR_CACHE_BUCKETS 256
+
+static u32 g_CacheLock = 0;
+static u64 g_CacheBudget = 0;
+static u64 g_CacheMaxFile = 0;
+static afr_cache_entry *g_CacheBucket[AFR_CACHE_BUCKETS];
+static afr_cache_entry *g_CacheNewest = NULL;
+static afr_cache_entry *g_CacheOldest = NULL;
+static afr_cache_stats g_CacheStats;
+static telemetry_slot *g_CacheHitSlot = NULL;
+static telemetry_slot *g_CacheMissSlot = NULL;
+static telemetry_slot *g_CacheBytesSlot = NULL;
+
+// Lookups are a hash and a few compares, a spin lock keeps game threads off kernel mutexes.
+static void cache_lock(void)
+{
+    while (__atomic_test_and_set(&g_CacheLock, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&g_CacheLock, __ATOMIC_RELAXED)) {
+            scePthreadYield();
+        }
+    }
+}
+
+static void cache_unlock(void)
+{
+    __atomic_clear(&g_CacheLock, __ATOMIC_RELEASE);
+}
+
+static u32 cache_hash(const char *key)
+{
+    u32 hash = 0x811c9dc5u;
+    for (const char *p = key; *p; p++) {
+        hash = (hash ^ (u8)*p) * 0x01000193u;
+    }
+    return hash;
+}
+
+// Called with the lock held.
+static void cache_unlink(afr_cache_entry *entry)
+{
+    afr_cache_entry **link = &g_CacheBucket[entry->hash & (AFR_CACHE_BUCKETS - 1)];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        g_CacheOldest = entry->newer;
+    }
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        g_CacheNewest = entry->older;
+    }
+    entry->state = AFR_CACHE_DROPPED;
+    g_CacheStats.entries--;
+    g_CacheStats.bytes -= entry->size;
+}
+
+// Called with the lock held.
+static void cache_make_newest(afr_cache_entry *entry)
+{
+    if (g_CacheNewest == entry) {
+        return;
+    }
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        g_CacheOldest = entry->newer;
+    }
+    entry->newer->older = entry->older;
+    entry->older = g_CacheNewest;
+    entry->newer = NULL;
+    g_CacheNewest->newer = entry;
+    g_CacheNewest = entry;
+}
+
+// Called with the lock held.
+static afr_cache_entry *cache_find(const char *key, u32 hash)
+{
+    for (afr_cache_entry *entry = g_CacheBucket[hash & (AFR_CACHE_BUCKETS - 1)]; entry; entry = entry->next) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+bool afr_cache_init(const char *owner, uint64_t budget, uint64_t max_file)
+{
+    if (!budget || !max_file) {
+        return false;
+    }
+    cache_lock();
+    memset(g_CacheBucket, 0, sizeof(g_CacheBucket));
+    memset(&g_CacheStats, 0, sizeof(g_CacheStats));
+    g_CacheNewest = NULL;
+    g_CacheOldest = NULL;
+    g_CacheBudget = budget;
+    g_CacheMaxFile = max_file < budget ? max_file : budget;
+    cache_unlock();
+    g_CacheHitSlot = telemetry_register(TELEMETRY_COUNTER, owner, "cache_hits");
+    g_CacheMissSlot = telemetry_register(TELEMETRY_COUNTER, owner, "cache_misses");
+    g_CacheBytesSlot = telemetry_register(TELEMETRY_GAUGE, owner, "cache_bytes");
+    return true;
+}
+
+void afr_cache_shutdown(void)
+{
+    cache_lock();
+    afr_cache_entry *free_list = NULL;
+    while (g_CacheOldest) {
+        afr_cache_entry *entry = g_CacheOldest;
+        cache_unlink(entry);
+        if (!entry->refs) {
+            entry->next = free_list;
+            free_list = entry;
+        }
+    }
+    g_CacheStats.bytes = 0;
+    g_CacheMaxFile = 0;
+    g_CacheBudget = 0;
+    cache_unlock();
+    while (free_list) {
+        afr_cache_entry *next = free_list->next;
+        plugin_heap_free(free_list);
+        free_list = next;
+    }
+}
+
+uint64_t afr_cache_max_file(void)
+{
+    return __atomic_load_n(&g_CacheMaxFile, __ATOMIC_RELAXED);
+}
+
+afr_cache_entry *afr_cache_get(const char *key)
+{
+    const u32 hash = cache_hash(key);
+    cache_lock();
+    afr_cache_entry *entry = cache_find(key, hash);
+    if (entry) {
+        entry->refs++;
+        cache_make_newest(entry);
+        g_CacheStats.hits++;
+    }
+    cache_unlock();
+    if (entry) {
+        telemetry_add(g_CacheHitSlot, 1);
+    }
+    return entry;
+}
+
+afr_cache_entry *afr_cache_reserve(const char *key, const struct stat *st, uint64_t size)
+{
+    const size_t key_size = strlen(key) + 1;
+    afr_cache_entry *evicted = NULL;
+    telemetry_add(g_CacheMissSlot, 1);
+    cache_lock();
+    g_CacheStats.misses++;
+    // Reserved entries count against the budget while they are read.
+    for (afr_cache_entry *entry = g_CacheOldest; entry && g_CacheStats.bytes + size > g_CacheBudget;) {
+        afr_cache_entry *newer = entry->newer;
+        if (!entry->refs) {
+            cache_unlink(entry);
+            g_CacheStats.evictions++;
+            entry->next = evicted;
+            evicted = entry;
+        }
+        entry = newer;
+    }
+    const bool fits = g_CacheBudget && g_CacheStats.bytes + size <= g_CacheBudget;
+    if (fits) {
+        g_CacheStats.bytes += size;
+    }
+    cache_unlock();
+    while (evicted) {
+        afr_cache_entry *next = evicted->next;
+        plugin_heap_free(evicted);
+        evicted = next;
+    }
+    if (!fits) {
+        return NULL;
+    }
+
+    afr_cache_entry *entry = (afr_cache_entry *)plugin_heap_alloc(sizeof(*entry) + key_size + size);
+    if (!entry) {
+        cache_lock();
+        g_CacheStats.bytes -= size;
+        cache_unlock();
+        return NULL;
+    }
+    memset(entry, 0, sizeof(*entry));
+    entry->state = AFR_CACHE_RESERVED;
+    entry->hash = cache_hash(key);
+    entry->refs = 1;
+    entry->st = *st;
+    entry->size = size;
+    entry->data = (u8 *)(entry + 1);
+    entry->key = (const char *)entry->data + size;
+    memcpy((char *)entry->key, key, key_size);
+    return entry;
+}
+
+afr_cache_entry *afr_cache_publish(afr_cache_entry *entry)
+{
+    cache_lock();
+    afr_cache_entry *cached = cache_find(entry->key, entry->hash);
+    if (cached || !g_CacheBudget) {
+        if (cached) {
+            cached->refs++;
+        }
+        cache_unlock();
+        afr_cache_release(entry);
+        return cached;
+    }
+    entry->next = g_CacheBucket[entry->hash & (AFR_CACHE_BUCKETS - 1)];
+    g_CacheBucket[entry->hash & (AFR_CACHE_BUCKETS - 1)] = entry;
+    entry->older = g_CacheNewest;
+    entry->newer = NULL;
+    if (g_CacheNewest) {
+        g_CacheNewest->newer = entry;
+    } else {
+        g_CacheOldest = entry;
+    }
+    g_CacheNewest = entry;
+    entry->state = AFR_CACHE_CACHED;
+    g_CacheStats.entries++;
+    const u64 bytes = g_CacheStats.bytes;
+    cache_unlock();
+    telemetry_set(g_CacheBytesSlot, (s64)bytes);
+    return entry;
+}
+
+void afr_cache_release(afr_cache_entry *entry)
+{
+    cache_lock();
+    const bool free_entry = --entry->refs == 0 && entry->state != AFR_CACHE_CACHED;
+    // Never published, afr_cache_shutdown already cleared its bytes when the cache is off.
+    if (free_entry && entry->state == AFR_CACHE_RESERVED && g_CacheBudget) {
+        g_CacheStats.bytes -= entry->size;
+    }
+    cache_unlock();
+    if (free_entry) {
+        plugin_heap_free(entry);
+    }
+}
+
+void afr_cache_drop_stale(bool (*stale)(const char *key, const struct stat *st))
+{
+    cache_lock();
+    const u32 capacity = g_CacheStats.entries;
+    cache_unlock();
+    afr_cache_entry **entries = capacity ? (afr_cache_entry **)plugin_heap_alloc(capacity * sizeof(*entries)) : NULL;
+    if (!entries) {
+        return;
+    }
+    // Referenced so they outlive the checks, entries cached meanwhile wait for the next call.
+    u32 count = 0;
+    cache_lock();
+    for (afr_cache_entry *entry = g_CacheOldest; entry && count < capacity; entry = entry->newer) {
+        entry->refs++;
+        entries[count++] = entry;
+    }
+    cache_unlock();
+    for (u32 i = 0; i < count; i++) {
+        afr_cache_entry *entry = entries[i];
+        if (stale(entry->key, &entry->st)) {
+            cache_lock();
+            if (entry->state == AFR_CACHE_CACHED) {
+                cache_unlink(entry);
+                g_CacheStats.invalidations++;
+            }
+            cache_unlock();
+        }
+        afr_cache_release(entry);
+    }
+    plugin_heap_free(entries);
+    cache_lock();
+    const u64 bytes = g_CacheStats.bytes;
+    cache_unlock();
+    telemetry_set(g_CacheBytesSlot, (s64)bytes);
+}
+
+void afr_cache_get_stats(afr_cache_stats *stats)
+{
+    cache_lock();
+    *stats = g_CacheStats;
+    cache_unlock();
+}
@@ -0,0 +1,281 @@
+#include "afr_chunk.h"
+#include "afr_lz4.h"
+#include "plugin_common.h"
+#include "plugin_heap.h"
+#include "telemetry.h"
+#include <orbis/libkernel.h>
+
+// Decoded blocks kept, AFR_CHUNK_BUFFER_SIZE bytes each once used.
+#define AFR_CHUNK_CACHE_BLOCKS 8
+
+typedef enum {
+    CHUNK_BLOCK_EMPTY,
+    CHUNK_BLOCK_LOADING, // claimed by the thread decoding it
+    CHUNK_BLOCK_READY,
+} chunk_block_state;
+
+typedef struct {
+    chunk_block_state state;
+    u32 refs;            // readers copying out of `data'
+    u32 size;            // decoded bytes
+    u64 used;            // g_ChunkTick of the last use
+    // The block stored at `offset' of the file `dev', `ino' as of `mtime'.
+    u64 dev;
+    u64 ino;
+    s64 mtime_sec;
+    s64 mtime_nsec;
+    u64 offset;
+    u8 *data;
+} chunk_block;
+
+static u32 g_ChunkLock = 0;
+static u64 g_ChunkTick = 0;
+static chunk_block g_ChunkBlock[AFR_CHUNK_CACHE_BLOCKS];
+static afr_chunk_stats g_ChunkStats;
+static telemetry_slot *g_ChunkHitSlot = NULL;
+static telemetry_slot *g_ChunkMissSlot = NULL;
+
+// Held for a scan of the blocks, never while loading one.
+static void chunk_lock(void)
+{
+    while (__atomic_test_and_set(&g_ChunkLock, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&g_ChunkLock, __ATOMIC_RELAXED)) {
+            scePthreadYield();
+        }
+    }
+}
+
+static void chunk_unlock(void)
+{
+    __atomic_clear(&g_ChunkLock, __ATOMIC_RELEASE);
+}
+
+void afr_chunk_init(const char *owner)
+{
+    g_ChunkHitSlot = telemetry_register(TELEMETRY_COUNTER, owner, "chunk_hits");
+    g_ChunkMissSlot = telemetry_register(TELEMETRY_COUNTER, owner, "chunk_misses");
+}
+
+void afr_chunk_shutdown(void)
+{
+    chunk_lock();
+    for (u32 i = 0; i < AFR_CHUNK_CACHE_BLOCKS; i++) {
+        plugin_heap_free(g_ChunkBlock[i].data);
+    }
+    memset(g_ChunkBlock, 0, sizeof(g_ChunkBlock));
+    memset(&g_ChunkStats, 0, sizeof(g_ChunkStats));
+    g_ChunkTick = 0;
+    chunk_unlock();
+}
+
+// Short reads are errors, chunked files do not change while they are open.
+static s32 chunk_pread(s32 fd, void *buf, u64 size, u64 offset)
+{
+    for (u64 done = 0; done < size;) {
+        const ssize_t got = sceKernelPread(fd, (u8 *)buf + done, size - done, (off_t)(offset + done));
+        if (got <= 0) {
+            return got < 0 ? (s32)got : ORBIS_KERNEL_ERROR_EIO;
+        }
+        done += (u64)got;
+    }
+    return 0;
+}
+
+int32_t afr_chunk_read_header(int32_t fd, uint64_t base, uint64_t stored_size, afr_chunk_header *header)
+{
+    if (stored_size < sizeof(*header)) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    const s32 ret = chunk_pread(fd, header, sizeof(*header), base);
+    if (ret) {
+        return ret;
+    }
+    if (header->magic != AFR_CHUNK_MAGIC || header->version != AFR_CHUNK_VERSION ||
+        header->block_size != AFR_CHUNK_BLOCK_SIZE ||
+        header->blocks != (header->size + AFR_CHUNK_BLOCK_SIZE - 1) / AFR_CHUNK_BLOCK_SIZE ||
+        sizeof(*header) + ((u64)header->blocks + 1) * sizeof(u64) > stored_size) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    return 0;
+}
+
+int32_t afr_chunk_open(afr_chunk_file **file, int32_t fd, bool own_fd, const struct stat *st, uint64_t base,
+                       uint64_t stored_size)
+{
+    *file = NULL;
+    afr_chunk_header header;
+    s32 ret = afr_chunk_read_header(fd, base, stored_size, &header);
+    const u64 table_size = ret == 0 ? ((u64)header.blocks + 1) * sizeof(u64) : 0;
+    afr_chunk_file *chunk = NULL;
+    if (ret == 0) {
+        chunk = (afr_chunk_file *)plugin_heap_alloc(sizeof(*chunk) + table_size);
+        ret = chunk ? chunk_pread(fd, chunk->offset, table_size, base + sizeof(header)) : ORBIS_KERNEL_ERROR_ENOMEM;
+    }
+    // Every block lies after the table and inside the file, stored in at most its decoded size.
+    if (ret == 0 && chunk->offset[0] != sizeof(header) + table_size) {
+        ret = ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    for (u32 i = 0; i < header.blocks && ret == 0; i++) {
+        const u64 left = header.size - (u64)i * AFR_CHUNK_BLOCK_SIZE;
+        const u64 decoded = left < AFR_CHUNK_BLOCK_SIZE ? left : AFR_CHUNK_BLOCK_SIZE;
+        if (chunk->offset[i + 1] <= chunk->offset[i] || chunk->offset[i + 1] - chunk->offset[i] > decoded ||
+            chunk->offset[i + 1] > stored_size) {
+            ret = ORBIS_KERNEL_ERROR_EINVAL;
+        }
+    }
+    if (ret) {
+        plugin_heap_free(chunk);
+        if (own_fd) {
+            sceKernelClose(fd);
+        }
+        return ret;
+    }
+    chunk->fd = fd;
+    chunk->own_fd = own_fd;
+    chunk->blocks = header.blocks;
+    chunk->size = header.size;
+    chunk->base = base;
+    chunk->st = *st;
+    *file = chunk;
+    return 0;
+}
+
+void afr_chunk_close(afr_chunk_file *file)
+{
+    if (file->own_fd) {
+        sceKernelClose(file->fd);
+    }
+    plugin_heap_free(file);
+}
+
+static bool chunk_block_is(const chunk_block *block, const afr_chunk_file *file, u64 offset)
+{
+    return block->state != CHUNK_BLOCK_EMPTY && block->offset == offset && block->ino == (u64)file->st.st_ino &&
+           block->dev == (u64)file->st.st_dev && block->mtime_sec == file->st.st_mtim.tv_sec &&
+           block->mtime_nsec == file->st.st_mtim.tv_nsec;
+}
+
+// Loads and decodes block `index' into a block claimed by the caller.
+static s32 chunk_load(const afr_chunk_file *file, u32 index, chunk_block *block)
+{
+    if (!block->data) {
+        block->data = (u8 *)plugin_heap_alloc(AFR_CHUNK_BUFFER_SIZE);
+        if (!block->data) {
+            return ORBIS_KERNEL_ERROR_ENOMEM;
+        }
+    }
+    const u64 left = file->size - (u64)index * AFR_CHUNK_BLOCK_SIZE;
+    const u32 decoded = left < AFR_CHUNK_BLOCK_SIZE ? (u32)left : AFR_CHUNK_BLOCK_SIZE;
+    const u32 stored = (u32)(file->offset[index + 1] - file->offset[index]);
+    block->size = decoded;
+    if (stored == decoded) {
+        return chunk_pread(file->fd, block->data, stored, file->base + file->offset[index]);
+    }
+    // Read to the end of the buffer and decode in place.
+    u8 *src = block->data + AFR_CHUNK_BUFFER_SIZE - stored;
+    const s32 ret = chunk_pread(file->fd, src, stored, file->base + file->offset[index]);
+    if (ret) {
+        return ret;
+    }
+    return afr_lz4_decode(src, stored, block->data, decoded) == (s64)decoded ? 0 : ORBIS_KERNEL_ERROR_EIO;
+}
+
+// Returns block `index' of `file' decoded with a reference held, NULL and `*error' on failure.
+// Waits while the block is decoded by another thread or every block is being read.
+static chunk_block *chunk_acquire(const afr_chunk_file *file, u32 index, s32 *error)
+{
+    const u64 offset = file->base + file->offset[index];
+    for (;;) {
+        chunk_block *victim = NULL;
+        bool loading = false;
+        chunk_lock();
+        for (u32 i = 0; i < AFR_CHUNK_CACHE_BLOCKS; i++) {
+            chunk_block *block = &g_ChunkBlock[i];
+            if (chunk_block_is(block, file, offset)) {
+                if (block->state == CHUNK_BLOCK_LOADING) {
+                    loading = true;
+                    break;
+                }
+                block->refs++;
+                block->used = ++g_ChunkTick;
+                g_ChunkStats.hits++;
+                chunk_unlock();
+                telemetry_add(g_ChunkHitSlot, 1);
+                return block;
+            }
+            if (!block->refs && (!victim || block->used < victim->used)) {
+                victim = block;
+            }
+        }
+        if (loading || !victim) {
+            chunk_unlock();
+            scePthreadYield();
+            continue;
+        }
+        victim->state = CHUNK_BLOCK_LOADING;
+        victim->refs = 1;
+        victim->dev = (u64)file->st.st_dev;
+        victim->ino = (u64)file->st.st_ino;
+        victim->mtime_sec = file->st.st_mtim.tv_sec;
+        victim->mtime_nsec = file->st.st_mtim.tv_nsec;
+        victim->offset = offset;
+        chunk_unlock();
+
+        const s32 ret = chunk_load(file, index, victim);
+        chunk_lock();
+        victim->used = ++g_ChunkTick;
+        if (ret == 0) {
+            victim->state = CHUNK_BLOCK_READY;
+            g_ChunkStats.misses++;
+            g_ChunkStats.stored += file->offset[index + 1] - file->offset[index];
+            g_ChunkStats.decoded += victim->size;
+        } else {
+            victim->state = CHUNK_BLOCK_EMPTY;
+            victim->refs = 0;
+        }
+        chunk_unlock();
+        if (ret) {
+            *error = ret;
+            return NULL;
+        }
+        telemetry_add(g_ChunkMissSlot, 1);
+        return victim;
+    }
+}
+
+static void chunk_release(chunk_block *block)
+{
+    chunk_lock();
+    block->refs--;
+    chunk_unlock();
+}
+
+ssize_t afr_chunk_read(afr_chunk_file *file, void *buf, size_t nbytes, uint64_t offset)
+{
+    if (offset >= file->size) {
+        return 0;
+    }
+    const u64 left = file->size - offset;
+    const size_t n = nbytes < left ? nbytes : (size_t)left;
+    for (size_t done = 0; done < n;) {
+        const u64 at = offset + done;
+        const u32 in_block = (u32)(at % AFR_CHUNK_BLOCK_SIZE);
+        s32 error = 0;
+        chunk_block *block = chunk_acquire(file, (u32)(at / AFR_CHUNK_BLOCK_SIZE), &error);
+        if (!block) {
+            return done ? (ssize_t)done : error;
+        }
+        const size_t copy = block->size - in_block < n - done ? block->size - in_block : n - done;
+        memcpy((u8 *)buf + done, block->data + in_block, copy);
+        chunk_release(block);
+        done += copy;
+    }
+    return (ssize_t)n;
+}
+
+void afr_chunk_get_stats(afr_chunk_stats *stats)
+{
+    chunk_lock();
+    *stats = g_ChunkStats;
+    chunk_unlock();
+}
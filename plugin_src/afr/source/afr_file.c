@@ -0,0 +1,231 @@
+#include "afr_file.h"
+#include "plugin_common.h"
+#include <orbis/libkernel.h>
+
+// Open virtual descriptor, `used' claims the slot.
+typedef struct {
+    u32 used;
+    s32 fd;                  // window source, -1 for cached and chunked files
+    afr_cache_entry *entry;  // cached file, NULL otherwise
+    afr_chunk_file *chunk;   // chunked file, NULL otherwise
+    const struct stat *st;
+    u64 offset;
+    u64 size;
+    u64 pos;
+} afr_file;
+
+static afr_file g_Files[AFR_FILE_FDS];
+
+#define AFR_FILE_PAGE_SIZE 0x4000
+
+// FreeBSD mmap(2) values.
+#define AFR_PROT_READ   0x01
+#define AFR_PROT_WRITE  0x02
+#define AFR_MAP_SHARED  0x0001
+#define AFR_MAP_PRIVATE 0x0002
+#define AFR_MAP_FIXED   0x0010
+#define AFR_MAP_ANON    0x1000
+
+void afr_file_stat(const struct stat *source, uint64_t size, struct stat *st)
+{
+    *st = *source;
+    st->st_mode = S_IFREG | 0444;
+    st->st_nlink = 1;
+    st->st_size = (off_t)size;
+    st->st_blocks = (blkcnt_t)((size + 511) / 512);
+}
+
+static s32 afr_file_claim(s32 fd, afr_cache_entry *entry, afr_chunk_file *chunk, const struct stat *st, u64 offset,
+                          u64 size)
+{
+    for (u32 i = 0; i < AFR_FILE_FDS; i++) {
+        afr_file *file = &g_Files[i];
+        u32 used = 0;
+        if (__atomic_load_n(&file->used, __ATOMIC_RELAXED) ||
+            !__atomic_compare_exchange_n(&file->used, &used, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        file->fd = fd;
+        file->entry = entry;
+        file->chunk = chunk;
+        file->st = st;
+        file->offset = offset;
+        file->size = size;
+        file->pos = 0;
+        return AFR_FILE_FD_BASE + (s32)i;
+    }
+    return ORBIS_KERNEL_ERROR_EMFILE;
+}
+
+int32_t afr_file_open_window(int32_t fd, const struct stat *st, uint64_t offset, uint64_t size)
+{
+    return afr_file_claim(fd, NULL, NULL, st, offset, size);
+}
+
+int32_t afr_file_open_cached(afr_cache_entry *entry)
+{
+    return afr_file_claim(-1, entry, NULL, &entry->st, 0, entry->size);
+}
+
+int32_t afr_file_open_chunked(afr_chunk_file *chunk)
+{
+    return afr_file_claim(-1, NULL, chunk, &chunk->st, 0, chunk->size);
+}
+
+static afr_file *afr_file_get(int32_t fd)
+{
+    if (!afr_file_owns_fd(fd)) {
+        return NULL;
+    }
+    afr_file *file = &g_Files[fd - AFR_FILE_FD_BASE];
+    return __atomic_load_n(&file->used, __ATOMIC_ACQUIRE) ? file : NULL;
+}
+
+bool afr_file_window(int32_t fd, int32_t *source, uint64_t *offset, uint64_t *size)
+{
+    const afr_file *file = afr_file_get(fd);
+    if (!file || file->fd < 0) {
+        return false;
+    }
+    *source = file->fd;
+    *offset = file->offset;
+    *size = file->size;
+    return true;
+}
+
+// Reads past the end of the file return 0 like a plain file.
+static ssize_t afr_file_read_at(const afr_file *file, void *buf, size_t nbytes, off_t offset)
+{
+    if (offset < 0) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    if (file->chunk) {
+        return afr_chunk_read(file->chunk, buf, nbytes, (u64)offset);
+    }
+    if ((u64)offset >= file->size) {
+        return 0;
+    }
+    const u64 left = file->size - (u64)offset;
+    const size_t n = nbytes < left ? nbytes : (size_t)left;
+    if (file->entry) {
+        memcpy(buf, file->entry->data + offset, n);
+        return (ssize_t)n;
+    }
+    return sceKernelPread(file->fd, buf, n, (off_t)(file->offset + offset));
+}
+
+ssize_t afr_file_read(int32_t fd, void *buf, size_t nbytes)
+{
+    afr_file *file = afr_file_get(fd);
+    if (!file) {
+        return ORBIS_KERNEL_ERROR_EBADF;
+    }
+    const ssize_t got = afr_file_read_at(file, buf, nbytes, (off_t)file->pos);
+    if (got > 0) {
+        file->pos += (u64)got;
+    }
+    return got;
+}
+
+ssize_t afr_file_pread(int32_t fd, void *buf, size_t nbytes, off_t offset)
+{
+    const afr_file *file = afr_file_get(fd);
+    return file ? afr_file_read_at(file, buf, nbytes, offset) : ORBIS_KERNEL_ERROR_EBADF;
+}
+
+off_t afr_file_lseek(int32_t fd, off_t offset, int32_t whence)
+{
+    afr_file *file = afr_file_get(fd);
+    if (!file) {
+        return ORBIS_KERNEL_ERROR_EBADF;
+    }
+    s64 base = 0;
+    switch (whence) {
+    case 0: // SEEK_SET
+        break;
+    case 1: // SEEK_CUR
+        base = (s64)file->pos;
+        break;
+    case 2: // SEEK_END
+        base = (s64)file->size;
+        break;
+    default:
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    if (base + offset < 0) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    file->pos = (u64)(base + offset);
+    return (off_t)file->pos;
+}
+
+int32_t afr_file_fstat(int32_t fd, struct stat *st)
+{
+    const afr_file *file = afr_file_get(fd);
+    if (!file) {
+        return ORBIS_KERNEL_ERROR_EBADF;
+    }
+    afr_file_stat(file->st, file->size, st);
+    return 0;
+}
+
+int32_t afr_file_close(int32_t fd)
+{
+    afr_file *file = afr_file_get(fd);
+    if (!file) {
+        return ORBIS_KERNEL_ERROR_EBADF;
+    }
+    afr_cache_entry *entry = file->entry;
+    afr_chunk_file *chunk = file->chunk;
+    __atomic_store_n(&file->used, 0, __ATOMIC_RELEASE);
+    if (entry) {
+        afr_cache_release(entry);
+    }
+    if (chunk) {
+        afr_chunk_close(chunk);
+    }
+    return 0;
+}
+
+int32_t afr_file_mmap(void *addr, size_t len, int32_t prot, int32_t flags, int32_t fd, off_t offset, void **res)
+{
+    const afr_file *file = afr_file_get(fd);
+    if (!file) {
+        return ORBIS_KERNEL_ERROR_EBADF;
+    }
+    if (!len || offset < 0 || (offset & (AFR_FILE_PAGE_SIZE - 1))) {
+        return ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    if ((flags & AFR_MAP_SHARED) && (prot & AFR_PROT_WRITE)) {
+        return ORBIS_KERNEL_ERROR_EACCES;
+    }
+    flags = (flags & AFR_MAP_FIXED) | AFR_MAP_PRIVATE;
+    // Pages past the end of the pack can not be touched, mappings reaching there are copied.
+    const u64 source = file->offset + (u64)offset;
+    const bool direct = file->fd >= 0 && !(source & (AFR_FILE_PAGE_SIZE - 1)) && source + len <= (u64)file->st->st_size;
+    void *map = NULL;
+    s32 ret = direct ? sceKernelMmap(addr, len, prot | AFR_PROT_WRITE, flags, file->fd, (off_t)source, &map)
+                     : sceKernelMmap(addr, len, AFR_PROT_READ | AFR_PROT_WRITE, flags | AFR_MAP_ANON, -1, 0, &map);
+    if (ret) {
+        return ret;
+    }
+    const u64 valid = (u64)offset < file->size ? file->size - (u64)offset : 0;
+    if (direct) {
+        // Past the window the pack holds other files, a plain file reads as zeros there.
+        if (valid < len) {
+            memset((u8 *)map + valid, 0, len - valid);
+        }
+    } else if (valid) {
+        const size_t want = valid < len ? (size_t)valid : len;
+        const ssize_t got = afr_file_read_at(file, map, want, offset);
+        if (got != (ssize_t)want) {
+            sceKernelMunmap(map, len);
+            return got < 0 ? (s32)got : ORBIS_KERNEL_ERROR_EIO;
+        }
+    }
+    if (!(prot & AFR_PROT_WRITE)) {
+        sceKernelMprotect(map, len, prot);
+    }
+    *res = map;
+    return 0;
+}
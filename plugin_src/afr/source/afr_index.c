@@ -0,0 +1,488 @@
+#include "afr_index.h"
+#include "plugin_common.h"
+#include "plugin_heap.h"
+#include <sys/stat.h>
+#include <orbis/libkernel.h>
+
+#define AFR_INDEX_MAX_DEPTH 32
+#define AFR_INDEX_DIRENT_BUF 1024
+#define AFR_INDEX_MIN_SLOTS 64
+
+#define AFR_DT_DIR 4
+#define AFR_DT_REG 8
+
+// Set in the layer byte of directories, layers stay below it.
+#define AFR_INDEX_DIR 0x80
+
+// Directory records of a build, written to the cache file.
+typedef struct {
+    u8 *data;
+    u32 size;
+    u32 used;
+} afr_index_buf;
+
+// FNV-1a of the path with repeated and trailing slashes dropped.
+static u32 afr_index_hash(const char *path)
+{
+    u32 hash = 0x811c9dc5u;
+    u32 n = 0;
+    for (const char *p = path; *p; p++) {
+        if (*p == '/' && (p[1] == '/' || p[1] == '\0' || n == 0)) {
+            continue;
+        }
+        hash = (hash ^ (u8)*p) * 0x01000193u;
+        n++;
+    }
+    return hash;
+}
+
+static bool afr_index_equal(const char *stored, const char *path)
+{
+    u32 n = 0;
+    for (const char *p = path; *p; p++) {
+        if (*p == '/' && (p[1] == '/' || p[1] == '\0' || n == 0)) {
+            continue;
+        }
+        if (stored[n] != *p) {
+            return false;
+        }
+        n++;
+    }
+    return stored[n] == '\0';
+}
+
+static bool afr_index_grow(afr_index *index)
+{
+    const u32 slots = index->slot ? (index->mask + 1) * 2 : AFR_INDEX_MIN_SLOTS;
+    u64 *slot = (u64 *)plugin_heap_calloc(slots, sizeof(u64));
+    if (!slot) {
+        return false;
+    }
+    if (index->slot) {
+        for (u32 i = 0; i <= index->mask; i++) {
+            const u64 entry = index->slot[i];
+            if (!entry) {
+                continue;
+            }
+            u32 pos = (u32)(entry >> 32) & (slots - 1);
+            while (slot[pos]) {
+                pos = (pos + 1) & (slots - 1);
+            }
+            slot[pos] = entry;
+        }
+        plugin_heap_free(index->slot);
+    }
+    index->slot = slot;
+    index->mask = slots - 1;
+    return true;
+}
+
+// Slot of `path' in the index, -1 when it is not there.
+static s32 afr_index_slot(const afr_index *index, const char *path)
+{
+    if (!index->count) {
+        return -1;
+    }
+    const u32 hash = afr_index_hash(path);
+    for (u32 pos = hash & index->mask;; pos = (pos + 1) & index->mask) {
+        const u64 entry = index->slot[pos];
+        if (!entry) {
+            return -1;
+        }
+        if ((u32)(entry >> 32) == hash && afr_index_equal(index->pool + (u32)entry, path)) {
+            return (s32)pos;
+        }
+    }
+}
+
+// `tag' is the layer, with AFR_INDEX_DIR for a directory.
+static bool afr_index_add(afr_index *index, const char *path, u32 length, u8 tag)
+{
+    if (!index->slot || (index->count + 1) * 2 > index->mask + 1) {
+        if (!afr_index_grow(index)) {
+            return false;
+        }
+    }
+    if (index->pool_used + length + 2 > index->pool_size) {
+        u32 size = index->pool_size ? index->pool_size * 2 : 4096;
+        while (index->pool_used + length + 2 > size) {
+            size *= 2;
+        }
+        char *pool = (char *)plugin_heap_realloc(index->pool, size);
+        if (!pool) {
+            return false;
+        }
+        index->pool = pool;
+        index->pool_size = size;
+    }
+    const u32 hash = afr_index_hash(path);
+    u32 pos = hash & index->mask;
+    while (index->slot[pos]) {
+        pos = (pos + 1) & index->mask;
+    }
+    index->pool[index->pool_used] = (char)tag;
+    memcpy(index->pool + index->pool_used + 1, path, length + 1);
+    index->slot[pos] = (u64)hash << 32 | (index->pool_used + 1);
+    index->pool_used += length + 2;
+    index->count++;
+    return true;
+}
+
+// Adds `name' of the directory `dir' (relative, empty for the folder) to the set, `type' is
+// its d_type from the listing.
+static bool afr_index_add_child(afr_index *index, const char *dir, u32 dir_len, const char *name, u32 name_len,
+                                u8 type)
+{
+    char path[MAX_PATH_];
+    u32 length = 0;
+    if (dir_len + 1 + name_len >= sizeof(path)) {
+        return true;
+    }
+    if (dir_len) {
+        memcpy(path, dir, dir_len);
+        path[dir_len] = '/';
+        length = dir_len + 1;
+    }
+    memcpy(path + length, name, name_len);
+    length += name_len;
+    path[length] = '\0';
+    return afr_index_add(index, path, length, type == AFR_DT_DIR ? AFR_INDEX_DIR : 0);
+}
+
+static bool afr_index_append(afr_index_buf *buf, const void *data, u32 size)
+{
+    if (buf->used + size > buf->size) {
+        u32 capacity = buf->size ? buf->size * 2 : 16 * 1024;
+        while (buf->used + size > capacity) {
+            capacity *= 2;
+        }
+        u8 *grown = (u8 *)plugin_heap_realloc(buf->data, capacity);
+        if (!grown) {
+            return false;
+        }
+        buf->data = grown;
+        buf->size = capacity;
+    }
+    memcpy(buf->data + buf->used, data, size);
+    buf->used += size;
+    return true;
+}
+
+// Lists the directory in `path', whose relative part starts at `rel', into a new record.
+// Then walks the subdirectories `cached' has no record of, all of them when it is NULL.
+static int32_t afr_index_list(afr_index *index, afr_index_buf *buf, const afr_index *cached, char *path, u32 length,
+                              u32 rel, u32 depth)
+{
+    if (depth >= AFR_INDEX_MAX_DEPTH) {
+        final_printf("afr_index: %s is nested too deep, skipped\n", path);
+        return 0;
+    }
+    const s32 fd = sceKernelOpen(path, 0x0000 | 0x20000, 0); // O_RDONLY | O_DIRECTORY
+    if (fd < 0) {
+        return fd;
+    }
+    // Taken before listing, a change during the listing is seen by the next build.
+    struct stat st;
+    s32 ret = sceKernelFstat(fd, &st);
+    const u32 rel_len = length > rel ? length - rel : 0;
+    const u32 record = buf->used;
+    afr_index_dir dir = { st.st_mtim.tv_sec, st.st_mtim.tv_nsec, 0, (u16)rel_len, 0 };
+    char *dirents = NULL;
+    if (ret == 0 && (!(dirents = (char *)plugin_heap_alloc(AFR_INDEX_DIRENT_BUF)) ||
+                     !afr_index_append(buf, &dir, sizeof(dir)) || !afr_index_append(buf, path + rel, rel_len))) {
+        ret = -1;
+    }
+    s32 got = 0;
+    while (ret == 0 && (got = sceKernelGetdents(fd, dirents, AFR_INDEX_DIRENT_BUF)) > 0) {
+        for (s32 pos = 0; pos < got && ret == 0;) {
+            const OrbisKernelDirent *entry = (const OrbisKernelDirent *)(dirents + pos);
+            pos += entry->d_reclen;
+            if (!entry->d_reclen) {
+                break;
+            }
+            const char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            if (entry->d_type != AFR_DT_DIR && entry->d_type != AFR_DT_REG) {
+                continue;
+            }
+            const u8 child[2] = { entry->d_type, (u8)entry->d_namlen };
+            if (!afr_index_append(buf, child, sizeof(child)) || !afr_index_append(buf, name, entry->d_namlen) ||
+                !afr_index_add_child(index, path + rel, rel_len, name, entry->d_namlen, entry->d_type)) {
+                ret = -1;
+            }
+            dir.children++;
+        }
+    }
+    if (got < 0 && ret == 0) {
+        ret = got;
+    }
+    plugin_heap_free(dirents);
+    sceKernelClose(fd);
+    if (ret < 0) {
+        return ret;
+    }
+    memcpy(buf->data + record, &dir, sizeof(dir));
+    index->dirs++;
+    index->listed++;
+
+    // Subdirectories once the record is complete, so their records follow it. The buffer
+    // moves while they are listed, names are read back by offset.
+    u32 pos = record + sizeof(dir) + rel_len;
+    for (u32 i = 0; i < dir.children && ret == 0; i++) {
+        const u8 type = buf->data[pos];
+        const u32 name_len = buf->data[pos + 1];
+        const u32 name = pos + 2;
+        pos = name + name_len;
+        const u32 child = length + 1 + name_len;
+        if (type != AFR_DT_DIR || child >= MAX_PATH_) {
+            continue;
+        }
+        path[length] = '/';
+        memcpy(path + length + 1, buf->data + name, name_len);
+        path[child] = '\0';
+        if (!cached || !afr_index_contains(cached, path + rel)) {
+            ret = afr_index_list(index, buf, cached, path, child, rel, depth + 1);
+        }
+        path[length] = '\0';
+    }
+    return ret;
+}
+
+// Checks that `dirs' records fill `size' bytes and collects their directories in `cached'.
+static bool afr_index_parse(const u8 *data, u64 size, u32 dirs, u32 root_len, afr_index *cached)
+{
+    char rel[MAX_PATH_];
+    u64 pos = 0;
+    for (u32 i = 0; i < dirs; i++) {
+        afr_index_dir dir;
+        if (pos + sizeof(dir) > size) {
+            return false;
+        }
+        memcpy(&dir, data + pos, sizeof(dir));
+        pos += sizeof(dir);
+        if (pos + dir.path_len > size || root_len + 1 + dir.path_len >= MAX_PATH_) {
+            return false;
+        }
+        memcpy(rel, data + pos, dir.path_len);
+        rel[dir.path_len] = '\0';
+        pos += dir.path_len;
+        if (!afr_index_add(cached, rel, dir.path_len, AFR_INDEX_DIR)) {
+            return false;
+        }
+        for (u32 j = 0; j < dir.children; j++) {
+            if (pos + 2 > size || pos + 2 + data[pos + 1] > size) {
+                return false;
+            }
+            pos += 2 + data[pos + 1];
+        }
+    }
+    return pos == size;
+}
+
+// Keeps the records of directories whose mtime is unchanged and lists the others again.
+static int32_t afr_index_revalidate(afr_index *index, afr_index_buf *buf, const afr_index *cached, const u8 *data,
+                                    u32 dirs, char *path, u32 root_len, bool *changed)
+{
+    u64 pos = 0;
+    for (u32 i = 0; i < dirs; i++) {
+        const u64 record = pos;
+        afr_index_dir dir;
+        memcpy(&dir, data + pos, sizeof(dir));
+        const char *rel = (const char *)data + pos + sizeof(dir);
+        pos += sizeof(dir) + dir.path_len;
+        const u64 children = pos;
+        for (u32 j = 0; j < dir.children; j++) {
+            pos += 2 + data[pos + 1];
+        }
+
+        u32 length = root_len;
+        if (dir.path_len) {
+            path[root_len] = '/';
+            memcpy(path + root_len + 1, rel, dir.path_len);
+            length += 1 + dir.path_len;
+        }
+        path[length] = '\0';
+        struct stat st;
+        s32 ret = 0;
+        if (sceKernelStat(path, &st) < 0 || !S_ISDIR(st.st_mode)) {
+            // Removed, the listing of its parent changed with it.
+            *changed = true;
+        } else if (st.st_mtim.tv_sec == dir.mtime_sec && st.st_mtim.tv_nsec == dir.mtime_nsec) {
+            if (!afr_index_append(buf, data + record, (u32)(pos - record))) {
+                ret = -1;
+            }
+            for (u64 child = children; child < pos && ret == 0; child += 2 + data[child + 1]) {
+                if (!afr_index_add_child(index, rel, dir.path_len, (const char *)data + child + 2, data[child + 1],
+                                         data[child])) {
+                    ret = -1;
+                }
+            }
+            index->dirs++;
+        } else {
+            *changed = true;
+            ret = afr_index_list(index, buf, cached, path, length, root_len + 1, 0);
+        }
+        path[root_len] = '\0';
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+// Returns 0 when the index was revalidated from `cache', 1 when the cache is missing or unusable.
+static int32_t afr_index_load(afr_index *index, afr_index_buf *buf, const char *cache, char *path, u32 root_len,
+                              bool *changed)
+{
+    const s32 fd = sceKernelOpen(cache, 0x0000, 0); // O_RDONLY
+    if (fd < 0) {
+        return 1;
+    }
+    struct stat st;
+    void *addr = NULL;
+    s32 ret = 1;
+    if (sceKernelFstat(fd, &st) == 0 && st.st_size > (off_t)sizeof(afr_index_file_header) &&
+        sceKernelMmap(NULL, st.st_size, 0x01, 0x0002, fd, 0, &addr) == 0) { // PROT_READ, MAP_PRIVATE
+        const afr_index_file_header *header = (const afr_index_file_header *)addr;
+        const u8 *data = (const u8 *)(header + 1);
+        afr_index cached;
+        memset(&cached, 0, sizeof(cached));
+        if (header->magic == AFR_INDEX_MAGIC && header->version == AFR_INDEX_VERSION &&
+            header->size == (u64)st.st_size - sizeof(*header) &&
+            afr_index_parse(data, header->size, header->dirs, root_len, &cached)) {
+            ret = afr_index_revalidate(index, buf, &cached, data, header->dirs, path, root_len, changed);
+        }
+        afr_index_free(&cached);
+        sceKernelMunmap(addr, st.st_size);
+    }
+    sceKernelClose(fd);
+    return ret;
+}
+
+// Written beside the cache and renamed over it, a crash never leaves half a cache behind.
+static void afr_index_save(const char *cache, const afr_index_buf *buf, u32 dirs)
+{
+    char tmp[MAX_PATH_];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", cache);
+    const s32 fd = sceKernelOpen(tmp, 0x0001 | 0x0200 | 0x0400, 0777); // O_WRONLY | O_CREAT | O_TRUNC
+    if (fd < 0) {
+        final_printf("afr_index: failed to open %s (0x%08x)\n", tmp, fd);
+        return;
+    }
+    const afr_index_file_header header = { AFR_INDEX_MAGIC, AFR_INDEX_VERSION, dirs, 0, buf->used };
+    const bool written = sceKernelWrite(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+                         sceKernelWrite(fd, buf->data, buf->used) == (ssize_t)buf->used;
+    sceKernelClose(fd);
+    if (!written || sceKernelRename(tmp, cache) < 0) {
+        final_printf("afr_index: failed to write %s\n", cache);
+        sceKernelUnlink(tmp);
+    }
+}
+
+int32_t afr_index_build(afr_index *index, const char *root, const char *cache)
+{
+    char path[MAX_PATH_];
+    memset(index, 0, sizeof(*index));
+    if (!afr_index_grow(index)) {
+        return -1;
+    }
+    struct stat st;
+    if (sceKernelStat(root, &st) < 0) {
+        return 0;
+    }
+    const u32 root_len = (u32)strnlen(root, sizeof(path) - 1);
+    memcpy(path, root, root_len);
+    path[root_len] = '\0';
+
+    afr_index_buf buf = { NULL, 0, 0 };
+    bool changed = false;
+    s32 ret = cache ? afr_index_load(index, &buf, cache, path, root_len, &changed) : 1;
+    if (ret == 1) {
+        // Whatever a corrupt cache added is dropped, the walk starts over.
+        afr_index_free(index);
+        buf.used = 0;
+        changed = true;
+        ret = afr_index_grow(index) ? afr_index_list(index, &buf, NULL, path, root_len, root_len + 1, 0) : -1;
+    }
+    if (ret == 0 && cache && changed) {
+        afr_index_save(cache, &buf, index->dirs);
+    }
+    plugin_heap_free(buf.data);
+    if (ret < 0) {
+        afr_index_free(index);
+    }
+    return ret;
+}
+
+bool afr_index_insert(afr_index *index, const char *path)
+{
+    return afr_index_add(index, path, (u32)strlen(path), 0);
+}
+
+bool afr_index_merge(afr_index *merged, const afr_index *layer, uint8_t id)
+{
+    for (u32 i = 0; layer->slot && i <= layer->mask; i++) {
+        const u64 entry = layer->slot[i];
+        if (!entry) {
+            continue;
+        }
+        const char *path = layer->pool + (u32)entry;
+        const u8 tag = id | ((u8)path[-1] & AFR_INDEX_DIR);
+        const s32 pos = afr_index_slot(merged, path);
+        if (pos >= 0) {
+            merged->pool[(u32)merged->slot[pos] - 1] = (char)tag;
+        } else if (!afr_index_add(merged, path, (u32)strlen(path), tag)) {
+            return false;
+        }
+    }
+    merged->dirs += layer->dirs;
+    merged->listed += layer->listed;
+    return true;
+}
+
+int32_t afr_index_find(const afr_index *index, const char *path)
+{
+    const s32 pos = afr_index_slot(index, path);
+    return pos < 0 ? -1 : (u8)index->pool[(u32)index->slot[pos] - 1] & ~AFR_INDEX_DIR;
+}
+
+bool afr_index_contains(const afr_index *index, const char *path)
+{
+    return afr_index_slot(index, path) >= 0;
+}
+
+uint32_t afr_index_count_suffix(const afr_index *index, const char *suffix)
+{
+    const u32 suffix_len = (u32)strlen(suffix);
+    u32 count = 0;
+    for (u32 pos = 0; pos < index->pool_used;) {
+        const char *path = index->pool + pos + 1;
+        const u32 length = (u32)strlen(path);
+        if (length >= suffix_len && memcmp(path + length - suffix_len, suffix, suffix_len) == 0) {
+            count++;
+        }
+        pos += length + 2;
+    }
+    return count;
+}
+
+const char *afr_index_next(const afr_index *index, uint32_t *cursor, int32_t *layer, bool *dir)
+{
+    if (*cursor >= index->pool_used) {
+        return NULL;
+    }
+    const char *path = index->pool + *cursor + 1;
+    *layer = (u8)index->pool[*cursor] & ~AFR_INDEX_DIR;
+    *dir = ((u8)index->pool[*cursor] & AFR_INDEX_DIR) != 0;
+    *cursor += (u32)strlen(path) + 2;
+    return path;
+}
+
+void afr_index_free(afr_index *index)
+{
+    plugin_heap_free(index->slot);
+    plugin_heap_free(index->pool);
+    memset(index, 0, sizeof(*index));
+}
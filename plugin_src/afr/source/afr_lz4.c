@@ -0,0 +1,73 @@
+#include "afr_lz4.h"
+#include <stdbool.h>
+#include <string.h>
+
+// Lengths of 15 continue in the following bytes, up to and including the first one below 255.
+static bool lz4_length(const uint8_t **ip, const uint8_t *iend, size_t *length)
+{
+    uint8_t byte;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+int64_t afr_lz4_decode(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size)
+{
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + src_size;
+    uint8_t *op = dst;
+    uint8_t *const oend = dst + dst_size;
+    const bool in_place = (uintptr_t)src >= (uintptr_t)dst && (uintptr_t)src < (uintptr_t)oend;
+    for (;;) {
+        if (ip >= iend) {
+            return -1;
+        }
+        const uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !lz4_length(&ip, iend, &literals)) {
+            return -1;
+        }
+        if ((size_t)(iend - ip) < literals || (size_t)(oend - op) < literals) {
+            return -1;
+        }
+        memmove(op, ip, literals);
+        op += literals;
+        ip += literals;
+        // The last sequence has no match.
+        if (ip == iend) {
+            break;
+        }
+        if (iend - ip < 2) {
+            return -1;
+        }
+        const size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        size_t match = token & 15;
+        if (match == 15 && !lz4_length(&ip, iend, &match)) {
+            return -1;
+        }
+        match += 4;
+        if (!offset || offset > (size_t)(op - dst) || (size_t)(oend - op) < match) {
+            return -1;
+        }
+        if (in_place && (uintptr_t)(op + match) > (uintptr_t)ip) {
+            return -1;
+        }
+        const uint8_t *from = op - offset;
+        if (offset >= match) {
+            memcpy(op, from, match);
+            op += match;
+        } else {
+            // Overlapping matches repeat the last `offset' bytes.
+            for (size_t i = 0; i < match; i++) {
+                *op++ = *from++;
+            }
+        }
+    }
+    return (int64_t)(op - dst);
+}
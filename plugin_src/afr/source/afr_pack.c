@@ -0,0 +1,116 @@
+#include "afr_pack.h"
+#include "afr_file.h"
+#include "plugin_common.h"
+#include <orbis/libkernel.h>
+
+int32_t afr_pack_open(afr_pack *pack, const char *path)
+{
+    memset(pack, 0, sizeof(*pack));
+    pack->fd = sceKernelOpen(path, 0x0000, 0); // O_RDONLY
+    if (pack->fd < 0) {
+        const s32 ret = pack->fd;
+        pack->fd = -1;
+        return ret;
+    }
+    afr_pack_header header;
+    s32 ret = sceKernelFstat(pack->fd, &pack->st);
+    if (ret == 0 && sceKernelPread(pack->fd, &header, sizeof(header), 0) != sizeof(header)) {
+        ret = ORBIS_KERNEL_ERROR_EIO;
+    }
+    const u64 file_size = ret == 0 ? (u64)pack->st.st_size : 0;
+    if (ret == 0 && (header.magic != AFR_PACK_MAGIC || header.version != AFR_PACK_VERSION ||
+                     header.names_offset != sizeof(header) + (u64)header.entries * sizeof(afr_pack_entry) ||
+                     header.names_offset + header.names_size > header.data_offset || header.data_offset > file_size ||
+                     header.names_size > 0xffffffffu)) {
+        ret = ORBIS_KERNEL_ERROR_EINVAL;
+    }
+    if (ret == 0) {
+        pack->table_size = header.names_offset + header.names_size;
+        ret = sceKernelMmap(NULL, pack->table_size, 0x01, 0x0002, pack->fd, 0, &pack->table); // PROT_READ, MAP_PRIVATE
+    }
+    if (ret == 0) {
+        pack->header = (const afr_pack_header *)pack->table;
+        pack->entry = (const afr_pack_entry *)(pack->header + 1);
+        pack->names = (const char *)pack->table + header.names_offset;
+        // A path has to end inside the names, data inside the file.
+        for (u32 i = 0; i < header.entries && ret == 0; i++) {
+            const afr_pack_entry *entry = &pack->entry[i];
+            if (entry->name >= header.names_size ||
+                !memchr(pack->names + entry->name, '\0', header.names_size - entry->name) ||
+                entry->offset < header.data_offset || entry->offset > file_size ||
+                entry->size > file_size - entry->offset) {
+                ret = ORBIS_KERNEL_ERROR_EINVAL;
+            }
+        }
+    }
+    if (ret != 0) {
+        afr_pack_close(pack);
+    }
+    return ret;
+}
+
+void afr_pack_close(afr_pack *pack)
+{
+    if (pack->table) {
+        sceKernelMunmap(pack->table, pack->table_size);
+    }
+    if (pack->fd >= 0) {
+        sceKernelClose(pack->fd);
+    }
+    memset(pack, 0, sizeof(*pack));
+    pack->fd = -1;
+}
+
+bool afr_pack_index(const afr_pack *pack, afr_index *index)
+{
+    for (u32 i = 0; pack->header && i < pack->header->entries; i++) {
+        if (!afr_index_insert(index, pack->names + pack->entry[i].name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int32_t afr_pack_find(const afr_pack *pack, const char *path)
+{
+    if (!pack->header) {
+        return -1;
+    }
+    // Stored paths carry no extra slashes, drop them from the lookup too.
+    char name[MAX_PATH_];
+    u32 n = 0;
+    for (const char *p = path; *p && n < sizeof(name) - 1; p++) {
+        if (*p == '/' && (p[1] == '/' || p[1] == '\0' || n == 0)) {
+            continue;
+        }
+        name[n++] = *p;
+    }
+    name[n] = '\0';
+    const u32 hash = afr_pack_hash(name);
+    u32 low = 0;
+    u32 high = pack->header->entries;
+    while (low < high) {
+        const u32 mid = low + (high - low) / 2;
+        if (pack->entry[mid].hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    for (u32 i = low; i < pack->header->entries && pack->entry[i].hash == hash; i++) {
+        if (strcmp(pack->names + pack->entry[i].name, name) == 0) {
+            return (s32)i;
+        }
+    }
+    return -1;
+}
+
+int32_t afr_pack_stat(const afr_pack *pack, const char *path, struct stat *st)
+{
+    const s32 entry = afr_pack_find(pack, path);
+    if (entry < 0) {
+        return ORBIS_KERNEL_ERROR_ENOENT;
+    }
+    afr_file_stat(&pack->st, pack->entry[entry].size, st);
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "afr_rcu.h"
+#include "plugin_common.h"
+#include <orbis/libkernel.h>
+
+typedef struct {
+    u64 thread;
+    u32 seq; // odd inside a read side section, only written by `thread'
+} __attribute__((aligned(64))) rcu_thread;
+
+static rcu_thread g_RcuThreads[AFR_RCU_THREADS];
+static OrbisPthreadKey g_RcuKey;
+static bool g_RcuKeyCreated = false;
+static u64 g_RcuFallbacks = 0; // sections entered without a slot
+
+// Destructor of g_RcuKey, gives the slot of an exiting thread back. Its last section
+// ended before, so the sequence is even for whoever claims it next.
+static void rcu_thread_exit(void *value)
+{
+    rcu_thread *slot = (rcu_thread *)value;
+    __atomic_store_n(&slot->thread, 0, __ATOMIC_RELEASE);
+}
+
+// Returns the calling thread's slot, claiming a free one on its first read. The slot is
+// looked up before any is claimed, a slot freed by an exited thread earlier in the probe
+// chain must not give a live thread a second one.
+static s32 rcu_thread_slot(u64 thread)
+{
+    const u32 start = (u32)((thread >> 6) * 0x9e3779b1u >> 16);
+    if (g_RcuKeyCreated) {
+        const rcu_thread *own = (const rcu_thread *)scePthreadGetspecific(g_RcuKey);
+        if (own) {
+            return (s32)(own - g_RcuThreads);
+        }
+    } else {
+        for (u32 i = 0; i < AFR_RCU_THREADS; i++) {
+            const u32 index = (start + i) & (AFR_RCU_THREADS - 1);
+            if (__atomic_load_n(&g_RcuThreads[index].thread, __ATOMIC_ACQUIRE) == thread) {
+                return (s32)index;
+            }
+        }
+    }
+    for (u32 i = 0; i < AFR_RCU_THREADS; i++) {
+        const u32 index = (start + i) & (AFR_RCU_THREADS - 1);
+        rcu_thread *slot = &g_RcuThreads[index];
+        u64 owner = 0;
+        if (__atomic_compare_exchange_n(&slot->thread, &owner, thread, false, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE)) {
+            if (g_RcuKeyCreated) {
+                scePthreadSetspecific(g_RcuKey, slot);
+            }
+            return (s32)index;
+        }
+    }
+    return -1;
+}
+
+void afr_rcu_init(void)
+{
+    const s32 ret = scePthreadKeyCreate(&g_RcuKey, rcu_thread_exit);
+    if (ret != 0) {
+        final_printf("afr: scePthreadKeyCreate: 0x%08x, rcu slots stay with exited threads\n", ret);
+        return;
+    }
+    g_RcuKeyCreated = true;
+}
+
+void afr_rcu_shutdown(void)
+{
+    if (g_RcuKeyCreated) {
+        g_RcuKeyCreated = false;
+        scePthreadKeyDelete(g_RcuKey);
+    }
+    const u64 fallbacks = __atomic_exchange_n(&g_RcuFallbacks, 0, __ATOMIC_RELAXED);
+    if (fallbacks) {
+        final_printf("afr: %lu lookup(s) found no free rcu slot and skipped the index\n", fallbacks);
+    }
+}
+
+int32_t afr_rcu_read_begin(void)
+{
+    const s32 index = rcu_thread_slot((u64)(uintptr_t)scePthreadSelf());
+    if (index >= 0) {
+        rcu_thread *slot = &g_RcuThreads[index];
+        // Ordered before the loads of the section, pairs with the writer's swap.
+        __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_SEQ_CST);
+    } else {
+        __atomic_fetch_add(&g_RcuFallbacks, 1, __ATOMIC_RELAXED);
+    }
+    return index;
+}
+
+void afr_rcu_read_end(int32_t index)
+{
+    if (index >= 0) {
+        rcu_thread *slot = &g_RcuThreads[index];
+        __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+    }
+}
+
+void afr_rcu_synchronize(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (u32 i = 0; i < AFR_RCU_THREADS; i++) {
+        const rcu_thread *slot = &g_RcuThreads[i];
+        const u32 seq = __atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST);
+        // A reader that entered again since holds the new pointer.
+        while ((seq & 1) && __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) == seq) {
+            scePthreadYield();
+        }
+    }
+}
@@ -0,0 +1,273 @@
+#include "afr_stats.h"
+#include "afr_chunk.h"
+#include "plugin_common.h"
+#include "plugin_heap.h"
+#include <orbis/libkernel.h>
+
+typedef struct {
+    u32 hash;    // of the full path, 0 while the entry is free
+    s32 layer;
+    u32 hits;
+    u32 misses;
+    u32 bucket[AFR_STATS_KINDS][AFR_STATS_BUCKETS];
+    char path[AFR_STATS_PATH_MAX];
+} stats_entry;
+
+// Counters are only written by `thread', afr_stats_write reads them as they are.
+typedef struct {
+    u64 thread;
+    stats_entry *table; // AFR_STATS_PATHS entries, mapped at the first call
+    u32 paths;
+    u32 dropped;        // calls of paths the table had no room for
+} __attribute__((aligned(64))) stats_thread;
+
+static u32 g_StatsEnabled = 0;
+static u64 g_StatsFrequency = 1;
+static u32 g_StatsDropped = 0; // calls of threads without a slot
+static stats_thread g_StatsThreads[AFR_STATS_THREADS];
+
+// FNV-1a, 0 is kept for free entries.
+static u32 stats_hash(const char *path)
+{
+    u32 hash = 0x811c9dc5u;
+    for (const char *p = path; *p; p++) {
+        hash = (hash ^ (u8)*p) * 0x01000193u;
+    }
+    return hash ? hash : 1;
+}
+
+static u32 stats_bucket(u64 ticks)
+{
+    const u64 us = ticks * 1000000 / g_StatsFrequency;
+    if (us < 2) {
+        return 0;
+    }
+    const u32 bucket = 63 - __builtin_clzll(us);
+    return bucket < AFR_STATS_BUCKETS ? bucket : AFR_STATS_BUCKETS - 1;
+}
+
+// Only the owner bumps its counters, no read-modify-write needed.
+static void stats_bump(u32 *counter)
+{
+    __atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+void afr_stats_start(void)
+{
+    memset(g_StatsThreads, 0, sizeof(g_StatsThreads));
+    g_StatsDropped = 0;
+    g_StatsFrequency = sceKernelGetProcessTimeCounterFrequency();
+    __atomic_store_n(&g_StatsEnabled, 1, __ATOMIC_RELEASE);
+}
+
+void afr_stats_stop(void)
+{
+    __atomic_store_n(&g_StatsEnabled, 0, __ATOMIC_RELEASE);
+    for (u32 i = 0; i < AFR_STATS_THREADS; i++) {
+        plugin_heap_free(g_StatsThreads[i].table);
+    }
+    memset(g_StatsThreads, 0, sizeof(g_StatsThreads));
+}
+
+bool afr_stats_enabled(void)
+{
+    return __atomic_load_n(&g_StatsEnabled, __ATOMIC_ACQUIRE) != 0;
+}
+
+// Returns the calling thread's slot with its table, claiming a free one on its first call.
+static stats_thread *stats_thread_slot(u64 thread)
+{
+    const u32 start = (u32)((thread >> 6) * 0x9e3779b1u >> 16);
+    for (u32 i = 0; i < AFR_STATS_THREADS; i++) {
+        stats_thread *slot = &g_StatsThreads[(start + i) & (AFR_STATS_THREADS - 1)];
+        u64 owner = __atomic_load_n(&slot->thread, __ATOMIC_ACQUIRE);
+        if (owner == thread) {
+            return slot->table ? slot : NULL;
+        }
+        if (owner == 0 && __atomic_compare_exchange_n(&slot->thread, &owner, thread, false,
+                                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            stats_entry *table = (stats_entry *)plugin_heap_calloc(AFR_STATS_PATHS, sizeof(stats_entry));
+            __atomic_store_n(&slot->table, table, __ATOMIC_RELEASE);
+            return table ? slot : NULL;
+        }
+    }
+    return NULL;
+}
+
+// Finds `path' in a table, adding it to a free entry. NULL when the table is full.
+static stats_entry *stats_find(stats_entry *table, u32 mask, const char *path, u32 hash, u32 *paths)
+{
+    for (u32 i = 0; i <= mask; i++) {
+        stats_entry *entry = &table[(hash + i) & mask];
+        const u32 stored = __atomic_load_n(&entry->hash, __ATOMIC_ACQUIRE);
+        if (stored == hash && strncmp(entry->path, path, AFR_STATS_PATH_MAX - 1) == 0) {
+            return entry;
+        }
+        if (stored == 0) {
+            strncpy(entry->path, path, AFR_STATS_PATH_MAX - 1);
+            entry->layer = -1;
+            __atomic_store_n(&entry->hash, hash, __ATOMIC_RELEASE);
+            __atomic_store_n(paths, *paths + 1, __ATOMIC_RELAXED);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void afr_stats_record(const char *path, afr_stats_kind kind, int32_t layer, uint64_t ticks)
+{
+    if (!afr_stats_enabled()) {
+        return;
+    }
+    stats_thread *slot = stats_thread_slot((u64)(uintptr_t)scePthreadSelf());
+    if (!slot) {
+        __atomic_fetch_add(&g_StatsDropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    stats_entry *entry = stats_find(slot->table, AFR_STATS_PATHS - 1, path, stats_hash(path), &slot->paths);
+    if (!entry) {
+        stats_bump(&slot->dropped);
+        return;
+    }
+    if (layer >= 0) {
+        __atomic_store_n(&entry->layer, layer, __ATOMIC_RELAXED);
+        stats_bump(&entry->hits);
+    } else {
+        stats_bump(&entry->misses);
+    }
+    stats_bump(&entry->bucket[kind][stats_bucket(ticks)]);
+}
+
+uint64_t afr_stats_dropped(void)
+{
+    u64 dropped = __atomic_load_n(&g_StatsDropped, __ATOMIC_RELAXED);
+    for (u32 i = 0; i < AFR_STATS_THREADS; i++) {
+        dropped += __atomic_load_n(&g_StatsThreads[i].dropped, __ATOMIC_RELAXED);
+    }
+    return dropped;
+}
+
+// Upper end of the bucket `percent' of `calls' fall in, in microseconds.
+static u64 stats_percentile(const u32 *bucket, u64 calls, u32 percent)
+{
+    const u64 target = (calls * percent + 99) / 100;
+    u64 seen = 0;
+    for (u32 i = 0; i < AFR_STATS_BUCKETS; i++) {
+        seen += bucket[i];
+        if (seen >= target && seen) {
+            return 2ull << i;
+        }
+    }
+    return 0;
+}
+
+static s32 stats_write_entry(s32 fd, const stats_entry *entry)
+{
+    char line[AFR_STATS_PATH_MAX + 512];
+    u64 calls[AFR_STATS_KINDS] = { 0 };
+    for (u32 k = 0; k < AFR_STATS_KINDS; k++) {
+        for (u32 i = 0; i < AFR_STATS_BUCKETS; i++) {
+            calls[k] += entry->bucket[k][i];
+        }
+    }
+    s32 len = snprintf(line, sizeof(line), "%s,%d,%u,%u,%lu,%lu,%lu,%lu,%lu,%lu,", entry->path, entry->layer,
+                       entry->hits, entry->misses, calls[AFR_STATS_OPEN],
+                       stats_percentile(entry->bucket[AFR_STATS_OPEN], calls[AFR_STATS_OPEN], 50),
+                       stats_percentile(entry->bucket[AFR_STATS_OPEN], calls[AFR_STATS_OPEN], 99),
+                       calls[AFR_STATS_STAT], stats_percentile(entry->bucket[AFR_STATS_STAT], calls[AFR_STATS_STAT], 50),
+                       stats_percentile(entry->bucket[AFR_STATS_STAT], calls[AFR_STATS_STAT], 99));
+    for (u32 k = 0; k < AFR_STATS_KINDS; k++) {
+        for (u32 i = 0; i < AFR_STATS_BUCKETS; i++) {
+            len += snprintf(line + len, sizeof(line) - len, i ? " %u" : "%u", entry->bucket[k][i]);
+        }
+        len += snprintf(line + len, sizeof(line) - len, k + 1 < AFR_STATS_KINDS ? "," : "\n");
+    }
+    return sceKernelWrite(fd, line, (size_t)len) == len ? 0 : ORBIS_KERNEL_ERROR_EIO;
+}
+
+int32_t afr_stats_write(const char *file, const afr_index *index)
+{
+    // The tables of every thread merge into one twice the size of their paths.
+    u32 paths = 0;
+    for (u32 i = 0; i < AFR_STATS_THREADS; i++) {
+        paths += __atomic_load_n(&g_StatsThreads[i].paths, __ATOMIC_RELAXED);
+    }
+    u32 slots = 64;
+    while (slots < paths * 2) {
+        slots *= 2;
+    }
+    stats_entry *merged = (stats_entry *)plugin_heap_calloc(slots, sizeof(stats_entry));
+    if (!merged) {
+        return ORBIS_KERNEL_ERROR_ENOMEM;
+    }
+    u32 used = 0;
+    for (u32 t = 0; t < AFR_STATS_THREADS; t++) {
+        const stats_entry *table = __atomic_load_n(&g_StatsThreads[t].table, __ATOMIC_ACQUIRE);
+        for (u32 i = 0; table && i < AFR_STATS_PATHS; i++) {
+            const stats_entry *entry = &table[i];
+            const u32 hash = __atomic_load_n(&entry->hash, __ATOMIC_ACQUIRE);
+            // Paths added since the count are left for the next write.
+            stats_entry *sum = hash ? stats_find(merged, slots - 1, entry->path, hash, &used) : NULL;
+            if (!sum) {
+                continue;
+            }
+            const s32 layer = __atomic_load_n(&entry->layer, __ATOMIC_RELAXED);
+            sum->layer = layer >= 0 ? layer : sum->layer;
+            sum->hits += __atomic_load_n(&entry->hits, __ATOMIC_RELAXED);
+            sum->misses += __atomic_load_n(&entry->misses, __ATOMIC_RELAXED);
+            for (u32 k = 0; k < AFR_STATS_KINDS; k++) {
+                for (u32 b = 0; b < AFR_STATS_BUCKETS; b++) {
+                    sum->bucket[k][b] += __atomic_load_n(&entry->bucket[k][b], __ATOMIC_RELAXED);
+                }
+            }
+        }
+    }
+
+    s32 fd = sceKernelOpen(file, 0x0001 | 0x0200 | 0x0400, 0777); // O_WRONLY | O_CREAT | O_TRUNC
+    if (fd < 0) {
+        plugin_heap_free(merged);
+        return fd;
+    }
+    static const char header[] =
+        "path,layer,hits,misses,opens,open_p50_us,open_p99_us,stats,stat_p50_us,stat_p99_us,open_us,stat_us\n";
+    s32 ret = sceKernelWrite(fd, header, sizeof(header) - 1) == sizeof(header) - 1 ? 0 : ORBIS_KERNEL_ERROR_EIO;
+    for (u32 i = 0; i < slots && ret == 0; i++) {
+        if (merged[i].hash) {
+            ret = stats_write_entry(fd, &merged[i]);
+        }
+    }
+    // Overrides never touched, compressed ones under the path the game opens.
+    u32 cursor = 0;
+    s32 layer = 0;
+    bool dir = false;
+    const char *path;
+    while (index && ret == 0 && (path = afr_index_next(index, &cursor, &layer, &dir))) {
+        if (dir) {
+            continue;
+        }
+        char rel[AFR_STATS_PATH_MAX];
+        const size_t length = strlen(path);
+        const size_t suffix = sizeof(AFR_CHUNK_SUFFIX) - 1;
+        const bool chunked = length > suffix && strcmp(path + length - suffix, AFR_CHUNK_SUFFIX) == 0;
+        snprintf(rel, sizeof(rel), "%.*s", (int)(chunked ? length - suffix : length), path);
+        const u32 hash = stats_hash(rel);
+        bool seen = false;
+        for (u32 i = 0; i < slots && merged[(hash + i) & (slots - 1)].hash; i++) {
+            const stats_entry *entry = &merged[(hash + i) & (slots - 1)];
+            if (entry->hash == hash && strncmp(entry->path, rel, AFR_STATS_PATH_MAX - 1) == 0) {
+                seen = true;
+                break;
+            }
+        }
+        if (!seen) {
+            stats_entry unused;
+            memset(&unused, 0, sizeof(unused));
+            memcpy(unused.path, rel, sizeof(unused.path));
+            unused.layer = layer;
+            ret = stats_write_entry(fd, &unused);
+        }
+    }
+    sceKernelClose(fd);
+    plugin_heap_free(merged);
+    return ret;
+}
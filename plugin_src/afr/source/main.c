@@ -4,6 +4,18 @@
 
 #include "Common.h"
 #include "plugin_common.h"
+#include "binlog.h"
+#include "hook_stats.h"
+#include "trace.h"
+#include "plugin_heap.h"
+#include "config_service.h"
+#include "afr_index.h"
+#include "afr_pack.h"
+#include "afr_cache.h"
+#include "afr_file.h"
+#include "afr_chunk.h"
+#include "afr_rcu.h"
+#include "afr_stats.h"
 
 attr_public const char *g_pluginName = "afr";
 attr_public const char *g_pluginDesc = "Application File Redirector";
@@ -13,25 +25,441 @@ attr_public u32 g_pluginVersion = 0x00000100; // 1.00
 HOOK_INIT(sceKernelOpen);
 HOOK_INIT(sceKernelStat);
 HOOK_INIT(fopen);
+HOOK_INIT(sceKernelRead);
+HOOK_INIT(sceKernelPread);
+HOOK_INIT(sceKernelLseek);
+HOOK_INIT(sceKernelFstat);
+HOOK_INIT(sceKernelClose);
+HOOK_INIT(sceKernelMmap);
+HOOK_INIT(sceKernelCheckReachability);
+HOOK_INIT(libkernel_open);
+HOOK_INIT(sceKernelAioSubmitReadCommands);
+HOOK_INIT(sceKernelAioSubmitReadCommandsMultiple);
+
+HOOK_STATS_INIT(sceKernelOpen);
+HOOK_STATS_INIT(sceKernelStat);
+HOOK_STATS_INIT(fopen);
+HOOK_STATS_INIT(sceKernelRead);
+HOOK_STATS_INIT(sceKernelPread);
+HOOK_STATS_INIT(sceKernelCheckReachability);
+HOOK_STATS_INIT(libkernel_open);
+HOOK_STATS_INIT(sceKernelAioSubmitReadCommands);
+HOOK_STATS_INIT(sceKernelAioSubmitReadCommandsMultiple);
+
+// Entry points the SDK headers do not declare, resolved from libkernel at load like
+// aio_fix_505 does. `libkernel_open' is the POSIX open.
+#define SCE_KERNEL_AIO_STATE_COMPLETED (3)
+#define SCE_KERNEL_AIO_STATE_ABORTED   (4)
+
+typedef struct SceKernelAioResult {
+    s64 returnValue;
+    u32 state;
+} SceKernelAioResult;
+
+typedef s32 SceKernelAioSubmitId;
+
+typedef struct SceKernelAioRWRequest {
+    off_t offset;
+    s64 nbyte;
+    void *buf;
+    struct SceKernelAioResult *result;
+    s32 fd;
+} SceKernelAioRWRequest;
+
+s32 (*libkernel_open)(const char *path, s32 flags, OrbisKernelMode mode);
+s32 (*sceKernelAioSubmitReadCommands)(SceKernelAioRWRequest req[], s32 size, s32 prio, SceKernelAioSubmitId *id);
+s32 (*sceKernelAioSubmitReadCommandsMultiple)(SceKernelAioRWRequest req[], s32 size, s32 prio,
+                                              SceKernelAioSubmitId id[]);
+
+// Overlay folders of the title, e.g.
+//     [default]
+//     overlays=packs/hd_textures,CUSA00001
+// Names are folders below /data/GoldHEN/AFR unless they start with `/', later ones win.
+// Without the key only /data/GoldHEN/AFR/<titleid> is used. A layer with a `<name>.pack'
+// built by tools/afr_pack is served from the pack instead of its folder. A `<path>.afrz'
+// built by tools/afr_compress overrides `<path>' with its decompressed contents.
+// `cache_kb' enables a RAM cache of that size for overrides up to `cache_file_kb'
+// (default 64) opened read-only, set it in the title ID section to size it per game.
+// `rescan_s' rebuilds the index that often so files added while the game runs are found,
+// and drops overrides in the RAM cache that changed since they were read.
+// `stats_s' records which /app0 paths are opened and stat'ed, served or not and how fast,
+// and writes them to /data/GoldHEN/AFR/<titleid>.stats.csv that often and at unload.
+#define AFR_CONFIG_PATH GOLDHEN_PATH "/afr.ini"
+#define AFR_MAX_LAYERS  8
+#define AFR_ROOT_MAX    96
+#define AFR_CACHE_FILE_KB_DEFAULT 64
+#define AFR_AIO_LOCAL_REQUESTS 16 // translated on the stack of the submitting thread, more on the heap
+
+// Opens that may modify the file or list a directory are never served by afr itself.
+#define AFR_OPEN_NOT_READ_ONLY (0x0001 | 0x0002 | 0x0200 | 0x0400 | 0x20000) // O_WRONLY | O_RDWR | O_CREAT | O_TRUNC | O_DIRECTORY
 
 char titleid[16];
+static char g_LayerRoot[AFR_MAX_LAYERS][AFR_ROOT_MAX];
+static afr_pack g_LayerPack[AFR_MAX_LAYERS];
+static u32 g_Layers = 0;
+static u32 g_Packs = 0;
+static bool g_FileHooks = false; // descriptor calls hooked for virtual descriptors
+static s32 g_AioSink = -1; // empty AIO reads of it stand in for requests afr served itself
+static SceKernelAioResult g_AioSinkResult;
+
+// Every layer merged, paths map to the layer that wins. Hooks read the published
+// snapshot inside an afr_rcu section, a rescan swaps in a new one and frees the old
+// one once no hook can hold it anymore. NULL while there is no index.
+typedef struct {
+    afr_index index;
+    u32 chunked; // indexed `.afrz' paths
+} afr_snapshot;
+
+static afr_snapshot *g_Snapshot = NULL;
+static u32 g_RescanInterval = 0; // seconds between rescans of the layer folders, 0 for none
+static u32 g_StatsInterval = 0;  // seconds between writes of the access statistics, 0 for none
+static char g_StatsPath[AFR_ROOT_MAX];
+static u32 g_WorkerRunning = 0;
+static OrbisPthread g_WorkerThread;
+
+// Returns the layer overriding an /app0 path, -1 when afr has nothing for it.
+// `out' receives the override path, for packs the path the folder would have.
+// `*chunked' tells whether the override is the compressed `<path>.afrz' (see afr_chunk.h),
+// which wins over a plain override of an earlier layer.
+// Without an index, or a thread slot to read it (see afr_rcu.h), the layers are probed
+// from the last one.
+static s32 afr_resolve(const char *path, char *out, size_t size, bool *chunked)
+{
+    *chunked = false;
+    if (!(path[0] == '/' && path[1] == 'a' && path[2] == 'p' && path[3] == 'p' &&
+          path[4] == '0' && strlen(path) > 6)) {
+        return -1;
+    }
+    const char *rel = path + 6;
+    char compressed[MAX_PATH_];
+    const s32 reader = afr_rcu_read_begin();
+    const afr_snapshot *snapshot = reader >= 0 ? __atomic_load_n(&g_Snapshot, __ATOMIC_ACQUIRE) : NULL;
+    const bool can_compress = (!snapshot || snapshot->chunked) &&
+                              snprintf(compressed, sizeof(compressed), "%s" AFR_CHUNK_SUFFIX, rel) < (int)sizeof(compressed);
+    if (snapshot) {
+        const s32 layer = afr_index_find(&snapshot->index, rel);
+        const s32 chunked_layer = can_compress ? afr_index_find(&snapshot->index, compressed) : -1;
+        afr_rcu_read_end(reader);
+        *chunked = chunked_layer > layer;
+        if (*chunked) {
+            // An override path too long for `out' is left to /app0.
+            return snprintf(out, size, "%s/%s", g_LayerRoot[chunked_layer], compressed) < (int)size ? chunked_layer : -1;
+        }
+        if (layer >= 0) {
+            snprintf(out, size, "%s/%s", g_LayerRoot[layer], rel);
+        }
+        return layer;
+    }
+    afr_rcu_read_end(reader);
+    for (u32 i = g_Layers; i-- > 0;) {
+        struct stat st;
+        *chunked = can_compress;
+        if (g_LayerPack[i].header) {
+            *chunked = *chunked && afr_pack_find(&g_LayerPack[i], compressed) >= 0;
+            if (*chunked || afr_pack_find(&g_LayerPack[i], rel) >= 0) {
+                return snprintf(out, size, "%s/%s", g_LayerRoot[i], *chunked ? compressed : rel) < (int)size ? (s32)i : -1;
+            }
+            continue;
+        }
+        if (*chunked && snprintf(out, size, "%s/%s", g_LayerRoot[i], compressed) < (int)size && stat(out, &st) >= 0) {
+            return (s32)i;
+        }
+        *chunked = false;
+        snprintf(out, size, "%s/%s", g_LayerRoot[i], rel);
+        if (i == 0 || stat(out, &st) >= 0) {
+            return (s32)i;
+        }
+    }
+    return -1;
+}
+
+static void afr_add_layer(const char *name, u32 length)
+{
+    if (g_Layers == AFR_MAX_LAYERS) {
+        final_printf("afr: more than %u overlays, %.*s ignored\n", AFR_MAX_LAYERS, (int)length, name);
+        return;
+    }
+    const s32 written = name[0] == '/'
+        ? snprintf(g_LayerRoot[g_Layers], AFR_ROOT_MAX, "%.*s", (int)length, name)
+        : snprintf(g_LayerRoot[g_Layers], AFR_ROOT_MAX, GOLDHEN_PATH "/AFR/%.*s", (int)length, name);
+    if (written >= AFR_ROOT_MAX) {
+        final_printf("afr: overlay path %.*s is too long, ignored\n", (int)length, name);
+        return;
+    }
+    char pack[AFR_ROOT_MAX + 8];
+    snprintf(pack, sizeof(pack), "%s.pack", g_LayerRoot[g_Layers]);
+    const s32 ret = afr_pack_open(&g_LayerPack[g_Layers], pack);
+    if (ret == 0) {
+        final_printf("afr: serving %s from %s, %u file(s)\n", g_LayerRoot[g_Layers], pack,
+                     g_LayerPack[g_Layers].header->entries);
+        g_Packs++;
+    } else if (ret != ORBIS_KERNEL_ERROR_ENOENT) {
+        final_printf("afr: failed to open %s (0x%08x), using the folder\n", pack, ret);
+    }
+    g_Layers++;
+}
+
+static void afr_load_layers(const config_view *view)
+{
+    const char *overlays = config_view_get(view, "overlays");
+    for (const char *p = overlays; p && *p;) {
+        const char *end = strchr(p, ',');
+        u32 length = end ? (u32)(end - p) : (u32)strlen(p);
+        const char *name = p;
+        p += length + (end ? 1 : 0);
+        while (length && (*name == ' ' || *name == '\t')) {
+            name++;
+            length--;
+        }
+        while (length && (name[length - 1] == ' ' || name[length - 1] == '\t' || name[length - 1] == '/')) {
+            length--;
+        }
+        if (length) {
+            afr_add_layer(name, length);
+        }
+    }
+    if (!g_Layers) {
+        afr_add_layer(titleid, (u32)strlen(titleid));
+    }
+}
+
+// Builds every layer's index with its cache beside the folder and merges them in order.
+static s32 afr_build_index(afr_index *merged)
+{
+    memset(merged, 0, sizeof(*merged));
+    for (u32 i = 0; i < g_Layers; i++) {
+        char cache[AFR_ROOT_MAX + 8];
+        afr_index layer;
+        s32 ret = 0;
+        if (g_LayerPack[i].header) {
+            memset(&layer, 0, sizeof(layer));
+            ret = afr_pack_index(&g_LayerPack[i], &layer) ? 0 : -1;
+        } else {
+            const bool cached = snprintf(cache, sizeof(cache), "%s.index", g_LayerRoot[i]) < (int)sizeof(cache);
+            ret = afr_index_build(&layer, g_LayerRoot[i], cached ? cache : NULL);
+        }
+        if (ret == 0 && !afr_index_merge(merged, &layer, (u8)i)) {
+            ret = -1;
+        }
+        afr_index_free(&layer);
+        if (ret < 0) {
+            final_printf("afr: failed to index %s (0x%08x)\n", g_LayerRoot[i], ret);
+            afr_index_free(merged);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static afr_snapshot *afr_snapshot_build(void)
+{
+    afr_snapshot *snapshot = (afr_snapshot *)plugin_heap_alloc(sizeof(*snapshot));
+    if (!snapshot) {
+        return NULL;
+    }
+    if (afr_build_index(&snapshot->index) != 0) {
+        plugin_heap_free(snapshot);
+        return NULL;
+    }
+    snapshot->chunked = afr_index_count_suffix(&snapshot->index, AFR_CHUNK_SUFFIX);
+    return snapshot;
+}
+
+// Swaps in `snapshot', NULL to drop the index, and frees the one it replaces.
+static void afr_snapshot_publish(afr_snapshot *snapshot)
+{
+    afr_snapshot *old = __atomic_exchange_n(&g_Snapshot, snapshot, __ATOMIC_SEQ_CST);
+    if (old) {
+        afr_rcu_synchronize();
+        afr_index_free(&old->index);
+        plugin_heap_free(old);
+    }
+}
+
+// True when the override cached as `key' changed or went away on storage since it was read.
+// Packs are opened once at load and never change under their entries.
+static bool afr_cache_stale(const char *key, const struct stat *cached)
+{
+    for (u32 i = 0; i < g_Layers; i++) {
+        const size_t len = strlen(g_LayerRoot[i]);
+        if (g_LayerPack[i].header && strncmp(key, g_LayerRoot[i], len) == 0 && key[len] == '/') {
+            return false;
+        }
+    }
+    struct stat st;
+    return stat(key, &st) != 0 || st.st_dev != cached->st_dev || st.st_ino != cached->st_ino ||
+           st.st_mtim.tv_sec != cached->st_mtim.tv_sec || st.st_mtim.tv_nsec != cached->st_mtim.tv_nsec;
+}
+
+// Rebuilds the index. Only folders whose directories changed are listed again
+// (see afr_index.h), an unchanged index is not swapped. Files rewritten in place leave
+// their directory alone, so the RAM cache is checked against storage every time.
+static void afr_rescan(void)
+{
+    if (afr_cache_max_file()) {
+        afr_cache_drop_stale(afr_cache_stale);
+    }
+    afr_snapshot *snapshot = afr_snapshot_build();
+    if (snapshot && snapshot->index.listed) {
+        final_printf("afr: rescanned %u path(s), %u of %u dir(s) changed\n", snapshot->index.count,
+                     snapshot->index.listed, snapshot->index.dirs);
+        afr_snapshot_publish(snapshot);
+    } else if (snapshot) {
+        afr_index_free(&snapshot->index);
+        plugin_heap_free(snapshot);
+    }
+}
+
+// Only called where no rescan can swap the snapshot, the worker thread or after it stopped.
+static void afr_write_stats(void)
+{
+    const afr_snapshot *snapshot = __atomic_load_n(&g_Snapshot, __ATOMIC_ACQUIRE);
+    const s32 ret = afr_stats_write(g_StatsPath, snapshot ? &snapshot->index : NULL);
+    if (ret) {
+        final_printf("afr: failed to write %s (0x%08x)\n", g_StatsPath, ret);
+    }
+}
+
+// Rescans the overlays and writes the access statistics at their intervals.
+static void *afr_worker_thread(void *args)
+{
+    scePthreadSetprio(scePthreadSelf(), ORBIS_KERNEL_PRIO_FIFO_LOWEST);
+    u64 rescan_ms = 0;
+    u64 stats_ms = 0;
+    while (__atomic_load_n(&g_WorkerRunning, __ATOMIC_ACQUIRE)) {
+        sceKernelUsleep(100 * 1000);
+        rescan_ms += 100;
+        stats_ms += 100;
+        if (g_RescanInterval && rescan_ms >= (u64)g_RescanInterval * 1000) {
+            rescan_ms = 0;
+            afr_rescan();
+        }
+        if (g_StatsInterval && stats_ms >= (u64)g_StatsInterval * 1000) {
+            stats_ms = 0;
+            afr_write_stats();
+        }
+    }
+    scePthreadExit(NULL);
+    return NULL;
+}
+
+// Reads `size' bytes at `offset' of `fd', or all of `chunk' when set, into the RAM cache
+// under `key'. Returns a virtual descriptor on the cached copy, negative when it does not fit.
+static s32 afr_cache_fill(const char *key, s32 fd, afr_chunk_file *chunk, const struct stat *st, u64 offset, u64 size)
+{
+    afr_cache_entry *entry = afr_cache_reserve(key, st, size);
+    if (!entry) {
+        return -1;
+    }
+    for (u64 done = 0; done < size;) {
+        const ssize_t got = chunk ? afr_chunk_read(chunk, entry->data + done, size - done, done)
+                                  : sceKernelPread(fd, entry->data + done, size - done, (off_t)(offset + done));
+        if (got <= 0) {
+            afr_cache_release(entry);
+            return -1;
+        }
+        done += (u64)got;
+    }
+    entry = afr_cache_publish(entry);
+    if (!entry) {
+        return -1;
+    }
+    const s32 vfd = afr_file_open_cached(entry);
+    if (vfd < 0) {
+        afr_cache_release(entry);
+    }
+    return vfd;
+}
+
+// Opens the chunked override `<rel>.afrz' of a layer, `key' being its path in the folder.
+// Files the RAM cache takes are decoded whole at once.
+static s32 afr_open_chunked(s32 layer, const char *key, const char *rel, u64 cache_max)
+{
+    afr_chunk_file *chunk = NULL;
+    s32 ret = 0;
+    if (g_LayerPack[layer].header) {
+        const afr_pack *pack = &g_LayerPack[layer];
+        const s32 entry = afr_pack_find(pack, rel);
+        ret = entry < 0 ? ORBIS_KERNEL_ERROR_ENOENT
+                        : afr_chunk_open(&chunk, pack->fd, false, &pack->st, pack->entry[entry].offset,
+                                         pack->entry[entry].size);
+    } else {
+        const s32 fd = HOOK_CONTINUE(sceKernelOpen, s32 (*)(const char *, s32, OrbisKernelMode), key, 0x0000, 0); // O_RDONLY
+        struct stat st;
+        ret = fd < 0 ? fd : sceKernelFstat(fd, &st);
+        if (ret == 0) {
+            ret = afr_chunk_open(&chunk, fd, true, &st, 0, (u64)st.st_size);
+        } else if (fd >= 0) {
+            sceKernelClose(fd);
+        }
+    }
+    if (ret) {
+        return ret;
+    }
+    s32 fd = -1;
+    if (chunk->size <= cache_max) {
+        fd = afr_cache_fill(key, -1, chunk, &chunk->st, 0, chunk->size);
+    }
+    if (fd >= 0) {
+        afr_chunk_close(chunk);
+        return fd;
+    }
+    fd = afr_file_open_chunked(chunk);
+    if (fd < 0) {
+        afr_chunk_close(chunk);
+    }
+    return fd;
+}
+
+// Stats the chunked override `<rel>.afrz' of a layer as the file it decompresses to.
+static s32 afr_stat_chunked(s32 layer, const char *key, const char *rel, struct stat *stat_buf)
+{
+    afr_chunk_header header;
+    s32 ret = 0;
+    if (g_LayerPack[layer].header) {
+        const afr_pack *pack = &g_LayerPack[layer];
+        const s32 entry = afr_pack_find(pack, rel);
+        ret = entry < 0 ? ORBIS_KERNEL_ERROR_ENOENT
+                        : afr_chunk_read_header(pack->fd, pack->entry[entry].offset, pack->entry[entry].size, &header);
+        if (ret == 0) {
+            afr_file_stat(&pack->st, header.size, stat_buf);
+        }
+        return ret;
+    }
+    const s32 fd = HOOK_CONTINUE(sceKernelOpen, s32 (*)(const char *, s32, OrbisKernelMode), key, 0x0000, 0); // O_RDONLY
+    if (fd < 0) {
+        return fd;
+    }
+    struct stat st;
+    ret = sceKernelFstat(fd, &st);
+    if (ret == 0) {
+        ret = afr_chunk_read_header(fd, 0, (u64)st.st_size, &header);
+    }
+    if (ret == 0) {
+        afr_file_stat(&st, header.size, stat_buf);
+    }
+    sceKernelClose(fd);
+    return ret;
+}
 
 FILE* fopen_hook(const char *path, const char *mode)
 {
+    HOOK_STATS_SCOPE(fopen);
+    TRACE_SCOPE("fopen");
     FILE* fp = NULL;
-    if (path[0] == '/' && path[1] == 'a' && path[2] == 'p' && path[3] == 'p' &&
-        path[4] == '0' && strlen(path) > 6)
+    char possible_path[MAX_PATH_];
+    // A FILE stream can not read a window of a pack or decompress, such paths open from /app0.
+    bool chunked = false;
+    const s32 layer = afr_resolve(path, possible_path, sizeof(possible_path), &chunked);
+    if (layer >= 0 && !g_LayerPack[layer].header && !chunked)
     {
-        char possible_path[MAX_PATH_];
-        memset(possible_path, 0, sizeof(possible_path));
-        snprintf(possible_path, sizeof(possible_path), GOLDHEN_PATH "/AFR/%s/%s", titleid, path + 6);
-
         fp = HOOK_CONTINUE(fopen,
                            FILE *(*)(const char *, const char *),
                            possible_path, mode);
         if (fp)
         {
-            final_printf("new_path: %s FILE*: 0x%p\n", possible_path, &fp);
+            binlog_info("new_path: %s FILE*: %p\n", possible_path, (void *)fp);
+            TRACE_INSTANT("afr_redirect", 0);
             return fp;
         }
     }
@@ -39,69 +467,316 @@ FILE* fopen_hook(const char *path, const char *mode)
     fp = HOOK_CONTINUE(fopen,
                        FILE *(*)(const char *, const char *),
                        path, mode);
-    debug_printf("path: %s FILE*: 0x%p\n", path, &fp);
+    binlog_debug("path: %s FILE*: %p\n", path, (void *)fp);
     return fp;
 }
 
+// Stats the override afr_resolve found for `path', 0 on success.
+static s32 afr_stat_override(const char *path, s32 layer, bool chunked, const char *override, struct stat *stat_buf)
+{
+    if (chunked) {
+        return afr_stat_chunked(layer, override, override + strlen(g_LayerRoot[layer]) + 1, stat_buf);
+    }
+    if (g_LayerPack[layer].header) {
+        return afr_pack_stat(&g_LayerPack[layer], path + 6, stat_buf);
+    }
+    return stat(override, stat_buf) >= 0 ? 0 : -1;
+}
+
+// Counts a call of the game that started at `start' in the access statistics, 0 when
+// they are off.
+static void afr_record(const char *path, afr_stats_kind kind, s32 layer, u64 start)
+{
+    if (start && strncmp(path, "/app0/", 6) == 0) {
+        afr_stats_record(path + 6, kind, layer, sceKernelGetProcessTimeCounter() - start);
+    }
+}
+
 s32 sceKernelStat_hook(char *path, struct stat* stat_buf)
 {
+    HOOK_STATS_SCOPE(sceKernelStat);
+    TRACE_SCOPE("sceKernelStat");
+    const u64 start = afr_stats_enabled() ? sceKernelGetProcessTimeCounter() : 0;
     // FIXME: use errno for correct `stat()` return values
-    s32 ret = 0;
-    s32 ret_pos = 0;
-    ret = stat(path, stat_buf);
-    if (path[0] == '/' && path[1] == 'a' && path[2] == 'p' && path[3] == 'p' &&
-        path[4] == '0' && strlen(path) > 6 )
+    char possible_path[MAX_PATH_];
+    bool chunked = false;
+    const s32 layer = afr_resolve(path, possible_path, sizeof(possible_path), &chunked);
+    if (layer >= 0 && afr_stat_override(path, layer, chunked, possible_path, stat_buf) == 0)
     {
-        char possible_path[MAX_PATH_];
-        memset(possible_path, 0, sizeof(possible_path));
-        snprintf(possible_path, sizeof(possible_path), GOLDHEN_PATH "/AFR/%s/%s", titleid, path + 6);
-
-        ret_pos = stat(possible_path, stat_buf);
-        if (ret_pos < 0)
-        {
-            debug_printf("old: %s\n", path);
-            debug_printf("old stat: 0x%08x\n", ret);
-            return ret;
-        }
-        else
-        {
-            final_printf("new: %s\n", possible_path);
-            final_printf("new stat: 0x%08x\n", ret_pos);
-            return ret_pos;
-        }
+        binlog_info("new: %s stat: %lu bytes\n", possible_path, (u64)stat_buf->st_size);
+        TRACE_INSTANT("afr_redirect", 0);
+        afr_record(path, AFR_STATS_STAT, layer, start);
+        return 0;
     }
+    const s32 ret = stat(path, stat_buf);
+    binlog_debug("old: %s stat: 0x%08x\n", path, ret);
+    afr_record(path, AFR_STATS_STAT, -1, start);
     return ret;
 }
 
-s32 sceKernelOpen_hook(const char *path, s32 flags, OrbisKernelMode mode)
+s32 sceKernelCheckReachability_hook(const char *path)
 {
-    s32 fd = 0;
-    if (path[0] == '/' && path[1] == 'a' && path[2] == 'p' && path[3] == 'p' &&
-        path[4] == '0' && strlen(path) > 6) {
+    HOOK_STATS_SCOPE(sceKernelCheckReachability);
+    char possible_path[MAX_PATH_];
+    bool chunked = false;
+    struct stat st;
+    const s32 layer = afr_resolve(path, possible_path, sizeof(possible_path), &chunked);
+    if (layer >= 0 && afr_stat_override(path, layer, chunked, possible_path, &st) == 0) {
+        binlog_info("new: %s reachable\n", possible_path);
+        return 0;
+    }
+    return HOOK_CONTINUE(sceKernelCheckReachability, s32 (*)(const char *), path);
+}
 
-        char possible_path[MAX_PATH_];
-        memset(possible_path, 0, sizeof(possible_path));
-        snprintf(possible_path, sizeof(possible_path), GOLDHEN_PATH "/AFR/%s/%s", titleid, path + 6);
-        fd = HOOK_CONTINUE(sceKernelOpen,
-                           s32 (*)(const char *, s32, OrbisKernelMode),
-                           possible_path, flags, mode);
+// Continues an open the game made with sceKernelOpen, or with open when `posix' is set.
+static s32 afr_open_next(bool posix, const char *path, s32 flags, OrbisKernelMode mode)
+{
+    return posix ? HOOK_CONTINUE(libkernel_open, s32 (*)(const char *, s32, OrbisKernelMode), path, flags, mode)
+                 : HOOK_CONTINUE(sceKernelOpen, s32 (*)(const char *, s32, OrbisKernelMode), path, flags, mode);
+}
+
+// Opens `path' for the game, `*served' receives the layer that served it, -1 for /app0.
+static s32 afr_open(const char *path, s32 flags, OrbisKernelMode mode, bool posix, s32 *served)
+{
+    *served = -1;
+    s32 fd = 0;
+    char possible_path[MAX_PATH_];
+    bool chunked = false;
+    const s32 layer = afr_resolve(path, possible_path, sizeof(possible_path), &chunked);
+    // Virtual descriptors only work with the sceKernel calls hooked here, not with POSIX read and
+    // close, so POSIX opens of packed and chunked files go to /app0 like writes do.
+    const bool read_only = !(flags & AFR_OPEN_NOT_READ_ONLY);
+    const bool virtual_fd = read_only && !posix;
+    const u64 cache_max = virtual_fd ? afr_cache_max_file() : 0;
+    if (layer >= 0 && cache_max) {
+        afr_cache_entry *entry = afr_cache_get(possible_path);
+        if (entry) {
+            fd = afr_file_open_cached(entry);
+            if (fd >= 0) {
+                binlog_info("cache: %s fd: 0x%08x\n", possible_path, fd);
+                TRACE_INSTANT("afr_cache_hit", fd);
+                *served = layer;
+                return fd;
+            }
+            afr_cache_release(entry);
+        }
+    }
+    if (layer >= 0 && chunked) {
+        // Compressed overrides are read-only, writes and directory opens go to /app0.
+        const char *rel = possible_path + strlen(g_LayerRoot[layer]) + 1;
+        fd = virtual_fd ? afr_open_chunked(layer, possible_path, rel, cache_max) : -1;
+        if (fd >= 0) {
+            binlog_info("chunked: %s fd: 0x%08x\n", possible_path, fd);
+            TRACE_INSTANT("afr_redirect", fd);
+            *served = layer;
+            return fd;
+        }
+    } else if (layer >= 0 && g_LayerPack[layer].header) {
+        // Packs are read-only, writes and directory opens go to /app0.
+        const afr_pack *pack = &g_LayerPack[layer];
+        const s32 entry = virtual_fd ? afr_pack_find(pack, path + 6) : -1;
+        if (entry >= 0 && pack->entry[entry].size <= cache_max) {
+            fd = afr_cache_fill(possible_path, pack->fd, NULL, &pack->st, pack->entry[entry].offset, pack->entry[entry].size);
+        } else {
+            fd = -1;
+        }
+        if (fd < 0 && entry >= 0) {
+            fd = afr_file_open_window(pack->fd, &pack->st, pack->entry[entry].offset, pack->entry[entry].size);
+        }
+        if (fd >= 0) {
+            binlog_info("pack: %s fd: 0x%08x\n", path, fd);
+            TRACE_INSTANT("afr_redirect", fd);
+            *served = layer;
+            return fd;
+        }
+    } else if (layer >= 0) {
+        fd = afr_open_next(posix, possible_path, flags, mode);
 
         if (fd >= 0)
         {
-            final_printf("new_path: %s\n", possible_path);
-            final_printf("new fd: 0x%08x\n", fd);
+            struct stat st;
+            if (cache_max && sceKernelFstat(fd, &st) == 0 && S_ISREG(st.st_mode) && (u64)st.st_size <= cache_max) {
+                const s32 vfd = afr_cache_fill(possible_path, fd, NULL, &st, 0, (u64)st.st_size);
+                if (vfd >= 0) {
+                    sceKernelClose(fd);
+                    fd = vfd;
+                }
+            }
+            binlog_info("new_path: %s fd: 0x%08x\n", possible_path, fd);
+            TRACE_INSTANT("afr_redirect", fd);
+            *served = layer;
             return fd;
         }
     }
 
-    fd = HOOK_CONTINUE(sceKernelOpen,
-                       s32 (*)(const char *, s32, OrbisKernelMode),
-                       path, flags, mode);
-    debug_printf("path: %s\n", path);
-    debug_printf("fd: 0x%08x\n", fd);
+    fd = afr_open_next(posix, path, flags, mode);
+    binlog_debug("path: %s fd: 0x%08x\n", path, fd);
+    return fd;
+}
+
+s32 sceKernelOpen_hook(const char *path, s32 flags, OrbisKernelMode mode)
+{
+    HOOK_STATS_SCOPE(sceKernelOpen);
+    TRACE_SCOPE("sceKernelOpen");
+    const u64 start = afr_stats_enabled() ? sceKernelGetProcessTimeCounter() : 0;
+    s32 layer = -1;
+    const s32 fd = afr_open(path, flags, mode, false, &layer);
+    afr_record(path, AFR_STATS_OPEN, layer, start);
+    return fd;
+}
+
+// POSIX open of libkernel, only loose overrides are redirected (see afr_open).
+s32 libkernel_open_hook(const char *path, s32 flags, OrbisKernelMode mode)
+{
+    HOOK_STATS_SCOPE(libkernel_open);
+    TRACE_SCOPE("open");
+    const u64 start = afr_stats_enabled() ? sceKernelGetProcessTimeCounter() : 0;
+    s32 layer = -1;
+    const s32 fd = afr_open(path, flags, mode, true, &layer);
+    afr_record(path, AFR_STATS_OPEN, layer, start);
     return fd;
 }
 
+// Descriptor calls, virtual descriptors of packed, cached and chunked files are served here.
+ssize_t sceKernelRead_hook(s32 fd, void *buf, size_t nbytes)
+{
+    HOOK_STATS_SCOPE(sceKernelRead);
+    if (afr_file_owns_fd(fd)) {
+        return afr_file_read(fd, buf, nbytes);
+    }
+    return HOOK_CONTINUE(sceKernelRead, ssize_t (*)(s32, void *, size_t), fd, buf, nbytes);
+}
+
+ssize_t sceKernelPread_hook(s32 fd, void *buf, size_t nbytes, off_t offset)
+{
+    HOOK_STATS_SCOPE(sceKernelPread);
+    if (afr_file_owns_fd(fd)) {
+        return afr_file_pread(fd, buf, nbytes, offset);
+    }
+    return HOOK_CONTINUE(sceKernelPread, ssize_t (*)(s32, void *, size_t, off_t), fd, buf, nbytes, offset);
+}
+
+off_t sceKernelLseek_hook(s32 fd, off_t offset, s32 whence)
+{
+    if (afr_file_owns_fd(fd)) {
+        return afr_file_lseek(fd, offset, whence);
+    }
+    return HOOK_CONTINUE(sceKernelLseek, off_t (*)(s32, off_t, s32), fd, offset, whence);
+}
+
+s32 sceKernelFstat_hook(s32 fd, struct stat *stat_buf)
+{
+    if (afr_file_owns_fd(fd)) {
+        return afr_file_fstat(fd, stat_buf);
+    }
+    return HOOK_CONTINUE(sceKernelFstat, s32 (*)(s32, struct stat *), fd, stat_buf);
+}
+
+s32 sceKernelClose_hook(s32 fd)
+{
+    if (afr_file_owns_fd(fd)) {
+        return afr_file_close(fd);
+    }
+    return HOOK_CONTINUE(sceKernelClose, s32 (*)(s32), fd);
+}
+
+s32 sceKernelMmap_hook(void *addr, size_t len, s32 prot, s32 flags, s32 fd, off_t offset, void **res)
+{
+    if (afr_file_owns_fd(fd)) {
+        return afr_file_mmap(addr, len, prot, flags, fd, offset, res);
+    }
+    return HOOK_CONTINUE(sceKernelMmap, s32 (*)(void *, size_t, s32, s32, s32, off_t, void **), addr, len, prot, flags, fd,
+                         offset, res);
+}
+
+// Returns the requests to give the kernel for `req', which stays as the game built it. Without
+// virtual descriptors that is `req' itself, otherwise a translated copy in `local' or, for more
+// than AFR_AIO_LOCAL_REQUESTS, the plugin heap. NULL when the heap is out of memory.
+// Windows of a pack become reads of the pack and stay asynchronous. Cached and chunked files
+// are read here, their copies turn into empty reads of g_AioSink whose result nobody looks at.
+// The kernel copies the requests when they are submitted, so the copy only lives for the call.
+static SceKernelAioRWRequest *afr_aio_translate(SceKernelAioRWRequest req[], s32 size,
+                                                SceKernelAioRWRequest local[AFR_AIO_LOCAL_REQUESTS])
+{
+    s32 first = 0;
+    while (first < size && !afr_file_owns_fd(req[first].fd)) {
+        first++;
+    }
+    if (first >= size) {
+        return req;
+    }
+    SceKernelAioRWRequest *copy = size <= AFR_AIO_LOCAL_REQUESTS
+                                      ? local
+                                      : (SceKernelAioRWRequest *)plugin_heap_alloc((size_t)size * sizeof(*copy));
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, req, (size_t)size * sizeof(*copy));
+    for (s32 i = first; i < size; i++) {
+        SceKernelAioRWRequest *request = &copy[i];
+        if (!afr_file_owns_fd(request->fd)) {
+            continue;
+        }
+        s32 source = -1;
+        u64 offset = 0;
+        u64 window = 0;
+        if (afr_file_window(request->fd, &source, &offset, &window)) {
+            const u64 at = request->offset < 0 ? window : (u64)request->offset;
+            const u64 left = at < window ? window - at : 0;
+            request->fd = source;
+            request->offset = (off_t)(offset + at);
+            request->nbyte = (u64)request->nbyte < left ? request->nbyte : (s64)left;
+            continue;
+        }
+        if (g_AioSink < 0) {
+            continue;
+        }
+        const ssize_t ret = afr_file_pread(request->fd, request->buf, (size_t)request->nbyte, request->offset);
+        request->result->returnValue = ret;
+        request->result->state = ret < 0 ? SCE_KERNEL_AIO_STATE_ABORTED : SCE_KERNEL_AIO_STATE_COMPLETED;
+        request->fd = g_AioSink;
+        request->offset = 0;
+        request->nbyte = 0;
+        request->result = &g_AioSinkResult;
+    }
+    return copy;
+}
+
+s32 sceKernelAioSubmitReadCommands_hook(SceKernelAioRWRequest req[], s32 size, s32 prio, SceKernelAioSubmitId *id)
+{
+    HOOK_STATS_SCOPE(sceKernelAioSubmitReadCommands);
+    SceKernelAioRWRequest local[AFR_AIO_LOCAL_REQUESTS];
+    SceKernelAioRWRequest *translated = afr_aio_translate(req, size, local);
+    if (!translated) {
+        return ORBIS_KERNEL_ERROR_ENOMEM;
+    }
+    const s32 ret = HOOK_CONTINUE(sceKernelAioSubmitReadCommands,
+                                  s32 (*)(SceKernelAioRWRequest *, s32, s32, SceKernelAioSubmitId *), translated,
+                                  size, prio, id);
+    if (translated != req && translated != local) {
+        plugin_heap_free(translated);
+    }
+    return ret;
+}
+
+s32 sceKernelAioSubmitReadCommandsMultiple_hook(SceKernelAioRWRequest req[], s32 size, s32 prio,
+                                                SceKernelAioSubmitId id[])
+{
+    HOOK_STATS_SCOPE(sceKernelAioSubmitReadCommandsMultiple);
+    SceKernelAioRWRequest local[AFR_AIO_LOCAL_REQUESTS];
+    SceKernelAioRWRequest *translated = afr_aio_translate(req, size, local);
+    if (!translated) {
+        return ORBIS_KERNEL_ERROR_ENOMEM;
+    }
+    const s32 ret = HOOK_CONTINUE(sceKernelAioSubmitReadCommandsMultiple,
+                                  s32 (*)(SceKernelAioRWRequest *, s32, s32, SceKernelAioSubmitId *), translated,
+                                  size, prio, id);
+    if (translated != req && translated != local) {
+        plugin_heap_free(translated);
+    }
+    return ret;
+}
+
 s32 attr_public plugin_load(s32 argc, const char* argv[])
 {
     final_printf("[GoldHEN] <%s\\Ver.0x%08x> %s\n", g_pluginName, g_pluginVersion, __func__);
@@ -112,18 +787,158 @@ s32 attr_public plugin_load(s32 argc, const char* argv[])
         memcpy(titleid, procInfo.titleid, sizeof(titleid));
         print_proc_info();
     }
+#if (__FINAL__) == 1
+    binlog_init(NULL, BINLOG_INFO, BINLOG_SINK_KLOG);
+#else
+    binlog_init(GOLDHEN_PATH "/AFR/afr.binlog", BINLOG_DEBUG, BINLOG_SINK_KLOG | BINLOG_SINK_FILE);
+#endif
+    hook_stats_start(g_pluginName, 5000);
+    trace_start(g_pluginName);
+    plugin_heap_init(g_pluginName, 64 * 1024, 0);
+    afr_rcu_init();
+    const config_view *view = config_service_get_view(AFR_CONFIG_PATH);
+    afr_load_layers(view);
+    int cache_kb = 0;
+    int cache_file_kb = AFR_CACHE_FILE_KB_DEFAULT;
+    config_view_get_int(view, "cache_kb", &cache_kb);
+    config_view_get_int(view, "cache_file_kb", &cache_file_kb);
+    if (cache_kb > 0 && cache_file_kb > 0 &&
+        afr_cache_init(g_pluginName, (u64)cache_kb * 1024, (u64)cache_file_kb * 1024)) {
+        final_printf("afr: caching overrides up to %d KiB in %d KiB of RAM\n", cache_file_kb, cache_kb);
+    }
+    afr_chunk_init(g_pluginName);
+    const u64 index_start = sceKernelGetProcessTimeCounter();
+    afr_snapshot *snapshot = afr_snapshot_build();
+    if (snapshot) {
+        final_printf("afr: indexed %u path(s) of %u overlay(s) in %lu us, %u of %u dir(s) listed, the rest cached\n",
+                     snapshot->index.count, g_Layers,
+                     (sceKernelGetProcessTimeCounter() - index_start) * 1000000 / sceKernelGetProcessTimeCounterFrequency(),
+                     snapshot->index.listed, snapshot->index.dirs);
+        afr_snapshot_publish(snapshot);
+        int rescan_s = 0;
+        config_view_get_int(view, "rescan_s", &rescan_s);
+        g_RescanInterval = rescan_s > 0 ? (u32)rescan_s : 0;
+    } else {
+        final_printf("afr: probing every /app0 path\n");
+    }
+    int stats_s = 0;
+    config_view_get_int(view, "stats_s", &stats_s);
+    if (stats_s > 0) {
+        g_StatsInterval = (u32)stats_s;
+        snprintf(g_StatsPath, sizeof(g_StatsPath), GOLDHEN_PATH "/AFR/%s.stats.csv", titleid);
+        afr_stats_start();
+        final_printf("afr: writing access statistics to %s every %d s\n", g_StatsPath, stats_s);
+    }
     HOOK32(sceKernelOpen);
     HOOK32(sceKernelStat);
     HOOK32(fopen);
+    HOOK32(sceKernelCheckReachability);
+    s32 libkernel = 0;
+    if (sys_dynlib_load_prx("libkernel.sprx", &libkernel))
+        if (sys_dynlib_load_prx("libkernel_sys.sprx", &libkernel))
+            sys_dynlib_load_prx("libkernel_web.sprx", &libkernel);
+    if (sys_dynlib_dlsym(libkernel, "open", &libkernel_open) == 0) {
+        HOOK(libkernel_open);
+    }
+    // Without an index, or with rescans, any path may turn out to be chunked.
+    if (g_Packs || !snapshot || snapshot->chunked || g_RescanInterval || afr_cache_max_file()) {
+        g_FileHooks = true;
+        HOOK32(sceKernelRead);
+        HOOK32(sceKernelPread);
+        HOOK32(sceKernelLseek);
+        HOOK32(sceKernelFstat);
+        HOOK32(sceKernelClose);
+        HOOK32(sceKernelMmap);
+        // Requests afr reads itself need a real descriptor to give the kernel instead, one of
+        // the game and not an override, so past the hook.
+        g_AioSink = HOOK_CONTINUE(sceKernelOpen, s32 (*)(const char *, s32, OrbisKernelMode),
+                                  "/app0/sce_sys/param.sfo", 0x0000, 0); // O_RDONLY
+        if (sys_dynlib_dlsym(libkernel, "sceKernelAioSubmitReadCommands", &sceKernelAioSubmitReadCommands) == 0 &&
+            sys_dynlib_dlsym(libkernel, "sceKernelAioSubmitReadCommandsMultiple",
+                             &sceKernelAioSubmitReadCommandsMultiple) == 0) {
+            HOOK(sceKernelAioSubmitReadCommands);
+            HOOK(sceKernelAioSubmitReadCommandsMultiple);
+        }
+    }
+    if (g_RescanInterval || g_StatsInterval) {
+        __atomic_store_n(&g_WorkerRunning, 1, __ATOMIC_RELEASE);
+        const s32 ret = scePthreadCreate(&g_WorkerThread, NULL, afr_worker_thread, NULL, "afr_worker_thread");
+        if (ret != 0) {
+            final_printf("afr: scePthreadCreate: 0x%08x, no rescans, statistics only written at unload\n", ret);
+            __atomic_store_n(&g_WorkerRunning, 0, __ATOMIC_RELEASE);
+        } else if (g_RescanInterval) {
+            final_printf("afr: rescanning overlays every %u s\n", g_RescanInterval);
+        }
+    }
     return 0;
 }
 
 s32 attr_public plugin_unload(s32 argc, const char* argv[])
 {
     final_printf("[GoldHEN] <%s\\Ver.0x%08x> %s\n", g_pluginName, g_pluginVersion, __func__);
+    u32 running = 1;
+    if (__atomic_compare_exchange_n(&g_WorkerRunning, &running, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        scePthreadJoin(g_WorkerThread, NULL);
+    }
+    g_RescanInterval = 0;
     UNHOOK(sceKernelOpen);
     UNHOOK(sceKernelStat);
     UNHOOK(fopen);
+    if (libkernel_open) {
+        UNHOOK(libkernel_open);
+    }
+    UNHOOK(sceKernelCheckReachability);
+    if (g_FileHooks) {
+        g_FileHooks = false;
+        UNHOOK(sceKernelRead);
+        UNHOOK(sceKernelPread);
+        UNHOOK(sceKernelLseek);
+        UNHOOK(sceKernelFstat);
+        UNHOOK(sceKernelClose);
+        UNHOOK(sceKernelMmap);
+        if (sceKernelAioSubmitReadCommands && sceKernelAioSubmitReadCommandsMultiple) {
+            UNHOOK(sceKernelAioSubmitReadCommands);
+            UNHOOK(sceKernelAioSubmitReadCommandsMultiple);
+        }
+        if (g_AioSink >= 0) {
+            sceKernelClose(g_AioSink);
+            g_AioSink = -1;
+        }
+    }
+    hook_stats_stop();
+    trace_stop();
+    if (g_StatsInterval) {
+        afr_write_stats();
+        const u64 dropped = afr_stats_dropped();
+        if (dropped) {
+            final_printf("afr: %lu call(s) missing from the access statistics, the tables were full\n", dropped);
+        }
+        afr_stats_stop();
+        g_StatsInterval = 0;
+    }
+    afr_snapshot_publish(NULL);
+    afr_rcu_shutdown();
+    afr_cache_stats cache;
+    afr_cache_get_stats(&cache);
+    if (cache.hits || cache.misses) {
+        final_printf("afr: cache %lu hit(s), %lu miss(es), %lu eviction(s), %lu changed on storage\n", cache.hits,
+                     cache.misses, cache.evictions, cache.invalidations);
+    }
+    afr_cache_shutdown();
+    afr_chunk_stats chunk;
+    afr_chunk_get_stats(&chunk);
+    if (chunk.hits || chunk.misses) {
+        final_printf("afr: chunked files %lu block hit(s), %lu decoded, %lu of %lu bytes read\n", chunk.hits,
+                     chunk.misses, chunk.stored, chunk.decoded);
+    }
+    afr_chunk_shutdown();
+    for (u32 i = 0; i < g_Layers; i++) {
+        afr_pack_close(&g_LayerPack[i]);
+    }
+    g_Layers = 0;
+    g_Packs = 0;
+    plugin_heap_shutdown();
+    binlog_shutdown();
     return 0;
 }
 
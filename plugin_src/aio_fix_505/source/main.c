@@ -3,6 +3,8 @@
 
 #include "plugin_common.h"
 #include "Common.h"
+#include "telemetry.h"
+#include "trace.h"
 
 attr_public const char *g_pluginName = "async_io_fix";
 attr_public const char *g_pluginDesc = "(null)";
@@ -46,6 +48,10 @@ typedef struct SceKernelAioRWRequest {
 
 static s32* id_state;
 static s32 id_index;
+static u64 ticks_per_us = 1;
+static telemetry_slot* read_latency;
+static telemetry_slot* read_bytes;
+static telemetry_slot* write_bytes;
 // static pthread_mutex_t lock;
 
 s32 (*sceKernelAioInitializeImpl)(void* p, s32 size);
@@ -133,6 +139,7 @@ s32 sceKernelAioCancelRequests_hook(SceKernelAioSubmitId id[], s32 num, s32 stat
 }
 
 s32 sceKernelAioWaitRequest_hook(SceKernelAioSubmitId id, s32* state, u32* usec) {
+    TRACE_SCOPE("sceKernelAioWaitRequest");
     u32 timer = 0;
 
     s32 timeout = 0;
@@ -157,6 +164,7 @@ s32 sceKernelAioWaitRequest_hook(SceKernelAioSubmitId id, s32* state, u32* usec)
 
 s32 sceKernelAioWaitRequests_hook(SceKernelAioSubmitId id[], s32 num, s32 state[], u32 mode,
                                   u32* usec) {
+    TRACE_SCOPE("sceKernelAioWaitRequests");
     u32 timer = 0;
     s32 timeout = 0;
     s32 completion = 0;
@@ -190,13 +198,16 @@ s32 sceKernelAioWaitRequests_hook(SceKernelAioSubmitId id[], s32 num, s32 state[
 
 s32 sceKernelAioSubmitReadCommands_hook(SceKernelAioRWRequest req[], s32 size, s32 prio,
                                         SceKernelAioSubmitId* id) {
+    TRACE_SCOPE("sceKernelAioSubmitReadCommands");
 
     id_state[id_index] = SCE_KERNEL_AIO_STATE_PROCESSING;
 
     for (s32 i = 0; i < size; i++) {
+        const u64 start = sceKernelGetProcessTimeCounter();
 
         s64 ret = sceKernelPread(req[i].fd, req[i].buf, req[i].nbyte, req[i].offset);
 
+        telemetry_observe(read_latency, (sceKernelGetProcessTimeCounter() - start) / ticks_per_us);
         if (ret < 0) {
             req[i].result->state = SCE_KERNEL_AIO_STATE_ABORTED;
             req[i].result->returnValue = ret;
@@ -204,6 +215,7 @@ s32 sceKernelAioSubmitReadCommands_hook(SceKernelAioRWRequest req[], s32 size, s
         } else {
             req[i].result->state = SCE_KERNEL_AIO_STATE_COMPLETED;
             req[i].result->returnValue = ret;
+            telemetry_add(read_bytes, ret);
 
         }
     }
@@ -221,11 +233,14 @@ s32 sceKernelAioSubmitReadCommands_hook(SceKernelAioRWRequest req[], s32 size, s
 
 s32 sceKernelAioSubmitReadCommandsMultiple_hook(SceKernelAioRWRequest req[], s32 size, s32 prio,
                                                 SceKernelAioSubmitId id[]) {
+    TRACE_SCOPE("sceKernelAioSubmitReadCommandsMultiple");
     for (s32 i = 0; i < size; i++) {
         id_state[id_index] = SCE_KERNEL_AIO_STATE_PROCESSING;
+        const u64 start = sceKernelGetProcessTimeCounter();
 
         s64 ret = sceKernelPread(req[i].fd, req[i].buf, req[i].nbyte, req[i].offset);
 
+        telemetry_observe(read_latency, (sceKernelGetProcessTimeCounter() - start) / ticks_per_us);
         if (ret < 0) {
             req[i].result->state = SCE_KERNEL_AIO_STATE_ABORTED;
             req[i].result->returnValue = ret;
@@ -235,6 +250,7 @@ s32 sceKernelAioSubmitReadCommandsMultiple_hook(SceKernelAioRWRequest req[], s32
         } else {
             req[i].result->state = SCE_KERNEL_AIO_STATE_COMPLETED;
             req[i].result->returnValue = ret;
+            telemetry_add(read_bytes, ret);
 
             id_state[id_index] = SCE_KERNEL_AIO_STATE_COMPLETED;
         }
@@ -251,6 +267,7 @@ s32 sceKernelAioSubmitReadCommandsMultiple_hook(SceKernelAioRWRequest req[], s32
 
 s32 sceKernelAioSubmitWriteCommands_hook(SceKernelAioRWRequest req[], s32 size, s32 prio,
                                          SceKernelAioSubmitId* id) {
+    TRACE_SCOPE("sceKernelAioSubmitWriteCommands");
     for (s32 i = 0; i < size; i++) {
         id_state[id_index] = SCE_KERNEL_AIO_STATE_PROCESSING;
 
@@ -265,6 +282,7 @@ s32 sceKernelAioSubmitWriteCommands_hook(SceKernelAioRWRequest req[], s32 size,
         } else {
             req[i].result->state = SCE_KERNEL_AIO_STATE_COMPLETED;
             req[i].result->returnValue = ret;
+            telemetry_add(write_bytes, ret);
 
             id_state[id_index] = SCE_KERNEL_AIO_STATE_COMPLETED;
         }
@@ -283,6 +301,7 @@ s32 sceKernelAioSubmitWriteCommands_hook(SceKernelAioRWRequest req[], s32 size,
 
 s32 sceKernelAioSubmitWriteCommandsMultiple_hook(SceKernelAioRWRequest req[], s32 size, s32 prio,
                                                  SceKernelAioSubmitId id[]) {
+    TRACE_SCOPE("sceKernelAioSubmitWriteCommandsMultiple");
     for (s32 i = 0; i < size; i++) {
         id_state[id_index] = SCE_KERNEL_AIO_STATE_PROCESSING;
         s64 ret = sceKernelPwrite(req[i].fd, req[i].buf, req[i].nbyte, req[i].offset);
@@ -296,6 +315,7 @@ s32 sceKernelAioSubmitWriteCommandsMultiple_hook(SceKernelAioRWRequest req[], s3
         } else {
             req[i].result->state = SCE_KERNEL_AIO_STATE_COMPLETED;
             req[i].result->returnValue = ret;
+            telemetry_add(write_bytes, ret);
             id_state[id_index] = SCE_KERNEL_AIO_STATE_COMPLETED;
         }
 
@@ -315,6 +335,12 @@ s32 attr_public plugin_load(s32 argc, const char* argv[]) {
     id_index = 1;
     id_state = (int*)malloc(sizeof(int) * MAX_QUEUE);
     memset(id_state, 0, sizeof(sizeof(int) * MAX_QUEUE));
+
+    ticks_per_us = sceKernelGetProcessTimeCounterFrequency() / 1000000;
+    read_latency = telemetry_register(TELEMETRY_HISTOGRAM, g_pluginName, "read_latency_us");
+    read_bytes = telemetry_register(TELEMETRY_COUNTER, g_pluginName, "read_bytes");
+    write_bytes = telemetry_register(TELEMETRY_COUNTER, g_pluginName, "write_bytes");
+    trace_start(g_pluginName);
     int h = 0;
 
     if (sys_dynlib_load_prx("libkernel.sprx", &h))
@@ -368,6 +394,7 @@ s32 attr_public plugin_unload(s32 argc, const char* argv[]) {
     UNHOOK(sceKernelAioSubmitReadCommandsMultiple);
     UNHOOK(sceKernelAioSubmitWriteCommands);
     UNHOOK(sceKernelAioSubmitWriteCommandsMultiple);
+    trace_stop();
     return 0;
 }
 
@@ -0,0 +1,124 @@
+#pragma once
+
+// Frame capture written by frame_logger while recording, one record per flip.
+// The flip hooks only store raw process time counter stamps, `tools/frame_csv' converts
+// a capture to the CSV of frame times frame_logger used to write (CapFrameX format).
+//
+// Completions come from the flip events of the video out handle, which frame_logger
+// waits for on its own thread: a record tells which flip it will be (`flip'), the newest
+// flip of its handle shown when it was submitted (`completed') and when that one was shown
+// (`completed_us'). Flip N was shown at the `completed_us' of the first later record with
+// `completed' == N, there is none when several flips completed between two submits.
+//
+// Usage:
+//     frame_ring_push(&ring, &record);            // flip hooks, one thread at a time
+//     n = frame_ring_peek(&ring, &first);         // drainer, the only consumer
+//     ... ring.record[(first + i) & FRAME_RING_MASK] for i < n ...
+//     frame_ring_consume(&ring, first + n);
+//
+// File format, all fields little endian:
+//     frame_capture_header
+//     frame_record[frames]
+// `frames' and `dropped' are written when the recording stops, a capture cut short by a
+// crash has them 0 and its records run to the end of the file.
+// Version 1 records were 16 bytes, `time' to `flip_mode' without completions or path.
+
+#include <stdint.h>
+
+#define FRAME_CAPTURE_MAGIC   0x54464847 // "GHFT"
+#define FRAME_CAPTURE_VERSION 2
+#define FRAME_RING_RECORDS    4096 // must be power of two
+#define FRAME_RING_MASK       (FRAME_RING_RECORDS - 1)
+
+// Present entry point a flip was submitted through.
+enum {
+    FRAME_PATH_GNM_FLIP,          // sceGnmSubmitAndFlipCommandBuffers
+    FRAME_PATH_GNM_FLIP_WORKLOAD, // sceGnmSubmitAndFlipCommandBuffersForWorkload
+    FRAME_PATH_VIDEO_OUT_FLIP,    // sceVideoOutSubmitFlip
+    FRAME_PATH_COUNT
+};
+
+typedef struct {
+    uint64_t time;         // process time counter when the flip was submitted
+    uint64_t completed_us; // process time in microseconds when flip `completed' was shown
+    uint32_t handle;       // video out handle
+    uint32_t flip;         // flip count of the handle once this flip is shown, 0 if unknown
+    uint32_t completed;    // flips of the handle shown when this one was submitted
+    uint8_t buffer_index;
+    uint8_t flip_mode;
+    uint8_t path;          // FRAME_PATH_*
+    uint8_t reserved;
+} frame_record;
+
+// Why a recording was started.
+enum {
+    FRAME_TRIGGER_NONE,       // by hand
+    FRAME_TRIGGER_FRAME_TIME, // a frame took longer than `trigger_frame_ms'
+    FRAME_TRIGGER_P99,        // the p99 frame time of the recent frames rose over `trigger_p99_ms'
+    FRAME_TRIGGER_HOTKEY,
+    FRAME_TRIGGER_COUNT
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t frequency;    // process time counter ticks per second
+    uint64_t start_time;   // counter when the recording started, before the trigger for triggered ones
+    uint64_t frames;       // records after the header
+    uint64_t dropped;      // flips lost to a full ring or a concurrent flip while recording
+    uint64_t trigger_time; // counter when the trigger fired, 0 for recordings started by hand
+    uint32_t trigger;      // FRAME_TRIGGER_*
+    uint32_t reserved0;
+    uint64_t reserved1;
+} frame_capture_header;
+
+// Single producer, single consumer ring. `head' is only written by the producer,
+// `tail' only by the consumer, each on its own cache line.
+typedef struct {
+    uint64_t head;
+    uint64_t dropped;      // flips the ring had no room for, or that another thread flipped during
+    uint64_t reserved0[6];
+    uint64_t tail;
+    uint64_t reserved1[7];
+    frame_record record[FRAME_RING_RECORDS];
+} __attribute__((aligned(64))) frame_ring;
+
+/**
+ * @brief Counts a flip that did not make it into the ring. Any thread.
+ */
+static inline void frame_ring_drop(frame_ring *ring)
+{
+    __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Appends a record, or counts it as dropped when the consumer fell behind.
+ *        Called by one thread at a time.
+ */
+static inline void frame_ring_push(frame_ring *ring, const frame_record *record)
+{
+    const uint64_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= FRAME_RING_RECORDS) {
+        frame_ring_drop(ring);
+        return;
+    }
+    ring->record[head & FRAME_RING_MASK] = *record;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Returns how many records are ready, starting at `*first'.
+ */
+static inline uint64_t frame_ring_peek(const frame_ring *ring, uint64_t *first)
+{
+    *first = ring->tail;
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - *first;
+}
+
+/**
+ * @brief Hands the records before `tail' back to the producer.
+ */
+static inline void frame_ring_consume(frame_ring *ring, uint64_t tail)
+{
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+}
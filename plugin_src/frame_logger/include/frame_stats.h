@@ -0,0 +1,50 @@
+#pragma once
+
+// Streaming frame time statistics in fixed memory.
+// Frame times go into a log-linear histogram of microseconds, FRAME_STATS_SUB_BITS
+// linear sub-buckets per power of two, so percentiles are exact to about 6 percent.
+// A rolling estimator also keeps its last FRAME_STATS_WINDOW frame times and takes the
+// oldest one back out of the histogram as a new one comes in.
+//
+// Usage:
+//     frame_stats_reset(&stats, true);   // rolling, or false for every frame since the reset
+//     frame_stats_add(&stats, frame_us); // for each frame
+//     frame_stats_summary summary;
+//     frame_stats_get(&stats, &summary);
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FRAME_STATS_SUB_BITS 4
+#define FRAME_STATS_BUCKETS  336  // up to 2^24 us, longer frames share the last bucket
+#define FRAME_STATS_WINDOW   1024 // frames of a rolling estimator, a power of two
+
+typedef struct {
+    uint32_t bucket[FRAME_STATS_BUCKETS];
+    uint64_t frames;    // in the histogram
+    uint64_t total_us;  // sum of their frame times
+    bool rolling;
+    uint64_t added;     // frames ever added, the next one goes to `recent[added % FRAME_STATS_WINDOW]'
+    uint32_t recent[FRAME_STATS_WINDOW];
+} frame_stats;
+
+typedef struct {
+    uint64_t frames;
+    double seconds;     // sum of the frame times
+    double avg_fps;
+    double low_1_fps;   // 1% low, the frame rate of the 99th percentile frame time
+    double low_01_fps;  // 0.1% low, of the 99.9th percentile
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    uint64_t stutters;  // frames longer than twice the median
+} frame_stats_summary;
+
+void frame_stats_reset(frame_stats *stats, bool rolling);
+
+void frame_stats_add(frame_stats *stats, uint32_t frame_us);
+
+/**
+ * @brief Computes the summary of the frames in `stats', all zero without frames.
+ */
+void frame_stats_get(const frame_stats *stats, frame_stats_summary *summary);
@@ -0,0 +1,87 @@
+#include "frame_stats.h"
+#include <string.h>
+
+static uint32_t frame_stats_bucket(uint32_t us)
+{
+    if (us < (1u << FRAME_STATS_SUB_BITS)) {
+        return us;
+    }
+    const uint32_t msb = 31 - __builtin_clz(us);
+    const uint32_t sub = (us >> (msb - FRAME_STATS_SUB_BITS)) & ((1u << FRAME_STATS_SUB_BITS) - 1);
+    const uint32_t bucket = ((msb - FRAME_STATS_SUB_BITS + 1) << FRAME_STATS_SUB_BITS) | sub;
+    return bucket < FRAME_STATS_BUCKETS ? bucket : FRAME_STATS_BUCKETS - 1;
+}
+
+// Middle of the microseconds counted in `bucket'.
+static double frame_stats_bucket_value(uint32_t bucket)
+{
+    if (bucket < (1u << FRAME_STATS_SUB_BITS)) {
+        return bucket;
+    }
+    const uint32_t msb = (bucket >> FRAME_STATS_SUB_BITS) + FRAME_STATS_SUB_BITS - 1;
+    const uint32_t sub = bucket & ((1u << FRAME_STATS_SUB_BITS) - 1);
+    const double width = (double)(1u << (msb - FRAME_STATS_SUB_BITS));
+    return (double)(1u << msb) + sub * width + width / 2;
+}
+
+void frame_stats_reset(frame_stats *stats, bool rolling)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->rolling = rolling;
+}
+
+void frame_stats_add(frame_stats *stats, uint32_t frame_us)
+{
+    if (stats->rolling) {
+        uint32_t *slot = &stats->recent[stats->added & (FRAME_STATS_WINDOW - 1)];
+        if (stats->added >= FRAME_STATS_WINDOW) {
+            stats->bucket[frame_stats_bucket(*slot)]--;
+            stats->total_us -= *slot;
+            stats->frames--;
+        }
+        *slot = frame_us;
+    }
+    stats->bucket[frame_stats_bucket(frame_us)]++;
+    stats->total_us += frame_us;
+    stats->frames++;
+    stats->added++;
+}
+
+// Frame time in microseconds `per_mille' of the frames do not exceed.
+static double frame_stats_percentile(const frame_stats *stats, uint32_t per_mille)
+{
+    const uint64_t target = (stats->frames * per_mille + 999) / 1000;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < FRAME_STATS_BUCKETS; i++) {
+        seen += stats->bucket[i];
+        if (seen >= target && seen) {
+            return frame_stats_bucket_value(i);
+        }
+    }
+    return 0;
+}
+
+void frame_stats_get(const frame_stats *stats, frame_stats_summary *summary)
+{
+    memset(summary, 0, sizeof(*summary));
+    if (!stats->frames || !stats->total_us) {
+        return;
+    }
+    const double p50 = frame_stats_percentile(stats, 500);
+    const double p99 = frame_stats_percentile(stats, 990);
+    const double p999 = frame_stats_percentile(stats, 999);
+    summary->frames = stats->frames;
+    summary->seconds = stats->total_us / 1000000.0;
+    summary->avg_fps = stats->frames / summary->seconds;
+    summary->low_1_fps = p99 > 0 ? 1000000.0 / p99 : 0;
+    summary->low_01_fps = p999 > 0 ? 1000000.0 / p999 : 0;
+    summary->p50_ms = p50 / 1000.0;
+    summary->p95_ms = frame_stats_percentile(stats, 950) / 1000.0;
+    summary->p99_ms = p99 / 1000.0;
+    // Buckets are counted whole, a frame is a stutter when its bucket lies past twice the median.
+    for (uint32_t i = 0; i < FRAME_STATS_BUCKETS; i++) {
+        if (frame_stats_bucket_value(i) > 2 * p50) {
+            summary->stutters += stats->bucket[i];
+        }
+    }
+}
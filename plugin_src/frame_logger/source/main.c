@@ -9,10 +9,21 @@
 #include <orbis/UserService.h>
 #include <orbis/SystemService.h>
 #include <orbis/Sysmodule.h>
+#include <orbis/VideoOut.h>
 #include "plugin_common.h"
+#include "hook_stats.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "config_service.h"
+#include "frame_capture.h"
+#include "frame_stats.h"
 
 #define PLUGIN_NAME "frame_logger"
 #define LOG_FOLDER "/data/" PLUGIN_NAME
+#define SUMMARY_PATH LOG_FOLDER "/summary.csv"
+#define CONFIG_PATH GOLDHEN_PATH "/" PLUGIN_NAME ".ini"
+#define HISTORY_RECORDS 16384 // must be power of two
+#define HISTORY_MASK (HISTORY_RECORDS - 1)
 
 attr_public const char *g_pluginName = PLUGIN_NAME;
 attr_public const char *g_pluginDesc = "Log frametime statistics.";
@@ -20,41 +31,156 @@ attr_public const char *g_pluginAuth = "illusion";
 attr_public u32 g_pluginVersion = 0x00000100; // 1.00
 
 int32_t sceGnmSubmitAndFlipCommandBuffers(uint32_t count, void *dcbGpuAddrs[], uint32_t *dcbSizesInBytes, void *ccbGpuAddrs[], uint32_t *ccbSizesInBytes, uint32_t videoOutHandle, uint32_t displayBufferIndex, uint32_t flipMode, int64_t flipArg);
+int32_t sceGnmSubmitAndFlipCommandBuffersForWorkload(uint64_t workload, uint32_t count, void *dcbGpuAddrs[], uint32_t *dcbSizesInBytes, void *ccbGpuAddrs[], uint32_t *ccbSizesInBytes, uint32_t videoOutHandle, uint32_t displayBufferIndex, uint32_t flipMode, int64_t flipArg);
 
 HOOK_INIT(sceGnmSubmitAndFlipCommandBuffers);
+HOOK_INIT(sceGnmSubmitAndFlipCommandBuffersForWorkload);
+HOOK_INIT(sceVideoOutSubmitFlip);
+HOOK_STATS_INIT(sceGnmSubmitAndFlipCommandBuffers);
+HOOK_STATS_INIT(sceGnmSubmitAndFlipCommandBuffersForWorkload);
+HOOK_STATS_INIT(sceVideoOutSubmitFlip);
 
-FILE *g_LogFILE = NULL;
+// Flips go from the hooks to the input thread through the ring, which writes them to
+// telemetry and the history. The capture file is written from the history, so a triggered
+// recording can start before its trigger (see frame_capture.h).
+frame_ring g_FrameRing;
+frame_record g_History[HISTORY_RECORDS];
+uint64_t g_HistoryHead = 0;    // records ever added
+uint64_t g_HistoryWritten = 0; // first record not written to the capture file yet
+// Trigger rules from CONFIG_PATH, 0 turns a rule off.
+uint64_t g_TriggerFrameUs = 0;
+uint64_t g_TriggerP99Us = 0;
+uint32_t g_TriggerPreS = 10;
+uint32_t g_TriggerPostS = 5;
+uint64_t g_TriggerEnd = 0;     // counter the triggered recording stops at, 0 when started by hand
+bool g_P99Above = false;
+int32_t g_LogFd = -1;
+frame_capture_header g_CaptureHeader;
 bool g_isRecording = false;
 uint64_t g_TimeStart = 0;
-uint64_t g_CurrentDelta = 0;
-double g_TscTick = 0;
-bool g_GnmHook = false;
+uint64_t g_LastFlip = 0;
+uint64_t g_DroppedAtStart = 0;
+uint64_t g_LastRecorded = 0;
+char g_LogFilePath[MAX_PATH_] = {0};
+// Live numbers over the last FRAME_STATS_WINDOW frames and over the running recording,
+// only touched by the input thread.
+frame_stats g_RecentStats;
+frame_stats g_RecordingStats;
+bool g_FlipHook = false;
+// Video out handle of the first flip, the flip thread reports its completions.
+uint32_t g_FlipHandle = 0;
+// Flips the hooks saw, a record carries the count including itself in `flip' until the
+// drainer adds g_FlipOffset, which the flip thread sets once it lined the count up with
+// the video out flip count. Games flip a single handle, other handles get no flip number.
+uint64_t g_FlipsSubmitted = 0;
+int64_t g_FlipOffset = 0;
+bool g_FlipCalibrated = false;
+// Flips of g_FlipHandle that were shown, from the flip thread to the drainer. Only
+// `handle', `completed' and `completed_us' are set.
+frame_ring g_CompletionRing;
+frame_record g_Completion; // newest completion the drainer took from the ring
+OrbisPthread g_FlipThread = NULL;
+// Thread inside a flip hook. A present entry point may be built on another one, only the
+// outermost call records the flip. Only the owner pushes, which keeps the ring single
+// producer; a flip on a second thread while the owner presents is counted as dropped.
+uint64_t g_FlipOwner = 0;
 bool g_RunningThread = false;
+uint64_t g_TicksPerUs = 1;
+telemetry_slot *g_FrameTimeSlot = NULL;
+telemetry_slot *g_FrameCountSlot = NULL;
 
-void doStats(void)
+// Returns true when the calling thread records the flip, it then calls endFlip once the
+// flip was submitted.
+bool beginFlip(void)
 {
-    if (!g_GnmHook)
+    const uint64_t self = (uint64_t)(uintptr_t)scePthreadSelf();
+    uint64_t owner = 0;
+    if (__atomic_compare_exchange_n(&g_FlipOwner, &owner, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
     {
-        return;
+        return true;
     }
-    uint64_t current_time = sceKernelGetProcessTimeCounter();
-    if (g_isRecording && g_LogFILE)
+    if (owner != self)
     {
-        fprintf(g_LogFILE, "%lf,%lf\n", ((current_time - g_TimeStart) / g_TscTick), ((current_time - g_CurrentDelta) / g_TscTick));
+        __atomic_add_fetch(&g_FlipsSubmitted, 1, __ATOMIC_RELAXED);
+        frame_ring_drop(&g_FrameRing);
     }
-    g_CurrentDelta = current_time;
+    return false;
+}
+
+void endFlip(void)
+{
+    __atomic_store_n(&g_FlipOwner, 0, __ATOMIC_RELEASE);
+}
+
+// Runs on the render thread, everything else is left to drainFrames and the flip thread.
+void doStats(uint8_t path, uint32_t videoOutHandle, uint32_t displayBufferIndex, uint32_t flipMode)
+{
+    if (!g_FlipHook)
+    {
+        g_FlipHandle = videoOutHandle;
+        __atomic_store_n(&g_FlipHook, true, __ATOMIC_RELEASE);
+    }
+    const uint32_t flip = (uint32_t)__atomic_add_fetch(&g_FlipsSubmitted, 1, __ATOMIC_RELAXED);
+    frame_record record = { sceKernelGetProcessTimeCounter(), 0, videoOutHandle, flip, 0, (uint8_t)displayBufferIndex, (uint8_t)flipMode, path, 0 };
+    frame_ring_push(&g_FrameRing, &record);
+    TRACE_INSTANT("flip", displayBufferIndex);
 }
 
 int32_t sceGnmSubmitAndFlipCommandBuffers_hook(uint32_t count, void *dcbGpuAddrs[], uint32_t *dcbSizesInBytes, void *ccbGpuAddrs[], uint32_t *ccbSizesInBytes, uint32_t videoOutHandle, uint32_t displayBufferIndex, uint32_t flipMode, int64_t flipArg)
 {
-    if (!g_GnmHook)
+    HOOK_STATS_SCOPE(sceGnmSubmitAndFlipCommandBuffers);
+    TRACE_SCOPE("sceGnmSubmitAndFlipCommandBuffers");
+    const bool outer = beginFlip();
+    if (outer)
+    {
+        doStats(FRAME_PATH_GNM_FLIP, videoOutHandle, displayBufferIndex, flipMode);
+    }
+    const int32_t ret = HOOK_CONTINUE(sceGnmSubmitAndFlipCommandBuffers,
+                                      int32_t(*)(uint32_t, void **, uint32_t *, void **, uint32_t *, uint32_t, uint32_t, uint32_t, int64_t),
+                                      count, dcbGpuAddrs, dcbSizesInBytes, ccbGpuAddrs, ccbSizesInBytes, videoOutHandle, displayBufferIndex, flipMode, flipArg);
+    if (outer)
+    {
+        endFlip();
+    }
+    return ret;
+}
+
+int32_t sceGnmSubmitAndFlipCommandBuffersForWorkload_hook(uint64_t workload, uint32_t count, void *dcbGpuAddrs[], uint32_t *dcbSizesInBytes, void *ccbGpuAddrs[], uint32_t *ccbSizesInBytes, uint32_t videoOutHandle, uint32_t displayBufferIndex, uint32_t flipMode, int64_t flipArg)
+{
+    HOOK_STATS_SCOPE(sceGnmSubmitAndFlipCommandBuffersForWorkload);
+    TRACE_SCOPE("sceGnmSubmitAndFlipCommandBuffersForWorkload");
+    const bool outer = beginFlip();
+    if (outer)
+    {
+        doStats(FRAME_PATH_GNM_FLIP_WORKLOAD, videoOutHandle, displayBufferIndex, flipMode);
+    }
+    const int32_t ret = HOOK_CONTINUE(sceGnmSubmitAndFlipCommandBuffersForWorkload,
+                                      int32_t(*)(uint64_t, uint32_t, void **, uint32_t *, void **, uint32_t *, uint32_t, uint32_t, uint32_t, int64_t),
+                                      workload, count, dcbGpuAddrs, dcbSizesInBytes, ccbGpuAddrs, ccbSizesInBytes, videoOutHandle, displayBufferIndex, flipMode, flipArg);
+    if (outer)
+    {
+        endFlip();
+    }
+    return ret;
+}
+
+int32_t sceVideoOutSubmitFlip_hook(int32_t handle, int32_t indexBuffer, int32_t flipMode, int64_t flipArg)
+{
+    HOOK_STATS_SCOPE(sceVideoOutSubmitFlip);
+    TRACE_SCOPE("sceVideoOutSubmitFlip");
+    const bool outer = beginFlip();
+    if (outer)
+    {
+        doStats(FRAME_PATH_VIDEO_OUT_FLIP, (uint32_t)handle, (uint32_t)indexBuffer, (uint32_t)flipMode);
+    }
+    const int32_t ret = HOOK_CONTINUE(sceVideoOutSubmitFlip,
+                                      int32_t(*)(int32_t, int32_t, int32_t, int64_t),
+                                      handle, indexBuffer, flipMode, flipArg);
+    if (outer)
     {
-        g_GnmHook = true;
+        endFlip();
     }
-    doStats();
-    return HOOK_CONTINUE(sceGnmSubmitAndFlipCommandBuffers,
-                         int32_t(*)(uint32_t, void **, uint32_t *, void **, uint32_t *, uint32_t, uint32_t, uint32_t, int64_t),
-                         count, dcbGpuAddrs, dcbSizesInBytes, ccbGpuAddrs, ccbSizesInBytes, videoOutHandle, displayBufferIndex, flipMode, flipArg);
+    return ret;
 }
 
 struct tm get_local_time(void)
@@ -81,48 +207,274 @@ struct tm get_local_time(void)
     return (*gmtime(&modifiedTime));
 }
 
-void toggleRecording(void)
+// Appends history records `from' to `to' to the capture file and the recording statistics.
+void writeFrames(uint64_t from, uint64_t to)
 {
-    g_isRecording = !g_isRecording;
-    if (!g_GnmHook)
+    for (uint64_t i = from; i < to; i++)
     {
-        NotifyStatic(TEX_ICON_SYSTEM, "g_GnmHook is false! cannot start data capture\nPlugin (" PLUGIN_NAME ") will now quit.");
-        g_isRecording = false;
-        g_RunningThread = false;
-        return;
+        // Like frame_csv, the first frame of a recording is measured from its start.
+        const uint64_t time = g_History[i & HISTORY_MASK].time;
+        const uint64_t frame_us = (time - g_LastRecorded) / g_TicksPerUs;
+        frame_stats_add(&g_RecordingStats, frame_us < UINT32_MAX ? (uint32_t)frame_us : UINT32_MAX);
+        g_LastRecorded = time;
     }
-    if (g_isRecording)
+    while (from < to)
     {
-        sceKernelMkdir(LOG_FOLDER "/", 0777);
-        char LogFilePath[MAX_PATH_] = {0};
-        g_LogFILE = NULL;
-        struct tm t = get_local_time();
-        snprintf(LogFilePath, sizeof(LogFilePath), LOG_FOLDER "/" PLUGIN_NAME "-data-%d-%02d-%02d_%02d-%02d-%02d.csv", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
-        g_LogFILE = fopen(LogFilePath, "w");
-        if (g_LogFILE)
+        const uint64_t index = from & HISTORY_MASK;
+        const uint64_t count = to - from < HISTORY_RECORDS - index ? to - from : HISTORY_RECORDS - index;
+        const ssize_t size = (ssize_t)(count * sizeof(frame_record));
+        const ssize_t ret = sceKernelWrite(g_LogFd, &g_History[index], (size_t)size);
+        if (ret != size)
         {
-            g_TscTick = (double)sceKernelGetProcessTimeCounterFrequency();
-            g_TimeStart = sceKernelGetProcessTimeCounter();
-            g_CurrentDelta = g_TimeStart;
-            Notify(TEX_ICON_SYSTEM, "Recording start:\n%s", LogFilePath);
-            fputs("//Ignore=true\n"
-                  "TimeInSeconds,msBetweenPresents\n",
-                  g_LogFILE);
+            final_printf("sceKernelWrite: 0x%08x\n", (int32_t)ret);
+            return;
         }
-        else
+        g_CaptureHeader.frames += count;
+        from += count;
+    }
+}
+
+// First history record at or after counter `time', or the oldest one the history still has.
+uint64_t findHistory(uint64_t time)
+{
+    uint64_t first = g_HistoryHead > HISTORY_RECORDS ? g_HistoryHead - HISTORY_RECORDS : 0;
+    while (first < g_HistoryHead && g_History[first & HISTORY_MASK].time < time)
+    {
+        first++;
+    }
+    return first;
+}
+
+// Appends a row with the summary of the stopped recording to SUMMARY_PATH.
+void writeSummary(void)
+{
+    frame_stats_summary summary;
+    frame_stats_get(&g_RecordingStats, &summary);
+    const int32_t fd = sceKernelOpen(SUMMARY_PATH, 0x0001 | 0x0008 | 0x0200, 0777); // O_WRONLY | O_APPEND | O_CREAT
+    if (fd < 0)
+    {
+        final_printf("sceKernelOpen(" SUMMARY_PATH "): 0x%08x\n", fd);
+        return;
+    }
+    char row[MAX_PATH_ + 256] = {0};
+    struct stat st;
+    if (sceKernelFstat(fd, &st) == 0 && st.st_size == 0)
+    {
+        static const char header[] = "file,seconds,frames,dropped,avg_fps,low_1_fps,low_01_fps,p50_ms,p95_ms,p99_ms,stutters\n";
+        sceKernelWrite(fd, header, sizeof(header) - 1);
+    }
+    const int len = snprintf(row, sizeof(row), "%s,%.3f,%lu,%lu,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%lu\n", g_LogFilePath,
+                             summary.seconds, (unsigned long)summary.frames, (unsigned long)g_CaptureHeader.dropped,
+                             summary.avg_fps, summary.low_1_fps, summary.low_01_fps, summary.p50_ms, summary.p95_ms,
+                             summary.p99_ms, (unsigned long)summary.stutters);
+    if (len > 0 && (size_t)len < sizeof(row))
+    {
+        sceKernelWrite(fd, row, (size_t)len);
+    }
+    sceKernelClose(fd);
+}
+
+// Opens a capture file of the flips from counter `start' on.
+bool startRecording(uint64_t start, uint32_t trigger, uint64_t trigger_time)
+{
+    sceKernelMkdir(LOG_FOLDER "/", 0777);
+    struct tm t = get_local_time();
+    snprintf(g_LogFilePath, sizeof(g_LogFilePath), LOG_FOLDER "/" PLUGIN_NAME "-%s-%d-%02d-%02d_%02d-%02d-%02d.frames", trigger ? "trigger" : "data", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
+    g_LogFd = sceKernelOpen(g_LogFilePath, 0x0001 | 0x0200 | 0x0400, 0777); // O_WRONLY | O_CREAT | O_TRUNC
+    memset(&g_CaptureHeader, 0, sizeof(g_CaptureHeader));
+    g_CaptureHeader.magic = FRAME_CAPTURE_MAGIC;
+    g_CaptureHeader.version = FRAME_CAPTURE_VERSION;
+    g_CaptureHeader.frequency = sceKernelGetProcessTimeCounterFrequency();
+    g_CaptureHeader.start_time = start;
+    g_CaptureHeader.trigger_time = trigger_time;
+    g_CaptureHeader.trigger = trigger;
+    if (g_LogFd < 0 || sceKernelWrite(g_LogFd, &g_CaptureHeader, sizeof(g_CaptureHeader)) != sizeof(g_CaptureHeader))
+    {
+        Notify(TEX_ICON_SYSTEM, "Failed to create:\n%s", g_LogFilePath);
+        if (g_LogFd >= 0)
         {
-            Notify(TEX_ICON_SYSTEM, "Failed to create:\n%s", LogFilePath);
-            g_isRecording = false;
+            sceKernelClose(g_LogFd);
+            g_LogFd = -1;
         }
+        return false;
+    }
+    g_TimeStart = start;
+    g_LastRecorded = start;
+    g_HistoryWritten = findHistory(start);
+    g_DroppedAtStart = __atomic_load_n(&g_FrameRing.dropped, __ATOMIC_RELAXED);
+    frame_stats_reset(&g_RecordingStats, false);
+    g_isRecording = true;
+    return true;
+}
+
+void stopRecording(void)
+{
+    g_CaptureHeader.dropped = __atomic_load_n(&g_FrameRing.dropped, __ATOMIC_RELAXED) - g_DroppedAtStart;
+    sceKernelPwrite(g_LogFd, &g_CaptureHeader, sizeof(g_CaptureHeader), 0);
+    sceKernelClose(g_LogFd);
+    g_LogFd = -1;
+    g_isRecording = false;
+    writeSummary();
+    if (g_TriggerEnd)
+    {
+        g_TriggerEnd = 0;
+        Notify(TEX_ICON_SYSTEM, "Capture saved:\n%s", g_LogFilePath);
     }
     else
     {
-        fflush(g_LogFILE);
-        fclose(g_LogFILE);
         NotifyStatic(TEX_ICON_SYSTEM, "Recording stop");
     }
 }
 
+// Starts a recording reaching g_TriggerPreS seconds before counter `time' and stopping
+// g_TriggerPostS seconds after it, unless one is running already.
+void triggerRecording(uint32_t trigger, uint64_t time)
+{
+    static const char *const names[FRAME_TRIGGER_COUNT] = { "", "frame time", "p99 frame time", "hotkey" };
+    if (g_isRecording)
+    {
+        return;
+    }
+    const uint64_t frequency = sceKernelGetProcessTimeCounterFrequency();
+    const uint64_t before = g_TriggerPreS * frequency;
+    uint64_t start = time > before ? time - before : 0;
+    // the history may not reach back that far
+    const uint64_t oldest = g_HistoryHead > HISTORY_RECORDS ? g_HistoryHead - HISTORY_RECORDS : 0;
+    if (oldest < g_HistoryHead && g_History[oldest & HISTORY_MASK].time > start)
+    {
+        start = g_History[oldest & HISTORY_MASK].time;
+    }
+    if (startRecording(start, trigger, time))
+    {
+        g_TriggerEnd = time + g_TriggerPostS * frequency;
+        Notify(TEX_ICON_SYSTEM, "Trigger (%s), capturing %u s before and %u s after:\n%s", names[trigger],
+               (uint32_t)((time - start) / frequency), g_TriggerPostS, g_LogFilePath);
+    }
+}
+
+// Moves the flips the hooks recorded to telemetry and the history, checks the triggers and
+// while recording writes them to the capture file. Only called from the input thread.
+void drainFrames(void)
+{
+    uint64_t first = 0;
+    const uint64_t count = frame_ring_peek(&g_FrameRing, &first);
+    const uint64_t end = first + count;
+    uint32_t trigger = FRAME_TRIGGER_NONE;
+    uint64_t trigger_time = 0;
+    uint64_t completion = 0;
+    const uint64_t completions = frame_ring_peek(&g_CompletionRing, &completion);
+    const uint64_t completionEnd = completion + completions;
+    const bool calibrated = __atomic_load_n(&g_FlipCalibrated, __ATOMIC_ACQUIRE);
+    for (uint64_t i = first; i < end; i++)
+    {
+        frame_record record = g_FrameRing.record[i & FRAME_RING_MASK];
+        // the newest flip that was shown when this one was submitted
+        while (completion < completionEnd && g_CompletionRing.record[completion & FRAME_RING_MASK].completed_us < record.time / g_TicksPerUs)
+        {
+            g_Completion = g_CompletionRing.record[completion++ & FRAME_RING_MASK];
+        }
+        if (record.handle == g_Completion.handle)
+        {
+            record.completed = g_Completion.completed;
+            record.completed_us = g_Completion.completed_us;
+        }
+        record.flip = calibrated && record.handle == g_FlipHandle ? (uint32_t)(record.flip + g_FlipOffset) : 0;
+        if (g_LastFlip)
+        {
+            const uint64_t frame_us = (record.time - g_LastFlip) / g_TicksPerUs;
+            telemetry_observe(g_FrameTimeSlot, frame_us);
+            telemetry_add(g_FrameCountSlot, 1);
+            frame_stats_add(&g_RecentStats, frame_us < UINT32_MAX ? (uint32_t)frame_us : UINT32_MAX);
+            if (g_TriggerFrameUs && frame_us > g_TriggerFrameUs && !trigger)
+            {
+                trigger = FRAME_TRIGGER_FRAME_TIME;
+                trigger_time = record.time;
+            }
+        }
+        g_LastFlip = record.time;
+        g_History[g_HistoryHead++ & HISTORY_MASK] = record;
+    }
+    frame_ring_consume(&g_FrameRing, end);
+    frame_ring_consume(&g_CompletionRing, completion);
+    // Fires when the p99 of the recent frames rises over the limit, not again until it fell below.
+    if (g_TriggerP99Us && count && g_RecentStats.frames >= FRAME_STATS_WINDOW / 4)
+    {
+        frame_stats_summary summary;
+        frame_stats_get(&g_RecentStats, &summary);
+        const bool above = summary.p99_ms * 1000 > g_TriggerP99Us;
+        if (above && !g_P99Above && !trigger)
+        {
+            trigger = FRAME_TRIGGER_P99;
+            trigger_time = g_LastFlip;
+        }
+        g_P99Above = above;
+    }
+    if (trigger)
+    {
+        triggerRecording(trigger, trigger_time);
+    }
+    if (!g_isRecording || g_LogFd < 0)
+    {
+        return;
+    }
+    // flips submitted while the recording was being started belong before it
+    while (g_HistoryWritten < g_HistoryHead && g_History[g_HistoryWritten & HISTORY_MASK].time < g_TimeStart)
+    {
+        g_HistoryWritten++;
+    }
+    uint64_t to = g_HistoryHead;
+    if (g_TriggerEnd)
+    {
+        to = g_HistoryWritten;
+        while (to < g_HistoryHead && g_History[to & HISTORY_MASK].time <= g_TriggerEnd)
+        {
+            to++;
+        }
+    }
+    writeFrames(g_HistoryWritten, to);
+    g_HistoryWritten = to;
+    if (g_TriggerEnd && (to < g_HistoryHead || sceKernelGetProcessTimeCounter() > g_TriggerEnd))
+    {
+        stopRecording();
+    }
+}
+
+void showStats(void)
+{
+    drainFrames();
+    frame_stats_summary summary;
+    frame_stats_get(g_isRecording ? &g_RecordingStats : &g_RecentStats, &summary);
+    if (!summary.frames)
+    {
+        NotifyStatic(TEX_ICON_SYSTEM, "No frames yet");
+        return;
+    }
+    Notify(TEX_ICON_SYSTEM, "%s, %lu frames\nAvg %.1f FPS, 1%% low %.1f, 0.1%% low %.1f\np50 %.2f ms, p95 %.2f ms, p99 %.2f ms\nStutters (> 2x median): %lu",
+           g_isRecording ? "Recording" : "Recent", (unsigned long)summary.frames, summary.avg_fps, summary.low_1_fps,
+           summary.low_01_fps, summary.p50_ms, summary.p95_ms, summary.p99_ms, (unsigned long)summary.stutters);
+}
+
+void toggleRecording(void)
+{
+    if (!g_FlipHook)
+    {
+        NotifyStatic(TEX_ICON_SYSTEM, "No flip seen yet! cannot start data capture\nPlugin (" PLUGIN_NAME ") will now quit.");
+        g_isRecording = false;
+        g_RunningThread = false;
+        return;
+    }
+    // Flips so far belong to the recording being stopped, or only go to the history.
+    drainFrames();
+    if (g_isRecording)
+    {
+        stopRecording();
+    }
+    else if (startRecording(sceKernelGetProcessTimeCounter(), FRAME_TRIGGER_NONE, 0))
+    {
+        Notify(TEX_ICON_SYSTEM, "Recording start:\n%s", g_LogFilePath);
+    }
+}
+
 bool checkRecordingButton(OrbisPadData *pData)
 {
     return (pData->buttons & ORBIS_PAD_BUTTON_L3) &&
@@ -130,6 +482,20 @@ bool checkRecordingButton(OrbisPadData *pData)
            (pData->buttons & ORBIS_PAD_BUTTON_TRIANGLE);
 }
 
+bool checkStatsButton(OrbisPadData *pData)
+{
+    return (pData->buttons & ORBIS_PAD_BUTTON_L3) &&
+           (pData->buttons & ORBIS_PAD_BUTTON_L1) &&
+           (pData->buttons & ORBIS_PAD_BUTTON_CIRCLE);
+}
+
+bool checkTriggerButton(OrbisPadData *pData)
+{
+    return (pData->buttons & ORBIS_PAD_BUTTON_L3) &&
+           (pData->buttons & ORBIS_PAD_BUTTON_L1) &&
+           (pData->buttons & ORBIS_PAD_BUTTON_CROSS);
+}
+
 bool checkKillButton(OrbisPadData *pData)
 {
     return (pData->buttons & ORBIS_PAD_BUTTON_L3) &&
@@ -166,6 +532,8 @@ void *frame_logger_input_thread(void *args)
     sleep(10);
     int32_t ret = 0;
     bool prevTogglePressed = false;
+    bool prevStatsPressed = false;
+    bool prevTriggerPressed = false;
     if ((ret = scePadInit() < 0))
     {
         NotifyStatic(TEX_ICON_SYSTEM, "Failed to init pad");
@@ -186,6 +554,19 @@ void *frame_logger_input_thread(void *args)
                 toggleRecording();
             }
             prevTogglePressed = currentTogglePressed;
+            bool currentStatsPressed = checkStatsButton(&pData);
+            if (currentStatsPressed && !prevStatsPressed)
+            {
+                showStats();
+            }
+            prevStatsPressed = currentStatsPressed;
+            bool currentTriggerPressed = checkTriggerButton(&pData);
+            if (currentTriggerPressed && !prevTriggerPressed)
+            {
+                drainFrames();
+                triggerRecording(FRAME_TRIGGER_HOTKEY, sceKernelGetProcessTimeCounter());
+            }
+            prevTriggerPressed = currentTriggerPressed;
             if (checkKillButton(&pData))
             {
                 NotifyStatic(TEX_ICON_SYSTEM, "User requested exit for Plugin (" PLUGIN_NAME ")");
@@ -198,18 +579,79 @@ void *frame_logger_input_thread(void *args)
             final_printf(STRINGIFY(ret)": 0x%08x\n", ret);
             final_printf(STRINGIFY(pData.connected)": 0x%02x (%s)\n", pData.connected, pData.connected ? "true" : "false");
         }
-        // periodically flush the stream every second to avoid data loss
-        if (g_LogFILE)
+        // write the flips of the last second in one batch, a crash loses at most that much
+        drainFrames();
+        sleep(1);
+    }
+    if (g_isRecording)
+    {
+        toggleRecording();
+    }
+    final_printf("%s: Exit\n", __func__);
+    scePthreadExit(NULL);
+    return NULL;
+}
+
+// Waits for the flips of g_FlipHandle to be shown and passes their completions to the
+// drainer, which keeps the flip status reads off the render thread.
+void *frame_logger_flip_thread(void *args)
+{
+    final_printf("%s: Started\n", __func__);
+    OrbisKernelEqueue queue = NULL;
+    int32_t ret = sceKernelCreateEqueue(&queue, PLUGIN_NAME "_flip");
+    if (ret < 0)
+    {
+        final_printf("sceKernelCreateEqueue: 0x%08x\n", ret);
+        scePthreadExit(NULL);
+        return NULL;
+    }
+    bool added = false;
+    uint64_t shown = 0;
+    while (g_RunningThread)
+    {
+        if (!added)
+        {
+            if (!__atomic_load_n(&g_FlipHook, __ATOMIC_ACQUIRE))
+            {
+                sceKernelUsleep(100000);
+                continue;
+            }
+            if ((ret = sceVideoOutAddFlipEvent(queue, (int32_t)g_FlipHandle, NULL)) < 0)
+            {
+                final_printf("sceVideoOutAddFlipEvent: 0x%08x\n", ret);
+                break;
+            }
+            added = true;
+        }
+        OrbisKernelEvent event;
+        int32_t events = 0;
+        OrbisKernelUseconds timeout = 100000; // to notice g_RunningThread
+        if (sceKernelWaitEqueue(queue, &event, 1, &events, &timeout) < 0 || !events)
         {
-#if (__FINAL__) == 0
-            int32_t flush_ret = fflush(g_LogFILE);
-            debug_printf("fflush: 0x%08x\n", flush_ret);
-#else
-            fflush(g_LogFILE);
-#endif
+            continue;
         }
-        sleep(1);
+        // No flip may start or finish between the reads that line the counts up.
+        const uint64_t submitted = __atomic_load_n(&g_FlipsSubmitted, __ATOMIC_ACQUIRE);
+        const bool idle = !__atomic_load_n(&g_FlipOwner, __ATOMIC_ACQUIRE);
+        OrbisVideoOutFlipStatus status;
+        if (sceVideoOutGetFlipStatus((int32_t)g_FlipHandle, &status) != 0 || status.count == shown)
+        {
+            continue;
+        }
+        shown = status.count;
+        if (!g_FlipCalibrated && idle && !__atomic_load_n(&g_FlipOwner, __ATOMIC_ACQUIRE) &&
+            submitted == __atomic_load_n(&g_FlipsSubmitted, __ATOMIC_ACQUIRE))
+        {
+            g_FlipOffset = (int64_t)(status.count + status.flipPendingNum - submitted);
+            __atomic_store_n(&g_FlipCalibrated, true, __ATOMIC_RELEASE);
+        }
+        frame_record completion = { 0 };
+        completion.handle = g_FlipHandle;
+        completion.completed = (uint32_t)status.count;
+        completion.completed_us = status.processTime;
+        frame_ring_push(&g_CompletionRing, &completion);
     }
+    sceKernelDeleteEqueue(queue);
     final_printf("%s: Exit\n", __func__);
     scePthreadExit(NULL);
     return NULL;
@@ -220,14 +662,41 @@ s32 attr_public plugin_load(s32 argc, const char *argv[])
     final_printf("[GoldHEN] <%s\\Ver.0x%08x> %s\n", g_pluginName, g_pluginVersion, __func__);
     final_printf("[GoldHEN] Plugin Author(s): %s\n", g_pluginAuth);
     boot_ver();
-    g_GnmHook = false;
+    g_FlipHook = false;
     g_RunningThread = true;
-    g_TimeStart = sceKernelGetProcessTimeCounter();
-    g_TscTick = (double)sceKernelGetProcessTimeCounterFrequency();
+    g_TicksPerUs = sceKernelGetProcessTimeCounterFrequency() / 1000000;
+    g_FrameTimeSlot = telemetry_register(TELEMETRY_HISTOGRAM, PLUGIN_NAME, "frame_time_us");
+    g_FrameCountSlot = telemetry_register(TELEMETRY_COUNTER, PLUGIN_NAME, "frames");
+    frame_stats_reset(&g_RecentStats, true);
+    frame_stats_reset(&g_RecordingStats, false);
+    const config_view *view = config_service_get_view(CONFIG_PATH);
+    int value = 0;
+    if (config_view_get_int(view, "trigger_frame_ms", &value) && value > 0)
+    {
+        g_TriggerFrameUs = (uint64_t)value * 1000;
+    }
+    if (config_view_get_int(view, "trigger_p99_ms", &value) && value > 0)
+    {
+        g_TriggerP99Us = (uint64_t)value * 1000;
+    }
+    if (config_view_get_int(view, "trigger_pre_s", &value) && value >= 0)
+    {
+        g_TriggerPreS = (uint32_t)value;
+    }
+    if (config_view_get_int(view, "trigger_post_s", &value) && value >= 0)
+    {
+        g_TriggerPostS = (uint32_t)value;
+    }
+    final_printf("Triggers: frame time > %lu us, p99 > %lu us, %u s before, %u s after\n", g_TriggerFrameUs, g_TriggerP99Us, g_TriggerPreS, g_TriggerPostS);
 
     OrbisPthread thread;
     scePthreadCreate(&thread, NULL, frame_logger_input_thread, NULL, STRINGIFY(frame_logger_input_thread));
+    scePthreadCreate(&g_FlipThread, NULL, frame_logger_flip_thread, NULL, STRINGIFY(frame_logger_flip_thread));
+    hook_stats_start(g_pluginName, 5000);
+    trace_start(g_pluginName);
     HOOK32(sceGnmSubmitAndFlipCommandBuffers);
+    HOOK32(sceGnmSubmitAndFlipCommandBuffersForWorkload);
+    HOOK32(sceVideoOutSubmitFlip);
     return 0;
 }
 
@@ -235,6 +704,13 @@ s32 attr_public plugin_unload(s32 argc, const char *argv[])
 {
     final_printf("[GoldHEN] <%s\\Ver.0x%08x> %s\n", g_pluginName, g_pluginVersion, __func__);
     UNHOOK(sceGnmSubmitAndFlipCommandBuffers);
+    UNHOOK(sceGnmSubmitAndFlipCommandBuffersForWorkload);
+    UNHOOK(sceVideoOutSubmitFlip);
+    g_RunningThread = false;
+    scePthreadJoin(g_FlipThread, NULL);
+    hook_stats_stop();
+    trace_stop();
+    NotifyShutdown();
     return 0;
 }
 
@@ -1,5 +1,6 @@
 #include <Common.h>
 #include "plugin_common.h"
+#include "plugin_heap.h"
 #include <stdbool.h>
 
 unsigned char *hexstrtochar2(const char *hexstr, s64 *size);
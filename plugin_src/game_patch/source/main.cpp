@@ -66,7 +66,7 @@ void get_key_init(void)
         if (!tree)
         {
             final_printf("XML: could not parse XML:\n%s\n", patch_buffer);
-            free(patch_buffer);
+            plugin_heap_free(patch_buffer);
             return;
         }
 
@@ -210,13 +210,13 @@ void get_key_init(void)
             }
             if (settings_buffer)
             {
-                free(settings_buffer);
+                plugin_heap_free(settings_buffer);
             }
         }
 
         mxmlDelete(node);
         mxmlDelete(tree);
-        free(patch_buffer);
+        plugin_heap_free(patch_buffer);
 
         if (patch_items > 0 && patch_lines > 0)
         {
@@ -255,6 +255,8 @@ s32 attr_public plugin_load(s32 argc, const char* argv[]) {
     final_printf("[GoldHEN] <%s\\Ver.0x%08x> %s\n", g_pluginName, g_pluginVersion, __func__);
     final_printf("[GoldHEN] Plugin Author(s): %s\n", g_pluginAuth);
     boot_ver();
+    // Patch and settings files, freed once the patches are applied.
+    plugin_heap_init(g_pluginName, 64 * 1024, 0);
     proc_info procInfo{};
     OrbisKernelModuleInfo CurrentModuleInfo{};
     CurrentModuleInfo.size = sizeof(OrbisKernelModuleInfo);
@@ -280,6 +282,8 @@ s32 attr_public plugin_load(s32 argc, const char* argv[]) {
 
 s32 attr_public plugin_unload(s32 argc, const char* argv[]) {
     final_printf("[GoldHEN] <%s\\Ver.0x%08x> %s\n", g_pluginName, g_pluginVersion, __func__);
+    NotifyShutdown();
+    plugin_heap_shutdown();
     return 0;
 }
 
@@ -3,7 +3,7 @@
 char *unescape(const char *s)
 {
     s64 len = strlen(s);
-    char *unescaped_str = (char *)malloc(len + 1);
+    char *unescaped_str = (char *)plugin_heap_alloc(len + 1);
     if (!unescaped_str)
     {
         return nullptr;
@@ -95,7 +95,7 @@ u8 *hexstrtochar2(const char *hexstr, s64 *size)
     {
         return nullptr;
     }
-    u8 *data = (u8 *)malloc(*size);
+    u8 *data = (u8 *)plugin_heap_alloc(*size);
     if (!data)
     {
         return nullptr;
@@ -243,7 +243,7 @@ void patch_data1(const char *patch_type_str, u64 addr, const char *value, uint32
             break;
         }
         sys_proc_rw(addr, bytearray, bytearray_size);
-        free(bytearray);
+        plugin_heap_free(bytearray);
         break;
     }
     case djb2_hash("float32"):
@@ -272,7 +272,7 @@ void patch_data1(const char *patch_type_str, u64 addr, const char *value, uint32
         }
         u64 char_len = strlen(new_str);
         sys_proc_rw(addr, (void *)new_str, char_len + 1); // get null
-        free(new_str);
+        plugin_heap_free(new_str);
         break;
     }
     case djb2_hash("utf16"):
@@ -292,7 +292,7 @@ void patch_data1(const char *patch_type_str, u64 addr, const char *value, uint32
         }
         u8 value_[2] = {0x00, 0x00};
         sys_proc_rw(addr, value_, sizeof(value_));
-        free(new_str);
+        plugin_heap_free(new_str);
         break;
     }
     case djb2_hash("mask_jump32"):
@@ -326,7 +326,7 @@ void patch_data1(const char *patch_type_str, u64 addr, const char *value, uint32
         sys_proc_rw(addr + 1, &target_jmp, sizeof(target_jmp));
         sys_proc_rw(jump_target + bytearray_size, jump_32, sizeof(jump_32));
         sys_proc_rw(code_cave_end + 1, &target_return, sizeof(target_return));
-        free(bytearray);
+        plugin_heap_free(bytearray);
         break;
     }
     case djb2_hash("patchCall"):
@@ -348,7 +348,7 @@ void patch_data1(const char *patch_type_str, u64 addr, const char *value, uint32
                     break;
                 }
                 sys_proc_rw(branched_call, bytearray, bytearray_size);
-                free(bytearray);
+                plugin_heap_free(bytearray);
             }
         }
         break;
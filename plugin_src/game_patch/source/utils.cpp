@@ -26,9 +26,9 @@ s32 Read_File(const char *input_file, char **file_data, u64 *filesize, u32 extra
         goto term;
     }
 
-    *file_data = (char *)malloc(*filesize + extra);
+    *file_data = (char *)plugin_heap_alloc(*filesize + extra);
     if (*file_data == NULL) {
-        debug_printf("ERROR: malloc()\n");
+        debug_printf("ERROR: plugin_heap_alloc()\n");
         goto term;
     }
 
@@ -67,11 +67,11 @@ s32 Write_File(const char *input_file, unsigned char *file_data, u64 filesize) {
         debug_printf("Failed to make file \"%s\"\n", input_file);
         return 0;
     }
-    debug_printf("Writing input_file \"%s\" %li\n", input_file, filesize);
+    debug_printf("Writing input_file \"%s\" %lu\n", input_file, filesize);
     size_written = sceKernelWrite(fd, file_data, filesize);
     debug_printf("Written input_file \"%s\" %li\n", input_file, size_written);
     sceKernelClose(fd);
-    return 1;
+    return size_written == (s64)filesize;
 }
 
 // https://github.com/bucanero/apollo-ps4/blob/a530cae3c81639eedebac606c67322acd6fa8965/source/orbis_jbc.c#L62
@@ -156,10 +156,10 @@ u8* PatternScan(uint64_t module_base, uint32_t module_size, const char* signatur
     }
     constexpr u32 MAX_PATTERN_LENGTH = 256;
     u8 patternBytes[MAX_PATTERN_LENGTH] = { 0 };
-    s32 patternLength = pattern_to_byte(signature, patternBytes);
+    u32 patternLength = pattern_to_byte(signature, patternBytes);
     if (!patternLength || patternLength >= MAX_PATTERN_LENGTH)
     {
-        final_printf("Pattern length too large or invalid! %i (0x%08x)\n", patternLength, patternLength);
+        final_printf("Pattern length too large or invalid! %u (0x%08x)\n", patternLength, patternLength);
         final_printf("Input Pattern %s\n", signature);
         return nullptr;
     }
@@ -168,7 +168,7 @@ u8* PatternScan(uint64_t module_base, uint32_t module_size, const char* signatur
     for (u64 i = 0; i < module_size; ++i)
     {
         bool found = true;
-        for (s32 j = 0; j < patternLength; ++j)
+        for (u32 j = 0; j < patternLength; ++j)
         {
             if (scanBytes[i + j] != patternBytes[j] && patternBytes[j] != 0xff)
             {
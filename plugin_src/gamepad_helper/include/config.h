@@ -4,10 +4,9 @@
 #include <stdbool.h>
 #endif
 
-typedef struct ini_entry_s {
-    char* key;
-    char* value;
-} ini_entry_s;
+#include "config_service.h"
+
+typedef config_entry ini_entry_s;
 
 typedef struct ini_section_s {
     char* name;
@@ -111,8 +110,13 @@ bool ini_table_get_entry_as_bool(ini_table_s* table, const char* section_name, c
 // Ctn: make this non-static
 ini_section_s* _ini_section_find(ini_table_s* table, const char* name);
 
-bool ini_table_get_entry_as_scePadButton(ini_table_s* table, const char* section_name,
-                                         const char* key, uint32_t* value);
-
-bool ini_table_get_entry_as_viration_intensity(ini_table_s* table, const char* section_name,
-                                               const char* key, int32_t* value);
+/**
+ * @brief Merges the `default' section and `section_name' into `view', keys in
+ *        `section_name' override default ones. `view' points into `table' and
+ *        `view->pair' must be released with plugin_heap_free().
+ * @param table
+ * @param section_name
+ * @param [out]view
+ * @return bool
+ */
+bool ini_table_merge_view(ini_table_s* table, const char* section_name, config_view* view);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "config_schema.h"
+#include "pad.h"
+
+extern config_enum g_padButtonEnum;
+extern config_enum g_virationIntensityEnum;
+
+// Every key of gamepad.ini with its default and valid range.
+#define GAMEPAD_CONFIG(X, S)                                                                 \
+    X(S, BOOL, enableDeadZone, true, 0, 1, NULL)                                             \
+    X(S, INT, DeadZoneLeft, 0xd, 0, 128, NULL)                                               \
+    X(S, INT, DeadZoneRight, 0xd, 0, 128, NULL)                                              \
+    X(S, BOOL, enableCustomTouchPad, false, 0, 1, NULL)                                      \
+    X(S, ENUM, TOUCH_L1, SCE_PAD_BUTTON_TOUCH_PAD, 0, 0, &g_padButtonEnum)                   \
+    X(S, ENUM, TOUCH_R1, SCE_PAD_BUTTON_TOUCH_PAD, 0, 0, &g_padButtonEnum)                   \
+    X(S, ENUM, TOUCH_L2, SCE_PAD_BUTTON_TOUCH_PAD, 0, 0, &g_padButtonEnum)                   \
+    X(S, ENUM, TOUCH_R2, SCE_PAD_BUTTON_TOUCH_PAD, 0, 0, &g_padButtonEnum)                   \
+    X(S, BOOL, enableCustomButton, false, 0, 1, NULL)                                        \
+    X(S, ENUM, BUTTON_L3, SCE_PAD_BUTTON_L3, 0, 0, &g_padButtonEnum)                         \
+    X(S, ENUM, BUTTON_R3, SCE_PAD_BUTTON_R3, 0, 0, &g_padButtonEnum)                         \
+    X(S, ENUM, BUTTON_OPTIONS, SCE_PAD_BUTTON_OPTIONS, 0, 0, &g_padButtonEnum)               \
+    X(S, ENUM, BUTTON_UP, SCE_PAD_BUTTON_UP, 0, 0, &g_padButtonEnum)                         \
+    X(S, ENUM, BUTTON_RIGHT, SCE_PAD_BUTTON_RIGHT, 0, 0, &g_padButtonEnum)                   \
+    X(S, ENUM, BUTTON_DOWN, SCE_PAD_BUTTON_DOWN, 0, 0, &g_padButtonEnum)                     \
+    X(S, ENUM, BUTTON_LEFT, SCE_PAD_BUTTON_LEFT, 0, 0, &g_padButtonEnum)                     \
+    X(S, ENUM, BUTTON_L2, SCE_PAD_BUTTON_L2, 0, 0, &g_padButtonEnum)                         \
+    X(S, ENUM, BUTTON_R2, SCE_PAD_BUTTON_R2, 0, 0, &g_padButtonEnum)                         \
+    X(S, ENUM, BUTTON_L1, SCE_PAD_BUTTON_L1, 0, 0, &g_padButtonEnum)                         \
+    X(S, ENUM, BUTTON_R1, SCE_PAD_BUTTON_R1, 0, 0, &g_padButtonEnum)                         \
+    X(S, ENUM, BUTTON_TRIANGLE, SCE_PAD_BUTTON_TRIANGLE, 0, 0, &g_padButtonEnum)             \
+    X(S, ENUM, BUTTON_CIRCLE, SCE_PAD_BUTTON_CIRCLE, 0, 0, &g_padButtonEnum)                 \
+    X(S, ENUM, BUTTON_CROSS, SCE_PAD_BUTTON_CROSS, 0, 0, &g_padButtonEnum)                   \
+    X(S, ENUM, BUTTON_SQUARE, SCE_PAD_BUTTON_SQUARE, 0, 0, &g_padButtonEnum)                 \
+    X(S, ENUM, BUTTON_TOUCH_PAD, SCE_PAD_BUTTON_TOUCH_PAD, 0, 0, &g_padButtonEnum)           \
+    X(S, ENUM, VirationIntensity, PAD_VIRATION_INTENSITY_STRONG, 0, 0, &g_virationIntensityEnum)
+
+CONFIG_DECLARE_STRUCT(gamepad_config, GAMEPAD_CONFIG);
+
+extern config_schema gamepad_config_schema;
@@ -5,20 +5,65 @@
 #include <unistd.h>
 
 #include "plugin_common.h"
+#include "plugin_heap.h"
 
 #define _atoi atoi
 
 /// https://github.com/Teklad/tconfig > https://github.com/gimli2/tconfig
 #include "config.h"
 #include "pad.h"
+#include "gamepad_config.h"
+
+static const config_enum_value g_padButtonValues[] = {
+    {"BUTTON_L3", SCE_PAD_BUTTON_L3},
+    {"BUTTON_R3", SCE_PAD_BUTTON_R3},
+    {"BUTTON_OPTIONS", SCE_PAD_BUTTON_OPTIONS},
+    {"BUTTON_UP", SCE_PAD_BUTTON_UP},
+    {"BUTTON_RIGHT", SCE_PAD_BUTTON_RIGHT},
+    {"BUTTON_DOWN", SCE_PAD_BUTTON_DOWN},
+    {"BUTTON_LEFT", SCE_PAD_BUTTON_LEFT},
+    {"BUTTON_L2", SCE_PAD_BUTTON_L2},
+    {"BUTTON_R2", SCE_PAD_BUTTON_R2},
+    {"BUTTON_L1", SCE_PAD_BUTTON_L1},
+    {"BUTTON_R1", SCE_PAD_BUTTON_R1},
+    {"BUTTON_TRIANGLE", SCE_PAD_BUTTON_TRIANGLE},
+    {"BUTTON_CIRCLE", SCE_PAD_BUTTON_CIRCLE},
+    {"BUTTON_CROSS", SCE_PAD_BUTTON_CROSS},
+    {"BUTTON_SQUARE", SCE_PAD_BUTTON_SQUARE},
+    {"BUTTON_TOUCH_PAD", SCE_PAD_BUTTON_TOUCH_PAD},
+};
+
+static const config_enum_value g_virationIntensityValues[] = {
+    {"off", PAD_VIRATION_INTENSITY_OFF},
+    {"weak", PAD_VIRATION_INTENSITY_WEAK},
+    {"medium", PAD_VIRATION_INTENSITY_MEDIUM},
+    {"strong", PAD_VIRATION_INTENSITY_STRONG},
+};
+
+config_enum g_padButtonEnum = CONFIG_ENUM_INIT(g_padButtonValues);
+config_enum g_virationIntensityEnum = CONFIG_ENUM_INIT(g_virationIntensityValues);
+
+CONFIG_DEFINE_SCHEMA(gamepad_config, GAMEPAD_CONFIG);
+// The table lives in the plugin heap, NULL when it is out of budget, the table is left as it was.
 static ini_entry_s* _ini_entry_create(ini_section_s* section, const char* key, const char* value) {
     if ((section->size % 10) == 0) {
-        section->entry =
-            (ini_entry_s*)realloc(section->entry, (10 + section->size) * sizeof(ini_entry_s));
+        ini_entry_s* grown = (ini_entry_s*)plugin_heap_realloc(
+            section->entry, (10 + section->size) * sizeof(ini_entry_s));
+        if (grown == NULL) {
+            return NULL;
+        }
+        section->entry = grown;
+    }
+    char* entry_key = (char*)plugin_heap_alloc((strlen(key) + 1) * sizeof(char));
+    char* entry_value = (char*)plugin_heap_alloc((strlen(value) + 1) * sizeof(char));
+    if (entry_key == NULL || entry_value == NULL) {
+        plugin_heap_free(entry_key);
+        plugin_heap_free(entry_value);
+        return NULL;
     }
     ini_entry_s* entry = &section->entry[section->size++];
-    entry->key = (char*)malloc((strlen(key) + 1) * sizeof(char));
-    entry->value = (char*)malloc((strlen(value) + 1) * sizeof(char));
+    entry->key = entry_key;
+    entry->value = entry_value;
     debug_printf("key: %s = value: %s\n", key, value);
     strcpy(entry->key, key);
     strcpy(entry->value, value);
@@ -27,14 +72,25 @@ static ini_entry_s* _ini_entry_create(ini_section_s* section, const char* key, c
 
 static ini_section_s* _ini_section_create(ini_table_s* table, const char* section_name) {
     if ((table->size % 10) == 0) {
-        table->section =
-            (ini_section_s*)realloc(table->section, (10 + table->size) * sizeof(ini_section_s));
+        ini_section_s* grown = (ini_section_s*)plugin_heap_realloc(
+            table->section, (10 + table->size) * sizeof(ini_section_s));
+        if (grown == NULL) {
+            return NULL;
+        }
+        table->section = grown;
+    }
+    char* name = (char*)plugin_heap_alloc((strlen(section_name) + 1) * sizeof(char));
+    ini_entry_s* entry = (ini_entry_s*)plugin_heap_alloc(10 * sizeof(ini_entry_s));
+    if (name == NULL || entry == NULL) {
+        plugin_heap_free(name);
+        plugin_heap_free(entry);
+        return NULL;
     }
     ini_section_s* section = &table->section[table->size++];
     section->size = 0;
-    section->name = (char*)malloc((strlen(section_name) + 1) * sizeof(char));
+    section->name = name;
     strcpy(section->name, section_name);
-    section->entry = (ini_entry_s*)malloc(10 * sizeof(ini_entry_s));
+    section->entry = entry;
     return section;
 }
 
@@ -71,9 +127,16 @@ static ini_entry_s* _ini_entry_get(ini_table_s* table, const char* section_name,
 }
 
 ini_table_s* ini_table_create() {
-    ini_table_s* table = (ini_table_s*)malloc(sizeof(ini_table_s));
+    ini_table_s* table = (ini_table_s*)plugin_heap_alloc(sizeof(ini_table_s));
+    if (table == NULL) {
+        return NULL;
+    }
     table->size = 0;
-    table->section = (ini_section_s*)malloc(10 * sizeof(ini_section_s));
+    table->section = (ini_section_s*)plugin_heap_alloc(10 * sizeof(ini_section_s));
+    if (table->section == NULL) {
+        plugin_heap_free(table);
+        return NULL;
+    }
     return table;
 }
 
@@ -82,14 +145,14 @@ void ini_table_destroy(ini_table_s* table) {
         ini_section_s* section = &table->section[i];
         for (int q = 0; q < section->size; q++) {
             ini_entry_s* entry = &section->entry[q];
-            free(entry->key);
-            free(entry->value);
+            plugin_heap_free(entry->key);
+            plugin_heap_free(entry->value);
         }
-        free(section->entry);
-        free(section->name);
+        plugin_heap_free(section->entry);
+        plugin_heap_free(section->name);
     }
-    free(table->section);
-    free(table);
+    plugin_heap_free(table->section);
+    plugin_heap_free(table);
 }
 
 int eof_hack(int c) {
@@ -113,14 +176,19 @@ bool ini_table_read_from_file(ini_table_s* table, const char* file) {
     int spaces = 0;
     int line = 0;
     int buffer_size = 128 * sizeof(char);
-    char* buf = (char*)malloc(buffer_size);
+    char* buf = (char*)plugin_heap_alloc(buffer_size);
     char* value = NULL;
+    if (buf == NULL) {
+        fclose(f);
+        return false;
+    }
 
     ini_section_s* current_section = NULL;
     memset(buf, '\0', buffer_size);
 
     bool first_eol = false;
-    while (1) {
+    bool ok = true;
+    while (ok) {
         c = fgetc(f);
         if (c == eof_hack(c)) break;
 
@@ -128,7 +196,12 @@ bool ini_table_read_from_file(ini_table_s* table, const char* file) {
         if (position > buffer_size - 2) {
             buffer_size += 128 * sizeof(char);
             size_t value_offset = value == NULL ? 0 : value - buf;
-            buf = (char*)realloc(buf, buffer_size);
+            char* grown = (char*)plugin_heap_realloc(buf, buffer_size);
+            if (grown == NULL) {
+                ok = false;
+                break;
+            }
+            buf = grown;
             memset(buf + position, '\0', buffer_size - position);
 
             if (value != NULL) value = buf + value_offset;
@@ -161,18 +234,18 @@ bool ini_table_read_from_file(ini_table_s* table, const char* file) {
                     if (current_section == NULL) {
                         current_section = _ini_section_create(table, "");
                     }
-                    _ini_entry_create(current_section, buf, value);
+                    ok = current_section && _ini_entry_create(current_section, buf, value);
                     value = NULL;
                 } else if (strlen(buf) > 1 && position && state == Key) {
                     if (current_section == NULL) {
                         current_section = _ini_section_create(table, "");
                     }
-                    _ini_entry_create(current_section, buf, "");
+                    ok = current_section && _ini_entry_create(current_section, buf, "");
                 } else if (state == Comment) {
                     if (current_section == NULL) {
                         current_section = _ini_section_create(table, "");
                     }
-                    _ini_entry_create(current_section, buf, "");
+                    ok = current_section && _ini_entry_create(current_section, buf, "");
                 } else if (state == Section) {
                     debug_printf("Section `%s' missing `]' operator.", buf);
                 } else if (state == Key && position) {
@@ -188,6 +261,7 @@ bool ini_table_read_from_file(ini_table_s* table, const char* file) {
                 break;
             case ']':
                 current_section = _ini_section_create(table, buf);
+                ok = current_section != NULL;
                 memset(buf, '\0', buffer_size);
                 position = 0;
                 spaces = 0;
@@ -207,10 +281,13 @@ bool ini_table_read_from_file(ini_table_s* table, const char* file) {
                 break;
         }
     }
-    free(buf);
+    plugin_heap_free(buf);
     if (fflush(f) == 0) fsync(fileno(f));
     fclose(f);
-    return true;
+    if (!ok) {
+        final_printf("Out of plugin heap after %d line(s)\n", line);
+    }
+    return ok;
 }
 
 bool ini_table_write_to_file(ini_table_s* table, const char* file) {
@@ -238,14 +315,20 @@ void ini_table_create_entry(ini_table_s* table, const char* section_name, const
     ini_section_s* section = _ini_section_find(table, section_name);
     if (section == NULL) {
         section = _ini_section_create(table, section_name);
+        if (section == NULL) {
+            return;
+        }
     }
     ini_entry_s* entry = _ini_entry_find(section, key);
     if (entry == NULL) {
         entry = _ini_entry_create(section, key, value);
     } else {
-        free(entry->value);
-        entry->value = (char*)malloc((strlen(value) + 1) * sizeof(char));
-        strcpy(entry->value, value);
+        char* entry_value = (char*)plugin_heap_alloc((strlen(value) + 1) * sizeof(char));
+        if (entry_value != NULL) {
+            plugin_heap_free(entry->value);
+            entry->value = entry_value;
+            strcpy(entry->value, value);
+        }
     }
 }
 
@@ -285,66 +368,20 @@ bool ini_table_get_entry_as_bool(ini_table_s* table, const char* section_name, c
     return true;
 }
 
-bool ini_table_get_entry_as_scePadButton(ini_table_s* table, const char* section_name,
-                                         const char* key, uint32_t* value) {
-    const char* val = ini_table_get_entry(table, section_name, key);
-    if (val == NULL) {
-        return false;
-    }
-
-    if (strcasecmp(val, "BUTTON_L3") == 0) {
-        *value = SCE_PAD_BUTTON_L3;
-    } else if (strcasecmp(val, "BUTTON_R3") == 0) {
-        *value = SCE_PAD_BUTTON_R3;
-    } else if (strcasecmp(val, "BUTTON_OPTIONS") == 0) {
-        *value = SCE_PAD_BUTTON_OPTIONS;
-    } else if (strcasecmp(val, "BUTTON_UP") == 0) {
-        *value = SCE_PAD_BUTTON_UP;
-    } else if (strcasecmp(val, "BUTTON_RIGHT") == 0) {
-        *value = SCE_PAD_BUTTON_RIGHT;
-    } else if (strcasecmp(val, "BUTTON_DOWN") == 0) {
-        *value = BUTTON_DOWN;
-    } else if (strcasecmp(val, "BUTTON_LEFT") == 0) {
-        *value = SCE_PAD_BUTTON_LEFT;
-    } else if (strcasecmp(val, "BUTTON_L2") == 0) {
-        *value = SCE_PAD_BUTTON_L2;
-    } else if (strcasecmp(val, "BUTTON_R2") == 0) {
-        *value = SCE_PAD_BUTTON_R2;
-    } else if (strcasecmp(val, "BUTTON_L1") == 0) {
-        *value = SCE_PAD_BUTTON_L1;
-    } else if (strcasecmp(val, "BUTTON_R1") == 0) {
-        *value = SCE_PAD_BUTTON_R1;
-    } else if (strcasecmp(val, "BUTTON_TRIANGLE") == 0) {
-        *value = SCE_PAD_BUTTON_TRIANGLE;
-    } else if (strcasecmp(val, "BUTTON_CIRCLE") == 0) {
-        *value = SCE_PAD_BUTTON_CIRCLE;
-    } else if (strcasecmp(val, "BUTTON_CROSS") == 0) {
-        *value = SCE_PAD_BUTTON_CROSS;
-    } else if (strcasecmp(val, "BUTTON_SQUARE") == 0) {
-        *value = SCE_PAD_BUTTON_SQUARE;
-    } else if (strcasecmp(val, "BUTTON_TOUCH_PAD") == 0) {
-        *value = SCE_PAD_BUTTON_TOUCH_PAD;
-    } else {
-        return false;
-    }
-
-    return true;
-}
-
-bool ini_table_get_entry_as_viration_intensity(ini_table_s* table, const char* section_name,
-                                               const char* key, int32_t* value) {
-    const char* val = ini_table_get_entry(table, section_name, key);
-    if (val == NULL) {
-        return false;
-    }
-    if (strcasecmp(val, "off") == 0) {
-        *value = PAD_VIRATION_INTENSITY_OFF;
-    } else if (strcasecmp(val, "weak") == 0) {
-        *value = PAD_VIRATION_INTENSITY_WEAK;
-    } else if (strcasecmp(val, "medium") == 0) {
-        *value = PAD_VIRATION_INTENSITY_MEDIUM;
-    } else {
+bool ini_table_merge_view(ini_table_s* table, const char* section_name, config_view* view) {
+    ini_section_s* default_section = _ini_section_find(table, CONFIG_DEFAULT_SECTION);
+    ini_section_s* title_section = _ini_section_find(table, section_name);
+    uint32_t max_size = (default_section ? default_section->size : 0) +
+                        (title_section ? title_section->size : 0);
+    config_pair* pair =
+        (config_pair*)plugin_heap_alloc((max_size ? max_size : 1) * sizeof(config_pair));
+    if (pair == NULL) {
         return false;
     }
+    view->pair = pair;
+    view->size = config_view_merge(pair, default_section ? default_section->entry : NULL,
+                                   default_section ? default_section->size : 0,
+                                   title_section ? title_section->entry : NULL,
+                                   title_section ? title_section->size : 0);
     return true;
 }
@@ -6,6 +6,10 @@
 #include <Patcher.h>
 #include "config.h"
 #include "pad.h"
+#include "gamepad_config.h"
+#include "hook_stats.h"
+#include "plugin_heap.h"
+#include "trace.h"
 
 attr_public const char* g_pluginName = "gamepad_helper";
 attr_public const char* g_pluginDesc = "(null)";
@@ -16,23 +20,18 @@ HOOK_INIT(scePadRead);
 HOOK_INIT(scePadReadState);
 HOOK_INIT(scePadSetVibration);
 
+HOOK_STATS_INIT(scePadRead);
+HOOK_STATS_INIT(scePadReadState);
+HOOK_STATS_INIT(scePadSetVibration);
+
 Patcher* scePadReadExtPatcher;
 Patcher* scePadReadStateExtPatcher;
 
 #define PLUGIN_CONFIG_PATH GOLDHEN_PATH "/gamepad.ini"
-#define PLUGIN_DEFAULT_SECTION "default"
 
 #define JOY_CENTER_POS 0x80
 
-bool g_enableDeadZone;
-int g_deadZoneLeft;
-int g_deadZoneRight;
-
-bool g_enableCustomTouchPad;
-bool g_enableCustomButton;
-int g_virationIntensity;
-
-uint32_t* buttonMapping;
+gamepad_config g_config = CONFIG_DEFAULTS(gamepad_config, GAMEPAD_CONFIG);
 
 inline int deadzone_apply(ScePadData* pData);
 inline uint8_t check_deadzone(uint8_t input, uint8_t deadZone);
@@ -43,18 +42,20 @@ bool file_exists(const char* filename) {
 }
 
 int scePadSetVibration_hook(int32_t handle, const ScePadVibrationParam* pParam) {
-    if (g_virationIntensity == PAD_VIRATION_INTENSITY_OFF) {
+    HOOK_STATS_SCOPE(scePadSetVibration);
+    TRACE_SCOPE("scePadSetVibration");
+    if (g_config.VirationIntensity == PAD_VIRATION_INTENSITY_OFF) {
         return 0;
     }
 
     ScePadVibrationParam Param;
 
-    if (g_virationIntensity == PAD_VIRATION_INTENSITY_MEDIUM) {
+    if (g_config.VirationIntensity == PAD_VIRATION_INTENSITY_MEDIUM) {
         Param.largeMotor = pParam->largeMotor * 0.6;
         Param.smallMotor = pParam->smallMotor * 0.6;
     }
 
-    if (g_virationIntensity == PAD_VIRATION_INTENSITY_WEAK) {
+    if (g_config.VirationIntensity == PAD_VIRATION_INTENSITY_WEAK) {
         Param.largeMotor = pParam->largeMotor * 0.3;
         Param.smallMotor = pParam->smallMotor * 0.3;
     }
@@ -73,35 +74,35 @@ uint8_t check_deadzone(uint8_t input, uint8_t deadZone) {
 };
 
 int deadzone_apply(ScePadData* pData) {
-    if (g_enableDeadZone) {
-        pData->leftStick.x = check_deadzone(pData->leftStick.x, g_deadZoneLeft);
-        pData->leftStick.y = check_deadzone(pData->leftStick.y, g_deadZoneLeft);
-        pData->rightStick.x = check_deadzone(pData->rightStick.x, g_deadZoneRight);
-        pData->rightStick.y = check_deadzone(pData->rightStick.y, g_deadZoneRight);
+    if (g_config.enableDeadZone) {
+        pData->leftStick.x = check_deadzone(pData->leftStick.x, g_config.DeadZoneLeft);
+        pData->leftStick.y = check_deadzone(pData->leftStick.y, g_config.DeadZoneLeft);
+        pData->rightStick.x = check_deadzone(pData->rightStick.x, g_config.DeadZoneRight);
+        pData->rightStick.y = check_deadzone(pData->rightStick.y, g_config.DeadZoneRight);
     }
     return 0;
 }
 
 int custom_touchpad(int32_t handle, ScePadData* pData) {
-    if (g_enableCustomTouchPad) {
+    if (g_config.enableCustomTouchPad) {
         if (pData->buttons & SCE_PAD_BUTTON_TOUCH_PAD) {
             // clear touch pad button flag
             pData->buttons &= ~SCE_PAD_BUTTON_TOUCH_PAD;
 
             if (pData->touchData.touch[0].x < 960 && pData->touchData.touch[0].y < 471) {
-                pData->buttons |= buttonMapping[TOUCH_L1];
+                pData->buttons |= g_config.TOUCH_L1;
             }
 
             if (pData->touchData.touch[0].x > 960 && pData->touchData.touch[0].y < 471) {
-                pData->buttons |= buttonMapping[TOUCH_R1];
+                pData->buttons |= g_config.TOUCH_R1;
             }
 
             if (pData->touchData.touch[0].x < 960 && pData->touchData.touch[0].y > 471) {
-                pData->buttons |= buttonMapping[TOUCH_L2];
+                pData->buttons |= g_config.TOUCH_L2;
             }
 
             if (pData->touchData.touch[0].x > 960 && pData->touchData.touch[0].y > 471) {
-                pData->buttons |= buttonMapping[TOUCH_R2];
+                pData->buttons |= g_config.TOUCH_R2;
             }
         }
     }
@@ -109,29 +110,29 @@ int custom_touchpad(int32_t handle, ScePadData* pData) {
 }
 
 int custom_button(int32_t handle, ScePadData* pData) {
-    if (g_enableCustomButton) {
+    if (g_config.enableCustomButton) {
         uint32_t buttons = 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_L3) ? buttonMapping[BUTTON_L3] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_R3) ? buttonMapping[BUTTON_R3] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_OPTIONS) ? buttonMapping[BUTTON_OPTIONS] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_UP) ? buttonMapping[BUTTON_UP] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_RIGHT) ? buttonMapping[BUTTON_RIGHT] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_DOWN) ? buttonMapping[BUTTON_DOWN] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_LEFT) ? buttonMapping[BUTTON_LEFT] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_L2) ? buttonMapping[BUTTON_L2] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_R2) ? buttonMapping[BUTTON_R2] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_L1) ? buttonMapping[BUTTON_L1] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_R1) ? buttonMapping[BUTTON_R1] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_TRIANGLE) ? buttonMapping[BUTTON_TRIANGLE] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_CIRCLE) ? buttonMapping[BUTTON_CIRCLE] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_CROSS) ? buttonMapping[BUTTON_CROSS] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_SQUARE) ? buttonMapping[BUTTON_SQUARE] : 0;
-        buttons |= (pData->buttons & SCE_PAD_BUTTON_INTERCEPTED) ? buttonMapping[BUTTON_INTERCEPTED] : 0;
-
-        if (g_enableCustomTouchPad) {
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_L3) ? g_config.BUTTON_L3 : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_R3) ? g_config.BUTTON_R3 : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_OPTIONS) ? g_config.BUTTON_OPTIONS : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_UP) ? g_config.BUTTON_UP : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_RIGHT) ? g_config.BUTTON_RIGHT : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_DOWN) ? g_config.BUTTON_DOWN : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_LEFT) ? g_config.BUTTON_LEFT : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_L2) ? g_config.BUTTON_L2 : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_R2) ? g_config.BUTTON_R2 : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_L1) ? g_config.BUTTON_L1 : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_R1) ? g_config.BUTTON_R1 : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_TRIANGLE) ? g_config.BUTTON_TRIANGLE : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_CIRCLE) ? g_config.BUTTON_CIRCLE : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_CROSS) ? g_config.BUTTON_CROSS : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_SQUARE) ? g_config.BUTTON_SQUARE : 0;
+        buttons |= (pData->buttons & SCE_PAD_BUTTON_INTERCEPTED) ? SCE_PAD_BUTTON_INTERCEPTED : 0;
+
+        if (g_config.enableCustomTouchPad) {
             buttons |= (pData->buttons & SCE_PAD_BUTTON_TOUCH_PAD) ? SCE_PAD_BUTTON_TOUCH_PAD : 0;
         } else {
-            buttons |= (pData->buttons & SCE_PAD_BUTTON_TOUCH_PAD) ? buttonMapping[BUTTON_TOUCH_PAD] : 0;
+            buttons |= (pData->buttons & SCE_PAD_BUTTON_TOUCH_PAD) ? g_config.BUTTON_TOUCH_PAD : 0;
         }
 
         pData->buttons = buttons;
@@ -140,6 +141,8 @@ int custom_button(int32_t handle, ScePadData* pData) {
 }
 
 int32_t scePadRead_hook(int32_t handle, ScePadData* pData, int32_t num) {
+    HOOK_STATS_SCOPE(scePadRead);
+    TRACE_SCOPE("scePadRead");
     int ret = 0;
     ret = scePadReadExt(handle, pData, num);
 
@@ -155,6 +158,8 @@ int32_t scePadRead_hook(int32_t handle, ScePadData* pData, int32_t num) {
 }
 
 int32_t scePadReadState_hook(int32_t handle, ScePadData* pData) {
+    HOOK_STATS_SCOPE(scePadReadState);
+    TRACE_SCOPE("scePadReadState");
     int ret = 0;
     ret = scePadReadStateExt(handle, pData);
 
@@ -167,45 +172,9 @@ int32_t scePadReadState_hook(int32_t handle, ScePadData* pData) {
     return ret;
 }
 
-int32_t load_config(ini_table_s* table, const char* section_name) {
-    ini_table_get_entry_as_bool(table, section_name, "enableDeadZone", &g_enableDeadZone);
-
-    if (g_enableDeadZone) {
-        ini_table_get_entry_as_int(table, section_name, "DeadZoneLeft", &g_deadZoneLeft);
-        ini_table_get_entry_as_int(table, section_name, "DeadZoneRight", &g_deadZoneRight);
-    }
-
-    ini_table_get_entry_as_bool(table, section_name, "enableCustomTouchPad", &g_enableCustomTouchPad);
-
-    if (g_enableCustomTouchPad) {
-        ini_table_get_entry_as_scePadButton(table, section_name, "TOUCH_L1", &buttonMapping[TOUCH_L1]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "TOUCH_R1", &buttonMapping[TOUCH_R1]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "TOUCH_L2", &buttonMapping[TOUCH_L2]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "TOUCH_R2", &buttonMapping[TOUCH_R2]);
-    }
-
-    ini_table_get_entry_as_bool(table, section_name, "enableCustomButton", &g_enableCustomButton);
-
-    if (g_enableCustomButton) {
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_L3", &buttonMapping[BUTTON_L3]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_R3", &buttonMapping[BUTTON_R3]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_OPTIONS", &buttonMapping[BUTTON_OPTIONS]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_UP", &buttonMapping[BUTTON_UP]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_RIGHT", &buttonMapping[BUTTON_RIGHT]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_DOWN", &buttonMapping[BUTTON_DOWN]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_LEFT", &buttonMapping[BUTTON_LEFT]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_L2", &buttonMapping[BUTTON_L2]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_R2", &buttonMapping[BUTTON_R2]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_L1", &buttonMapping[BUTTON_L1]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_R1", &buttonMapping[BUTTON_R1]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_TRIANGLE", &buttonMapping[BUTTON_TRIANGLE]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_CIRCLE", &buttonMapping[BUTTON_CIRCLE]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_CROSS", &buttonMapping[BUTTON_CROSS]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_SQUARE", &buttonMapping[BUTTON_SQUARE]);
-        ini_table_get_entry_as_scePadButton(table, section_name, "BUTTON_TOUCH_PAD", &buttonMapping[BUTTON_TOUCH_PAD]);
-    }
-
-    ini_table_get_entry_as_viration_intensity(table, section_name, "VirationIntensity", &g_virationIntensity);
+int32_t load_config(const config_view* view) {
+    uint32_t bound = config_schema_bind(&gamepad_config_schema, view, &g_config);
+    final_printf("Loaded %u key(s) from %s\n", bound, PLUGIN_CONFIG_PATH);
     return 0;
 }
 
@@ -219,8 +188,17 @@ s32 attr_public plugin_load(s32 argc, const char* argv[]) {
     int h = 0;
     sys_dynlib_load_prx(module, &h);
 
-    scePadReadExtPatcher = (Patcher*)malloc(sizeof(Patcher));
-    scePadReadStateExtPatcher = (Patcher*)malloc(sizeof(Patcher));
+    // The budget also holds gamepad.ini while it is parsed without plugin_loader.
+    plugin_heap_init(g_pluginName, 16 * 1024, 256 * 1024);
+    scePadReadExtPatcher = (Patcher*)plugin_heap_alloc(sizeof(Patcher));
+    scePadReadStateExtPatcher = (Patcher*)plugin_heap_alloc(sizeof(Patcher));
+    if (!scePadReadExtPatcher || !scePadReadStateExtPatcher) {
+        final_printf("plugin_heap_alloc(Patcher) failed\n");
+        plugin_heap_free(scePadReadExtPatcher);
+        plugin_heap_free(scePadReadStateExtPatcher);
+        plugin_heap_shutdown();
+        return -1;
+    }
     Patcher_Construct(scePadReadExtPatcher);
     Patcher_Construct(scePadReadStateExtPatcher);
 
@@ -230,46 +208,11 @@ s32 attr_public plugin_load(s32 argc, const char* argv[]) {
     uint8_t xor_edx_edx[5] = {0x31, 0xD2, 0x90, 0x90, 0x90};
     Patcher_Install_Patch(scePadReadStateExtPatcher, (uint64_t)scePadReadStateExt, xor_edx_edx, sizeof(xor_edx_edx));
 
+    hook_stats_start(g_pluginName, 5000);
+    trace_start(g_pluginName);
     HOOK32(scePadRead);
     HOOK32(scePadReadState);
 
-    // defaults value
-    g_enableDeadZone = true;
-
-    g_deadZoneLeft = 0xd;
-    g_deadZoneRight = 0xd;
-
-    g_enableCustomTouchPad = false;
-    g_enableCustomButton = false;
-    g_virationIntensity = PAD_VIRATION_INTENSITY_STRONG;
-
-    buttonMapping = (uint32_t*)malloc(BUTTON_MAPPING_MAX * sizeof(uint32_t));
-
-    memset(buttonMapping, 0, BUTTON_MAPPING_MAX * sizeof(uint32_t));
-
-    buttonMapping[TOUCH_L1] = SCE_PAD_BUTTON_TOUCH_PAD;
-    buttonMapping[TOUCH_R1] = SCE_PAD_BUTTON_TOUCH_PAD;
-    buttonMapping[TOUCH_L2] = SCE_PAD_BUTTON_TOUCH_PAD;
-    buttonMapping[TOUCH_R2] = SCE_PAD_BUTTON_TOUCH_PAD;
-
-    buttonMapping[BUTTON_L3] = SCE_PAD_BUTTON_L3;
-    buttonMapping[BUTTON_R3] = SCE_PAD_BUTTON_R3;
-    buttonMapping[BUTTON_OPTIONS] = SCE_PAD_BUTTON_OPTIONS;
-    buttonMapping[BUTTON_UP] = SCE_PAD_BUTTON_UP;
-    buttonMapping[BUTTON_RIGHT] = SCE_PAD_BUTTON_RIGHT;
-    buttonMapping[BUTTON_DOWN] = SCE_PAD_BUTTON_DOWN;
-    buttonMapping[BUTTON_LEFT] = SCE_PAD_BUTTON_LEFT;
-    buttonMapping[BUTTON_L2] = SCE_PAD_BUTTON_L2;
-    buttonMapping[BUTTON_R2] = SCE_PAD_BUTTON_R2;
-    buttonMapping[BUTTON_L1] = SCE_PAD_BUTTON_L1;
-    buttonMapping[BUTTON_R1] = SCE_PAD_BUTTON_R1;
-    buttonMapping[BUTTON_TRIANGLE] = SCE_PAD_BUTTON_TRIANGLE;
-    buttonMapping[BUTTON_CIRCLE] = SCE_PAD_BUTTON_CIRCLE;
-    buttonMapping[BUTTON_CROSS] = SCE_PAD_BUTTON_CROSS;
-    buttonMapping[BUTTON_SQUARE] = SCE_PAD_BUTTON_SQUARE;
-    buttonMapping[BUTTON_TOUCH_PAD] = SCE_PAD_BUTTON_TOUCH_PAD;
-    buttonMapping[BUTTON_INTERCEPTED] = SCE_PAD_BUTTON_INTERCEPTED;
-
     // load config
     struct proc_info procInfo;
     if (sys_sdk_proc_info(&procInfo) == 0) {
@@ -279,54 +222,40 @@ s32 attr_public plugin_load(s32 argc, const char* argv[]) {
         return -1;
     }
 
-    if (!file_exists(PLUGIN_CONFIG_PATH)) {
-        final_printf("Not found gamepad.ini config file\n");
-        return 0;
-    }
-
-    ini_table_s* config = ini_table_create();
-    if (config == NULL) {
-        final_printf("Config parser failed to initialise\n");
-        return -1;
-    }
-
-    if (!ini_table_read_from_file(config, PLUGIN_CONFIG_PATH)) {
-        final_printf("Config parser failed to parse config: %s\n", PLUGIN_CONFIG_PATH);
-        return -1;
-    }
-
     final_printf("Section is TitleID [%s]\n", procInfo.titleid);
 
-    for (uint16_t i = 0; i < config->size; i++) {
-        ini_section_s* section = &config->section[i];
+    // Parsed once by plugin_loader, already merged with the title ID section.
+    const config_view* view = config_service_get_view(PLUGIN_CONFIG_PATH);
+    if (view) {
+        load_config(view);
+    } else {
+        if (!file_exists(PLUGIN_CONFIG_PATH)) {
+            final_printf("Not found gamepad.ini config file\n");
+            return 0;
+        }
 
-        if (section == NULL) continue;
+        ini_table_s* config = ini_table_create();
+        if (config == NULL) {
+            final_printf("Config parser failed to initialise\n");
+            return -1;
+        }
 
-        if (strcmp(section->name, PLUGIN_DEFAULT_SECTION) == 0) {
-            final_printf("Section [%s] is default\n", section->name);
-            load_config(config, section->name);
-        } else if (strcmp(section->name, procInfo.titleid) == 0) {
-            final_printf("Section is TitleID [%s]\n", procInfo.titleid);
-            load_config(config, section->name);
+        if (!ini_table_read_from_file(config, PLUGIN_CONFIG_PATH)) {
+            final_printf("Config parser failed to parse config: %s\n", PLUGIN_CONFIG_PATH);
+            ini_table_destroy(config);
+            return -1;
         }
-    }
 
-    if (config != NULL) {
+        config_view local_view = {0};
+        local_view.file = PLUGIN_CONFIG_PATH;
+        if (ini_table_merge_view(config, procInfo.titleid, &local_view)) {
+            load_config(&local_view);
+            plugin_heap_free((void*)local_view.pair);
+        }
         ini_table_destroy(config);
     }
 
-    // check config value
-    if (g_deadZoneLeft > 0xFF && g_deadZoneLeft < 0) {
-        final_printf("deadZoneLeft config error, restore default value");
-        g_deadZoneLeft = 0xd;
-    }
-
-    if (g_deadZoneRight > 0xFF && g_deadZoneRight < 0) {
-        final_printf("deadZoneRight config error, restore default value");
-        g_deadZoneRight = 0xd;
-    }
-
-    if (g_virationIntensity != PAD_VIRATION_INTENSITY_STRONG) {
+    if (g_config.VirationIntensity != PAD_VIRATION_INTENSITY_STRONG) {
         HOOK32(scePadSetVibration);
     }
 
@@ -338,15 +267,17 @@ s32 attr_public plugin_unload(s32 argc, const char* argv[]) {
     UNHOOK(scePadRead);
     UNHOOK(scePadReadState);
 
-    if (g_virationIntensity != PAD_VIRATION_INTENSITY_STRONG) {
+    if (g_config.VirationIntensity != PAD_VIRATION_INTENSITY_STRONG) {
         UNHOOK(scePadSetVibration);
     }
+    hook_stats_stop();
+    trace_stop();
 
     Patcher_Destroy(scePadReadExtPatcher);
     Patcher_Destroy(scePadReadStateExtPatcher);
-    free(scePadReadExtPatcher);
-    free(scePadReadStateExtPatcher);
-    free(buttonMapping);
+    plugin_heap_free(scePadReadExtPatcher);
+    plugin_heap_free(scePadReadStateExtPatcher);
+    plugin_heap_shutdown();
 
     return 0;
 }
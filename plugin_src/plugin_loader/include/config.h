@@ -4,10 +4,9 @@
 #include <stdbool.h>
 #endif
 
-typedef struct ini_entry_s {
-    char *key;
-    char *value;
-} ini_entry_s;
+#include "config_service.h"
+
+typedef config_entry ini_entry_s;
 
 typedef struct ini_section_s {
     char *name;
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "config_service.h"
+
+/**
+ * @brief Sets the title ID whose section is merged over `default' in every view.
+ *        Must be called before any plugin is started.
+ * @param titleid
+ */
+void config_cache_init(const char *titleid);
+
+/**
+ * @brief Parses `file' on first use and returns its merged view.
+ *        Views live in an arena that is never freed and must not be modified.
+ *        Returns NULL if the file can not be read.
+ * @param file
+ * @return const config_view*
+ */
+const config_view *config_cache_get_view(const char *file);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum plugin_stage
+{
+    STAGE_VALIDATE,    // path checks and chmod
+    STAGE_MODULE,      // sceKernelLoadStartModule
+    STAGE_SYMBOLS,     // sceKernelDlsym of the plugin exports
+    STAGE_PLUGIN_LOAD, // plugin_load
+    STAGE_MAX
+} plugin_stage;
+
+typedef struct plugin_record
+{
+    struct plugin_record *next;
+    char path[260];
+    char name[64];
+    const char *phase;
+    int32_t handle;
+    int32_t result;
+    bool loaded;
+    uint64_t stage_start;
+    uint64_t stage_us[STAGE_MAX];
+    uint64_t heap_start;
+    uint64_t flexible_start;
+    int64_t heap_delta;
+    int64_t mapped_delta;
+} plugin_record;
+
+/**
+ * @brief Appends a new record for `path' to the record list.
+ * @param path
+ * @param phase
+ * @return plugin_record*, NULL on allocation failure.
+ */
+plugin_record *profile_record_create(const char *path, const char *phase);
+
+/**
+ * @brief Returns the head of the record list, in load order.
+ * @return plugin_record*
+ */
+plugin_record *profile_records(void);
+
+/**
+ * @brief Starts timing a stage. Stops with profile_stage_stop().
+ * @param record
+ */
+void profile_stage_start(plugin_record *record);
+void profile_stage_stop(plugin_record *record, plugin_stage stage);
+
+/**
+ * @brief Samples process heap and mapped memory before and after a plugin.
+ * @param record
+ */
+void profile_memory_start(plugin_record *record);
+void profile_memory_stop(plugin_record *record);
+
+/**
+ * @brief Formats the loaded plugins as "1. name" lines into `buf'.
+ * @param buf
+ * @param size
+ * @return uint32_t Number of loaded plugins.
+ */
+uint32_t profile_format_loaded(char *buf, size_t size);
+
+/**
+ * @brief Writes every record with its stage timings and memory deltas to `file'.
+ * @param file
+ * @return bool
+ */
+bool profile_write_csv(const char *file);
+
+/**
+ * @brief Shows a notification listing the slowest and heaviest plugins.
+ */
+void profile_notify_summary(void);
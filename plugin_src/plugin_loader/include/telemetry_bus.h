@@ -0,0 +1,12 @@
+#pragma once
+
+#include "telemetry.h"
+
+/**
+ * @brief Maps the telemetry bus and starts the snapshot thread.
+ *        Must be called before any plugin is started, plugins that load
+ *        earlier see no bus.
+ * @param titleid Used in the snapshot file name.
+ * @param interval_ms Snapshot interval, 0 disables telemetry.
+ */
+void telemetry_bus_init(const char *titleid, uint32_t interval_ms);
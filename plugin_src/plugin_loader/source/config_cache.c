@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <orbis/libkernel.h>
+
+#include "plugin_common.h"
+#include "config.h"
+#include "config_cache.h"
+
+#define CONFIG_ARENA_BLOCK_SIZE (16 * 1024)
+#define CONFIG_MAX_FILES 16
+
+typedef struct config_arena_block {
+    struct config_arena_block *next;
+    size_t used;
+    size_t size;
+    char data[];
+} config_arena_block;
+
+typedef struct config_cache_entry {
+    const char *file;
+    const config_view *view; // NULL if the file could not be read
+} config_cache_entry;
+
+static config_arena_block *g_ArenaHead = NULL;
+static config_cache_entry g_CacheEntries[CONFIG_MAX_FILES];
+static uint32_t g_CacheCount = 0;
+static char g_TitleId[16] = {0};
+static OrbisPthreadMutex g_CacheMutex = NULL;
+
+static void *arena_alloc(size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    if (g_ArenaHead == NULL || g_ArenaHead->used + size > g_ArenaHead->size) {
+        size_t block_size = size > CONFIG_ARENA_BLOCK_SIZE ? size : CONFIG_ARENA_BLOCK_SIZE;
+        config_arena_block *block = (config_arena_block *)malloc(sizeof(config_arena_block) + block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = g_ArenaHead;
+        block->used = 0;
+        block->size = block_size;
+        g_ArenaHead = block;
+    }
+    void *ptr = g_ArenaHead->data + g_ArenaHead->used;
+    g_ArenaHead->used += size;
+    return ptr;
+}
+
+static const char *arena_strdup(const char *str) {
+    size_t len = strlen(str) + 1;
+    char *copy = (char *)arena_alloc(len);
+    if (copy) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+static const config_view *build_view(const char *file) {
+    ini_table_s *table = ini_table_create();
+    if (table == NULL) {
+        return NULL;
+    }
+    if (!ini_table_read_from_file(table, file)) {
+        final_printf("Config parser failed to parse config: %s\n", file);
+        ini_table_destroy(table);
+        return NULL;
+    }
+    ini_section_s *default_section = _ini_section_find(table, CONFIG_DEFAULT_SECTION);
+    ini_section_s *title_section = _ini_section_find(table, g_TitleId);
+    uint32_t max_size = (default_section ? default_section->size : 0) + (title_section ? title_section->size : 0);
+
+    // Merge into a scratch array pointing at the table, then copy into the arena.
+    config_pair *scratch = (config_pair *)malloc((max_size ? max_size : 1) * sizeof(config_pair));
+    config_view *view = (config_view *)arena_alloc(sizeof(config_view));
+    if (scratch == NULL || view == NULL) {
+        free(scratch);
+        ini_table_destroy(table);
+        return NULL;
+    }
+    const uint32_t size = config_view_merge(scratch, default_section ? default_section->entry : NULL,
+                                            default_section ? default_section->size : 0,
+                                            title_section ? title_section->entry : NULL,
+                                            title_section ? title_section->size : 0);
+
+    config_pair *pair = (config_pair *)arena_alloc((size ? size : 1) * sizeof(config_pair));
+    for (uint32_t i = 0; pair && i < size; i++) {
+        pair[i].key = arena_strdup(scratch[i].key);
+        pair[i].value = arena_strdup(scratch[i].value);
+    }
+    view->file = arena_strdup(file);
+    view->pair = pair;
+    view->size = pair ? size : 0;
+    free(scratch);
+    ini_table_destroy(table);
+    final_printf("Cached %u merged key(s) from %s\n", view->size, file);
+    return view;
+}
+
+void config_cache_init(const char *titleid) {
+    snprintf(g_TitleId, sizeof(g_TitleId), "%s", titleid);
+    if (g_CacheMutex == NULL) {
+        scePthreadMutexInit(&g_CacheMutex, NULL, "config_cache");
+    }
+}
+
+const config_view *config_cache_get_view(const char *file) {
+    if (file == NULL) {
+        return NULL;
+    }
+    const config_view *view = NULL;
+    scePthreadMutexLock(&g_CacheMutex);
+    for (uint32_t i = 0; i < g_CacheCount; i++) {
+        if (strcmp(g_CacheEntries[i].file, file) == 0) {
+            view = g_CacheEntries[i].view;
+            scePthreadMutexUnlock(&g_CacheMutex);
+            return view;
+        }
+    }
+    view = build_view(file);
+    if (g_CacheCount < CONFIG_MAX_FILES) {
+        const char *key = view ? view->file : arena_strdup(file);
+        if (key) {
+            g_CacheEntries[g_CacheCount].file = key;
+            g_CacheEntries[g_CacheCount].view = view;
+            g_CacheCount++;
+        }
+    }
+    scePthreadMutexUnlock(&g_CacheMutex);
+    return view;
+}
+
+// Exported for plugins, see common/config_service.h
+attr_public const config_view *plugin_config_get_view(const char *file) {
+    return config_cache_get_view(file);
+}
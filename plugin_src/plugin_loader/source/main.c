@@ -7,25 +7,68 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include "GoldHEN.h"
 
 #include <orbis/libkernel.h>
+#include <orbis/VideoOut.h>
 
 #include "plugin_common.h"
 #include "config.h"
+#include "profile.h"
+#include "config_cache.h"
+#include "telemetry_bus.h"
 
 #define PLUGIN_CONFIG_PATH GOLDHEN_PATH "/plugins.ini"
 #define PLUGIN_PATH GOLDHEN_PATH "/plugins"
 #define PLUGIN_DEFAULT_SECTION "default"
 #define PLUGIN_SETTINGS_SECTION "settings"
+#define PLUGIN_PROFILE_PATH GOLDHEN_PATH "/plugin_load_profile.csv"
 
 attr_public const char *g_pluginName = "plugin_loader";
 attr_public const char *g_pluginDesc = "Plugin loader for GoldHEN";
 attr_public const char *g_pluginAuth = "Ctn123, illusion";
 attr_public u32 g_pluginVersion = 0x00000200; // 2.00
 
-static char g_PluginDetails[256] = {0};
+// Load phases selectable per entry in plugins.ini, e.g.
+// /data/GoldHEN/plugins/frame_logger.prx=first_flip
+typedef enum plugin_phase
+{
+    PLUGIN_PHASE_EARLY,      // inline from `_init_env`, before the game starts
+    PLUGIN_PHASE_POST_INIT,  // background thread, right after `_init_env` returns
+    PLUGIN_PHASE_FIRST_FLIP, // background thread, once the game presents its first frame
+    PLUGIN_PHASE_IDLE,       // background thread, a while after the first frame
+    PLUGIN_PHASE_MAX
+} plugin_phase;
+
+static const char *g_PhaseNames[PLUGIN_PHASE_MAX] = {"early", "post_init", "first_flip", "idle"};
+
+typedef struct plugin_entry
+{
+    char path[MAX_PATH_];
+    plugin_phase phase;
+} plugin_entry;
+
+#define MAX_DEFERRED_PLUGINS 64
+// Don't wait forever on titles that never flip.
+#define FIRST_FLIP_TIMEOUT_MS 30000
+
+static plugin_entry g_DeferredPlugins[MAX_DEFERRED_PLUGINS];
+static uint32_t g_DeferredCount = 0;
+static uint32_t g_EarlyLoadBudgetMs = 100;
+static uint32_t g_IdleDelayMs = 5000;
+static volatile bool g_FirstFlip = false;
+static int g_LoaderArgc = 0;
+static char **g_LoaderArgv = NULL;
+static bool g_ShowLoadNotification = false;
+static bool g_WriteLoadProfile = false;
+static bool g_ShowProfileNotification = false;
+
+int32_t sceGnmSubmitAndFlipCommandBuffers(uint32_t count, void *dcbGpuAddrs[], uint32_t *dcbSizesInBytes, void *ccbGpuAddrs[], uint32_t *ccbSizesInBytes, uint32_t videoOutHandle, uint32_t displayBufferIndex, uint32_t flipMode, int64_t flipArg);
+
+HOOK_INIT(sceGnmSubmitAndFlipCommandBuffers);
+HOOK_INIT(sceVideoOutSubmitFlip);
 
 // Todo: Move to sdk.
 static bool file_exists(const char *filename)
@@ -46,11 +89,24 @@ static void create_template_config(void)
                             "; Details for show_load_notification\n" \
                             "; Shows how many plugins were successfully loaded.\n" \
                             "; Valid options: false or true.\n" \
+                            "early_load_budget_ms=100\n" \
+                            "; Logs a warning for early plugins whose plugin_load takes longer.\n" \
+                            "; 0 disables the check.\n" \
+                            "idle_delay_ms=5000\n" \
+                            "; Delay between the first frame and loading idle plugins.\n" \
+                            "write_load_profile=false\n" \
+                            "; Writes per plugin load timings and memory use to " PLUGIN_PROFILE_PATH "\n" \
+                            "show_profile_notification=false\n" \
+                            "; Shows the slowest and heaviest plugins after loading.\n" \
+                            "telemetry_interval_ms=0\n" \
+                            "; Snapshots the shared telemetry bus to " GOLDHEN_PATH "/telemetry at this interval.\n" \
+                            "; 0 disables the bus.\n" \
                             "\n" \
                             "; Load plugins in default section regardless of Title ID\n" \
+                            "; Optional load phase: early (default), post_init, first_flip or idle\n" \
                             "[default]\n" \
                             ";/data/GoldHEN/plugins/example.prx\n" \
-                            ";/data/GoldHEN/plugins/example2.prx\n" \
+                            ";/data/GoldHEN/plugins/example2.prx=first_flip\n" \
                             "\n" \
                             "; Note: text following the ; are comments\n"
 
@@ -91,34 +147,144 @@ static bool simple_get_bool(const char *val)
     return true;
 }
 
-static size_t strncat_s(char *dest, size_t destSize, const char *source, size_t source_count)
+static bool get_entry_phase(const char *val, plugin_phase *phase)
 {
-    if (dest == NULL || destSize == 0 || source == NULL || source_count == 0)
+    *phase = PLUGIN_PHASE_EARLY;
+    if (val == NULL || val[0] == 0)
     {
-        return 0;
+        return true;
     }
+    for (uint32_t i = 0; i < PLUGIN_PHASE_MAX; i++)
+    {
+        if (strcmp(val, g_PhaseNames[i]) == 0)
+        {
+            *phase = (plugin_phase)i;
+            return true;
+        }
+    }
+    return simple_get_bool(val);
+}
 
-    size_t destLen = strlen(dest);
-    size_t srcLen = strlen(source);
+static uint64_t elapsed_ms(uint64_t start)
+{
+    return ((sceKernelGetProcessTimeCounter() - start) * 1000) / sceKernelGetProcessTimeCounterFrequency();
+}
 
-    if ((destLen + srcLen) >= destSize)
+static bool load_plugin(const char *path, plugin_phase phase, uint32_t *load_count, int argc, char **argv)
+{
+    plugin_record *record = profile_record_create(path, g_PhaseNames[phase]);
+    profile_memory_start(record);
+    bool load_success = false;
+    // `record' may be NULL, the profile functions ignore it.
+    profile_stage_start(record);
+    bool found = file_exists(path);
+    chmod(path, 0777);
+    sceKernelChmod(path, 0777);
+    profile_stage_stop(record, STAGE_VALIDATE);
+    if (!found)
     {
-        return 0;
+        final_printf("Plugin %s not found\n", path);
+        goto done;
     }
 
-    size_t copyLen = destSize - destLen - 1;
-    if (copyLen > source_count)
+    final_printf("Starting %s (%s)\n", path, g_PhaseNames[phase]);
+    profile_stage_start(record);
+    int32_t result = sceKernelLoadStartModule(path, 0, 0, 0, NULL, NULL);
+    profile_stage_stop(record, STAGE_MODULE);
+    if (record)
+    {
+        record->handle = result;
+        record->result = result;
+    }
+    if (result == 0x80020002)
+    {
+        final_printf("Plugin %s not found\n", path);
+        goto done;
+    }
+    else if (result < 0)
+    {
+        final_printf("Error loading Plugin %s! Error code 0x%08x (%i)\n", path, result, result);
+        goto done;
+    }
+
+    int32_t ret = 0;
+    const char** ModuleName = NULL;
+    // TODO: accept user provided arguments
+    int32_t (*plugin_load_ret)(int, char **) = NULL;
+    int32_t (*plugin_unload_ret)(int, char **) = NULL;
+    profile_stage_start(record);
+    ret = sceKernelDlsym(result, "g_pluginName", (void**)&ModuleName);
+    final_printf("Loaded Plugin %s\n", path);
+    final_printf("Plugin Handle 0x%08x Dlsym 0x%08x\n", result, ret);
+    ret = sceKernelDlsym(result, "plugin_load", (void**)&plugin_load_ret);
+    final_printf("plugin_load Dlsym 0x%08x @ 0x%p\n", ret, plugin_load_ret);
+    ret = sceKernelDlsym(result, "plugin_unload", (void**)&plugin_unload_ret);
+    final_printf("plugin_unload Dlsym 0x%08x @ 0x%p\n", ret, plugin_unload_ret);
+    profile_stage_stop(record, STAGE_SYMBOLS);
+    if (record)
+    {
+        if (ModuleName && *ModuleName)
+        {
+            snprintf(record->name, sizeof(record->name), "%s", *ModuleName);
+        }
+        else
+        {
+            final_printf("Failed to resolve g_pluginName string!\n");
+        }
+    }
+    if (!plugin_load_ret || !plugin_unload_ret)
+    {
+        final_printf("Unable to find plugin_load or plugin_unload!\n");
+        goto done;
+    }
+
+    final_printf("Starting plugin...\n");
+    uint64_t load_start = sceKernelGetProcessTimeCounter();
+    profile_stage_start(record);
+    int32_t prx_ret = plugin_load_ret(argc, argv);
+    profile_stage_stop(record, STAGE_PLUGIN_LOAD);
+    uint64_t load_ms = elapsed_ms(load_start);
+    final_printf("plugin_load returned with 0x%08x in %lu ms\n", prx_ret, load_ms);
+    if (record)
+    {
+        record->result = prx_ret;
+    }
+    if (phase == PLUGIN_PHASE_EARLY && g_EarlyLoadBudgetMs && load_ms > g_EarlyLoadBudgetMs)
+    {
+        final_printf("[watchdog] %s plugin_load took %lu ms, over the early budget of %u ms.\n", path, load_ms, g_EarlyLoadBudgetMs);
+        final_printf("[watchdog] Consider loading it with =post_init, =first_flip or =idle.\n");
+    }
+    if (prx_ret)
     {
-        copyLen = source_count;
+        final_printf("Program returned non zero, Starting plugin_unload...\n");
+        int32_t prx_ret = plugin_unload_ret(argc, argv);
+        final_printf("plugin_unload returned with 0x%08x\n", prx_ret);
+        goto done;
     }
 
-    for (size_t i = 0; i < copyLen; i++)
+    final_printf("plugin_load exit successful 0x%08x\n", prx_ret);
+    *load_count += 1;
+    load_success = true;
+
+done:
+    profile_memory_stop(record);
+    if (record)
     {
-        dest[destLen + i] = source[i];
+        record->loaded = load_success;
     }
+    return load_success;
+}
 
-    dest[destLen + copyLen] = '\0';
-    return destLen + copyLen;
+static void finish_load_profile(void)
+{
+    if (g_WriteLoadProfile)
+    {
+        profile_write_csv(PLUGIN_PROFILE_PATH);
+    }
+    if (g_ShowProfileNotification)
+    {
+        profile_notify_summary();
+    }
 }
 
 static void load_plugins(ini_section_s *section, uint32_t *load_count, int argc, char **argv)
@@ -128,7 +294,8 @@ static void load_plugins(ini_section_s *section, uint32_t *load_count, int argc,
     {
         ini_entry_s *entry = &section->entry[j];
         final_printf("%s=%s\n", entry->key, entry->value);
-        if (!simple_get_bool(entry->value))
+        plugin_phase phase = PLUGIN_PHASE_EARLY;
+        if (!get_entry_phase(entry->value, &phase))
         {
             final_printf("Skipping entry (%s)\n", entry->value);
             continue;
@@ -148,81 +315,135 @@ static void load_plugins(ini_section_s *section, uint32_t *load_count, int argc,
             }
             continue;
         }
-        chmod(entry->key, 0777);
-        sceKernelChmod(entry->key, 0777);
-        final_printf("Starting %s\n", entry->key);
-        int32_t result = sceKernelLoadStartModule(entry->key, 0, 0, 0, NULL, NULL);
-        if (result == 0x80020002)
-        {
-            final_printf("Plugin %s not found\n", entry->key);
-        } else if (result < 0)
+        if (phase != PLUGIN_PHASE_EARLY)
         {
-            final_printf("Error loading Plugin %s! Error code 0x%08x (%i)\n", entry->key, result, result);
-        } else
-        {
-            int32_t ret = 0;
-            bool load_success = false;
-            const char** ModuleName = NULL;
-            // TODO: accept user provided arguments
-            int32_t (*plugin_load_ret)(int, char **) = NULL;
-            int32_t (*plugin_unload_ret)(int, char **) = NULL;
-            ret = sceKernelDlsym(result, "g_pluginName", (void**)&ModuleName);
-            final_printf("Loaded Plugin %s\n", entry->key);
-            final_printf("Plugin Handle 0x%08x Dlsym 0x%08x\n", result, ret);
-            ret = sceKernelDlsym(result, "plugin_load", (void**)&plugin_load_ret);
-            final_printf("plugin_load Dlsym 0x%08x @ 0x%p\n", ret, plugin_load_ret);
-            ret = sceKernelDlsym(result, "plugin_unload", (void**)&plugin_unload_ret);
-            final_printf("plugin_unload Dlsym 0x%08x @ 0x%p\n", ret, plugin_unload_ret);
-            if (plugin_load_ret && plugin_unload_ret)
+            if (g_DeferredCount >= MAX_DEFERRED_PLUGINS)
             {
-                final_printf("Starting plugin...\n");
-                int32_t prx_ret = plugin_load_ret(argc,argv);
-                final_printf("plugin_load returned with 0x%08x\n", prx_ret);
-                if (prx_ret || prx_ret < 0)
-                {
-                    final_printf("Program returned non zero, Starting plugin_unload...\n");
-                    int32_t prx_ret = plugin_unload_ret(argc, argv);
-                    final_printf("plugin_unload returned with 0x%08x\n", prx_ret);
-                }
-                else if (prx_ret == 0)
-                {
-                    final_printf("plugin_load exit successful 0x%08x\n", prx_ret);
-                    *load_count += 1;
-                    load_success = true;
-                }
+                final_printf("Too many deferred plugins, loading %s early\n", entry->key);
             }
             else
             {
-                final_printf("Unable to find plugin_load or plugin_unload!\n");
-                load_success = false;
+                plugin_entry *deferred = &g_DeferredPlugins[g_DeferredCount++];
+                snprintf(deferred->path, sizeof(deferred->path), "%s", entry->key);
+                deferred->phase = phase;
+                final_printf("Deferring %s to %s\n", entry->key, g_PhaseNames[phase]);
                 continue;
             }
-            char plugin_entry[128] = {0};
-            if (ModuleName && load_success)
-            {
-                snprintf(plugin_entry, sizeof(plugin_entry), "%u. %s\n", *load_count, *ModuleName);
-            }
-            else if (!ModuleName)
-            {
-                final_printf("Failed to resolve g_pluginName string!\n");
-                snprintf(plugin_entry, sizeof(plugin_entry), "%u. unknown\n", *load_count);
-            }
-            else if (strlen(g_PluginDetails) >= sizeof(g_PluginDetails))
-            {
-                final_printf("String size of g_PluginDetails is too large!\n");
-                final_printf("g_PluginDetails: %s\n", g_PluginDetails);
-                final_printf("strlen(g_PluginDetails): %li\n", strlen(g_PluginDetails));
-            }
-            if (!strncat_s(g_PluginDetails, sizeof(g_PluginDetails), plugin_entry, strlen(plugin_entry)))
-            {
-                final_printf("Failed to concatenate string!\n");
-                final_printf("g_PluginDetails: %s\n", g_PluginDetails);
-                final_printf("strlen(g_PluginDetails): %li\n", strlen(g_PluginDetails));
-                final_printf("sizeof(g_PluginDetails): %li\n", sizeof(g_PluginDetails));
-                final_printf("plugin_entry: %s\n", plugin_entry);
-                final_printf("strlen(plugin_entry): %li\n", strlen(plugin_entry));
-            }
         }
+        load_plugin(entry->key, PLUGIN_PHASE_EARLY, load_count, argc, argv);
+    }
+}
+
+// The flip hooks stay for the session: unhooking patches the entry points back while the
+// render thread may be inside them, one check per flip is cheaper than that risk.
+// first_flip plugins hooking the same functions chain onto them.
+static void set_first_flip(void)
+{
+    if (!g_FirstFlip)
+    {
+        g_FirstFlip = true;
+    }
+}
+
+int32_t sceGnmSubmitAndFlipCommandBuffers_hook(uint32_t count, void *dcbGpuAddrs[], uint32_t *dcbSizesInBytes, void *ccbGpuAddrs[], uint32_t *ccbSizesInBytes, uint32_t videoOutHandle, uint32_t displayBufferIndex, uint32_t flipMode, int64_t flipArg)
+{
+    set_first_flip();
+    return HOOK_CONTINUE(sceGnmSubmitAndFlipCommandBuffers,
+                         int32_t(*)(uint32_t, void **, uint32_t *, void **, uint32_t *, uint32_t, uint32_t, uint32_t, int64_t),
+                         count, dcbGpuAddrs, dcbSizesInBytes, ccbGpuAddrs, ccbSizesInBytes, videoOutHandle, displayBufferIndex, flipMode, flipArg);
+}
+
+int32_t sceVideoOutSubmitFlip_hook(int32_t handle, int32_t indexBuffer, int32_t flipMode, int64_t flipArg)
+{
+    set_first_flip();
+    return HOOK_CONTINUE(sceVideoOutSubmitFlip,
+                         int32_t(*)(int32_t, int32_t, int32_t, int64_t),
+                         handle, indexBuffer, flipMode, flipArg);
+}
+
+static void load_deferred_phase(plugin_phase phase, uint32_t *load_count)
+{
+    for (uint32_t i = 0; i < g_DeferredCount; i++)
+    {
+        if (g_DeferredPlugins[i].phase == phase)
+        {
+            load_plugin(g_DeferredPlugins[i].path, phase, load_count, g_LoaderArgc, g_LoaderArgv);
+        }
+    }
+}
+
+static bool has_deferred_phase(plugin_phase phase)
+{
+    for (uint32_t i = 0; i < g_DeferredCount; i++)
+    {
+        if (g_DeferredPlugins[i].phase == phase)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void *plugin_deferred_thread(void *args)
+{
+    final_printf("%s: Started with %u plugin(s)\n", __func__, g_DeferredCount);
+    uint32_t load_count = 0;
+    uint64_t start = sceKernelGetProcessTimeCounter();
+
+    load_deferred_phase(PLUGIN_PHASE_POST_INIT, &load_count);
+
+    if (has_deferred_phase(PLUGIN_PHASE_FIRST_FLIP) || has_deferred_phase(PLUGIN_PHASE_IDLE))
+    {
+        while (!g_FirstFlip && elapsed_ms(start) < FIRST_FLIP_TIMEOUT_MS)
+        {
+            sceKernelUsleep(10 * 1000);
+        }
+        final_printf("%s: %s after %lu ms\n", __func__, g_FirstFlip ? "First flip" : "First flip timed out", elapsed_ms(start));
+        load_deferred_phase(PLUGIN_PHASE_FIRST_FLIP, &load_count);
+    }
+
+    if (has_deferred_phase(PLUGIN_PHASE_IDLE))
+    {
+        scePthreadSetprio(scePthreadSelf(), ORBIS_KERNEL_PRIO_FIFO_LOWEST);
+        sceKernelUsleep(g_IdleDelayMs * 1000);
+        load_deferred_phase(PLUGIN_PHASE_IDLE, &load_count);
+    }
+
+    if (g_ShowLoadNotification && load_count > 0)
+    {
+        Notify(TEX_ICON_SYSTEM, "Loaded %u deferred plugin(s)", load_count);
+    }
+    finish_load_profile();
+    final_printf("%s: Exit\n", __func__);
+    scePthreadExit(NULL);
+    return NULL;
+}
+
+static void start_deferred_loading(int argc, char **argv)
+{
+    if (g_DeferredCount == 0)
+    {
+        finish_load_profile();
+        return;
+    }
+    g_LoaderArgc = argc;
+    g_LoaderArgv = argv;
+    if (has_deferred_phase(PLUGIN_PHASE_FIRST_FLIP) || has_deferred_phase(PLUGIN_PHASE_IDLE))
+    {
+        HOOK32(sceGnmSubmitAndFlipCommandBuffers);
+        HOOK32(sceVideoOutSubmitFlip);
+    }
+    OrbisPthread thread;
+    int32_t ret = scePthreadCreate(&thread, NULL, plugin_deferred_thread, NULL, STRINGIFY(plugin_deferred_thread));
+    if (ret)
+    {
+        final_printf("scePthreadCreate: 0x%08x, loading deferred plugins inline\n", ret);
+        uint32_t load_count = 0;
+        for (uint32_t i = 0; i < g_DeferredCount; i++)
+        {
+            load_plugin(g_DeferredPlugins[i].path, g_DeferredPlugins[i].phase, &load_count, argc, argv);
+        }
+        finish_load_profile();
     }
 }
 
@@ -243,6 +464,7 @@ static int load(int *argc, char **argv)
     }
 
     final_printf("Plugin Manager started successfully\n");
+    config_cache_init(procInfo.titleid);
 
 
     // Better done in GoldHEN
@@ -278,7 +500,9 @@ static int load(int *argc, char **argv)
 
     // final_printf("Section is TitleID [%s]\n", procInfo.titleid);
     bool show_load_notification = false;
+    uint32_t telemetry_interval_ms = 0;
     uint32_t load_count = 0;
+    g_DeferredCount = 0;
 
     for (uint32_t i = 0; i < config->size; i++)
     {
@@ -299,8 +523,44 @@ static int load(int *argc, char **argv)
                     show_load_notification = simple_get_bool(entry->value);
                     final_printf("%s=%u\n", entry->key, show_load_notification);
                 }
+                else if (strcmp("early_load_budget_ms", entry->key) == 0)
+                {
+                    g_EarlyLoadBudgetMs = (uint32_t)atoi(entry->value);
+                    final_printf("%s=%u\n", entry->key, g_EarlyLoadBudgetMs);
+                }
+                else if (strcmp("write_load_profile", entry->key) == 0)
+                {
+                    g_WriteLoadProfile = simple_get_bool(entry->value);
+                    final_printf("%s=%u\n", entry->key, g_WriteLoadProfile);
+                }
+                else if (strcmp("show_profile_notification", entry->key) == 0)
+                {
+                    g_ShowProfileNotification = simple_get_bool(entry->value);
+                    final_printf("%s=%u\n", entry->key, g_ShowProfileNotification);
+                }
+                else if (strcmp("idle_delay_ms", entry->key) == 0)
+                {
+                    g_IdleDelayMs = (uint32_t)atoi(entry->value);
+                    final_printf("%s=%u\n", entry->key, g_IdleDelayMs);
+                }
+                else if (strcmp("telemetry_interval_ms", entry->key) == 0)
+                {
+                    telemetry_interval_ms = (uint32_t)atoi(entry->value);
+                    final_printf("%s=%u\n", entry->key, telemetry_interval_ms);
+                }
             }
         }
+    }
+
+    // The bus has to exist before the first plugin registers into it.
+    telemetry_bus_init(procInfo.titleid, telemetry_interval_ms);
+
+    for (uint32_t i = 0; i < config->size; i++)
+    {
+        ini_section_s *section = &config->section[i];
+
+        if (section == NULL)
+            continue;
 
         if (strcmp(section->name, PLUGIN_DEFAULT_SECTION) == 0)
         {
@@ -318,14 +578,10 @@ static int load(int *argc, char **argv)
     {
         if (load_count > 0)
         {
-            char notify_msg[128] = {0};
-            // trim newline
-            size_t PluginLen = strlen(g_PluginDetails) - 1;
-            if (g_PluginDetails[PluginLen] == '\n')
-            {
-                g_PluginDetails[PluginLen] = '\0';
-            }
-            snprintf(notify_msg, sizeof(notify_msg), "Loaded %u plugin(s)\n%s", load_count, g_PluginDetails);
+            char plugin_details[512] = {0};
+            char notify_msg[600] = {0};
+            profile_format_loaded(plugin_details, sizeof(plugin_details));
+            snprintf(notify_msg, sizeof(notify_msg), "Loaded %u plugin(s)\n%s", load_count, plugin_details);
             NotifyStatic(TEX_ICON_SYSTEM, notify_msg);
         }
     }
@@ -334,6 +590,9 @@ static int load(int *argc, char **argv)
     {
         ini_table_destroy(config);
     }
+
+    g_ShowLoadNotification = show_load_notification;
+    start_deferred_loading(*argc, argv);
     return 0;
 }
 
@@ -354,11 +613,9 @@ static s32 get_module_info(const char *name, OrbisKernelModuleInfo *module_out,
         struct OrbisKernelModuleInfo moduleInfo = {0};
         moduleInfo.size = sizeof(moduleInfo);
         ret = sceKernelGetModuleInfo(handles[i], &moduleInfo);
-        final_printf("ret 0x%x\n", ret);
-        final_printf("module %d\n", handles[i]);
-        final_printf("name: %s\n", moduleInfo.name);
-        final_printf("start: 0x%lx\n", (uint64_t)moduleInfo.segmentInfo[0].address);
-        final_printf("size: %u (0x%08x) bytes\n", moduleInfo.segmentInfo[0].size, moduleInfo.segmentInfo[0].size);
+        final_printf("ret 0x%x module %d name: %s start: 0x%lx size: %u (0x%08x) bytes\n",
+                 ret, handles[i], moduleInfo.name, (uint64_t)moduleInfo.segmentInfo[0].address,
+                 moduleInfo.segmentInfo[0].size, moduleInfo.segmentInfo[0].size);
         if (ret)
         {
             final_printf("sceKernelGetModuleInfo (%X)\n", ret);
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <orbis/libkernel.h>
+
+#include "plugin_common.h"
+#include "profile.h"
+
+// libc heap statistics, not exposed by the toolchain headers.
+typedef struct SceLibcMallocManagedSize
+{
+    uint16_t size;
+    uint16_t version;
+    uint32_t reserved1;
+    size_t maxSystemSize;
+    size_t currentSystemSize;
+    size_t maxInuseSize;
+    size_t currentInuseSize;
+} SceLibcMallocManagedSize;
+
+int malloc_stats_fast(SceLibcMallocManagedSize *ManagedSize);
+
+#define PROFILE_SUMMARY_COUNT 3
+
+static const char *g_StageNames[STAGE_MAX] = {"validate_us", "module_us", "symbols_us", "plugin_load_us"};
+
+static plugin_record *g_RecordHead = NULL;
+static plugin_record *g_RecordTail = NULL;
+
+static uint64_t get_heap_in_use(void)
+{
+    SceLibcMallocManagedSize ManagedSize = {0};
+    ManagedSize.size = sizeof(ManagedSize);
+    ManagedSize.version = 1;
+    if (malloc_stats_fast(&ManagedSize) != 0)
+    {
+        return 0;
+    }
+    return ManagedSize.currentInuseSize;
+}
+
+static uint64_t get_flexible_available(void)
+{
+    size_t available = 0;
+    if (sceKernelAvailableFlexibleMemorySize(&available) != 0)
+    {
+        return 0;
+    }
+    return available;
+}
+
+static uint64_t get_total_us(const plugin_record *record)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < STAGE_MAX; i++)
+    {
+        total += record->stage_us[i];
+    }
+    return total;
+}
+
+plugin_record *profile_record_create(const char *path, const char *phase)
+{
+    plugin_record *record = (plugin_record *)calloc(1, sizeof(plugin_record));
+    if (record == NULL)
+    {
+        final_printf("Failed to allocate record for %s\n", path);
+        return NULL;
+    }
+    snprintf(record->path, sizeof(record->path), "%s", path);
+    snprintf(record->name, sizeof(record->name), "unknown");
+    record->phase = phase;
+    if (g_RecordTail)
+    {
+        g_RecordTail->next = record;
+    }
+    else
+    {
+        g_RecordHead = record;
+    }
+    g_RecordTail = record;
+    return record;
+}
+
+plugin_record *profile_records(void)
+{
+    return g_RecordHead;
+}
+
+void profile_stage_start(plugin_record *record)
+{
+    if (record)
+    {
+        record->stage_start = sceKernelGetProcessTimeCounter();
+    }
+}
+
+void profile_stage_stop(plugin_record *record, plugin_stage stage)
+{
+    if (record)
+    {
+        uint64_t ticks = sceKernelGetProcessTimeCounter() - record->stage_start;
+        record->stage_us[stage] += (ticks * 1000000) / sceKernelGetProcessTimeCounterFrequency();
+    }
+}
+
+void profile_memory_start(plugin_record *record)
+{
+    if (record)
+    {
+        record->heap_start = get_heap_in_use();
+        record->flexible_start = get_flexible_available();
+    }
+}
+
+void profile_memory_stop(plugin_record *record)
+{
+    if (record)
+    {
+        record->heap_delta = (int64_t)(get_heap_in_use() - record->heap_start);
+        // Flexible memory backs module segments and plugin mmaps,
+        // so the drop in available size is what the plugin has mapped.
+        record->mapped_delta = (int64_t)(record->flexible_start - get_flexible_available());
+    }
+}
+
+uint32_t profile_format_loaded(char *buf, size_t size)
+{
+    uint32_t count = 0;
+    size_t len = 0;
+    buf[0] = '\0';
+    for (plugin_record *record = g_RecordHead; record; record = record->next)
+    {
+        if (!record->loaded)
+        {
+            continue;
+        }
+        count++;
+        if (len < size)
+        {
+            int written = snprintf(buf + len, size - len, "%s%u. %s", count > 1 ? "\n" : "", count, record->name);
+            if (written > 0)
+            {
+                len += written;
+            }
+        }
+    }
+    return count;
+}
+
+bool profile_write_csv(const char *file)
+{
+    // Todo: Move to sdk.
+    int32_t f = sceKernelOpen(file, 0x200 | 0x400 | 0x001, 0777);
+    if (f < 0)
+    {
+        final_printf("Failed to create file \"%s\" 0x%08x\n", file, f);
+        return false;
+    }
+    char line[512] = {0};
+    int len = snprintf(line, sizeof(line), "path,name,phase,result,loaded,%s,%s,%s,%s,total_us,heap_delta,mapped_delta\n",
+                       g_StageNames[STAGE_VALIDATE], g_StageNames[STAGE_MODULE], g_StageNames[STAGE_SYMBOLS], g_StageNames[STAGE_PLUGIN_LOAD]);
+    sceKernelWrite(f, line, len);
+    for (plugin_record *record = g_RecordHead; record; record = record->next)
+    {
+        len = snprintf(line, sizeof(line), "%s,%s,%s,0x%08x,%u,%lu,%lu,%lu,%lu,%lu,%li,%li\n",
+                       record->path, record->name, record->phase, record->result, record->loaded,
+                       record->stage_us[STAGE_VALIDATE], record->stage_us[STAGE_MODULE],
+                       record->stage_us[STAGE_SYMBOLS], record->stage_us[STAGE_PLUGIN_LOAD],
+                       get_total_us(record), record->heap_delta, record->mapped_delta);
+        if (len > 0)
+        {
+            sceKernelWrite(f, line, len < (int)sizeof(line) ? len : (int)sizeof(line) - 1);
+        }
+    }
+    sceKernelClose(f);
+    final_printf("Wrote load profile to %s\n", file);
+    return true;
+}
+
+static void insert_top(plugin_record **top, int64_t *top_value, plugin_record *record, int64_t value)
+{
+    for (uint32_t i = 0; i < PROFILE_SUMMARY_COUNT; i++)
+    {
+        if (top[i] == NULL || value > top_value[i])
+        {
+            for (uint32_t j = PROFILE_SUMMARY_COUNT - 1; j > i; j--)
+            {
+                top[j] = top[j - 1];
+                top_value[j] = top_value[j - 1];
+            }
+            top[i] = record;
+            top_value[i] = value;
+            return;
+        }
+    }
+}
+
+void profile_notify_summary(void)
+{
+    plugin_record *slowest[PROFILE_SUMMARY_COUNT] = {0};
+    plugin_record *heaviest[PROFILE_SUMMARY_COUNT] = {0};
+    int64_t slowest_us[PROFILE_SUMMARY_COUNT] = {0};
+    int64_t heaviest_bytes[PROFILE_SUMMARY_COUNT] = {0};
+    for (plugin_record *record = g_RecordHead; record; record = record->next)
+    {
+        insert_top(slowest, slowest_us, record, (int64_t)get_total_us(record));
+        insert_top(heaviest, heaviest_bytes, record, record->heap_delta + record->mapped_delta);
+    }
+    if (slowest[0] == NULL)
+    {
+        return;
+    }
+    char msg[512] = {0};
+    size_t len = snprintf(msg, sizeof(msg), "Slowest plugins:");
+    for (uint32_t i = 0; i < PROFILE_SUMMARY_COUNT && slowest[i] && len < sizeof(msg); i++)
+    {
+        len += snprintf(msg + len, sizeof(msg) - len, "\n%s %lu ms", slowest[i]->name, slowest_us[i] / 1000);
+    }
+    if (len < sizeof(msg))
+    {
+        len += snprintf(msg + len, sizeof(msg) - len, "\nHeaviest plugins:");
+    }
+    for (uint32_t i = 0; i < PROFILE_SUMMARY_COUNT && heaviest[i] && len < sizeof(msg); i++)
+    {
+        len += snprintf(msg + len, sizeof(msg) - len, "\n%s %li KB", heaviest[i]->name, heaviest_bytes[i] / 1024);
+    }
+    NotifyStatic(TEX_ICON_SYSTEM, msg);
+}
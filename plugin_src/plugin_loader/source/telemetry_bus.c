@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <orbis/libkernel.h>
+
+#include "plugin_common.h"
+#include "telemetry_bus.h"
+
+#define TELEMETRY_PATH GOLDHEN_PATH "/telemetry"
+#define TELEMETRY_MAP_ALIGN (16 * 1024)
+#define TELEMETRY_FILE_BUFFER (16 * 1024)
+
+static telemetry_bus *g_TelemetryBus = NULL;
+static uint32_t g_TelemetryInterval = 0;
+static int32_t g_TelemetryFd = -1;
+
+// Only touched by the snapshot thread.
+static uint8_t g_TelemetryBuffer[TELEMETRY_FILE_BUFFER];
+static uint32_t g_TelemetryBufferUsed = 0;
+static bool g_TelemetryDefined[TELEMETRY_SLOTS];
+
+attr_public telemetry_bus *plugin_telemetry_get_bus(void) {
+    return g_TelemetryBus;
+}
+
+static void telemetry_flush(void) {
+    if (g_TelemetryBufferUsed) {
+        sceKernelWrite(g_TelemetryFd, g_TelemetryBuffer, g_TelemetryBufferUsed);
+    }
+    g_TelemetryBufferUsed = 0;
+}
+
+static void telemetry_write(const void *data, uint32_t size) {
+    if (g_TelemetryBufferUsed + size > sizeof(g_TelemetryBuffer)) {
+        telemetry_flush();
+    }
+    memcpy(g_TelemetryBuffer + g_TelemetryBufferUsed, data, size);
+    g_TelemetryBufferUsed += size;
+}
+
+static void telemetry_snapshot(void) {
+    const uint32_t used = __atomic_load_n(&g_TelemetryBus->used, __ATOMIC_ACQUIRE);
+    const uint32_t count = used < g_TelemetryBus->slot_count ? used : g_TelemetryBus->slot_count;
+    uint16_t ready = 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        telemetry_slot *slot = &g_TelemetryBus->slot[i];
+        if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != TELEMETRY_SLOT_READY) {
+            continue;
+        }
+        ready++;
+        if (!g_TelemetryDefined[i]) {
+            const uint8_t kind = TELEMETRY_ENTRY_SLOT;
+            const uint8_t type = (uint8_t)slot->type;
+            telemetry_write(&kind, sizeof(kind));
+            telemetry_write(&i, sizeof(i));
+            telemetry_write(&type, sizeof(type));
+            telemetry_write(slot->owner, sizeof(slot->owner));
+            telemetry_write(slot->name, sizeof(slot->name));
+            g_TelemetryDefined[i] = true;
+        }
+    }
+
+    const uint8_t kind = TELEMETRY_ENTRY_SNAPSHOT;
+    const uint64_t now = sceKernelGetProcessTimeCounter();
+    telemetry_write(&kind, sizeof(kind));
+    telemetry_write(&now, sizeof(now));
+    telemetry_write(&ready, sizeof(ready));
+    for (uint16_t i = 0; i < count; i++) {
+        telemetry_slot *slot = &g_TelemetryBus->slot[i];
+        if (!g_TelemetryDefined[i]) {
+            continue;
+        }
+        const uint64_t value = __atomic_load_n(&slot->value, __ATOMIC_RELAXED);
+        const uint64_t samples = __atomic_load_n(&slot->count, __ATOMIC_RELAXED);
+        telemetry_write(&i, sizeof(i));
+        telemetry_write(&value, sizeof(value));
+        telemetry_write(&samples, sizeof(samples));
+        if (slot->type == TELEMETRY_HISTOGRAM) {
+            for (uint32_t b = 0; b < TELEMETRY_BUCKETS; b++) {
+                const uint64_t bucket = __atomic_load_n(&slot->bucket[b], __ATOMIC_RELAXED);
+                telemetry_write(&bucket, sizeof(bucket));
+            }
+        }
+    }
+    telemetry_flush();
+}
+
+static void *telemetry_thread(void *args) {
+    scePthreadSetprio(scePthreadSelf(), ORBIS_KERNEL_PRIO_FIFO_LOWEST);
+    for (;;) {
+        sceKernelUsleep(g_TelemetryInterval * 1000);
+        telemetry_snapshot();
+    }
+    scePthreadExit(NULL);
+    return NULL;
+}
+
+void telemetry_bus_init(const char *titleid, uint32_t interval_ms) {
+    if (interval_ms == 0 || g_TelemetryBus) {
+        return;
+    }
+
+    void *addr = NULL;
+    const size_t size = (sizeof(telemetry_bus) + TELEMETRY_MAP_ALIGN - 1) & ~(size_t)(TELEMETRY_MAP_ALIGN - 1);
+    int32_t ret = sceKernelMapNamedFlexibleMemory(&addr, size, 0x01 | 0x02, 0, "GoldHEN telemetry");
+    if (ret != 0) {
+        final_printf("telemetry: sceKernelMapNamedFlexibleMemory: 0x%08x\n", ret);
+        return;
+    }
+    telemetry_bus *bus = (telemetry_bus *)addr;
+    memset(bus, 0, size);
+    bus->magic = TELEMETRY_MAGIC;
+    bus->version = TELEMETRY_VERSION;
+    bus->slot_count = TELEMETRY_SLOTS;
+
+    char path[MAX_PATH_] = {0};
+    sceKernelMkdir(TELEMETRY_PATH, 0777);
+    snprintf(path, sizeof(path), TELEMETRY_PATH "/%s_%ld.bin", titleid, (long)time(NULL));
+    g_TelemetryFd = sceKernelOpen(path, 0x200 | 0x400 | 0x001, 0777);
+    if (g_TelemetryFd < 0) {
+        final_printf("telemetry: failed to open %s (0x%08x)\n", path, g_TelemetryFd);
+        sceKernelMunmap(addr, size);
+        return;
+    }
+    telemetry_file_header header = {0};
+    header.magic = TELEMETRY_FILE_MAGIC;
+    header.version = TELEMETRY_VERSION;
+    header.frequency = sceKernelGetProcessTimeCounterFrequency();
+    telemetry_write(&header, sizeof(header));
+    telemetry_flush();
+
+    g_TelemetryInterval = interval_ms;
+    g_TelemetryBus = bus;
+    OrbisPthread thread;
+    ret = scePthreadCreate(&thread, NULL, telemetry_thread, NULL, "telemetry_thread");
+    if (ret != 0) {
+        final_printf("telemetry: scePthreadCreate: 0x%08x\n", ret);
+        sceKernelClose(g_TelemetryFd);
+        g_TelemetryFd = -1;
+        g_TelemetryBus = NULL;
+        sceKernelMunmap(addr, size);
+        return;
+    }
+    final_printf("telemetry: %u slot(s), snapshot every %u ms to %s\n", bus->slot_count, interval_ms, path);
+}
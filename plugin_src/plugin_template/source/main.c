@@ -22,6 +22,7 @@ int32_t attr_public plugin_load(int32_t argc, const char* argv[]) {
 int32_t attr_public plugin_unload(int32_t argc, const char* argv[]) {
     final_printf("[GoldHEN] <%s\\Ver.0x%08x> %s\n", g_pluginName, g_pluginVersion, __func__);
     final_printf("[GoldHEN] %s Plugin Ended.\n", g_pluginName);
+    NotifyShutdown();
     return 0;
 }
 
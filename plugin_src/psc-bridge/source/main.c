@@ -5,6 +5,8 @@
 #include "../include/dualsense.h"
 #include <Detour.h>
 #include "plugin_common.h"
+#include "plugin_heap.h"
+#include "trace.h"
 
 void* DetourFunction(const char* library, const char* symbol, void* hook, void** original) {
     int handle = 0;
@@ -13,7 +15,7 @@ void* DetourFunction(const char* library, const char* symbol, void* hook, void**
     if (sys_dynlib_load_prx(library, &handle) == 0 || handle != 0) {
         if (sys_dynlib_dlsym(handle, symbol, &func_ptr) == 0 && func_ptr != NULL) {
             
-            Detour* detour = (Detour*)malloc(sizeof(Detour));
+            Detour* detour = (Detour*)plugin_heap_alloc(sizeof(Detour));
             if (!detour) return NULL;
             
             Detour_Construct(detour, DetourMode_x64);
@@ -189,6 +191,7 @@ void check_usb_device() {
 }
 
 int hooked_scePadRead(int handle, ScePadData* data, int count) {
+    TRACE_SCOPE("scePadRead");
     int ret = 0;
     if (original_scePadRead) {
         ret = original_scePadRead(handle, data, count);
@@ -206,6 +209,7 @@ int hooked_scePadRead(int handle, ScePadData* data, int count) {
             }
         } else if (r < 0 && r != -99) { 
              if (r != -7) { 
+                 TRACE_INSTANT("ds5_disconnect", r);
                  NotifyStatic(TEX_ICON_SYSTEM, "DualSense Disconnected");
                  sceUsbdReleaseInterface(dev_handle, 0);
                  sceUsbdClose(dev_handle);
@@ -222,6 +226,10 @@ int32_t attr_public plugin_load(int32_t argc, const char* argv[]) {
     snprintf(msg, sizeof(msg), "DualSense Bridge Loaded");
     NotifyStatic(TEX_ICON_SYSTEM, msg);
     
+    // One Detour per hook, they are never restored so the heap is not shut down.
+    plugin_heap_init(g_pluginName, 16 * 1024, 0);
+    trace_start(g_pluginName);
+
     sceUsbdInit(&ctx);
     
     keepalive_running = 1;
@@ -241,6 +249,8 @@ int32_t attr_public plugin_unload(int32_t argc, const char* argv[]) {
         sceUsbdClose(dev_handle);
     }
     if (ctx) sceUsbdExit(ctx);
+    trace_stop();
+    NotifyShutdown();
     
     return 0;
 }
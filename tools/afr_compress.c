@@ -0,0 +1,196 @@
+// afr_compress: Builds a chunk-compressed afr override from a file.
+// Usage: afr_compress <file> [out.afrz]
+// The output defaults to `<file>.afrz'. Put it where the plain override would be, e.g.
+// /data/GoldHEN/AFR/CUSA00001/sound/music.bin.afrz overrides /app0/sound/music.bin.
+// Blocks LZ4 can not shrink are stored raw, so already compressed data costs little.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "afr_chunk.h"
+#include "afr_lz4.h"
+
+#define HASH_BITS   12
+#define MIN_MATCH   4
+#define LAST_LITERALS 5  // a block ends in at least this many literals
+#define MATCH_LIMIT 12   // and its last match starts at least this far before the end
+
+static uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Appends a length continued after a nibble of 15.
+static uint8_t *put_length(uint8_t *op, const uint8_t *oend, size_t length)
+{
+    for (; length >= 255; length -= 255) {
+        if (op >= oend) {
+            return NULL;
+        }
+        *op++ = 255;
+    }
+    if (op >= oend) {
+        return NULL;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+static uint8_t *put_sequence(uint8_t *op, const uint8_t *oend, const uint8_t *literals, size_t count,
+                             size_t offset, size_t match)
+{
+    if (op >= oend) {
+        return NULL;
+    }
+    uint8_t *token = op++;
+    *token = (uint8_t)((count < 15 ? count : 15) << 4);
+    if (count >= 15 && !(op = put_length(op, oend, count - 15))) {
+        return NULL;
+    }
+    if ((size_t)(oend - op) < count) {
+        return NULL;
+    }
+    memcpy(op, literals, count);
+    op += count;
+    if (!match) {
+        return op;
+    }
+    if (oend - op < 2) {
+        return NULL;
+    }
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    match -= MIN_MATCH;
+    *token |= (uint8_t)(match < 15 ? match : 15);
+    if (match >= 15 && !(op = put_length(op, oend, match - 15))) {
+        return NULL;
+    }
+    return op;
+}
+
+// Greedy LZ4 block encoder, returns 0 when the block does not fit `capacity'.
+static size_t lz4_encode(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity)
+{
+    int32_t table[1 << HASH_BITS];
+    memset(table, 0xff, sizeof(table));
+    const uint8_t *oend = dst + capacity;
+    uint8_t *op = dst;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (size > MATCH_LIMIT && pos < size - MATCH_LIMIT) {
+        const uint32_t h = hash4(read32(src + pos));
+        const int32_t candidate = table[h];
+        table[h] = (int32_t)pos;
+        if (candidate < 0 || pos - (size_t)candidate > 0xffff || read32(src + candidate) != read32(src + pos)) {
+            pos++;
+            continue;
+        }
+        size_t match = MIN_MATCH;
+        while (pos + match < size - LAST_LITERALS && src[candidate + match] == src[pos + match]) {
+            match++;
+        }
+        op = put_sequence(op, oend, src + anchor, pos - anchor, pos - (size_t)candidate, match);
+        if (!op) {
+            return 0;
+        }
+        pos += match;
+        anchor = pos;
+    }
+    op = put_sequence(op, oend, src + anchor, size - anchor, 0, 0);
+    return op ? (size_t)(op - dst) : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "usage: %s <file> [out" AFR_CHUNK_SUFFIX "]\n", argv[0]);
+        return 1;
+    }
+    char output[4096];
+    if (snprintf(output, sizeof(output), "%s%s", argc == 3 ? argv[2] : argv[1], argc == 3 ? "" : AFR_CHUNK_SUFFIX) >=
+        (int)sizeof(output)) {
+        fprintf(stderr, "%s: path too long\n", argv[1]);
+        return 1;
+    }
+    FILE *in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(in, 0, SEEK_END);
+    const long length = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    if (length < 0) {
+        perror(argv[1]);
+        fclose(in);
+        return 1;
+    }
+
+    afr_chunk_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = AFR_CHUNK_MAGIC;
+    header.version = AFR_CHUNK_VERSION;
+    header.block_size = AFR_CHUNK_BLOCK_SIZE;
+    header.size = (uint64_t)length;
+    header.blocks = (uint32_t)((header.size + AFR_CHUNK_BLOCK_SIZE - 1) / AFR_CHUNK_BLOCK_SIZE);
+    uint64_t *offset = (uint64_t *)calloc((size_t)header.blocks + 1, sizeof(*offset));
+    FILE *out = offset ? fopen(output, "wb") : NULL;
+    if (!out) {
+        perror(output);
+        fclose(in);
+        free(offset);
+        return 1;
+    }
+    // The table is written again once every block size is known.
+    offset[0] = sizeof(header) + ((uint64_t)header.blocks + 1) * sizeof(*offset);
+    int ret = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              fwrite(offset, sizeof(*offset), (size_t)header.blocks + 1, out) == (size_t)header.blocks + 1 ? 0 : -1;
+
+    static uint8_t raw[AFR_CHUNK_BLOCK_SIZE];
+    static uint8_t packed[AFR_CHUNK_BLOCK_SIZE];
+    static uint8_t check[AFR_CHUNK_BUFFER_SIZE];
+    for (uint32_t i = 0; i < header.blocks && ret == 0; i++) {
+        const uint64_t left = header.size - (uint64_t)i * AFR_CHUNK_BLOCK_SIZE;
+        const size_t size = left < AFR_CHUNK_BLOCK_SIZE ? (size_t)left : AFR_CHUNK_BLOCK_SIZE;
+        if (fread(raw, 1, size, in) != size) {
+            fprintf(stderr, "%s: changed while compressing\n", argv[1]);
+            ret = -1;
+            break;
+        }
+        // Only blocks that shrink and decode in place the way afr reads them are kept compressed.
+        size_t stored = lz4_encode(raw, size, packed, size - 1);
+        if (stored) {
+            memcpy(check + sizeof(check) - stored, packed, stored);
+            if (afr_lz4_decode(check + sizeof(check) - stored, stored, check, size) != (int64_t)size ||
+                memcmp(check, raw, size) != 0) {
+                stored = 0;
+            }
+        }
+        const uint8_t *data = stored ? packed : raw;
+        stored = stored ? stored : size;
+        ret = fwrite(data, 1, stored, out) == stored ? 0 : -1;
+        offset[i + 1] = offset[i] + stored;
+    }
+    if (ret == 0 && (fseek(out, sizeof(header), SEEK_SET) ||
+                     fwrite(offset, sizeof(*offset), (size_t)header.blocks + 1, out) != (size_t)header.blocks + 1)) {
+        ret = -1;
+    }
+    fclose(in);
+    if (fclose(out) || ret) {
+        fprintf(stderr, "%s: write failed\n", output);
+        remove(output);
+        free(offset);
+        return 1;
+    }
+    fprintf(stderr, "%s: %llu -> %llu bytes in %u block(s)\n", output, (unsigned long long)header.size,
+            (unsigned long long)offset[header.blocks], header.blocks);
+    free(offset);
+    return 0;
+}
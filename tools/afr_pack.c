@@ -0,0 +1,194 @@
+// afr_pack: Builds an afr pack file from an override folder.
+// Usage: afr_pack [-a align] <folder> <out.pack>
+// Copy the pack next to the folder it replaces, e.g. /data/GoldHEN/AFR/CUSA00001.pack
+// for /data/GoldHEN/AFR/CUSA00001. Files start on `align' bytes (default 4096) so
+// every read of a packed file begins on a sector of the pack.
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "afr_pack.h"
+
+typedef struct {
+    char *path; // relative to the folder
+    uint32_t hash;
+    uint32_t name;
+    uint64_t offset;
+    uint64_t size;
+} pack_file;
+
+static pack_file *g_Files;
+static size_t g_Count;
+static size_t g_Capacity;
+
+static int compare_file(const void *a, const void *b)
+{
+    const pack_file *fa = (const pack_file *)a;
+    const pack_file *fb = (const pack_file *)b;
+    if (fa->hash != fb->hash) {
+        return fa->hash < fb->hash ? -1 : 1;
+    }
+    return strcmp(fa->path, fb->path);
+}
+
+static int add_file(const char *rel, uint64_t size)
+{
+    if (g_Count == g_Capacity) {
+        g_Capacity = g_Capacity ? g_Capacity * 2 : 1024;
+        pack_file *files = (pack_file *)realloc(g_Files, g_Capacity * sizeof(*files));
+        if (!files) {
+            return -1;
+        }
+        g_Files = files;
+    }
+    pack_file *file = &g_Files[g_Count++];
+    file->path = strdup(rel);
+    file->hash = afr_pack_hash(rel);
+    file->size = size;
+    return file->path ? 0 : -1;
+}
+
+// `rel' is empty for the folder itself.
+static int walk(const char *root, const char *rel)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s%s%s", root, *rel ? "/" : "", rel);
+    DIR *dir = opendir(path);
+    if (!dir) {
+        perror(path);
+        return -1;
+    }
+    int ret = 0;
+    struct dirent *entry;
+    while (ret == 0 && (entry = readdir(dir))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char child[4096];
+        struct stat st;
+        if (snprintf(child, sizeof(child), "%s%s%s", rel, *rel ? "/" : "", entry->d_name) >= (int)sizeof(child) ||
+            snprintf(path, sizeof(path), "%s/%s", root, child) >= (int)sizeof(path)) {
+            fprintf(stderr, "%s/%s: path too long\n", root, rel);
+            ret = -1;
+        } else if (stat(path, &st)) {
+            perror(path);
+            ret = -1;
+        } else if (S_ISDIR(st.st_mode)) {
+            ret = walk(root, child);
+        } else if (S_ISREG(st.st_mode)) {
+            ret = add_file(child, (uint64_t)st.st_size);
+        }
+    }
+    closedir(dir);
+    return ret;
+}
+
+static int write_padding(FILE *out, uint64_t to)
+{
+    static const char zero[4096];
+    uint64_t at = (uint64_t)ftell(out);
+    while (at < to) {
+        const size_t n = to - at < sizeof(zero) ? (size_t)(to - at) : sizeof(zero);
+        if (fwrite(zero, 1, n, out) != n) {
+            return -1;
+        }
+        at += n;
+    }
+    return 0;
+}
+
+static int copy_file(FILE *out, const char *path, uint64_t size)
+{
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+    char buf[64 * 1024];
+    uint64_t left = size;
+    while (left) {
+        const size_t n = fread(buf, 1, left < sizeof(buf) ? (size_t)left : sizeof(buf), in);
+        if (!n || fwrite(buf, 1, n, out) != n) {
+            fprintf(stderr, "%s: changed while packing\n", path);
+            fclose(in);
+            return -1;
+        }
+        left -= n;
+    }
+    fclose(in);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t align = 4096;
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-a") == 0) {
+        align = (uint32_t)strtoul(argv[2], NULL, 0);
+        arg = 3;
+    }
+    if (argc - arg != 2 || !align || (align & (align - 1))) {
+        fprintf(stderr, "usage: %s [-a align] <folder> <out.pack>\n", argv[0]);
+        fprintf(stderr, "align must be a power of two\n");
+        return 1;
+    }
+    const char *root = argv[arg];
+    const char *output = argv[arg + 1];
+    if (walk(root, "")) {
+        return 1;
+    }
+    qsort(g_Files, g_Count, sizeof(*g_Files), compare_file);
+
+    afr_pack_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = AFR_PACK_MAGIC;
+    header.version = AFR_PACK_VERSION;
+    header.entries = (uint32_t)g_Count;
+    header.align = align;
+    header.names_offset = sizeof(header) + g_Count * sizeof(afr_pack_entry);
+    for (size_t i = 0; i < g_Count; i++) {
+        g_Files[i].name = (uint32_t)header.names_size;
+        header.names_size += strlen(g_Files[i].path) + 1;
+    }
+    uint64_t offset = (header.names_offset + header.names_size + align - 1) & ~(uint64_t)(align - 1);
+    header.data_offset = offset;
+    for (size_t i = 0; i < g_Count; i++) {
+        g_Files[i].offset = offset;
+        offset = (offset + g_Files[i].size + align - 1) & ~(uint64_t)(align - 1);
+    }
+
+    FILE *out = fopen(output, "wb");
+    if (!out) {
+        perror(output);
+        return 1;
+    }
+    int ret = fwrite(&header, sizeof(header), 1, out) == 1 ? 0 : -1;
+    for (size_t i = 0; i < g_Count && ret == 0; i++) {
+        afr_pack_entry entry = { g_Files[i].hash, g_Files[i].name, g_Files[i].offset, g_Files[i].size };
+        ret = fwrite(&entry, sizeof(entry), 1, out) == 1 ? 0 : -1;
+    }
+    for (size_t i = 0; i < g_Count && ret == 0; i++) {
+        ret = fwrite(g_Files[i].path, strlen(g_Files[i].path) + 1, 1, out) == 1 ? 0 : -1;
+    }
+    for (size_t i = 0; i < g_Count && ret == 0; i++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", root, g_Files[i].path);
+        ret = write_padding(out, g_Files[i].offset);
+        if (ret == 0) {
+            ret = copy_file(out, path, g_Files[i].size);
+        }
+    }
+    if (fclose(out) || ret) {
+        fprintf(stderr, "%s: write failed\n", output);
+        remove(output);
+        return 1;
+    }
+    fprintf(stderr, "%zu file(s) packed, aligned to %u\n", g_Count, align);
+    for (size_t i = 0; i < g_Count; i++) {
+        free(g_Files[i].path);
+    }
+    free(g_Files);
+    return 0;
+}
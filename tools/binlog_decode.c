@@ -0,0 +1,147 @@
+// binlog_decode: Converts a binary log written by common/binlog.c to text.
+// Usage: binlog_decode <file.binlog> [--sort]
+// Records from different rings are written in drain order, --sort orders them by timestamp.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "binlog.h"
+
+typedef struct {
+    char *fmt;
+    char *file;
+    uint32_t line;
+    uint8_t level;
+} decoded_site;
+
+typedef struct {
+    uint32_t id;
+    uint64_t time;
+    uint64_t thread;
+    uint8_t size;
+    uint8_t payload[256];
+} decoded_record;
+
+static const char *g_LevelNames[] = { "ERROR", "WARN", "INFO", "DEBUG", "TRACE" };
+
+static int read_exact(FILE *f, void *out, size_t size)
+{
+    return fread(out, 1, size, f) == size;
+}
+
+static int compare_time(const void *a, const void *b)
+{
+    const decoded_record *ra = (const decoded_record *)a;
+    const decoded_record *rb = (const decoded_record *)b;
+    return (ra->time > rb->time) - (ra->time < rb->time);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <file.binlog> [--sort]\n", argv[0]);
+        return 1;
+    }
+    const int sort = argc > 2 && strcmp(argv[2], "--sort") == 0;
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    binlog_file_header header;
+    if (!read_exact(f, &header, sizeof(header)) || header.magic != BINLOG_MAGIC) {
+        fprintf(stderr, "%s: not a binlog file\n", argv[1]);
+        fclose(f);
+        return 1;
+    }
+    if (header.version < 1 || header.version > BINLOG_VERSION) {
+        fprintf(stderr, "%s: unsupported version %u\n", argv[1], header.version);
+        fclose(f);
+        return 1;
+    }
+    const double frequency = header.frequency ? (double)header.frequency : 1.0;
+
+    decoded_site *sites = NULL;
+    uint32_t site_count = 0;
+    decoded_record *records = NULL;
+    size_t record_count = 0;
+    size_t record_cap = 0;
+    uint8_t kind = 0;
+
+    while (read_exact(f, &kind, sizeof(kind))) {
+        if (kind == BINLOG_ENTRY_SITE) {
+            uint32_t id = 0;
+            uint32_t line = 0;
+            uint8_t level = 0;
+            uint16_t fmt_len = 0;
+            uint16_t file_len = 0;
+            if (!read_exact(f, &id, sizeof(id)) || !read_exact(f, &line, sizeof(line)) ||
+                !read_exact(f, &level, sizeof(level)) || !read_exact(f, &fmt_len, sizeof(fmt_len)) ||
+                !read_exact(f, &file_len, sizeof(file_len))) {
+                break;
+            }
+            if (id >= site_count) {
+                sites = (decoded_site *)realloc(sites, (id + 1) * sizeof(*sites));
+                memset(sites + site_count, 0, (id + 1 - site_count) * sizeof(*sites));
+                site_count = id + 1;
+            }
+            decoded_site *site = &sites[id];
+            free(site->fmt);
+            free(site->file);
+            site->fmt = (char *)calloc(fmt_len + 1, 1);
+            site->file = (char *)calloc(file_len + 1, 1);
+            site->line = line;
+            site->level = level;
+            if (!read_exact(f, site->fmt, fmt_len) || !read_exact(f, site->file, file_len)) {
+                break;
+            }
+        } else if (kind == BINLOG_ENTRY_RECORD) {
+            if (record_count == record_cap) {
+                record_cap = record_cap ? record_cap * 2 : 1024;
+                records = (decoded_record *)realloc(records, record_cap * sizeof(*records));
+            }
+            decoded_record *r = &records[record_count];
+            if (!read_exact(f, &r->id, sizeof(r->id)) || !read_exact(f, &r->time, sizeof(r->time)) ||
+                !read_exact(f, &r->thread, sizeof(r->thread)) || !read_exact(f, &r->size, sizeof(r->size)) ||
+                !read_exact(f, r->payload, r->size)) {
+                break;
+            }
+            record_count++;
+        } else {
+            fprintf(stderr, "%s: unknown entry 0x%02x at offset %ld\n", argv[1], kind, ftell(f) - 1);
+            break;
+        }
+    }
+    fclose(f);
+
+    if (sort) {
+        qsort(records, record_count, sizeof(*records), compare_time);
+    }
+
+    char text[1024];
+    for (size_t i = 0; i < record_count; i++) {
+        const decoded_record *r = &records[i];
+        if (r->id >= site_count || !sites[r->id].fmt) {
+            printf("[%14.6f] [0x%016llx] <unknown site %u>\n", r->time / frequency,
+                   (unsigned long long)r->thread, r->id);
+            continue;
+        }
+        const decoded_site *site = &sites[r->id];
+        binlog_format(site->fmt, r->payload, r->size, text, sizeof(text));
+        printf("[%14.6f] [0x%016llx] %-5s (%s:%u) %s", r->time / frequency, (unsigned long long)r->thread,
+               site->level < 5 ? g_LevelNames[site->level] : "?", site->file, site->line, text);
+        const size_t len = strlen(text);
+        if (!len || text[len - 1] != '\n') {
+            putchar('\n');
+        }
+    }
+
+    for (uint32_t i = 0; i < site_count; i++) {
+        free(sites[i].fmt);
+        free(sites[i].file);
+    }
+    free(sites);
+    free(records);
+    return 0;
+}
@@ -0,0 +1,144 @@
+// frame_csv: Converts frame captures written by frame_logger to CSV.
+// Usage: frame_csv <file.frames> > out.csv
+// The output has the frame times in the format CapFrameX reads, the same frame_logger
+// wrote before it recorded raw counter stamps. The first frame time is measured from
+// the start of the recording. Version 2 captures add the time from submit until the flip
+// was shown, empty when the capture has no completion for it, and the present entry point.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_capture.h"
+
+// Completions are looked up this many records after the flip, enough for a full flip queue.
+#define COMPLETION_LOOKAHEAD 16
+
+static const char *const g_PathNames[FRAME_PATH_COUNT] = {
+    "sceGnmSubmitAndFlipCommandBuffers",
+    "sceGnmSubmitAndFlipCommandBuffersForWorkload",
+    "sceVideoOutSubmitFlip",
+};
+
+static int read_record(FILE *f, uint32_t version, frame_record *record)
+{
+    memset(record, 0, sizeof(*record));
+    if (version == 1) {
+        struct {
+            uint64_t time;
+            uint32_t handle;
+            uint8_t buffer_index;
+            uint8_t flip_mode;
+            uint16_t reserved;
+        } v1;
+        if (fread(&v1, sizeof(v1), 1, f) != 1) {
+            return 0;
+        }
+        record->time = v1.time;
+        record->handle = v1.handle;
+        record->buffer_index = v1.buffer_index;
+        record->flip_mode = v1.flip_mode;
+        return 1;
+    }
+    return fread(record, sizeof(*record), 1, f) == 1;
+}
+
+// Process time in microseconds flip `index' was shown at, 0 when the capture does not say.
+static uint64_t completion_us(const frame_record *records, uint64_t count, uint64_t index)
+{
+    const frame_record *record = &records[index];
+    if (!record->flip) {
+        return 0;
+    }
+    for (uint64_t i = index + 1; i < count && i <= index + COMPLETION_LOOKAHEAD; i++) {
+        if (records[i].handle == record->handle && records[i].completed == record->flip) {
+            return records[i].completed_us;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <file.frames> > out.csv\n", argv[0]);
+        return 1;
+    }
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    frame_capture_header header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != FRAME_CAPTURE_MAGIC ||
+        header.version < 1 || header.version > FRAME_CAPTURE_VERSION || !header.frequency) {
+        fprintf(stderr, "%s: not a frame capture\n", argv[1]);
+        fclose(f);
+        return 1;
+    }
+    // Captures that were never stopped run to the end of the file.
+    if (!header.frames) {
+        fprintf(stderr, "%s: recording was not stopped, reading every frame in the file\n", argv[1]);
+    }
+    uint64_t frames = 0;
+    uint64_t capacity = header.frames ? header.frames : 4096;
+    frame_record *records = malloc(capacity * sizeof(*records));
+    while (records && (!header.frames || frames < header.frames) && read_record(f, header.version, &records[frames])) {
+        if (++frames == capacity) {
+            capacity *= 2;
+            frame_record *grown = realloc(records, capacity * sizeof(*records));
+            if (!grown) {
+                free(records);
+            }
+            records = grown;
+        }
+    }
+    fclose(f);
+    if (!records) {
+        fprintf(stderr, "%s: out of memory\n", argv[1]);
+        return 1;
+    }
+
+    const double frequency = (double)header.frequency;
+    if (header.version == 1) {
+        printf("//Ignore=true\n"
+               "TimeInSeconds,msBetweenPresents\n");
+    } else {
+        printf("//Ignore=true\n"
+               "TimeInSeconds,msBetweenPresents,msUntilDisplayed,Runtime\n");
+    }
+    uint64_t previous = header.start_time;
+    for (uint64_t i = 0; i < frames; i++) {
+        const frame_record *record = &records[i];
+        printf("%lf,%lf", (record->time - header.start_time) / frequency, (record->time - previous) * 1000.0 / frequency);
+        previous = record->time;
+        if (header.version == 1) {
+            printf("\n");
+            continue;
+        }
+        const uint64_t shown_us = completion_us(records, frames, i);
+        // whole microseconds like the flip status
+        const uint64_t submit_us = (uint64_t)(record->time * 1000000.0 / frequency);
+        if (shown_us && shown_us >= submit_us) {
+            printf(",%lf", (shown_us - submit_us) / 1000.0);
+        } else {
+            printf(",");
+        }
+        printf(",%s\n", record->path < FRAME_PATH_COUNT ? g_PathNames[record->path] : "unknown");
+    }
+    free(records);
+    if (header.frames && frames != header.frames) {
+        fprintf(stderr, "%s: truncated, %lu of %lu frame(s)\n", argv[1], (unsigned long)frames,
+                (unsigned long)header.frames);
+        return 1;
+    }
+    if (header.trigger) {
+        static const char *const triggers[FRAME_TRIGGER_COUNT] = { "", "frame time", "p99 frame time", "hotkey" };
+        fprintf(stderr, "%s: triggered by %s at %lf s\n", argv[1],
+                header.trigger < FRAME_TRIGGER_COUNT ? triggers[header.trigger] : "unknown",
+                (header.trigger_time - header.start_time) / frequency);
+    }
+    if (header.dropped) {
+        fprintf(stderr, "%s: %lu frame(s) dropped, the ring was full or two threads flipped at once\n", argv[1], (unsigned long)header.dropped);
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+// telemetry_csv: Converts a telemetry snapshot file written by plugin_loader to CSV.
+// Usage: telemetry_csv <file.bin> [out.csv]
+// One row per metric per snapshot. Counters and gauges fill `value', histograms fill
+// `value' (sum), `count', `mean' and bucket based `p50'/`p99'.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "telemetry.h"
+
+typedef struct {
+    int defined;
+    uint8_t type;
+    char owner[TELEMETRY_NAME_MAX + 1];
+    char name[TELEMETRY_NAME_MAX + 1];
+} decoded_slot;
+
+static const char *g_TypeNames[] = { "?", "counter", "gauge", "histogram" };
+
+static int read_exact(FILE *f, void *out, size_t size)
+{
+    return fread(out, 1, size, f) == size;
+}
+
+// Upper bound of the bucket holding the given percentile.
+static uint64_t percentile(const uint64_t *bucket, uint64_t count, uint32_t percent)
+{
+    const uint64_t target = (count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < TELEMETRY_BUCKETS; i++) {
+        seen += bucket[i];
+        if (seen && seen >= target) {
+            return i ? (1ull << i) - 1 : 0;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <file.bin> [out.csv]\n", argv[0]);
+        return 1;
+    }
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        perror(argv[2]);
+        fclose(f);
+        return 1;
+    }
+
+    telemetry_file_header header;
+    if (!read_exact(f, &header, sizeof(header)) || header.magic != TELEMETRY_FILE_MAGIC ||
+        header.version != TELEMETRY_VERSION) {
+        fprintf(stderr, "%s: not a telemetry file\n", argv[1]);
+        fclose(f);
+        return 1;
+    }
+    const double frequency = header.frequency ? (double)header.frequency : 1.0;
+
+    static decoded_slot slots[TELEMETRY_SLOTS];
+    uint64_t start = 0;
+    uint8_t kind = 0;
+    fprintf(out, "time_s,owner,metric,type,value,count,mean,p50,p99\n");
+
+    while (read_exact(f, &kind, sizeof(kind))) {
+        if (kind == TELEMETRY_ENTRY_SLOT) {
+            uint16_t index = 0;
+            uint8_t type = 0;
+            char owner[TELEMETRY_NAME_MAX];
+            char name[TELEMETRY_NAME_MAX];
+            if (!read_exact(f, &index, sizeof(index)) || !read_exact(f, &type, sizeof(type)) ||
+                !read_exact(f, owner, sizeof(owner)) || !read_exact(f, name, sizeof(name)) ||
+                index >= TELEMETRY_SLOTS) {
+                break;
+            }
+            slots[index].defined = 1;
+            slots[index].type = type;
+            memcpy(slots[index].owner, owner, sizeof(owner));
+            memcpy(slots[index].name, name, sizeof(name));
+        } else if (kind == TELEMETRY_ENTRY_SNAPSHOT) {
+            uint64_t time = 0;
+            uint16_t count = 0;
+            if (!read_exact(f, &time, sizeof(time)) || !read_exact(f, &count, sizeof(count))) {
+                break;
+            }
+            if (!start) {
+                start = time;
+            }
+            const double time_s = (time - start) / frequency;
+            for (uint16_t i = 0; i < count; i++) {
+                uint16_t index = 0;
+                uint64_t value = 0;
+                uint64_t samples = 0;
+                uint64_t bucket[TELEMETRY_BUCKETS] = {0};
+                if (!read_exact(f, &index, sizeof(index)) || !read_exact(f, &value, sizeof(value)) ||
+                    !read_exact(f, &samples, sizeof(samples)) || index >= TELEMETRY_SLOTS ||
+                    !slots[index].defined) {
+                    fprintf(stderr, "%s: corrupt snapshot\n", argv[1]);
+                    goto done;
+                }
+                const decoded_slot *slot = &slots[index];
+                const char *type = slot->type <= TELEMETRY_HISTOGRAM ? g_TypeNames[slot->type] : "?";
+                if (slot->type == TELEMETRY_HISTOGRAM) {
+                    if (!read_exact(f, bucket, sizeof(bucket))) {
+                        goto done;
+                    }
+                    fprintf(out, "%.3f,%s,%s,%s,%llu,%llu,%.3f,%llu,%llu\n", time_s, slot->owner, slot->name, type,
+                            (unsigned long long)value, (unsigned long long)samples,
+                            samples ? (double)value / samples : 0.0,
+                            (unsigned long long)percentile(bucket, samples, 50),
+                            (unsigned long long)percentile(bucket, samples, 99));
+                } else if (slot->type == TELEMETRY_GAUGE) {
+                    fprintf(out, "%.3f,%s,%s,%s,%lld,,,,\n", time_s, slot->owner, slot->name, type, (long long)value);
+                } else {
+                    fprintf(out, "%.3f,%s,%s,%s,%llu,,,,\n", time_s, slot->owner, slot->name, type,
+                            (unsigned long long)value);
+                }
+            }
+        } else {
+            fprintf(stderr, "%s: unknown entry 0x%02x at offset %ld\n", argv[1], kind, ftell(f) - 1);
+            break;
+        }
+    }
+
+done:
+    fclose(f);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
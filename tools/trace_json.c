@@ -0,0 +1,159 @@
+// trace_json: Converts trace files written by common/trace.c to Chrome trace JSON.
+// Usage: trace_json <file.trace> [file.trace...] > out.json
+// Open the output in chrome://tracing or ui.perfetto.dev. Files of several plugins are
+// merged on one timeline, their events share the thread ids of the game process and
+// carry the plugin name as category. End events whose begin was overwritten in the
+// ring are skipped, scopes open when the game crashed are left unterminated.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+typedef struct {
+    uint64_t time;
+    uint64_t thread;
+    uint64_t order;
+    const trace_file_header *header;
+    trace_event event;
+} decoded_event;
+
+static int compare_event(const void *a, const void *b)
+{
+    const decoded_event *ea = (const decoded_event *)a;
+    const decoded_event *eb = (const decoded_event *)b;
+    if (ea->time != eb->time) {
+        return (ea->time > eb->time) - (ea->time < eb->time);
+    }
+    return (ea->order > eb->order) - (ea->order < eb->order);
+}
+
+static void write_string(const char *s, size_t max)
+{
+    putchar('"');
+    for (size_t i = 0; i < max && s[i]; i++) {
+        const unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            printf("\\%c", c);
+        } else if (c < 0x20) {
+            printf("\\u%04x", c);
+        } else {
+            putchar(c);
+        }
+    }
+    putchar('"');
+}
+
+static trace_file_header *read_trace(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    trace_file_header *header = NULL;
+    if (size >= (long)sizeof(trace_file_header)) {
+        header = (trace_file_header *)malloc(size);
+    }
+    if (!header || fread(header, 1, size, f) != (size_t)size || header->magic != TRACE_MAGIC ||
+        header->version != TRACE_VERSION || header->threads > TRACE_THREADS ||
+        header->ring_events != TRACE_RING_EVENTS || header->names > TRACE_NAMES ||
+        (size_t)size < sizeof(trace_file_header) + sizeof(trace_ring) * header->threads) {
+        fprintf(stderr, "%s: not a trace file\n", path);
+        free(header);
+        header = NULL;
+    }
+    fclose(f);
+    return header;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <file.trace> [file.trace...] > out.json\n", argv[0]);
+        return 1;
+    }
+    const int files = argc - 1;
+    trace_file_header **header = (trace_file_header **)calloc(files, sizeof(*header));
+    decoded_event *events = (decoded_event *)malloc(sizeof(decoded_event) * files * TRACE_THREADS * TRACE_RING_EVENTS);
+    if (!header || !events) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    size_t count = 0;
+    uint64_t start = 0;
+    for (int i = 0; i < files; i++) {
+        header[i] = read_trace(argv[i + 1]);
+        if (!header[i]) {
+            continue;
+        }
+        if (!start || header[i]->start_time < start) {
+            start = header[i]->start_time;
+        }
+        if (header[i]->dropped) {
+            fprintf(stderr, "%s: %u event(s) dropped, more than %u threads traced\n", argv[i + 1],
+                    header[i]->dropped, TRACE_THREADS);
+        }
+        const trace_ring *ring = (const trace_ring *)(header[i] + 1);
+        for (uint32_t r = 0; r < header[i]->threads; r++) {
+            if (!ring[r].thread) {
+                continue;
+            }
+            const uint64_t head = ring[r].head;
+            const uint64_t first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+            uint32_t depth = 0;
+            for (uint64_t e = first; e < head; e++) {
+                const trace_event *event = &ring[r].event[e & (TRACE_RING_EVENTS - 1)];
+                if (event->name >= header[i]->names) {
+                    continue;
+                }
+                if (event->phase == TRACE_PHASE_BEGIN) {
+                    depth++;
+                } else if (event->phase == TRACE_PHASE_END) {
+                    if (!depth) {
+                        continue;
+                    }
+                    depth--;
+                }
+                decoded_event *out = &events[count];
+                out->time = event->time;
+                out->thread = ring[r].thread;
+                out->order = count;
+                out->header = header[i];
+                out->event = *event;
+                count++;
+            }
+        }
+    }
+    qsort(events, count, sizeof(*events), compare_event);
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    printf("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"game\"}}");
+    for (size_t i = 0; i < count; i++) {
+        const decoded_event *e = &events[i];
+        const double frequency = e->header->frequency ? (double)e->header->frequency : 1.0;
+        printf(",\n{\"name\":");
+        write_string(e->header->name[e->event.name], TRACE_NAME_MAX);
+        printf(",\"cat\":");
+        write_string(e->header->plugin, TRACE_NAME_MAX);
+        printf(",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%llu", e->event.phase,
+               (double)(e->time - start) * 1e6 / frequency, (unsigned long long)e->thread);
+        if (e->event.phase == TRACE_PHASE_INSTANT) {
+            printf(",\"s\":\"t\",\"args\":{\"arg\":%u}", e->event.arg);
+        }
+        putchar('}');
+    }
+    printf("\n]}\n");
+
+    fprintf(stderr, "%zu event(s) from %d file(s)\n", count, files);
+    for (int i = 0; i < files; i++) {
+        free(header[i]);
+    }
+    free(header);
+    free(events);
+    return 0;
+}